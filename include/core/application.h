@@ -21,8 +21,15 @@
 #include "core/resourcer.h"
 #include "core/timer.h"
 #include "core/utils.h"
+#include "graphics/recorder.h"
+#include "graphics/timelapse.h"
 #include "graphics/window.h"
 
+/**
+ * \desc The directory recordings of the window are written to.
+ */
+#define APPLICATION_CAPTURE_DIR "./captures"
+
 /**
  * \brief Holds pointers to systems and timing data.
  *
@@ -34,17 +41,19 @@
  */
 typedef struct [[nodiscard]]
 {
-    u64 frames;         /**< The number of passed frames. */
-    f64 fps;            /**< The current frames-per-second. */
-    f64 dt;             /**< Time between frames. */
-    f64 exec_time;      /**< Total execution time. */
-    bool running;       /**< Running flag. */
-    Editor* editor;     /**< Main editor object. */
-    Input* input;       /**< Input handler to poll event. */
-    Timer* fps_timer;   /**< Timer to calculate frames-per-second. */
-    Timer* limit_timer; /**< Timer to limit the frames-per-second. */
-    Resourcer* res;     /**< Main program resource handler. */
-    Window* wind;       /**< Main rendering window. */
+    u64 frames;              /**< The number of passed frames. */
+    f64 fps;                 /**< The current frames-per-second. */
+    f64 dt;                  /**< Time between frames. */
+    f64 exec_time;           /**< Total execution time. */
+    bool running;            /**< Running flag. */
+    Editor* editor;          /**< Main editor object. */
+    Input* input;            /**< Input handler to poll event. */
+    Timer* fps_timer;        /**< Timer to calculate frames-per-second. */
+    Timer* limit_timer;      /**< Timer to limit the frames-per-second. */
+    Resourcer* res;          /**< Main program resource handler. */
+    Window* wind;            /**< Main rendering window. */
+    Recorder* recorder;      /**< Recording of the window, if one is running. */
+    TimelapseJob* timelapse; /**< Timelapse being rendered, if any. */
 } Application;
 
 /**
@@ -74,6 +83,24 @@ void ApplicationRun(Application* app);
  */
 void ApplicationHandleInput(Application* app);
 
+/**
+ * \brief Starts recording the window to a new file of the capture directory,
+ * or stops the recording which is running.
+ * \param [in, out] app The corresponding application.
+ * \param [in] format The format to record in.
+ * \returns Void.
+ */
+void ApplicationToggleRecording(Application* app, RecorderFormat format);
+
+/**
+ * \brief Starts rendering a timelapse of the session of the active document
+ * to a new file of the capture directory, in the background.
+ * \param [in, out] app The corresponding application.
+ * \param [in] format The format to render in.
+ * \returns Whether the timelapse was started.
+ */
+bool ApplicationRenderTimelapse(Application* app, RecorderFormat format);
+
 /**
  * \brief Updates the systems of the application.
  * \param [in, out] app The corresponding application.
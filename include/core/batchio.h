@@ -0,0 +1,78 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file batchio.h
+ *
+ * \brief Batched file I/O reads or writes many whole files at once, keeping
+ * many of them in flight so that a directory of files is limited by the disk
+ * rather than by waiting on each call in turn. On Linux the files are read and
+ * written through io_uring, and elsewhere, or where io_uring is not allowed,
+ * by a pool of threads.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef BATCHIO_H
+#define BATCHIO_H
+
+#include "core/common.h"
+#include "core/utils.h"
+
+/**
+ * \desc Whether io_uring can be used, which needs the kernel header for its
+ * structures and a kernel which opens, reads and closes files through it.
+ */
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS)
+#define BATCHIO_URING 1
+#else
+#define BATCHIO_URING 0
+#endif
+
+/**
+ * \desc The most files in flight at once, which is also the size of the ring.
+ */
+#define BATCHIO_DEPTH 64
+
+/**
+ * \desc The number of threads reading and writing files when io_uring cannot
+ * be used.
+ */
+#define BATCHIO_WORKERS 8
+
+/**
+ * \brief Describes whether a file of a batch is read or written.
+ */
+typedef enum
+{
+    BATCHIO_READ, /**< Read the whole file into a new buffer. */
+    BATCHIO_WRITE /**< Replace the file with the buffer. */
+} BatchIoKind;
+
+/**
+ * \brief A file to read or write as part of a batch.
+ *
+ * The buffer of a file which is read is allocated by the batch and is to be
+ * freed by the caller, but only if the file was read.
+ */
+typedef struct [[nodiscard]]
+{
+    BatchIoKind kind; /**< Whether the file is read or written. */
+    const char* path; /**< Path of the file. */
+    u8* data;         /**< Contents read, or to be written. */
+    size_t size;      /**< Size of the contents in bytes. */
+    bool ok;          /**< Whether the file was read or written. */
+} BatchIoRequest;
+
+/**
+ * \brief Reads and writes a batch of files, in no particular order, and
+ * returns once every one is done.
+ * \param [in, out] requests The files to read or write.
+ * \param [in] count The number of files.
+ * \returns Whether every file was read or written.
+ */
+bool BatchIoRun(BatchIoRequest* requests, size_t count);
+
+#endif
@@ -0,0 +1,79 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file document.h
+ *
+ * \brief A document is a single map open in the editor. Each document owns its
+ * canvas, along with the cached canvas texture and the undo history, so that
+ * switching between documents does not reload or redraw anything.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include "core/common.h"
+#include "core/history.h"
+#include "core/journal.h"
+#include "core/mapfile.h"
+#include "core/pack.h"
+#include "core/utils.h"
+#include "graphics/glyph.h"
+#include "memory/vector.h"
+#include "ui/canvas.h"
+
+/**
+ * \desc The maximum length of a document name.
+ */
+#define DOCUMENT_MAX_NAME 64
+
+/**
+ * \desc The maximum length of the path a document is saved to.
+ */
+#define DOCUMENT_MAX_PATH 512
+
+/**
+ * \brief An open map with its own canvas and history.
+ *
+ * Tilesets are not owned by a document: every document is rendered from the
+ * textures held by the resourcer. A document which has been loaded or saved
+ * keeps the path of its map file.
+ */
+typedef struct [[nodiscard]]
+{
+    char name[DOCUMENT_MAX_NAME]; /**< Name shown for the document. */
+    char path[DOCUMENT_MAX_PATH]; /**< Path of its map file, if it has one. */
+    Canvas* canvas;               /**< The cells of the map. */
+    History* history;             /**< Undo history of the canvas. */
+    Journal* journal;             /**< Every change made this session. */
+} Document;
+
+/**
+ * \brief Creates a document with a copy of a template canvas.
+ * \param [in] name The name of the document.
+ * \param [in, out] base The canvas whose dimensions and cells are copied.
+ * \returns Pointer to a document object.
+ */
+[[nodiscard]] Document* DocumentCreate(const char* name, Canvas* base);
+
+/**
+ * \brief Creates a document from a map file, or from a map within a pack.
+ * \param [in] path The path of the map file, or of the map within a pack.
+ * \param [in, out] base The canvas whose settings are copied.
+ * \returns Pointer to a document object, or NULL if the map could not be
+ * loaded.
+ */
+[[nodiscard]] Document* DocumentLoad(const char* path, Canvas* base);
+
+/**
+ * \brief Frees the document memory, including its canvas and history.
+ * \param [in, out] doc The document to be freed.
+ * \returns Void.
+ */
+void DocumentFree(Document* doc);
+
+#endif
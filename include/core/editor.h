@@ -16,28 +16,105 @@
 #define EDITOR_H
 
 #include "core/common.h"
+#include "core/document.h"
 #include "core/input.h"
+#include "core/macro.h"
+#include "core/mapexport.h"
+#include "core/mapfile.h"
+#include "core/mapindex.h"
 #include "core/resourcer.h"
 #include "core/utils.h"
+#include "graphics/brush.h"
 #include "graphics/glyph.h"
+#include "graphics/gradient.h"
 #include "graphics/texture.h"
+#include "graphics/tileatlas.h"
 #include "graphics/window.h"
+#include "memory/compressor.h"
 #include "memory/hashmap.h"
 #include "memory/vector.h"
+#include "ui/browser.h"
 #include "ui/interface.h"
+#include "ui/view.h"
+
+/**
+ * \desc The maximum number of panes the drawing area may be split into.
+ */
+#define EDITOR_MAX_PANES 3
+
+/**
+ * \desc The project directory documents are saved to as map files.
+ */
+#define EDITOR_PROJECT_DIR "./maps"
+
+/**
+ * \desc The directory within the project directory thumbnails are cached in.
+ */
+#define EDITOR_THUMB_DIR EDITOR_PROJECT_DIR "/.thumbs"
+
+/**
+ * \desc The directory recorded macros are saved to.
+ */
+#define EDITOR_MACRO_DIR "./macros"
+
+/**
+ * \desc The tileset the editor draws with.
+ */
+#define EDITOR_TILESET "boxy_16x16"
+
+/**
+ * \desc The directory documents are exported to as pages, images and tile
+ * maps.
+ */
+#define EDITOR_EXPORT_DIR "./exports"
 
 /**
  * \brief Stores data pertaining to the editor state.
  *
  * The editor is where most of the program input is processed and fed back to
  * the user. The editor contains a UI where the input from the user is taken and
- * fed back appropriately.
+ * fed back appropriately. Several documents may be open at once; the canvas of
+ * the active document is the one shown by the interface. The canvas created by
+ * the interface layout serves as the template for new documents. The cells of
+ * every document are registered with a background compressor, which shrinks
+ * the chunks that have not been used for a while. The drawing area may be split
+ * into side by side panes: the first is the canvas itself, and the others are
+ * views onto the same canvas. The minimap of the interface, if it has one,
+ * always shows the active document. Animated tiles may be previewed on the
+ * active document. Glyphs are placed and erased with a brush of a chosen shape
+ * and size, which is shared by every document. Selections may be kept as
+ * stamps in the stamp library of the interface, and placed on any document.
+ * In place of glyphs, a gradient may be filled across the selection.
+ * Documents are saved as map files in the project directory, whose maps are
+ * indexed in the background so that they can be searched by glyph and colour.
+ * Maps are loaded by picking them in the file browser of the interface, and
+ * may be exported as pages, images and trimmed tile maps to the export
+ * directory.
+ * The tools used on the active document may be recorded as a macro, which is
+ * saved to the macro directory and may be played onto any document.
  */
 typedef struct [[nodiscard]]
 {
-    bool visible;    /**< Visible components flag. */
-    Interface* itfc; /**< The user interface. */
-    Texture* tex;    /**< Texture for the glyphs. */
+    bool visible;           /**< Visible components flag. */
+    Interface* itfc;        /**< The user interface. */
+    Texture* tex;           /**< Texture for the glyphs. */
+    Vector* documents;      /**< The open documents. */
+    size_t active;          /**< Index of the active document. */
+    Canvas* base;           /**< Template canvas for new documents. */
+    u32 next_document;      /**< Number used to name the next new document. */
+    Compressor* compressor; /**< Compresses cold chunks of the documents. */
+    Vector* views;          /**< Panes beside the canvas of the document. */
+    Minimap* minimap;       /**< Minimap of the active document, if any. */
+    Animations* animations; /**< Animated tile types, if any were loaded. */
+    bool animate;           /**< Whether the animations are previewed. */
+    Brush* brush;           /**< Brush glyphs are placed and erased with. */
+    StampLibrary* stamps;   /**< Stamp library of the interface, if any. */
+    Gradient gradient;      /**< Gradient filled in place of glyphs. */
+    bool filling;           /**< Whether the gradient is filled. */
+    MapIndexer* indexer;    /**< Indexes the maps of the project directory. */
+    Browser* browser;       /**< File browser of the interface, if any. */
+    Macro* macro;           /**< Macro last recorded, if any. */
+    bool recording;         /**< Whether the macro is being recorded. */
 } Editor;
 
 /**
@@ -55,6 +132,104 @@ typedef struct [[nodiscard]]
  */
 void EditorFree(Editor* editor);
 
+/**
+ * \brief Opens a new, blank document and makes it the active one.
+ * \param [in, out] editor The editor to open the document in.
+ * \returns Pointer to the new document.
+ */
+Document* EditorNewDocument(Editor* editor);
+
+/**
+ * \brief Closes the active document, unless it is the only one open.
+ * \param [in, out] editor The editor to close the document of.
+ * \returns Void.
+ */
+void EditorCloseDocument(Editor* editor);
+
+/**
+ * \brief Makes another open document the active one.
+ * \param [in, out] editor The editor to switch the document of.
+ * \param [in] index The index of the document to switch to.
+ * \returns Void.
+ */
+void EditorSwitchDocument(Editor* editor, size_t index);
+
+/**
+ * \brief Opens a map file as a new document and makes it the active one.
+ * \param [in, out] editor The editor to open the document in.
+ * \param [in] path The path of the map file.
+ * \returns Pointer to the new document, or NULL if the map could not be loaded.
+ */
+Document* EditorOpenDocument(Editor* editor, const char* path);
+
+/**
+ * \brief Saves the active document to its map file, or else as a map file in
+ * the project directory named after the document.
+ * \param [in, out] editor The editor to save the document of.
+ * \returns Whether the document was saved.
+ */
+bool EditorSaveDocument(Editor* editor);
+
+/**
+ * \brief Exports the active document to the export directory, as an HTML page,
+ * an SVG image and a tile map with an atlas of the tiles it uses, each named
+ * after the document.
+ * \param [in, out] editor The editor to export the document of.
+ * \returns Whether every export was written.
+ */
+bool EditorExportDocument(Editor* editor);
+
+/**
+ * \brief Splits the drawing area into a number of side by side panes.
+ * \param [in, out] editor The editor to split the drawing area of.
+ * \param [in] panes The number of panes, from 1 to EDITOR_MAX_PANES.
+ * \returns Void.
+ */
+void EditorSplitView(Editor* editor, size_t panes);
+
+/**
+ * \brief Replaces the brush glyphs are placed and erased with.
+ * \param [in, out] editor The editor to set the brush of.
+ * \param [in] shape The shape of the brush. A custom brush takes the shape of
+ * the selected stamp, if there is one, and is otherwise round.
+ * \param [in] radius The radius of the brush, unused by custom brushes.
+ * \returns Void.
+ */
+void EditorSetBrush(Editor* editor, BrushShape shape, i32 radius);
+
+/**
+ * \brief Sets the gradient filled in place of glyphs.
+ * \param [in, out] editor The editor to set the gradient of.
+ * \param [in] filling Whether the gradient is filled, or glyphs placed.
+ * \param [in] type The shape of the gradient.
+ * \param [in] targets The parts of each cell filled.
+ * \returns Void.
+ */
+void EditorSetGradient(Editor* editor, bool filling, GradientType type,
+                       u8 targets);
+
+/**
+ * \brief Keeps the selection of the active document as a new stamp.
+ * \param [in, out] editor The editor to add the stamp to.
+ * \returns Whether a stamp was added.
+ */
+bool EditorKeepSelection(Editor* editor);
+
+/**
+ * \brief Starts recording a new macro of the tools used on the active
+ * document, or stops recording and saves the macro to the macro directory.
+ * \param [in, out] editor The editor to record the macro of.
+ * \returns Whether a macro is being recorded afterwards.
+ */
+bool EditorRecordMacro(Editor* editor);
+
+/**
+ * \brief Plays the macro last recorded onto the active document.
+ * \param [in, out] editor The editor whose macro is played.
+ * \returns The number of cells changed by the macro.
+ */
+size_t EditorPlayMacro(Editor* editor);
+
 /**
  * \brief Deals with editor input.
  * \param [in, out] editor The editor to be freed.
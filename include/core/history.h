@@ -0,0 +1,133 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file history.h
+ *
+ * \brief The history of a document records the cell edits made to its canvas,
+ * and the transforms of the whole canvas, so that they can be undone and
+ * redone.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "graphics/glyph.h"
+#include "graphics/transform.h"
+#include "memory/vector.h"
+
+/**
+ * \desc The number of entries kept before the oldest entry is discarded.
+ */
+#define HISTORY_MAX_ENTRIES 256
+
+/**
+ * \brief A single cell edit of a canvas.
+ */
+typedef struct [[nodiscard]]
+{
+    size_t index; /**< Index of the edited canvas cell. */
+    Cell before;  /**< The cell before the edit. */
+    Cell after;   /**< The cell after the edit. */
+} HistoryEdit;
+
+/**
+ * \brief A set of edits which are undone and redone together.
+ *
+ * An entry holds every edit of a single stroke, i.e. all of the glyphs placed
+ * or erased whilst a mouse button was held. The edits are stored contiguously.
+ * Whilst the entry is being recorded, an open-addressed table maps each cell
+ * to its edit, so that a stroke of a large brush is coalesced in linear time.
+ * An entry which transforms the whole canvas holds the transform alone, as the
+ * inverse transform restores every cell.
+ */
+typedef struct [[nodiscard]]
+{
+    HistoryEdit* edits;      /**< The edits in the order they were made. */
+    size_t count;            /**< Number of edits. */
+    size_t capacity;         /**< Number of edits allocated. */
+    size_t* lookup;          /**< One more than the edit of each slot, or 0. */
+    size_t num_slots;        /**< Number of slots, a power of two. */
+    TransformType transform; /**< Transform of the whole canvas, if any. */
+} HistoryEntry;
+
+/**
+ * \brief An undo and redo stack of history entries.
+ *
+ * Entries before the position have been applied and may be undone; entries at
+ * or after it have been undone and may be redone. Recording a new edit discards
+ * the entries which could be redone.
+ */
+typedef struct [[nodiscard]]
+{
+    Vector* entries;    /**< Committed entries, oldest first. */
+    size_t position;    /**< Number of applied entries. */
+    HistoryEntry* open; /**< The entry being recorded, if any. */
+} History;
+
+/**
+ * \brief Creates an empty history.
+ * \returns Pointer to a history object.
+ */
+[[nodiscard]] History* HistoryCreate(void);
+
+/**
+ * \brief Frees the history memory, including every entry.
+ * \param [in, out] history The history to be freed.
+ * \returns Void.
+ */
+void HistoryFree(History* history);
+
+/**
+ * \brief Records an edit into the open entry, opening one if required.
+ * \param [in, out] history The history to record into.
+ * \param [in] index The index of the edited canvas cell.
+ * \param [in] before The cell before the edit.
+ * \param [in] after The cell after the edit.
+ * \returns Void.
+ */
+void HistoryRecord(History* history, size_t index, Cell before, Cell after);
+
+/**
+ * \brief Records a transform of the whole canvas as an entry of its own.
+ * \param [in, out] history The history to record into.
+ * \param [in] type The transform which was applied.
+ * \returns Void.
+ */
+void HistoryRecordTransform(History* history, TransformType type);
+
+/**
+ * \brief Closes the open entry, if any, so that it can be undone.
+ * \param [in, out] history The history to commit.
+ * \returns Void.
+ */
+void HistoryCommit(History* history);
+
+/**
+ * \brief Discards every entry, including the open one.
+ * \param [in, out] history The history to clear.
+ * \returns Void.
+ */
+void HistoryClear(History* history);
+
+/**
+ * \brief Steps back over the last applied entry.
+ * \param [in, out] history The history to undo from.
+ * \returns The entry whose edits should be reverted, or NULL if there is none.
+ */
+[[nodiscard]] const HistoryEntry* HistoryUndo(History* history);
+
+/**
+ * \brief Steps forward over the next undone entry.
+ * \param [in, out] history The history to redo from.
+ * \returns The entry whose edits should be reapplied, or NULL if there is none.
+ */
+[[nodiscard]] const HistoryEntry* HistoryRedo(History* history);
+
+#endif
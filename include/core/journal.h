@@ -0,0 +1,143 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file journal.h
+ *
+ * \brief The journal of a document logs every change made to its canvas over
+ * the session, with the time it was made, from a copy of the cells as they
+ * were when the journal was started. Unlike the history, nothing is undone, so
+ * the session can be replayed; only once the journal is full are its oldest
+ * changes folded into the copy of the cells.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "graphics/glyph.h"
+#include "graphics/transform.h"
+#include "memory/chunkstore.h"
+
+/**
+ * \desc The most operations a journal holds. Once full, the oldest half are
+ * applied to its copy of the cells and dropped.
+ */
+#define JOURNAL_MAX_OPS (1 << 18)
+
+/**
+ * \brief Describes what an operation of a journal did.
+ */
+typedef enum
+{
+    JOURNAL_EDIT,      /**< Set a single cell. */
+    JOURNAL_TRANSFORM, /**< Transformed the whole canvas. */
+    JOURNAL_RESIZE     /**< Resized the canvas. */
+} JournalKind;
+
+/**
+ * \brief A single change to a canvas.
+ *
+ * Every change is logged, including those made by undoing and redoing, so the
+ * operations replay to the cells as they are now. Only the field of the kind
+ * of operation is used.
+ */
+typedef struct [[nodiscard]]
+{
+    JournalKind kind; /**< What the operation did. */
+    u32 time;         /**< Milliseconds since the journal was started. */
+    union
+    {
+        struct
+        {
+            size_t index; /**< Index of the cell set. */
+            Cell cell;    /**< The cell after the edit. */
+        } edit;
+        TransformType transform; /**< Transform of the whole canvas. */
+        SDL_Rect rect;           /**< Area kept by a resize. */
+    };
+} JournalOp;
+
+/**
+ * \brief The log of the changes made to a canvas.
+ *
+ * The copy of the cells is only read when the session is replayed, so it is
+ * kept compressed.
+ */
+typedef struct [[nodiscard]]
+{
+    ChunkStore* start; /**< Copy of the cells when the journal was started. */
+    u32 started;       /**< Ticks when the journal was started. */
+    JournalOp* ops;    /**< The operations in the order they were made. */
+    size_t count;      /**< Number of operations. */
+    size_t capacity;   /**< Number of operations allocated. */
+} Journal;
+
+/**
+ * \brief Creates an empty journal, which logs nothing until it is started.
+ * \returns Pointer to a journal object.
+ */
+[[nodiscard]] Journal* JournalCreate(void);
+
+/**
+ * \brief Frees the journal memory, including its copy of the cells.
+ * \param [in, out] journal The journal to be freed.
+ * \returns Void.
+ */
+void JournalFree(Journal* journal);
+
+/**
+ * \brief Starts the journal afresh from a copy of the cells of a canvas.
+ * \param [in, out] journal The journal to start.
+ * \param [in] cells The cells of the canvas now.
+ * \returns Void.
+ */
+void JournalStart(Journal* journal, ChunkStore* cells);
+
+/**
+ * \brief Creates a copy of a journal, to be replayed whilst the journal goes
+ * on logging.
+ * \param [in] journal The journal to copy, which must have been started.
+ * \returns Pointer to a journal object.
+ */
+[[nodiscard]] Journal* JournalClone(const Journal* journal);
+
+/**
+ * \brief Applies an operation of a journal to a set of cells.
+ * \param [in, out] cells The cells as they were when the operation was made.
+ * \param [in] op The operation to apply.
+ * \returns Void.
+ */
+void JournalApply(ChunkStore* cells, const JournalOp* op);
+
+/**
+ * \brief Logs that a cell was set.
+ * \param [in, out] journal The journal to log to.
+ * \param [in] index The index of the cell.
+ * \param [in] cell The cell after the edit.
+ * \returns Void.
+ */
+void JournalEdit(Journal* journal, size_t index, Cell cell);
+
+/**
+ * \brief Logs that the whole canvas was transformed.
+ * \param [in, out] journal The journal to log to.
+ * \param [in] type The transform which was applied.
+ * \returns Void.
+ */
+void JournalTransform(Journal* journal, TransformType type);
+
+/**
+ * \brief Logs that the canvas was resized.
+ * \param [in, out] journal The journal to log to.
+ * \param [in] rect The area kept, in the cells before the resize.
+ * \returns Void.
+ */
+void JournalResize(Journal* journal, SDL_Rect rect);
+
+#endif
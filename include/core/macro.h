@@ -0,0 +1,127 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file macro.h
+ *
+ * \brief A macro is a list of tool operations, such as stamping a brush,
+ * pasting a stamp or replacing one kind of cell with another, recorded from
+ * the canvas so that they can be played onto other maps. Macros are saved as
+ * text, one operation to a line, so they can also be written by hand.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef MACRO_H
+#define MACRO_H
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "graphics/brush.h"
+#include "graphics/glyph.h"
+#include "graphics/gradient.h"
+#include "graphics/transform.h"
+#include "memory/chunkstore.h"
+
+/**
+ * \desc The extension of macro files.
+ */
+#define MACRO_EXTENSION ".kmac"
+
+/**
+ * \brief Describes the tool an operation of a macro used.
+ */
+typedef enum
+{
+    MACRO_PLACE,          /**< Placed a single cell. */
+    MACRO_BRUSH,          /**< Stamped a round or square brush. */
+    MACRO_SPAN,           /**< Wrote a run of cells of a row. */
+    MACRO_PASTE,          /**< Pasted a block of cells, such as a stamp. */
+    MACRO_REPLACE,        /**< Replaced every matching cell. */
+    MACRO_GRADIENT,       /**< Filled an area with a gradient. */
+    MACRO_TRANSFORM,      /**< Transformed the whole canvas. */
+    MACRO_TRANSFORM_AREA, /**< Transformed an area of the canvas. */
+    MACRO_RESIZE,         /**< Kept an area of the canvas. */
+    MACRO_GROW,           /**< Grew or shrank the canvas about an anchor. */
+    MACRO_CROP            /**< Cropped the canvas to its content. */
+} MacroKind;
+
+/**
+ * \brief A single operation of a macro.
+ *
+ * Only the fields of the kind of operation are used. The rectangle holds the
+ * cell placed or stamped at, the run written (whose width is its length), or
+ * the area pasted, filled, transformed or kept; a growth holds the change in
+ * size in its width and height.
+ */
+typedef struct [[nodiscard]]
+{
+    MacroKind kind;          /**< The tool used. */
+    SDL_Rect rect;           /**< Cell, run or area operated on. */
+    Cell cell;               /**< Cell placed, stamped, written or replaced. */
+    CellMatch match;         /**< Cells replaced. */
+    Gradient gradient;       /**< Gradient filled. */
+    BrushShape shape;        /**< Shape of the brush stamped. */
+    i32 radius;              /**< Radius of the brush stamped. */
+    TransformType transform; /**< Transform applied. */
+    u8 anchor;               /**< Side kept by a growth, as a CanvasAnchor. */
+    Cell* cells;             /**< Cells pasted, in row-major order. */
+} MacroOp;
+
+/**
+ * \brief A list of operations, played in order.
+ */
+typedef struct [[nodiscard]]
+{
+    MacroOp* ops;    /**< The operations in the order they were made. */
+    size_t count;    /**< Number of operations. */
+    size_t capacity; /**< Number of operations allocated. */
+} Macro;
+
+/**
+ * \brief Creates an empty macro.
+ * \returns Pointer to a macro object.
+ */
+[[nodiscard]] Macro* MacroCreate(void);
+
+/**
+ * \brief Frees the macro memory, including the cells of every paste.
+ * \param [in, out] macro The macro to be freed.
+ * \returns Void.
+ */
+void MacroFree(Macro* macro);
+
+/**
+ * \brief Appends an operation to a macro.
+ * \param [in, out] macro The macro to add to.
+ * \param [in] kind The tool used.
+ * \returns The operation, blank but for its kind, to be filled in.
+ */
+[[nodiscard]] MacroOp* MacroAdd(Macro* macro, MacroKind kind);
+
+/**
+ * \brief Removes the last operation of a macro, if there is one.
+ * \param [in, out] macro The macro to remove from.
+ * \returns Void.
+ */
+void MacroRemoveLast(Macro* macro);
+
+/**
+ * \brief Writes a macro to a text file.
+ * \param [in] macro The macro to write.
+ * \param [in] path The path of the file, which is replaced.
+ * \returns Whether the file was written.
+ */
+bool MacroSave(const Macro* macro, const char* path);
+
+/**
+ * \brief Reads a macro from a text file.
+ * \param [in] path The path of the file.
+ * \returns Pointer to a macro object, or NULL if the file could not be read or
+ * any line of it is invalid.
+ */
+[[nodiscard]] Macro* MacroLoad(const char* path);
+
+#endif
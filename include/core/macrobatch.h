@@ -0,0 +1,53 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file macrobatch.h
+ *
+ * \brief A macro batch plays a macro onto every map of a directory, without a
+ * window. Each map is loaded into a canvas of its own with no cache, played
+ * onto and saved, on a thread for each processor.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef MACROBATCH_H
+#define MACROBATCH_H
+
+#include "core/batchio.h"
+#include "core/common.h"
+#include "core/macro.h"
+#include "core/mapfile.h"
+#include "core/utils.h"
+#include "ui/canvas.h"
+
+/**
+ * \desc The longest path of a map played onto.
+ */
+#define MACROBATCH_MAX_PATH 512
+
+/**
+ * \desc The most worker threads playing onto maps at once.
+ */
+#define MACROBATCH_WORKERS 8
+
+/**
+ * \desc The number of maps read, played onto and written back at once, which
+ * bounds how many are held in memory.
+ */
+#define MACROBATCH_GROUP BATCHIO_DEPTH
+
+/**
+ * \brief Plays a macro onto every map of a directory.
+ * \param [in] macro The macro to play.
+ * \param [in] dir The directory whose maps are played onto, without descending
+ * into its subdirectories.
+ * \param [in] out_dir The directory the maps are saved to, under the same
+ * names, which is created if need be; or NULL to replace each map.
+ * \returns Whether every map was played onto and saved.
+ */
+bool MacroBatchRun(const Macro* macro, const char* dir, const char* out_dir);
+
+#endif
@@ -0,0 +1,74 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file mapexport.h
+ *
+ * \brief Exports a map as a standalone HTML page or SVG image. Glyph indices
+ * are written as the code page 437 characters the tilesets are laid out in.
+ * Along each row, neighbouring cells of the same colours are merged into a
+ * single span or rectangle, so that large maps stay small and quick to show.
+ * Exports are written a band of chunk rows at a time through a buffer, without
+ * holding the whole map or the whole file in memory.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef MAPEXPORT_H
+#define MAPEXPORT_H
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "graphics/glyph.h"
+#include "memory/chunkstore.h"
+
+/**
+ * \desc The extensions of exported pages and images.
+ */
+#define MAPEXPORT_HTML_EXTENSION ".html"
+#define MAPEXPORT_SVG_EXTENSION ".svg"
+
+/**
+ * \desc The size of the buffer an export is written through, in bytes.
+ */
+#define MAPEXPORT_BUFFER 65536
+
+/**
+ * \desc The size of a cell of an SVG image, in pixels, and the size of the
+ * font its glyphs are written in.
+ */
+#define MAPEXPORT_CELL_W 10
+#define MAPEXPORT_CELL_H 16
+#define MAPEXPORT_FONT_SIZE 16
+
+/**
+ * \brief Writes a map as an HTML page, its rows held in a single preformatted
+ * block with a span for each run of cells of the same colours.
+ * \param [in, out] store The cells of the map.
+ * \param [in] path The path of the page, which is replaced.
+ * \returns Whether the page was written.
+ */
+bool MapExportHtml(ChunkStore* store, const char* path);
+
+/**
+ * \brief Writes a map as an SVG image, with a rectangle for each run of cells
+ * of the same background and a text element for each run of glyphs of the
+ * same foreground.
+ * \param [in, out] store The cells of the map.
+ * \param [in] path The path of the image, which is replaced.
+ * \returns Whether the image was written.
+ */
+bool MapExportSvg(ChunkStore* store, const char* path);
+
+/**
+ * \brief Writes a map as an HTML page or an SVG image, by the extension of the
+ * path.
+ * \param [in, out] store The cells of the map.
+ * \param [in] path The path of the export, which is replaced.
+ * \returns Whether the export was written.
+ */
+bool MapExport(ChunkStore* store, const char* path);
+
+#endif
@@ -0,0 +1,128 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file mapfile.h
+ *
+ * \brief A map file holds the cells of a map, a compressed chunk at a time,
+ * along with a summary of the glyphs and colours the map uses. The summary can
+ * be read on its own, so that a map may be indexed without loading its cells.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "graphics/glyph.h"
+#include "memory/chunkstore.h"
+#include "memory/lz.h"
+
+/**
+ * \desc Identifies a map file, and the version of its format.
+ */
+#define MAP_MAGIC "KMAP"
+#define MAP_VERSION 1
+
+/**
+ * \desc The extension of map files.
+ */
+#define MAP_EXTENSION ".kmap"
+
+/**
+ * \brief The header at the start of a map file.
+ *
+ * The header is followed by the size of each compressed chunk in row-major
+ * order, then the chunks themselves, and last of all the colours the map uses,
+ * in ascending order of their packed value. A chunk which would not compress
+ * is stored as it is, with the size of its uncompressed cells.
+ */
+typedef struct [[nodiscard]]
+{
+    char magic[4];     /**< Always MAP_MAGIC. */
+    u32 version;       /**< Version of the format. */
+    u32 cell_size;     /**< Size of a cell in bytes. */
+    i32 width;         /**< Width of the map in cells. */
+    i32 height;        /**< Height of the map in cells. */
+    u32 num_colors;    /**< Number of colours the map uses. */
+    u64 colors_offset; /**< Offset of the colours from the start. */
+    u32 glyphs[8];     /**< Bitset of glyph indices the map uses. */
+} MapHeader;
+
+/**
+ * \brief The glyphs and colours used by a map.
+ */
+typedef struct [[nodiscard]]
+{
+    u32 glyphs[8];  /**< Bitset of glyph indices used. */
+    u32* colors;    /**< Packed colours used, in ascending order. */
+    u32 num_colors; /**< Number of colours used. */
+    i32 width;      /**< Width of the map in cells. */
+    i32 height;     /**< Height of the map in cells. */
+} MapSummary;
+
+/**
+ * \brief Packs a colour into a single value, the same on every platform.
+ * \param [in] color The colour to pack.
+ * \returns The red, green, blue and alpha channels from the top byte down.
+ */
+[[nodiscard]] u32 MapPackColor(SDL_Color color);
+
+/**
+ * \brief Writes the cells of a chunk store to a map file.
+ * \param [in, out] store The chunk store to write.
+ * \param [in] path The path of the map file, which is replaced.
+ * \returns Whether the file was written.
+ */
+bool MapSave(ChunkStore* store, const char* path);
+
+/**
+ * \brief Writes the cells of a chunk store to a map held in memory, laid out
+ * as a map file.
+ * \param [in, out] store The chunk store to write.
+ * \param [out] size The size of the map in bytes.
+ * \returns The map, to be freed by the caller.
+ */
+[[nodiscard]] u8* MapEncode(ChunkStore* store, size_t* size);
+
+/**
+ * \brief Reads the cells of a map file into a new chunk store.
+ * \param [in] path The path of the map file.
+ * \returns Pointer to a chunk store, or NULL if the file is not a valid map.
+ */
+[[nodiscard]] ChunkStore* MapLoad(const char* path);
+
+/**
+ * \brief Reads the cells of a map held in memory into a new chunk store.
+ * \param [in] data The contents of the map file.
+ * \param [in] size The size of the contents in bytes.
+ * \returns Pointer to a chunk store, or NULL if the data is not a valid map.
+ */
+[[nodiscard]] ChunkStore* MapLoadMemory(const u8* data, size_t size);
+
+/**
+ * \brief Copies a map held in memory with every chunk stored uncompressed,
+ * such as to compress the whole map at once.
+ * \param [in] data The contents of the map file.
+ * \param [in] size The size of the contents in bytes.
+ * \param [out] expanded_size The size of the copy in bytes.
+ * \returns The copy, to be freed by the caller, or NULL if the data is not a
+ * valid map.
+ */
+[[nodiscard]] u8* MapExpand(const u8* data, size_t size,
+                            size_t* expanded_size);
+
+/**
+ * \brief Reads the summary of a map file, without reading its cells.
+ * \param [in] path The path of the map file.
+ * \param [out] summary The summary, whose colours are to be freed by the
+ * caller.
+ * \returns Whether the summary could be read.
+ */
+bool MapReadSummary(const char* path, MapSummary* summary);
+
+#endif
@@ -0,0 +1,230 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file mapindex.h
+ *
+ * \brief A map index lists which of the maps of a project directory use each
+ * glyph and colour, so that a search across thousands of maps need not open
+ * any of them. The index is kept on disk in the project directory, and kept up
+ * to date by a background indexer which only summarises the maps that change.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef MAPINDEX_H
+#define MAPINDEX_H
+
+#include "core/common.h"
+#include "core/mapfile.h"
+#include "core/utils.h"
+
+/**
+ * \desc Identifies an index file, and the version of its format.
+ */
+#define MAPINDEX_MAGIC "KIDX"
+#define MAPINDEX_VERSION 1
+
+/**
+ * \desc The name of the index file within the project directory.
+ */
+#define MAPINDEX_FILE "karte.kidx"
+
+/**
+ * \desc The maximum length of the path of a map, and of its name within the
+ * project directory.
+ */
+#define MAPINDEX_MAX_PATH 512
+#define MAPINDEX_MAX_NAME 128
+
+/**
+ * \desc The time in milliseconds between passes of the indexer.
+ */
+#define MAPINDEX_INTERVAL 2000
+
+/**
+ * \brief Describes the kind of a term of the index.
+ *
+ * A term is a kind in the upper half of a key and a value in the lower half:
+ * the glyph index, or the packed colour. Further kinds may be added without
+ * changing the format.
+ */
+typedef enum
+{
+    MAPINDEX_GLYPH = 1,
+    MAPINDEX_COLOR = 2
+} MapIndexKind;
+
+/**
+ * \brief The header at the start of an index.
+ *
+ * The header is followed by the maps, in order of name; then the keys of the
+ * terms of each map in turn, each map's in ascending order; then the terms in
+ * ascending order of key; and last the postings of every term in turn, each
+ * an ascending run of map numbers.
+ */
+typedef struct [[nodiscard]]
+{
+    char magic[4];    /**< Always MAPINDEX_MAGIC. */
+    u32 version;      /**< Version of the format. */
+    u32 num_maps;     /**< Number of maps indexed. */
+    u32 num_terms;    /**< Number of distinct terms. */
+    u32 num_postings; /**< Number of postings of every term together. */
+    u32 reserved;     /**< Pads the header to a multiple of eight bytes. */
+} MapIndexHeader;
+
+/**
+ * \brief A map of an index.
+ *
+ * The size and modification time are those the map had when summarised, so
+ * that a map is only summarised again once it changes.
+ */
+typedef struct [[nodiscard]]
+{
+    char name[MAPINDEX_MAX_NAME]; /**< Name within the project directory. */
+    i64 size;                     /**< Size of the map file in bytes. */
+    i64 mtime;                    /**< Modification time of the map file. */
+    u32 first_key;                /**< Index of the first key of the map. */
+    u32 num_keys;                 /**< Number of keys of the map. */
+} MapIndexMap;
+
+/**
+ * \brief A term of an index, with the run of postings of the maps using it.
+ */
+typedef struct [[nodiscard]]
+{
+    u64 key;   /**< Kind and value of the term. */
+    u32 first; /**< Index of the first posting. */
+    u32 count; /**< Number of maps using the term. */
+} MapIndexTerm;
+
+/**
+ * \brief An index of a project directory.
+ *
+ * The index is a single blob in the format it is stored in, which is either
+ * mapped from the index file or built in memory, and never changed once made.
+ */
+typedef struct [[nodiscard]]
+{
+    u8* data;                     /**< The blob of the index. */
+    size_t size;                  /**< Size of the blob in bytes. */
+    bool mapped;                  /**< Whether the blob is a file mapping. */
+    const MapIndexHeader* header; /**< Header of the blob. */
+    const MapIndexMap* maps;      /**< Maps, in order of name. */
+    const u64* keys;              /**< Keys of the terms of each map. */
+    const MapIndexTerm* terms;    /**< Terms, in order of key. */
+    const u32* postings;          /**< Postings of every term. */
+} MapIndex;
+
+/**
+ * \brief A background thread keeping the index of a project directory up to
+ * date.
+ *
+ * The index is replaced as a whole under the lock whenever a pass finds maps
+ * which were added, changed or removed, and written to the index file.
+ */
+typedef struct [[nodiscard]]
+{
+    SDL_Thread* thread;          /**< The indexer thread. */
+    SDL_mutex* lock;             /**< Guards the index and running flag. */
+    SDL_cond* wake;              /**< Signalled to refresh or stop. */
+    MapIndex* index;             /**< The latest index. */
+    char dir[MAPINDEX_MAX_PATH]; /**< The project directory. */
+    bool running;                /**< Cleared to stop the thread. */
+} MapIndexer;
+
+/**
+ * \brief Makes the key of a glyph term.
+ * \param [in] index The glyph index.
+ * \returns The key.
+ */
+[[nodiscard]] u64 MapIndexGlyph(u8 index);
+
+/**
+ * \brief Makes the key of a colour term.
+ * \param [in] color The colour.
+ * \returns The key.
+ */
+[[nodiscard]] u64 MapIndexColor(SDL_Color color);
+
+/**
+ * \brief Loads the index file of a project directory.
+ * \param [in] dir The project directory.
+ * \returns Pointer to an index, which is empty if the file is missing or not
+ * valid.
+ */
+[[nodiscard]] MapIndex* MapIndexLoad(const char* dir);
+
+/**
+ * \brief Frees the index memory.
+ * \param [in, out] index The index to be freed.
+ * \returns Void.
+ */
+void MapIndexFree(MapIndex* index);
+
+/**
+ * \brief Indexes the maps of a project directory as they now are, reusing
+ * what an older index knows of any map which has not changed.
+ * \param [in] index The older index.
+ * \param [in] dir The project directory.
+ * \returns Pointer to a new index, or NULL if no map has changed.
+ */
+[[nodiscard]] MapIndex* MapIndexRefresh(const MapIndex* index,
+                                        const char* dir);
+
+/**
+ * \brief Writes an index to the index file of a project directory.
+ * \param [in] index The index to write.
+ * \param [in] dir The project directory.
+ * \returns Whether the file was written.
+ */
+bool MapIndexSave(const MapIndex* index, const char* dir);
+
+/**
+ * \brief Finds the maps using every one of a set of terms.
+ * \param [in] index The index to search.
+ * \param [in] keys The keys of the terms.
+ * \param [in] num_keys The number of keys.
+ * \param [out] maps The numbers of the maps found, in order of name, with room
+ * for every map of the index.
+ * \returns The number of maps found.
+ */
+size_t MapIndexQuery(const MapIndex* index, const u64* keys, size_t num_keys,
+                     u32* maps);
+
+/**
+ * \brief Brings the index of a project directory up to date and logs the maps
+ * using every one of a set of terms, each a glyph index such as "64" or a
+ * colour such as "#ff8000" or "#ff800080".
+ * \param [in] dir The project directory.
+ * \param [in] terms The terms to search for.
+ * \param [in] num_terms The number of terms.
+ * \returns Whether every term was valid.
+ */
+bool MapIndexSearch(const char* dir, char* const* terms, size_t num_terms);
+
+/**
+ * \brief Creates an indexer for a project directory and starts its thread.
+ * \param [in] dir The project directory.
+ * \returns Pointer to an indexer object.
+ */
+[[nodiscard]] MapIndexer* MapIndexerCreate(const char* dir);
+
+/**
+ * \brief Stops the indexer thread and frees its memory.
+ * \param [in, out] indexer The indexer to be freed.
+ * \returns Void.
+ */
+void MapIndexerFree(MapIndexer* indexer);
+
+/**
+ * \brief Wakes the indexer to refresh the index straight away, such as after a
+ * map has been saved.
+ * \param [in, out] indexer The indexer to wake.
+ * \returns Void.
+ */
+void MapIndexerWake(MapIndexer* indexer);
+
+#endif
@@ -0,0 +1,179 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file pack.h
+ *
+ * \brief A pack holds many maps in a single file, each compressed on its own
+ * against a dictionary trained from them all, behind an index which finds any
+ * map by name in constant time. A pack is mapped into memory rather than read,
+ * so opening one costs the same however many maps it holds.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef PACK_H
+#define PACK_H
+
+#include "core/batchio.h"
+#include "core/common.h"
+#include "core/mapfile.h"
+#include "core/utils.h"
+#include "memory/chunkstore.h"
+#include "memory/lz.h"
+#include "memory/phash.h"
+
+/**
+ * \desc Identifies a pack, and the version of its format.
+ */
+#define PACK_MAGIC "KPAK"
+#define PACK_VERSION 1
+
+/**
+ * \desc The extension of packs.
+ */
+#define PACK_EXTENSION ".kpak"
+
+/**
+ * \desc The maximum length of a path, and of the name of a map in a pack.
+ */
+#define PACK_MAX_PATH 512
+#define PACK_MAX_NAME 128
+
+/**
+ * \desc The largest dictionary trained for a pack, in bytes.
+ */
+#define PACK_DICT_SIZE 32768
+
+/**
+ * \desc The most worker threads used to build a pack.
+ */
+#define PACK_WORKERS 8
+
+/**
+ * \brief The header at the start of a pack.
+ *
+ * The header is followed by the displacements of the perfect hash of the names,
+ * then the entries in the slot order of the hash, then the dictionary and last
+ * the data of every entry.
+ */
+typedef struct [[nodiscard]]
+{
+    char magic[4];      /**< Always PACK_MAGIC. */
+    u32 version;        /**< Version of the format. */
+    u32 count;          /**< Number of maps. */
+    u32 num_buckets;    /**< Number of displacements of the hash. */
+    u32 dict_size;      /**< Size of the dictionary in bytes. */
+    u32 reserved;       /**< Pads the header to a multiple of eight bytes. */
+    u64 entries_offset; /**< Offset of the entries from the start. */
+    u64 dict_offset;    /**< Offset of the dictionary from the start. */
+} PackHeader;
+
+/**
+ * \brief A map of a pack.
+ *
+ * The data is a map file with every chunk stored uncompressed, so that the map
+ * is compressed as a whole against the dictionary. Data which would not
+ * compress is stored as it is, with a size equal to its uncompressed size.
+ */
+typedef struct [[nodiscard]]
+{
+    char name[PACK_MAX_NAME]; /**< File name of the map. */
+    u64 offset;               /**< Offset of the data from the start. */
+    u64 size;                 /**< Size of the data in bytes. */
+    u64 raw_size;             /**< Size of the data uncompressed. */
+} PackEntry;
+
+/**
+ * \brief A pack mapped into memory.
+ */
+typedef struct [[nodiscard]]
+{
+    const u8* data;           /**< Contents of the mapped file. */
+    size_t size;              /**< Size of the file in bytes. */
+    PackHeader header;        /**< Copy of the header. */
+    const u32* displacements; /**< Displacements of the hash of names. */
+    const PackEntry* entries; /**< Entries in slot order. */
+    const u8* dict;           /**< Shared dictionary. */
+} Pack;
+
+/**
+ * \brief Builds a pack of the maps of a directory, using a thread for each
+ * processor.
+ * \param [in] dir The directory of maps, whose subdirectories are left out.
+ * \param [in] path The path of the pack, which is replaced.
+ * \returns Whether the pack was written.
+ */
+bool PackBuild(const char* dir, const char* path);
+
+/**
+ * \brief Opens a pack by mapping it into memory.
+ * \param [in] path The path of the pack.
+ * \returns Pointer to a pack object, or NULL if the file is not a valid pack.
+ */
+[[nodiscard]] Pack* PackOpen(const char* path);
+
+/**
+ * \brief Unmaps a pack and frees the pack memory.
+ * \param [in, out] pack The pack to be freed.
+ * \returns Void.
+ */
+void PackFree(Pack* pack);
+
+/**
+ * \brief Finds a map of a pack by name.
+ * \param [in] pack The pack to search.
+ * \param [in] name The file name of the map.
+ * \returns The number of the entry of the map, or -1 if there is none.
+ */
+[[nodiscard]] i32 PackFind(const Pack* pack, const char* name);
+
+/**
+ * \brief Reads the cells of a map of a pack into a new chunk store.
+ * \param [in] pack The pack holding the map.
+ * \param [in] index The number of the entry of the map.
+ * \returns Pointer to a chunk store, or NULL if the entry is not a valid map.
+ */
+[[nodiscard]] ChunkStore* PackLoad(const Pack* pack, i32 index);
+
+/**
+ * \brief Lists the names of the maps of a pack, in the manner of FileList.
+ * \param [in] path The path of the pack.
+ * \param [in] visit Called with the name of each map, in no particular order.
+ * \param [in, out] data Passed on to each call.
+ * \returns Whether the pack could be read.
+ */
+bool PackList(const char* path,
+              void (*visit)(void* data, const char* name, bool is_dir),
+              void* data);
+
+/**
+ * \brief Checks whether a path names a pack by its extension.
+ * \param [in] path The path to check.
+ * \returns Whether the path ends in PACK_EXTENSION.
+ */
+[[nodiscard]] bool PackIsPath(const char* path);
+
+/**
+ * \brief Splits the path of a map within a pack, such as
+ * maps/world.kpak/a.kmap, into the path of the pack and the name of the map.
+ * \param [in] path The path to split.
+ * \param [out] pack The path of the pack.
+ * \param [in] size The size of the pack buffer in bytes.
+ * \param [out] name The name of the map, pointing into the path.
+ * \returns Whether the path is of a map within a pack.
+ */
+bool PackSplitPath(const char* path, char* pack, size_t size,
+                   const char** name);
+
+/**
+ * \brief Reads the cells of a map into a new chunk store, from a map file or
+ * from a map within a pack.
+ * \param [in] path The path of the map file, or of the map within a pack.
+ * \returns Pointer to a chunk store, or NULL if the map could not be read.
+ */
+[[nodiscard]] ChunkStore* PackLoadMap(const char* path);
+
+#endif
@@ -17,20 +17,32 @@
 
 #include "core/common.h"
 #include "core/utils.h"
+#include "generated/tilesets.h"
 #include "graphics/texture.h"
 #include "graphics/window.h"
-#include "memory/hashmap.h"
+#include "memory/concmap.h"
+#include "memory/phash.h"
+
+/**
+ * \desc The directory from which the built-in tilesets are loaded.
+ */
+#define TILESET_DIRECTORY "./res/textures/"
 
 /**
  * \brief Handles all resources (who would've guessed) to be used within the
  * program.
  *
  * The resourcer stores vectors of different resources such as textures. Other
- * types of resource can be added if required.
+ * types of resource can be added if required. The built-in tilesets are a fixed
+ * set known at build time, so they are stored in slots of a perfect hash table
+ * rather than in the general texture map. Textures are held in a concurrent map
+ * so that worker threads can look them up without contending with the UI
+ * thread.
  */
 typedef struct [[nodiscard]]
 {
-    Hashmap* textures; /**< Textures used by the program. */
+    ConcurrentMap* textures;           /**< Textures used by the program. */
+    Texture* tilesets[TILESETS_COUNT]; /**< Built-in tilesets by slot. */
 } Resourcer;
 
 /**
@@ -58,11 +70,31 @@ void ResourcerLoadTexture(Resourcer* res, const Window* wind, const char* path,
                           const char* key);
 
 /**
- * \brief Retrieves a texture from the resourcer.
+ * \brief Retrieves a texture from the resourcer. Safe to call from any thread.
  * \param [in] res The resourcer to retrieve the texture from.
  * \param [in] key The name of the texture to retrieve.
+ * \returns The texture, or NULL if no texture is loaded with that key.
  */
 [[nodiscard]] Texture* ResourcerGetTexture(const Resourcer* res,
                                            const char* key);
 
+/**
+ * \brief Loads one of the built-in tilesets into memory.
+ * \param [out] res The resourcer to load the tileset into.
+ * \param [in] wind The window with SDL surface to load to.
+ * \param [in] name The name of the tileset, as listed in
+ * res/keys/tilesets.keys.
+ * \returns Void.
+ */
+void ResourcerLoadTileset(Resourcer* res, const Window* wind, const char* name);
+
+/**
+ * \brief Retrieves a built-in tileset from the resourcer.
+ * \param [in] res The resourcer to retrieve the tileset from.
+ * \param [in] name The name of the tileset to retrieve.
+ * \returns The tileset texture, or NULL if it is unknown or not loaded.
+ */
+[[nodiscard]] Texture* ResourcerGetTileset(const Resourcer* res,
+                                           const char* name);
+
 #endif
\ No newline at end of file
@@ -27,6 +27,51 @@
  */
 [[nodiscard]] bool FileExists(const char* path);
 
+/**
+ * \brief Retrieves the size and last modification time of a file.
+ * \param [in] path The path to the file.
+ * \param [out] size The size of the file in bytes.
+ * \param [out] mtime The last modification time of the file.
+ * \returns Whether the file could be queried.
+ */
+[[nodiscard]] bool FileStat(const char* path, i64* size, i64* mtime);
+
+/**
+ * \brief Maps a whole file into memory for reading.
+ * \param [in] path The path to the file.
+ * \param [out] size The size of the mapping in bytes.
+ * \returns A pointer to the mapped file contents, or NULL on failure.
+ */
+[[nodiscard]] void* FileMap(const char* path, size_t* size);
+
+/**
+ * \brief Unmaps a file previously mapped with FileMap.
+ * \param [in] data The mapped file contents.
+ * \param [in] size The size of the mapping in bytes.
+ * \returns Void.
+ */
+void FileUnmap(void* data, size_t size);
+
+/**
+ * \brief Lists the regular files and subdirectories of a directory, without
+ * descending into the subdirectories.
+ * \param [in] dir The path to the directory.
+ * \param [in] visit Called with the name of each entry, in no particular
+ * order, and whether it is a subdirectory.
+ * \param [in, out] data Passed on to each call.
+ * \returns Whether the directory could be read.
+ */
+bool FileList(const char* dir,
+              void (*visit)(void* data, const char* name, bool is_dir),
+              void* data);
+
+/**
+ * \brief Creates a directory, unless it already exists.
+ * \param [in] dir The path to the directory.
+ * \returns Whether the directory exists afterwards.
+ */
+bool DirCreate(const char* dir);
+
 /* -------------------------------------------------------------------------- */
 /* LOGGING                                                                    */
 /* -------------------------------------------------------------------------- */
@@ -64,6 +109,15 @@ void Log(LogCode lc, const char* str, ...);
  */
 void* Allocate(size_t size);
 
+/**
+ * \brief Resizes memory, allocating it if there is none, and increments the
+ * number of allocations only when it is allocated.
+ * \param [in, out] mem Memory from Allocate or Reallocate, or NULL.
+ * \param [in] size Size the memory should be.
+ * \returns Pointer to the resized memory, which may have moved.
+ */
+void* Reallocate(void* mem, size_t size);
+
 /**
  * \brief Deallocates memory and decrements the number of allocations.
  * \param [in, out] mem A pointer to the memory to be freed.
@@ -0,0 +1,35 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file tilesets.h
+ *
+ * \brief Minimal perfect hash table generated by phashgen from
+ * res/keys/tilesets.keys.
+ *
+ * Do not edit by hand: change the key file and rebuild.
+ *
+ */
+
+#ifndef GENERATED_TILESETS_H
+#define GENERATED_TILESETS_H
+
+#include "memory/phash.h"
+
+#define TILESETS_COUNT 4
+
+static const u32 TILESETS_DISPLACEMENTS[2] = {
+    0, 3};
+
+static const char* const TILESETS_KEYS[4] = {
+    "curses_16x16",
+    "anikki_8x8",
+    "boxy_16x16",
+    "henry_32x32",
+};
+
+static const PerfectHash TILESETS = {
+    TILESETS_COUNT, 2, TILESETS_DISPLACEMENTS, TILESETS_KEYS};
+
+#endif
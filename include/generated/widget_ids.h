@@ -0,0 +1,63 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file widget_ids.h
+ *
+ * \brief Minimal perfect hash table generated by phashgen from
+ * res/keys/widget_ids.keys.
+ *
+ * Do not edit by hand: change the key file and rebuild.
+ *
+ */
+
+#ifndef GENERATED_WIDGET_IDS_H
+#define GENERATED_WIDGET_IDS_H
+
+#include "memory/phash.h"
+
+#define WIDGET_IDS_COUNT 31
+
+static const u32 WIDGET_IDS_DISPLACEMENTS[16] = {
+    0, 1, 3, 9, 1, 0, 9, 6,
+    4, 32, 11, 1, 10, 0, 4, 13};
+
+static const char* const WIDGET_IDS_KEYS[31] = {
+    "lbl_stamps",
+    "btn_tab1",
+    "pnl_tab",
+    "mmp_main",
+    "pnl_browser",
+    "stp_main",
+    "pnl_glyph_box",
+    "lbl_tab3",
+    "lbl_current",
+    "brw_main",
+    "lbl_brush",
+    "lbl_color",
+    "lbl_tab2",
+    "btn_tab2",
+    "pnl_editor",
+    "pnl_options",
+    "sct_glyphs",
+    "btn_load",
+    "btn_save",
+    "cvs_main",
+    "lbl_document",
+    "lbl_minimap",
+    "pnl_color_box",
+    "pnl_minimap",
+    "sct_colors",
+    "pnl_stamps",
+    "lbl_glyph",
+    "lbl_gradient",
+    "lbl_tab1",
+    "lbl_title",
+    "btn_quit",
+};
+
+static const PerfectHash WIDGET_IDS = {
+    WIDGET_IDS_COUNT, 16, WIDGET_IDS_DISPLACEMENTS, WIDGET_IDS_KEYS};
+
+#endif
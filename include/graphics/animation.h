@@ -0,0 +1,98 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file animation.h
+ *
+ * \brief Animated tile types, such as water or torches, cycle the glyph shown
+ * for a cell through a set of frames. Every animation runs from the same clock,
+ * so the frame of a cell depends only on its glyph and the time.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "core/common.h"
+#include "core/utils.h"
+
+/**
+ * \desc The file from which the animated tile types are loaded.
+ */
+#define ANIMATIONS_PATH "./res/animations/tiles.anim"
+
+/**
+ * \desc Limits on the number of tile types, their frames and their names.
+ */
+#define ANIMATIONS_MAX 32
+#define ANIMATION_MAX_FRAMES 16
+#define ANIMATION_MAX_NAME 32
+
+/**
+ * \brief An animated tile type.
+ */
+typedef struct [[nodiscard]]
+{
+    char name[ANIMATION_MAX_NAME];     /**< Name of the tile type. */
+    u8 frames[ANIMATION_MAX_FRAMES];   /**< Glyph index of each frame. */
+    u8 num_frames;                     /**< Number of frames. */
+    u32 period;                        /**< Time each frame is shown for. */
+} Animation;
+
+/**
+ * \brief A set of animated tile types.
+ *
+ * Every glyph index is looked up directly, so finding the frame of a cell is
+ * constant time however many tile types there are.
+ */
+typedef struct [[nodiscard]]
+{
+    Animation animations[ANIMATIONS_MAX]; /**< The tile types. */
+    size_t count;                         /**< Number of tile types. */
+    u8 lookup[256];     /**< One more than the tile type of each glyph. */
+    u8 position[256];   /**< Frame of each glyph within its tile type. */
+} Animations;
+
+/**
+ * \brief Loads a set of animated tile types.
+ * \param [in] path The path to the animation text file.
+ * \returns Pointer to a set of animations, or NULL if it could not be read.
+ */
+[[nodiscard]] Animations* AnimationsLoad(const char* path);
+
+/**
+ * \brief Frees the animations memory.
+ * \param [in, out] anims The animations to be freed.
+ * \returns Void.
+ */
+void AnimationsFree(Animations* anims);
+
+/**
+ * \brief Checks whether a glyph is animated.
+ * \param [in] anims The animations to search.
+ * \param [in] index The glyph index.
+ * \returns Whether the glyph is a frame of any tile type.
+ */
+[[nodiscard]] bool AnimationsHas(const Animations* anims, u8 index);
+
+/**
+ * \brief Finds the glyph shown for a cell at a given time.
+ * \param [in] anims The animations to search.
+ * \param [in] index The glyph index of the cell.
+ * \param [in] time The time in milliseconds.
+ * \returns The glyph index of the current frame, or index if not animated.
+ */
+[[nodiscard]] u8 AnimationsFrame(const Animations* anims, u8 index, u32 time);
+
+/**
+ * \brief Finds the next time after a given time at which any frame changes.
+ * \param [in] anims The animations to search.
+ * \param [in] time The time in milliseconds.
+ * \returns The time of the next change, or UINT32_MAX if there is none.
+ */
+[[nodiscard]] u32 AnimationsNextChange(const Animations* anims, u32 time);
+
+#endif
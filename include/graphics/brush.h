@@ -0,0 +1,100 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file brush.h
+ *
+ * \brief A brush is the footprint of a single stamp onto a canvas. The shape is
+ * worked out once, when the brush is created, as a list of row spans, so that
+ * stamping a brush is no more than a run of writes along each of its rows.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef BRUSH_H
+#define BRUSH_H
+
+#include "core/common.h"
+#include "core/utils.h"
+
+/**
+ * \desc The range of brush radii. A brush of radius one covers a single cell,
+ * and a brush of radius r spans 2r - 1 cells across.
+ */
+#define BRUSH_MIN_RADIUS 1
+#define BRUSH_MAX_RADIUS 64
+
+/**
+ * \brief Describes the shape of a brush.
+ */
+typedef enum
+{
+    BRUSH_ROUND = 0,
+    BRUSH_SQUARE = 1,
+    BRUSH_CUSTOM = 2
+} BrushShape;
+
+/**
+ * \brief A run of cells along a row of a brush.
+ *
+ * Positions are relative to the centre of the brush, and the run covers the
+ * cells from the start up to, but not including, the end.
+ */
+typedef struct [[nodiscard]]
+{
+    i16 dy; /**< Row of the run. */
+    i16 x0; /**< First column of the run. */
+    i16 x1; /**< Column after the last of the run. */
+} BrushSpan;
+
+/**
+ * \brief The footprint of a brush as row spans.
+ *
+ * Spans are ordered by row and then by column. A row of a custom brush may hold
+ * any number of spans, or none at all.
+ */
+typedef struct [[nodiscard]]
+{
+    BrushShape shape; /**< Shape the brush was created with. */
+    i32 radius;       /**< Half the extent of the brush, rounded up. */
+    BrushSpan* spans; /**< The runs of cells covered. */
+    size_t num_spans; /**< Number of runs. */
+    size_t num_cells; /**< Number of cells covered. */
+} Brush;
+
+/**
+ * \brief Creates a round or square brush.
+ * \param [in] shape The shape of the brush, which must not be custom.
+ * \param [in] radius The radius, which is clamped to the range of radii.
+ * \returns Pointer to a brush object.
+ */
+[[nodiscard]] Brush* BrushCreate(BrushShape shape, i32 radius);
+
+/**
+ * \brief Creates a custom brush from a mask of cells.
+ * \param [in] mask Whether each cell is covered, in row-major order.
+ * \param [in] width The width of the mask, at most twice the maximum radius.
+ * \param [in] height The height of the mask, at most twice the maximum radius.
+ * \returns Pointer to a brush object, centred on the middle of the mask.
+ */
+[[nodiscard]] Brush* BrushCreateStamp(const bool* mask, i32 width, i32 height);
+
+/**
+ * \brief Frees the brush memory.
+ * \param [in, out] brush The brush to be freed.
+ * \returns Void.
+ */
+void BrushFree(Brush* brush);
+
+/**
+ * \brief Checks whether a brush covers a cell.
+ * \param [in] brush The brush to test.
+ * \param [in] dx The column of the cell relative to the centre.
+ * \param [in] dy The row of the cell relative to the centre.
+ * \returns Whether the cell is covered.
+ */
+[[nodiscard]] bool BrushCovers(const Brush* brush, i32 dx, i32 dy);
+
+#endif
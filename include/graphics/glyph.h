@@ -41,6 +41,20 @@ typedef struct [[nodiscard]]
     SDL_Color fg; /**< Foreground colour of the glyph. */
 } Glyph;
 
+/**
+ * \brief The contents of a glyph without its position.
+ *
+ * Cells are what a canvas stores for each of its glyphs: the position of a cell
+ * is implied by where it is stored. Cells are packed, so that large maps stay
+ * small in memory and compress well.
+ */
+typedef struct [[nodiscard]]
+{
+    u8 index;     /**< ASCII index. */
+    SDL_Color fg; /**< Foreground colour of the cell. */
+    SDL_Color bg; /**< Background colour of the cell. */
+} Cell;
+
 /**
  * \brief Allocates memory for the glyph.
  * \returns A pointer to an glyph object.
@@ -63,4 +77,15 @@ void GlyphFree(Glyph* glyph);
  */
 void GlyphRender(const Glyph* glyph, const Window* wind, const Texture* tex);
 
+/**
+ * \brief Renders a glyph to a given destination rather than its own position.
+ * \param [in] glyph The glyph to be rendered.
+ * \param [in] wind The window to render to.
+ * \param [in] tex The texture to render from.
+ * \param [in] dest The destination rectangle in pixels.
+ * \returns Void.
+ */
+void GlyphRenderTo(const Glyph* glyph, const Window* wind, const Texture* tex,
+                   SDL_Rect dest);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,85 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file gradient.h
+ *
+ * \brief A gradient blends from one colour to another across a block of cells,
+ * along a line or outwards from a point. It may colour the foreground and/or
+ * background of the cells, and may shade them with glyphs of increasing
+ * coverage, dithered so that the shades blend smoothly.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef GRADIENT_H
+#define GRADIENT_H
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "graphics/glyph.h"
+
+/**
+ * \desc The parts of a cell a gradient fills, which may be combined.
+ */
+#define GRADIENT_FG 0x1
+#define GRADIENT_BG 0x2
+#define GRADIENT_SHADE 0x4
+
+/**
+ * \desc The number of cells of a row whose blend is worked out at once.
+ */
+#define GRADIENT_BATCH 64
+
+/**
+ * \brief Describes the shape of a gradient.
+ */
+typedef enum
+{
+    GRADIENT_LINEAR = 0,
+    GRADIENT_RADIAL = 1
+} GradientType;
+
+/**
+ * \brief A blend between two colours.
+ *
+ * A linear gradient runs from the start to the end, and is flat beyond either.
+ * A radial gradient runs outwards from the start, reaching the end colour at
+ * the distance of the end. Shading picks from blank, the three shade glyphs and
+ * the full block, in the end colour on the start colour unless the foreground
+ * or background are also filled.
+ */
+typedef struct [[nodiscard]]
+{
+    GradientType type; /**< Shape of the gradient. */
+    u8 targets;        /**< Parts of each cell filled. */
+    SDL_Color from;    /**< Colour at the start. */
+    SDL_Color to;      /**< Colour at the end. */
+    SDL_Point start;   /**< Cell the gradient starts at. */
+    SDL_Point end;     /**< Cell the gradient ends at. */
+} Gradient;
+
+/**
+ * \brief Fills a run of cells along a row.
+ * \param [in] gradient The gradient to fill with.
+ * \param [in] x The x-position of the first cell of the run.
+ * \param [in] y The y-position of the row.
+ * \param [in] count The number of cells in the run.
+ * \param [in, out] cells The cells of the run, whose parts not filled are kept.
+ * \returns Void.
+ */
+void GradientFillRow(const Gradient* gradient, i32 x, i32 y, i32 count,
+                     Cell* cells);
+
+/**
+ * \brief Fills a block of cells.
+ * \param [in] gradient The gradient to fill with.
+ * \param [in] rect The position and size of the block.
+ * \param [in, out] cells The cells of the block in row-major order.
+ * \returns Void.
+ */
+void GradientFill(const Gradient* gradient, SDL_Rect rect, Cell* cells);
+
+#endif
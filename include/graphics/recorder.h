@@ -0,0 +1,109 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file recorder.h
+ *
+ * \brief A recorder captures every frame of a window to a video file, as
+ * YUV4MPEG2 or as raw RGBA. Frames are copied into a ring of buffers made up
+ * front and written out by a background thread, so that recording does not
+ * slow the frame rate. Should the writer fall behind, frames are dropped and
+ * counted rather than making the window wait.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "graphics/window.h"
+
+/**
+ * \desc The number of frames the ring holds.
+ */
+#define RECORDER_SLOTS 8
+
+/**
+ * \desc The frame rate written to the header of a YUV4MPEG2 file, which is the
+ * rate the window is capped at.
+ */
+#define RECORDER_FPS 60
+
+/**
+ * \brief Describes the format a recorder writes.
+ */
+typedef enum
+{
+    RECORDER_Y4M, /**< YUV4MPEG2 with full resolution chroma (C444). */
+    RECORDER_RGBA /**< Headerless RGBA8888 frames, one after another. */
+} RecorderFormat;
+
+/**
+ * \brief Records the frames of a window to a file.
+ *
+ * The ring holds count frames from tail onwards, which belong to the writer
+ * until it has written them, and the rest belong to the thread which renders.
+ * A frame is captured into the slot at the head, or dropped if the ring is
+ * full or the window has changed size. The planes are only used by the writer.
+ */
+typedef struct [[nodiscard]]
+{
+    FILE* file;                 /**< The file being written. */
+    RecorderFormat format;      /**< Format of the file. */
+    i32 width;                  /**< Width of a frame in pixels. */
+    i32 height;                 /**< Height of a frame in pixels. */
+    u8* frames[RECORDER_SLOTS]; /**< Ring of RGBA frames. */
+    u8* planes;                 /**< Y, U and V planes of a frame. */
+    u32 head;                   /**< Slot the next frame is captured to. */
+    u32 tail;                   /**< Slot the next frame is written from. */
+    u32 count;                  /**< Number of frames waiting to be written. */
+    u64 captured;               /**< Number of frames captured. */
+    u64 dropped;                /**< Number of frames dropped. */
+    bool failed;                /**< Whether writing has failed. */
+    SDL_Thread* writer;         /**< The writer thread. */
+    SDL_mutex* lock;            /**< Guards the ring and counts. */
+    SDL_cond* wake;             /**< Signalled when a frame is captured. */
+    bool running;               /**< Cleared to stop the writer. */
+} Recorder;
+
+/**
+ * \brief Opens a file and starts recording the frames of a window to it.
+ * \param [in] wind The window to record, whose size is that of every frame.
+ * \param [in] path The path of the file, which is replaced.
+ * \param [in] format The format to write.
+ * \returns Pointer to a recorder object, or NULL if the file could not be
+ * opened.
+ */
+[[nodiscard]] Recorder* RecorderCreate(const Window* wind, const char* path,
+                                       RecorderFormat format);
+
+/**
+ * \brief Writes every frame captured, stops the writer, closes the file and
+ * frees the recorder memory.
+ * \param [in, out] rec The recorder to be freed.
+ * \returns Void.
+ */
+void RecorderFree(Recorder* rec);
+
+/**
+ * \brief Captures the frame rendered to a window, before it is presented.
+ * \param [in, out] rec The recorder to capture to.
+ * \param [in] wind The window to capture.
+ * \returns Void.
+ */
+void RecorderCapture(Recorder* rec, const Window* wind);
+
+/**
+ * \brief Converts an RGBA frame to the Y, U and V planes of a YUV4MPEG2 frame.
+ * \param [in] frame The RGBA pixels of the frame.
+ * \param [in] num_pixels The number of pixels of the frame.
+ * \param [out] planes The Y, U and V planes, each of one byte per pixel.
+ * \returns Void.
+ */
+void RecorderConvert(const u8* frame, size_t num_pixels, u8* planes);
+
+#endif
@@ -7,7 +7,8 @@
  *
  * \brief Textures hold a set of 16x16 glyphs that are used for most rendering.
  * The texture holds some data about the SDL_Texture it contains, such as glyph
- * width and height.
+ * width and height. Copies of it scaled up by whole factors may be made, so
+ * that glyphs are drawn larger without being scaled as they are drawn.
  *
  * \author Anthony Mercer
  *
@@ -20,6 +21,11 @@
 #include "core/utils.h"
 #include "graphics/window.h"
 
+/**
+ * \desc The largest whole factor a texture is scaled up by.
+ */
+#define TEXTURE_MAX_SCALE 8
+
 /**
  * \brief Holds a pointer to an SDL_Texture as well as some metadata.
  *
@@ -61,4 +67,16 @@ void TextureFree(Texture* tex);
 [[nodiscard]] bool TextureLoad(Texture* tex, const Window* wind,
                                const char* path);
 
+/**
+ * \brief Makes a copy of a texture scaled up by a whole factor, with each pixel
+ * repeated rather than filtered.
+ * \param [in] tex The texture to scale.
+ * \param [in] wind The window object holding the SDL_Renderer.
+ * \param [in] scale The factor, from 2 to TEXTURE_MAX_SCALE.
+ * \returns The scaled copy, whose SDL texture and memory are owned by the
+ * caller, or NULL should the copy not be made.
+ */
+[[nodiscard]] Texture* TextureScale(const Texture* tex, const Window* wind,
+                                    i32 scale);
+
 #endif
\ No newline at end of file
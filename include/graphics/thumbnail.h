@@ -0,0 +1,110 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file thumbnail.h
+ *
+ * \brief A thumbnail is a small picture of a map, composited on the CPU from
+ * the colours of its cells so that it can be made on any thread. Thumbnails
+ * are cached on disk, so that a map is only read again once it changes.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+
+#include "core/common.h"
+#include "core/mapfile.h"
+#include "core/pack.h"
+#include "core/utils.h"
+#include "graphics/glyph.h"
+#include "memory/chunkstore.h"
+
+/**
+ * \desc Identifies a cached thumbnail, and the version of its format.
+ */
+#define THUMBNAIL_MAGIC "KTHM"
+#define THUMBNAIL_VERSION 1
+
+/**
+ * \desc The extension of cached thumbnails.
+ */
+#define THUMBNAIL_EXTENSION ".kthm"
+
+/**
+ * \desc The largest width and height of a thumbnail in pixels.
+ */
+#define THUMBNAIL_SIZE 64
+
+/**
+ * \desc The maximum length of the path of a map or a cached thumbnail.
+ */
+#define THUMBNAIL_MAX_PATH 512
+
+/**
+ * \brief The header at the start of a cached thumbnail.
+ *
+ * The size and modification time are those of the map when the thumbnail was
+ * made, so that a cached thumbnail of a map which has since changed is never
+ * used. The header is followed by the pixels.
+ */
+typedef struct [[nodiscard]]
+{
+    char magic[4]; /**< Always THUMBNAIL_MAGIC. */
+    u32 version;   /**< Version of the format. */
+    i64 size;      /**< Size of the map file in bytes. */
+    i64 mtime;     /**< Modification time of the map file. */
+    i32 width;     /**< Width of the thumbnail in pixels. */
+    i32 height;    /**< Height of the thumbnail in pixels. */
+} ThumbnailHeader;
+
+/**
+ * \brief A picture of a map, no larger than THUMBNAIL_SIZE on either side.
+ *
+ * The pixels are packed as RGBA8888, in the format of the minimap.
+ */
+typedef struct [[nodiscard]]
+{
+    u32* pixels; /**< Colour of each pixel in row-major order. */
+    i32 width;   /**< Width of the thumbnail in pixels. */
+    i32 height;  /**< Height of the thumbnail in pixels. */
+} Thumbnail;
+
+/**
+ * \brief Gets the colour a cell shows from afar.
+ * \param [in] cell The cell.
+ * \returns The foreground colour, or the background colour if the glyph draws
+ * nothing.
+ */
+[[nodiscard]] SDL_Color ThumbnailCellColor(Cell cell);
+
+/**
+ * \brief Composites a thumbnail of the cells of a chunk store.
+ * \param [in, out] store The chunk store to picture.
+ * \param [out] thumb The thumbnail, whose pixels are to be freed by the caller.
+ * \returns Whether the store had any cells to picture.
+ */
+bool ThumbnailRender(ChunkStore* store, Thumbnail* thumb);
+
+/**
+ * \brief Gets the thumbnail of a map file, or of a map within a pack, from the
+ * cache if it is there and up to date, and otherwise by reading the map and
+ * adding it to the cache.
+ * \param [in] path The path of the map file, or of the map within a pack.
+ * \param [in] cache The directory of cached thumbnails.
+ * \param [out] thumb The thumbnail, whose pixels are to be freed by the caller.
+ * \returns Whether there is a thumbnail.
+ */
+bool ThumbnailFetch(const char* path, const char* cache, Thumbnail* thumb);
+
+/**
+ * \brief Frees the pixels of a thumbnail.
+ * \param [in, out] thumb The thumbnail to be emptied.
+ * \returns Void.
+ */
+void ThumbnailClear(Thumbnail* thumb);
+
+#endif
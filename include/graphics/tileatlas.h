@@ -0,0 +1,88 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file tileatlas.h
+ *
+ * \brief A tile atlas holds only the tiles a map uses, for runtimes which
+ * cannot spare the memory for a whole tileset. Each tile is a glyph already
+ * drawn in its colours over its background, trimmed to the pixels it covers
+ * and packed into a single image along with the rest. The map is exported
+ * beside the image with each cell holding the index of its tile.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef TILEATLAS_H
+#define TILEATLAS_H
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "graphics/glyph.h"
+#include "memory/chunkstore.h"
+
+/**
+ * \desc Identifies an exported tile map, and the version of its format.
+ */
+#define TILEATLAS_MAGIC "KTAT"
+#define TILEATLAS_VERSION 1
+
+/**
+ * \desc The extensions of an exported tile map and of its atlas image.
+ */
+#define TILEATLAS_EXTENSION ".ktat"
+#define TILEATLAS_IMAGE_EXTENSION ".png"
+
+/**
+ * \desc The most tiles an atlas holds, as the index of a tile must fit into
+ * each cell of the tile map.
+ */
+#define TILEATLAS_MAX_TILES 65536
+
+/**
+ * \brief The header at the start of an exported tile map.
+ *
+ * The header is followed by a TileAtlasTile for each tile, then by the index
+ * of the tile of each cell, as a u16 in row-major order. Tile zero is always
+ * the empty tile, which covers no pixels and is not drawn.
+ */
+typedef struct [[nodiscard]]
+{
+    char magic[4]; /**< Always TILEATLAS_MAGIC. */
+    u32 version;   /**< Version of the format. */
+    i32 width;     /**< Width of the map in cells. */
+    i32 height;    /**< Height of the map in cells. */
+    u32 tile_w;    /**< Width of a cell in pixels. */
+    u32 tile_h;    /**< Height of a cell in pixels. */
+    u32 num_tiles; /**< Number of tiles, including the empty tile. */
+    u32 atlas_w;   /**< Width of the atlas image in pixels. */
+    u32 atlas_h;   /**< Height of the atlas image in pixels. */
+} TileAtlasHeader;
+
+/**
+ * \brief Where a tile lies in the atlas, and where it is drawn within a cell.
+ */
+typedef struct [[nodiscard]]
+{
+    u16 x;  /**< Left of the tile in the atlas. */
+    u16 y;  /**< Top of the tile in the atlas. */
+    u16 w;  /**< Width of the tile, trimmed to the pixels it covers. */
+    u16 h;  /**< Height of the tile, trimmed to the pixels it covers. */
+    u16 ox; /**< Offset of the tile from the left of the cell. */
+    u16 oy; /**< Offset of the tile from the top of the cell. */
+} TileAtlasTile;
+
+/**
+ * \brief Exports a map as a tile map and an atlas image of the tiles it uses.
+ * \param [in, out] store The cells of the map.
+ * \param [in] tileset The path of the tileset image the map is drawn with, a
+ * grid of 16 by 16 glyphs in which magenta is clear.
+ * \param [in] path The path of the tile map, which is replaced. The atlas is
+ * written beside it, with the extension of an image in place of its own.
+ * \returns Whether both files were written.
+ */
+bool TileAtlasExport(ChunkStore* store, const char* tileset, const char* path);
+
+#endif
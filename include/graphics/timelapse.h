@@ -0,0 +1,125 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file timelapse.h
+ *
+ * \brief A timelapse replays the journal of a document into a video of the
+ * session, without a window. Each frame is composited on the CPU from the
+ * colours of the cells, in the manner of a thumbnail, and only the cells which
+ * changed since the frame before are drawn again. Frames are encoded in
+ * batches on a thread for each processor. A timelapse may be rendered in the
+ * background from a copy of the journal, whilst the session goes on.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef TIMELAPSE_H
+#define TIMELAPSE_H
+
+#include "core/common.h"
+#include "core/journal.h"
+#include "core/utils.h"
+#include "graphics/recorder.h"
+#include "graphics/thumbnail.h"
+#include "graphics/transform.h"
+#include "memory/chunkstore.h"
+
+/**
+ * \desc The frame rate of a timelapse.
+ */
+#define TIMELAPSE_FPS 30
+
+/**
+ * \desc The most frames the session is played over, after which it is sped up
+ * further rather than played for longer.
+ */
+#define TIMELAPSE_MAX_FRAMES (TIMELAPSE_FPS * 60)
+
+/**
+ * \desc The number of frames the finished map is held for at the end.
+ */
+#define TIMELAPSE_HOLD TIMELAPSE_FPS
+
+/**
+ * \desc The longest pause between two operations which is played, in
+ * milliseconds, so that time spent away from the map is skipped.
+ */
+#define TIMELAPSE_IDLE 2000
+
+/**
+ * \desc The largest size of a frame in pixels. A map which fits is scaled up
+ * by the largest whole factor which fits every size it had, and a larger map
+ * is sampled every so many cells.
+ */
+#define TIMELAPSE_WIDTH 1280
+#define TIMELAPSE_HEIGHT 720
+
+/**
+ * \desc The number of frames encoded at once, and the most threads encoding
+ * them.
+ */
+#define TIMELAPSE_BATCH 16
+#define TIMELAPSE_WORKERS 8
+
+/**
+ * \desc The longest path a timelapse rendered in the background is written to.
+ */
+#define TIMELAPSE_MAX_PATH 256
+
+/**
+ * \brief A timelapse being rendered in the background.
+ *
+ * The copy of the journal and the path belong to the thread which renders
+ * until done is set, after which ok holds whether the video was written.
+ */
+typedef struct [[nodiscard]]
+{
+    Journal* journal;              /**< Copy of the journal to replay. */
+    char path[TIMELAPSE_MAX_PATH]; /**< Path of the file. */
+    RecorderFormat format;         /**< Format to write. */
+    bool ok;                       /**< Whether the video was written. */
+    SDL_atomic_t done;             /**< Set once rendering has finished. */
+    SDL_Thread* thread;            /**< The thread which renders. */
+} TimelapseJob;
+
+/**
+ * \brief Renders the session logged by a journal to a video file.
+ * \param [in] journal The journal to replay.
+ * \param [in] path The path of the file, which is replaced.
+ * \param [in] format The format to write.
+ * \returns Whether the video was written.
+ */
+bool TimelapseRender(const Journal* journal, const char* path,
+                     RecorderFormat format);
+
+/**
+ * \brief Starts rendering the session logged by a journal to a video file on
+ * a thread of its own.
+ * \param [in] journal The journal to replay, which is copied.
+ * \param [in] path The path of the file, which is replaced.
+ * \param [in] format The format to write.
+ * \returns Pointer to a timelapse job object, or NULL if the journal has not
+ * been started or the path is too long.
+ */
+[[nodiscard]] TimelapseJob* TimelapseStart(const Journal* journal,
+                                           const char* path,
+                                           RecorderFormat format);
+
+/**
+ * \brief Checks whether a timelapse has finished rendering, without waiting.
+ * \param [in] job The timelapse job to check.
+ * \returns Whether the timelapse has finished.
+ */
+bool TimelapseDone(TimelapseJob* job);
+
+/**
+ * \brief Waits for a timelapse to finish rendering and frees it.
+ * \param [out] job The timelapse job to be freed.
+ * \returns Whether the video was written.
+ */
+bool TimelapseFinish(TimelapseJob* job);
+
+#endif
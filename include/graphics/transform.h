@@ -0,0 +1,102 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file transform.h
+ *
+ * \brief Transforms rotate, flip or transpose blocks of cells. Glyphs which
+ * point in a direction, such as box drawing lines and arrows, are remapped so
+ * that they still join up and point the right way once moved.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "graphics/glyph.h"
+
+/**
+ * \desc The width and height in cells of the tiles a block is transformed in,
+ * chosen so that the source and destination rows of a tile stay in cache.
+ */
+#define TRANSFORM_BLOCK 32
+
+/**
+ * \brief Describes a transform of a block of cells.
+ *
+ * Rotations are clockwise. A transpose swaps rows and columns, mirroring the
+ * block about its leading diagonal.
+ */
+typedef enum
+{
+    TRANSFORM_NONE = 0,
+    TRANSFORM_ROTATE_90 = 1,
+    TRANSFORM_ROTATE_180 = 2,
+    TRANSFORM_ROTATE_270 = 3,
+    TRANSFORM_FLIP_H = 4,
+    TRANSFORM_FLIP_V = 5,
+    TRANSFORM_TRANSPOSE = 6
+} TransformType;
+
+/**
+ * \desc The number of transform types, including none.
+ */
+#define TRANSFORM_COUNT 7
+
+/**
+ * \brief Finds the transform which undoes another.
+ * \param [in] type The transform to undo.
+ * \returns The inverse transform.
+ */
+[[nodiscard]] TransformType TransformInverse(TransformType type);
+
+/**
+ * \brief Finds the size of a block once transformed.
+ * \param [in] type The transform.
+ * \param [in] width The width of the block.
+ * \param [in] height The height of the block.
+ * \param [out] out_w The width of the transformed block.
+ * \param [out] out_h The height of the transformed block.
+ * \returns Void.
+ */
+void TransformSize(TransformType type, i32 width, i32 height, i32* out_w,
+                   i32* out_h);
+
+/**
+ * \brief Finds where a rectangle of a block ends up once transformed.
+ * \param [in] type The transform.
+ * \param [in] rect The rectangle, which must lie within the block.
+ * \param [in] width The width of the block.
+ * \param [in] height The height of the block.
+ * \returns The rectangle within the transformed block.
+ */
+[[nodiscard]] SDL_Rect TransformRect(TransformType type, SDL_Rect rect,
+                                     i32 width, i32 height);
+
+/**
+ * \brief Remaps a glyph so that it points the same way once transformed.
+ * \param [in] type The transform.
+ * \param [in] index The glyph index.
+ * \returns The transformed glyph index, which is unchanged for glyphs with no
+ * direction.
+ */
+[[nodiscard]] u8 TransformGlyph(TransformType type, u8 index);
+
+/**
+ * \brief Transforms a block of cells, remapping the glyph of every cell.
+ * \param [in] type The transform.
+ * \param [in] src The cells of the block in row-major order.
+ * \param [in] width The width of the block.
+ * \param [in] height The height of the block.
+ * \param [out] dst The transformed cells, which must not overlap the source.
+ * \returns Void.
+ */
+void TransformCells(TransformType type, const Cell* src, i32 width, i32 height,
+                    Cell* dst);
+
+#endif
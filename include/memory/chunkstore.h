@@ -0,0 +1,302 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file chunkstore.h
+ *
+ * \brief A chunk store holds a grid of cells split into square chunks. Chunks
+ * which have not been accessed for a while may be compressed in place, and are
+ * decompressed again on their next access, so that large maps which are open
+ * but idle take up little memory.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef CHUNKSTORE_H
+#define CHUNKSTORE_H
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "graphics/glyph.h"
+#include "graphics/transform.h"
+#include "memory/lz.h"
+
+/**
+ * \desc The width and height of a chunk in cells.
+ */
+#define CHUNK_SIZE 16
+#define CHUNK_CELLS (CHUNK_SIZE * CHUNK_SIZE)
+
+/**
+ * \desc The largest width or height of a store in cells, which keeps the
+ * number of chunks, and the index of every cell, well within an i32.
+ */
+#define CHUNK_MAX_EXTENT (1 << 14)
+
+/**
+ * \desc The time in milliseconds after its last access that a chunk becomes
+ * cold, and may be compressed.
+ */
+#define CHUNK_COLD_TICKS 5000
+
+/**
+ * \desc The number of distinct colours the usage of a chunk holds before it
+ * counts the chunk as using every colour.
+ */
+#define CHUNK_USAGE_COLORS 8
+
+/**
+ * \desc The parts of a cell compared by a match, which may be combined.
+ */
+#define CELL_MATCH_GLYPH 0x1
+#define CELL_MATCH_FG 0x2
+#define CELL_MATCH_BG 0x4
+
+/**
+ * \brief A summary of the glyphs and colours used by the cells of a chunk.
+ *
+ * Writes only ever add to the summary, so it may hold glyphs and colours which
+ * have since been overwritten, but never misses one which is in use. It is
+ * built again from the cells whenever the chunk is compressed, and whenever a
+ * query finds it loose, so that it stays tight for chunks which are not being
+ * edited. Foreground and background colours share the same set.
+ */
+typedef struct [[nodiscard]]
+{
+    u32 glyphs[8];                        /**< Bitset of glyph indices used. */
+    SDL_Color colors[CHUNK_USAGE_COLORS]; /**< Colours used. */
+    u8 num_colors;                        /**< Number of colours held. */
+    bool overflow;                        /**< Whether more colours are used. */
+    bool loose;                           /**< Whether written since built. */
+} ChunkUsage;
+
+/**
+ * \brief Describes the cells sought by a query.
+ *
+ * A cell matches when every part named by the fields matches; a match with no
+ * fields matches every cell.
+ */
+typedef struct [[nodiscard]]
+{
+    u8 fields;    /**< Parts of the cell compared. */
+    u8 index;     /**< Glyph index sought. */
+    SDL_Color fg; /**< Foreground colour sought. */
+    SDL_Color bg; /**< Background colour sought. */
+} CellMatch;
+
+/**
+ * \brief A square block of cells.
+ *
+ * A chunk is either resident, with its cells held uncompressed, or compressed.
+ * Resident chunks are linked into a least recently used list. A pinned chunk
+ * is in use and is never compressed. Either way the chunk keeps a summary of
+ * its usage, so that queries may skip it without reading its cells.
+ */
+typedef struct [[nodiscard]]
+{
+    Cell* cells;      /**< The cells, or NULL when compressed. */
+    u8* packed;       /**< The compressed cells, or NULL when resident. */
+    u32 packed_size;  /**< Size of the compressed cells in bytes. */
+    u32 last_access;  /**< Ticks at which the chunk was last accessed. */
+    u32 pins;         /**< Number of outstanding acquisitions. */
+    i32 prev;         /**< More recently used resident chunk, or -1. */
+    i32 next;         /**< Less recently used resident chunk, or -1. */
+    ChunkUsage usage; /**< Glyphs and colours used by the cells. */
+} Chunk;
+
+/**
+ * \brief A grid of cells stored in chunks.
+ *
+ * Every access goes through the store lock, so that a background thread may
+ * compress cold chunks whilst the grid is in use. Cells are only ever read or
+ * written through an acquired chunk, or by a single cell get or set.
+ */
+typedef struct [[nodiscard]]
+{
+    Chunk* chunks;       /**< Chunks in row-major order. */
+    i32 width;           /**< Width of the grid in cells. */
+    i32 height;          /**< Height of the grid in cells. */
+    i32 chunks_w;        /**< Width of the grid in chunks. */
+    i32 chunks_h;        /**< Height of the grid in chunks. */
+    i32 lru_head;        /**< Most recently used resident chunk, or -1. */
+    i32 lru_tail;        /**< Least recently used resident chunk, or -1. */
+    size_t num_resident; /**< Number of resident chunks. */
+    SDL_mutex* lock;     /**< Guards the chunks and the list. */
+} ChunkStore;
+
+/**
+ * \brief Creates a chunk store with every cell set to a fill cell.
+ * \param [in] width The width of the grid in cells.
+ * \param [in] height The height of the grid in cells.
+ * \param [in] fill The initial value of every cell.
+ * \returns Pointer to a chunk store.
+ */
+[[nodiscard]] ChunkStore* ChunkStoreCreate(i32 width, i32 height, Cell fill);
+
+/**
+ * \brief Creates a copy of a chunk store. Compressed chunks stay compressed.
+ * \param [in, out] store The chunk store to copy.
+ * \returns Pointer to a new chunk store.
+ */
+[[nodiscard]] ChunkStore* ChunkStoreClone(ChunkStore* store);
+
+/**
+ * \brief Frees the chunk store memory. No other thread may use the store.
+ * \param [in, out] store The chunk store to be freed.
+ * \returns Void.
+ */
+void ChunkStoreFree(ChunkStore* store);
+
+/**
+ * \brief Pins a chunk, decompressing it if required, and returns its cells.
+ * \param [in, out] store The chunk store the chunk belongs to.
+ * \param [in] cx The x-position of the chunk in chunks.
+ * \param [in] cy The y-position of the chunk in chunks.
+ * \returns The cells of the chunk in row-major order, valid until released.
+ */
+[[nodiscard]] Cell* ChunkStoreAcquire(ChunkStore* store, i32 cx, i32 cy);
+
+/**
+ * \brief Unpins a chunk which was acquired.
+ * \param [in, out] store The chunk store the chunk belongs to.
+ * \param [in] cx The x-position of the chunk in chunks.
+ * \param [in] cy The y-position of the chunk in chunks.
+ * \returns Void.
+ */
+void ChunkStoreRelease(ChunkStore* store, i32 cx, i32 cy);
+
+/**
+ * \brief Gets a single cell.
+ * \param [in, out] store The chunk store to read from.
+ * \param [in] x The x-position of the cell.
+ * \param [in] y The y-position of the cell.
+ * \returns The cell, or a blank cell if the position is out of bounds.
+ */
+[[nodiscard]] Cell ChunkStoreGet(ChunkStore* store, i32 x, i32 y);
+
+/**
+ * \brief Sets a single cell.
+ * \param [in, out] store The chunk store to write to.
+ * \param [in] x The x-position of the cell.
+ * \param [in] y The y-position of the cell.
+ * \param [in] cell The new value of the cell.
+ * \returns Void.
+ */
+void ChunkStoreSet(ChunkStore* store, i32 x, i32 y, Cell cell);
+
+/**
+ * \brief Notes a cell written through an acquired chunk in the usage of the
+ * chunk, which writes made by ChunkStoreSet do themselves.
+ * \param [in, out] store The chunk store the chunk belongs to.
+ * \param [in] cx The x-position of the chunk in chunks.
+ * \param [in] cy The y-position of the chunk in chunks.
+ * \param [in] cell The value written.
+ * \returns Void.
+ */
+void ChunkStoreNote(ChunkStore* store, i32 cx, i32 cy, Cell cell);
+
+/**
+ * \brief Reads a block of cells.
+ * \param [in, out] store The chunk store to read from.
+ * \param [in] rect The block of cells, which must lie within the grid.
+ * \param [out] cells The cells of the block in row-major order.
+ * \returns Void.
+ */
+void ChunkStoreRead(ChunkStore* store, SDL_Rect rect, Cell* cells);
+
+/**
+ * \brief Copies the cells of a whole chunk, without making it resident.
+ * \param [in, out] store The chunk store to read from.
+ * \param [in] cx The x-position of the chunk in chunks.
+ * \param [in] cy The y-position of the chunk in chunks.
+ * \param [out] cells The cells of the chunk in row-major order.
+ * \returns Void.
+ */
+void ChunkStoreReadChunk(ChunkStore* store, i32 cx, i32 cy, Cell* cells);
+
+/**
+ * \brief Overwrites the cells of a whole chunk, and builds its usage afresh.
+ * \param [in, out] store The chunk store to write to.
+ * \param [in] cx The x-position of the chunk in chunks.
+ * \param [in] cy The y-position of the chunk in chunks.
+ * \param [in] cells The cells of the chunk in row-major order.
+ * \returns Void.
+ */
+void ChunkStoreWriteChunk(ChunkStore* store, i32 cx, i32 cy,
+                          const Cell* cells);
+
+/**
+ * \brief Checks whether a cell matches a query.
+ * \param [in] match The cells sought.
+ * \param [in] cell The cell to check.
+ * \returns True if every part of the cell named by the match matches.
+ */
+[[nodiscard]] bool ChunkStoreMatches(const CellMatch* match, Cell cell);
+
+/**
+ * \brief Finds the chunks which may hold cells matching a query, from the
+ * usage of each chunk, without reading the cells of any compressed chunk.
+ * \param [in, out] store The chunk store to search.
+ * \param [in] match The cells sought.
+ * \param [out] chunks The indices of the chunks found, in row-major order,
+ * with room for every chunk of the store.
+ * \returns The number of chunks found.
+ */
+size_t ChunkStoreFind(ChunkStore* store, const CellMatch* match, i32* chunks);
+
+/**
+ * \brief Counts the cells matching a query. Only the chunks which may hold a
+ * match are read, and compressed ones are not made resident.
+ * \param [in, out] store The chunk store to search.
+ * \param [in] match The cells sought.
+ * \returns The number of cells which match.
+ */
+[[nodiscard]] size_t ChunkStoreCount(ChunkStore* store, const CellMatch* match);
+
+/**
+ * \brief Transforms the whole grid in place, which may swap its dimensions.
+ * \param [in, out] store The chunk store to transform.
+ * \param [in] type The transform.
+ * \returns Void.
+ */
+void ChunkStoreTransform(ChunkStore* store, TransformType type);
+
+/**
+ * \brief Resizes the grid in place to an area of it, cropping or extending it.
+ * \param [in, out] store The chunk store to resize.
+ * \param [in] rect The area of the grid to keep, in cells of the grid as it
+ * is. It may reach beyond the grid on any side to extend it.
+ * \param [in] fill The value of every cell added.
+ * \returns Void.
+ */
+void ChunkStoreResize(ChunkStore* store, SDL_Rect rect, Cell fill);
+
+/**
+ * \brief Finds the smallest area of the grid outside of which every cell is
+ * blank.
+ * \param [in, out] store The chunk store to search.
+ * \param [in] blank The value of a blank cell.
+ * \returns The bounds of the cells which are not blank, or an empty rectangle
+ * if every cell is.
+ */
+[[nodiscard]] SDL_Rect ChunkStoreBounds(ChunkStore* store, Cell blank);
+
+/**
+ * \brief Compresses the least recently used chunks which have gone cold.
+ * \param [in, out] store The chunk store to compress chunks of.
+ * \param [in] now The current ticks.
+ * \param [in] budget The maximum number of chunks to compress.
+ * \returns The number of chunks compressed.
+ */
+size_t ChunkStoreCompressCold(ChunkStore* store, u32 now, size_t budget);
+
+/**
+ * \brief Totals the memory held by the cells of a chunk store.
+ * \param [in, out] store The chunk store to measure.
+ * \returns The number of bytes of resident and compressed cells.
+ */
+[[nodiscard]] size_t ChunkStoreMemory(ChunkStore* store);
+
+#endif
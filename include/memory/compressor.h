@@ -0,0 +1,79 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file compressor.h
+ *
+ * \brief The compressor is a background thread which periodically compresses
+ * the cold chunks of every chunk store registered with it.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef COMPRESSOR_H
+#define COMPRESSOR_H
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "memory/chunkstore.h"
+#include "memory/vector.h"
+
+/**
+ * \desc The time in milliseconds between passes of the compressor.
+ */
+#define COMPRESSOR_INTERVAL 1000
+
+/**
+ * \desc The maximum number of chunks compressed per store in a single pass.
+ */
+#define COMPRESSOR_BUDGET 64
+
+/**
+ * \brief A background thread compressing cold chunks.
+ *
+ * Stores are registered and unregistered by their owner. The lock is held for
+ * the whole of a pass, so once a store has been unregistered the compressor
+ * will no longer touch it and it may be freed.
+ */
+typedef struct [[nodiscard]]
+{
+    SDL_Thread* thread; /**< The compressor thread. */
+    SDL_mutex* lock;    /**< Guards the stores and the running flag. */
+    SDL_cond* wake;     /**< Signalled to stop the thread. */
+    Vector* stores;     /**< Registered chunk stores. */
+    bool running;       /**< Cleared to stop the thread. */
+} Compressor;
+
+/**
+ * \brief Creates a compressor and starts its thread.
+ * \returns Pointer to a compressor object.
+ */
+[[nodiscard]] Compressor* CompressorCreate(void);
+
+/**
+ * \brief Stops the compressor thread and frees its memory. Registered stores
+ * are not freed.
+ * \param [in, out] comp The compressor to be freed.
+ * \returns Void.
+ */
+void CompressorFree(Compressor* comp);
+
+/**
+ * \brief Registers a chunk store to have its cold chunks compressed.
+ * \param [in, out] comp The compressor to register with.
+ * \param [in] store The chunk store to register.
+ * \returns Void.
+ */
+void CompressorAdd(Compressor* comp, ChunkStore* store);
+
+/**
+ * \brief Unregisters a chunk store, waiting for any pass in progress.
+ * \param [in, out] comp The compressor to unregister from.
+ * \param [in] store The chunk store to unregister.
+ * \returns Void.
+ */
+void CompressorRemove(Compressor* comp, const ChunkStore* store);
+
+#endif
@@ -0,0 +1,182 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file concmap.h
+ *
+ * \brief A concurrent map is a read-mostly hashmap which may be searched from
+ * any thread without taking a lock. Writers are serialised by a mutex and never
+ * modify a record in place: records and tables are replaced atomically and the
+ * old ones are only freed once no reader can still be looking at them.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef CONCMAP_H
+#define CONCMAP_H
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "memory/phash.h"
+
+/**
+ * \desc The initial number of slots of a concurrent map, as a power of two.
+ */
+#define CONCMAP_INITIAL_SIZE 16
+
+/**
+ * \desc Percentage of used slots (including deleted ones) above which the table
+ * of a concurrent map is rebuilt.
+ */
+#define CONCMAP_LOAD_INCREASE 70
+
+/**
+ * \brief An immutable key-value pair of a concurrent map.
+ *
+ * The hash of the key is stored alongside it so that probing only compares
+ * strings for likely matches.
+ */
+typedef struct [[nodiscard]]
+{
+    char* key;   /**< The key string of the record. */
+    void* value; /**< The data associated with the key. */
+    u32 hash;    /**< Hash of the key. */
+} ConcurrentRecord;
+
+/**
+ * \brief An open-addressed table of record pointers.
+ *
+ * A table is published as a whole: readers always probe a single table, and a
+ * resize builds a new table which then replaces the old one atomically.
+ */
+typedef struct [[nodiscard]]
+{
+    size_t size;                /**< Number of slots (a power of two). */
+    size_t used;                /**< Slots holding a record or tombstone. */
+    ConcurrentRecord** records; /**< The record slots. */
+} ConcurrentTable;
+
+/**
+ * \brief A hashmap with lock-free searches and serialised writers.
+ *
+ * Readers announce themselves in one of two counters, chosen by the parity of
+ * the current epoch. A writer which unlinks a record or table advances the
+ * epoch and waits for the readers of the previous epoch to drain before freeing
+ * what it unlinked. Only writers ever wait; readers never block.
+ * A free function is provided for the values, as with a regular hashmap.
+ */
+typedef struct [[nodiscard]]
+{
+    ConcurrentTable* table;  /**< Currently published table. */
+    size_t count;            /**< Number of live records. */
+    SDL_mutex* write_lock;   /**< Serialises writers. */
+    SDL_atomic_t epoch;      /**< Current reader epoch. */
+    SDL_atomic_t readers[2]; /**< Active readers per epoch parity. */
+    struct [[nodiscard]]
+    {
+        void (*free)();
+    } functions;
+} ConcurrentMap;
+
+/**
+ * \brief Creates a concurrent map record with a key, a value and its hash.
+ * \param [in] key The key string for the record.
+ * \param [in] value The actual data associated with that key.
+ * \param [in] hash The hash of the key.
+ * \returns Pointer to a concurrent map record.
+ */
+[[nodiscard]] ConcurrentRecord* ConcurrentRecordCreate(const char* key,
+                                                       void* value, u32 hash);
+
+/**
+ * \brief Frees the memory of a concurrent map record, but not its value.
+ * \param [out] record The record to be freed.
+ * \returns Void.
+ */
+void ConcurrentRecordFree(ConcurrentRecord* record);
+
+/**
+ * \brief Creates a table of empty record slots.
+ * \param [in] size The number of slots, as a power of two.
+ * \returns Pointer to a concurrent table.
+ */
+[[nodiscard]] ConcurrentTable* ConcurrentTableCreate(size_t size);
+
+/**
+ * \brief Frees the memory of a table, but not the records within.
+ * \param [out] table The table to be freed.
+ * \returns Void.
+ */
+void ConcurrentTableFree(ConcurrentTable* table);
+
+/**
+ * \brief Creates an empty concurrent map.
+ * \param [in] free A function pointer to a memory free function for values.
+ * \returns Pointer to an empty concurrent map.
+ */
+[[nodiscard]] ConcurrentMap* ConcurrentMapCreate(void (*free)());
+
+/**
+ * \brief Frees the memory of a concurrent map and data within if recursive is
+ * set. No other thread may use the map at this point.
+ * \param [out] map The concurrent map to be freed.
+ * \param [in] recursive Flag to determine whether values are freed.
+ * \returns Void.
+ */
+void ConcurrentMapFree(ConcurrentMap* map, bool recursive);
+
+/**
+ * \brief Inserts a key-value pair, replacing the value of an existing key.
+ * \param [in, out] map The concurrent map to insert into.
+ * \param [in] key A string key used to identify the value.
+ * \param [in] value A pointer to some data to add to the map.
+ * \returns Void.
+ */
+void ConcurrentMapInsert(ConcurrentMap* map, const char* key, void* value);
+
+/**
+ * \brief Searches a concurrent map without locking. May be called from any
+ * thread, concurrently with writers.
+ * \param [in] map The concurrent map to search.
+ * \param [in] key The key used for the search.
+ * \returns A value (if found) associated with the given key, or NULL. The value
+ * stays valid until its key is replaced or deleted; a reader racing with such a
+ * writer must wrap the search and its use of the value in ConcurrentMapEnter
+ * and ConcurrentMapExit.
+ */
+void* ConcurrentMapSearch(ConcurrentMap* map, const char* key);
+
+/**
+ * \brief Deletes a record within a concurrent map if the key is found.
+ * \param [in, out] map The concurrent map to delete a record from.
+ * \param [in] key The key of the record to delete.
+ * \returns Void.
+ */
+void ConcurrentMapDelete(ConcurrentMap* map, const char* key);
+
+/**
+ * \brief Announces a reader of a concurrent map.
+ * \param [in, out] map The concurrent map about to be read.
+ * \returns The epoch parity the reader was counted in.
+ */
+[[nodiscard]] i32 ConcurrentMapEnter(ConcurrentMap* map);
+
+/**
+ * \brief Withdraws a reader of a concurrent map.
+ * \param [in, out] map The concurrent map which was read.
+ * \param [in] parity The epoch parity returned when entering.
+ * \returns Void.
+ */
+void ConcurrentMapExit(ConcurrentMap* map, i32 parity);
+
+/**
+ * \brief Waits until every reader which could have seen an unlinked record or
+ * table has finished. Must only be called by a writer holding the write lock.
+ * \param [in, out] map The concurrent map to synchronise.
+ * \returns Void.
+ */
+void ConcurrentMapSynchronise(ConcurrentMap* map);
+
+#endif
@@ -0,0 +1,140 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file lz.h
+ *
+ * \brief A small, fast LZ77 block codec in the style of LZ4. It trades ratio
+ * for speed: compression is a single greedy pass with a hash table of recent
+ * positions, and decompression is little more than a sequence of copies.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef LZ_H
+#define LZ_H
+
+#include "core/common.h"
+#include "core/utils.h"
+
+/**
+ * \desc The shortest match worth encoding, in bytes.
+ */
+#define LZ_MIN_MATCH 4
+
+/**
+ * \desc The number of bytes at the end of a block which are always stored as
+ * literals, so that matching never reads past the end of the input.
+ */
+#define LZ_LAST_LITERALS 5
+
+/**
+ * \desc The furthest back a match may refer to.
+ */
+#define LZ_MAX_OFFSET 65535
+
+/**
+ * \desc The most a block can expand by when decompressed, as each byte of a
+ * match length adds at most 255 bytes.
+ */
+#define LZ_MAX_RATIO 255
+
+/**
+ * \desc The number of bits of the position hash table.
+ */
+#define LZ_HASH_BITS 12
+
+/**
+ * \desc The length of the pieces of sample data a dictionary is made from,
+ * the length of the sequences counted to score them, and the number of bits of
+ * the table they are counted in.
+ */
+#define LZ_TRAIN_SEGMENT 64
+#define LZ_TRAIN_SEQUENCE 8
+#define LZ_TRAIN_BITS 16
+
+/**
+ * \desc The largest compressed size of a block of a given size, should none of
+ * it compress.
+ */
+#define LZ_BOUND(size) ((size) + (size) / 255 + 16)
+
+/**
+ * \brief Compresses a block of memory.
+ *
+ * A block is a sequence of tokens, each holding a run of literal bytes and then
+ * a match: an offset back into the output and a length to copy. The high and
+ * low nibbles of the token hold the literal and match lengths, with a nibble of
+ * 15 followed by extra length bytes. The final token only holds literals.
+ *
+ * \param [in] src The data to compress.
+ * \param [in] size The size of the data in bytes.
+ * \param [out] dst The buffer for the compressed data.
+ * \param [in] capacity The size of the buffer in bytes.
+ * \returns The compressed size in bytes, or zero if it did not fit.
+ */
+[[nodiscard]] size_t LzCompress(const u8* src, size_t size, u8* dst,
+                                size_t capacity);
+
+/**
+ * \brief Decompresses a block of memory.
+ * \param [in] src The compressed data.
+ * \param [in] size The size of the compressed data in bytes.
+ * \param [out] dst The buffer for the decompressed data.
+ * \param [in] dst_size The exact size of the decompressed data in bytes.
+ * \returns Whether the block was valid and decompressed to exactly dst_size.
+ */
+[[nodiscard]] bool LzDecompress(const u8* src, size_t size, u8* dst,
+                                size_t dst_size);
+
+/**
+ * \brief Compresses a block of memory, letting matches refer back into a
+ * dictionary of data which is likely to recur, as though it came just before
+ * the block.
+ * \param [in] src The data to compress.
+ * \param [in] size The size of the data in bytes.
+ * \param [in] dict The dictionary, which may be NULL if dict_size is zero.
+ * \param [in] dict_size The size of the dictionary in bytes.
+ * \param [out] dst The buffer for the compressed data.
+ * \param [in] capacity The size of the buffer in bytes.
+ * \returns The compressed size in bytes, or zero if it did not fit.
+ */
+[[nodiscard]] size_t LzCompressDict(const u8* src, size_t size, const u8* dict,
+                                    size_t dict_size, u8* dst,
+                                    size_t capacity);
+
+/**
+ * \brief Decompresses a block of memory compressed against a dictionary.
+ * \param [in] src The compressed data.
+ * \param [in] size The size of the compressed data in bytes.
+ * \param [in] dict The dictionary the block was compressed against.
+ * \param [in] dict_size The size of the dictionary in bytes.
+ * \param [out] dst The buffer for the decompressed data.
+ * \param [in] dst_size The exact size of the decompressed data in bytes.
+ * \returns Whether the block was valid and decompressed to exactly dst_size.
+ */
+[[nodiscard]] bool LzDecompressDict(const u8* src, size_t size,
+                                    const u8* dict, size_t dict_size, u8* dst,
+                                    size_t dst_size);
+
+/**
+ * \brief Trains a dictionary from samples of the data it is to compress.
+ *
+ * The dictionary is made of the pieces of the samples holding the most
+ * sequences which recur across many samples, the best of them last so that
+ * they are nearest the data being compressed.
+ *
+ * \param [in] samples The sample data.
+ * \param [in] sizes The size of each sample in bytes.
+ * \param [in] count The number of samples.
+ * \param [out] dict The buffer for the dictionary.
+ * \param [in] capacity The size of the buffer in bytes.
+ * \returns The size of the dictionary in bytes, which is zero if the samples
+ * have nothing in common.
+ */
+[[nodiscard]] size_t LzTrain(const u8* const* samples, const size_t* sizes,
+                             size_t count, u8* dict, size_t capacity);
+
+#endif
@@ -0,0 +1,92 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file phash.h
+ *
+ * \brief A perfect hash is a read-only lookup table for a set of keys which is
+ * known at build time. The tables are emitted by the phashgen tool so that each
+ * key maps to its own slot: a lookup is a single probe with no collisions and
+ * no allocation.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef PHASH_H
+#define PHASH_H
+
+#include "core/common.h"
+#include "core/utils.h"
+
+/**
+ * \desc The FNV-1a offset basis and prime used by the perfect hash function.
+ */
+#define PHASH_OFFSET 2166136261u
+#define PHASH_PRIME 16777619u
+
+/**
+ * \desc The number of displacement seeds to try per bucket before giving up.
+ */
+#define PHASH_MAX_ATTEMPTS (1u << 24)
+
+/**
+ * \brief A minimal perfect hash table for a fixed set of string keys.
+ *
+ * Keys are first hashed with a zero seed to choose a bucket. Each bucket stores
+ * a displacement seed which, when used to hash any key of that bucket, places
+ * it in a unique slot of the key table. A zero displacement marks an empty
+ * bucket. The key table has exactly as many slots as there are keys.
+ */
+typedef struct [[nodiscard]]
+{
+    size_t count;             /**< Number of keys (and slots). */
+    size_t num_buckets;       /**< Number of displacement buckets. */
+    const u32* displacements; /**< Displacement seed per bucket. */
+    const char* const* keys;  /**< Keys stored in slot order. */
+} PerfectHash;
+
+/**
+ * \brief Generates a seeded hash from string input.
+ * \param [in] str The string to generate a hash for.
+ * \param [in] seed The seed to mix into the hash.
+ * \returns The 32-bit hash of the string.
+ */
+[[nodiscard]] u32 PerfectHashFunction(const char* str, u32 seed);
+
+/**
+ * \brief Builds the displacements of a minimal perfect hash table.
+ * \param [in] keys The distinct keys of the set.
+ * \param [in] count The number of keys.
+ * \param [in] num_buckets The number of displacement buckets.
+ * \param [out] displacements The displacement seed of each bucket.
+ * \param [out] slots The index of the key placed in each slot.
+ * \returns Whether a displacement was found for every bucket.
+ */
+[[nodiscard]] bool PerfectHashGenerate(const char* const* keys, size_t count,
+                                       size_t num_buckets, u32* displacements,
+                                       u32* slots);
+
+/**
+ * \brief Retrieves the only slot a key could occupy, from the displacements of
+ * a perfect hash table whose keys are kept elsewhere.
+ * \param [in] displacements The displacement seed of each bucket.
+ * \param [in] num_buckets The number of displacement buckets.
+ * \param [in] count The number of keys (and slots).
+ * \param [in] key The key used for the search.
+ * \returns The slot the key would occupy, or -1 if it cannot be in the set.
+ */
+[[nodiscard]] i32 PerfectHashSlot(const u32* displacements,
+                                  size_t num_buckets, size_t count,
+                                  const char* key);
+
+/**
+ * \brief Retrieves the slot of a key within a perfect hash table.
+ * \param [in] phash The perfect hash table to search.
+ * \param [in] key The key used for the search.
+ * \returns The slot of the key, or -1 if the key is not part of the set.
+ */
+[[nodiscard]] i32 PerfectHashLookup(const PerfectHash* phash, const char* key);
+
+#endif
@@ -0,0 +1,91 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file timingwheel.h
+ *
+ * \brief A timing wheel schedules keys to expire at given times. Time is split
+ * into slots of a fixed resolution which wrap around the wheel, so scheduling
+ * is constant time and advancing the wheel only visits the slots which have
+ * passed, however many keys are scheduled further ahead.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include "core/common.h"
+#include "core/utils.h"
+
+/**
+ * \desc The number of slots of a wheel. Must be a power of two.
+ */
+#define TIMING_WHEEL_SLOTS 64
+
+/**
+ * \brief A key scheduled in a timing wheel.
+ *
+ * Entries live in a single pool, linked into the list of their slot or, when
+ * unused, into the free list. An entry due further ahead than one turn of the
+ * wheel stays in its slot until the turn in which it is due.
+ */
+typedef struct [[nodiscard]]
+{
+    u32 key;  /**< The scheduled key. */
+    u32 due;  /**< Time at which the key expires. */
+    i32 next; /**< Next entry of the same list, or -1. */
+} TimingEntry;
+
+/**
+ * \brief A hashed timing wheel.
+ */
+typedef struct [[nodiscard]]
+{
+    TimingEntry* entries;           /**< Pool of entries. */
+    size_t capacity;                /**< Number of entries in the pool. */
+    size_t count;                   /**< Number of scheduled entries. */
+    i32 free;                       /**< First unused entry, or -1. */
+    i32 slots[TIMING_WHEEL_SLOTS];  /**< First entry of each slot, or -1. */
+    u32 resolution;                 /**< Length of a slot in milliseconds. */
+    u32 now;                        /**< Time the wheel was advanced to. */
+} TimingWheel;
+
+/**
+ * \brief Creates an empty timing wheel.
+ * \param [in] resolution The length of a slot in milliseconds.
+ * \param [in] now The current time.
+ * \returns Pointer to a timing wheel.
+ */
+[[nodiscard]] TimingWheel* TimingWheelCreate(u32 resolution, u32 now);
+
+/**
+ * \brief Frees the timing wheel memory.
+ * \param [in, out] wheel The timing wheel to be freed.
+ * \returns Void.
+ */
+void TimingWheelFree(TimingWheel* wheel);
+
+/**
+ * \brief Schedules a key. A key due in the past expires on the next advance.
+ * \param [in, out] wheel The timing wheel to schedule in.
+ * \param [in] key The key to schedule.
+ * \param [in] due The time at which the key expires.
+ * \returns Void.
+ */
+void TimingWheelSchedule(TimingWheel* wheel, u32 key, u32 due);
+
+/**
+ * \brief Advances a timing wheel, expiring every key which has fallen due.
+ * \param [in, out] wheel The timing wheel to advance.
+ * \param [in] now The current time.
+ * \param [in] expire Called with each expired key. It may schedule keys.
+ * \param [in, out] data Passed to each call of expire.
+ * \returns The number of keys expired.
+ */
+size_t TimingWheelAdvance(TimingWheel* wheel, u32 now,
+                          void (*expire)(void* data, u32 key), void* data);
+
+#endif
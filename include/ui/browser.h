@@ -0,0 +1,177 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file browser.h
+ *
+ * \brief A file browser shows the maps and subdirectories of a directory as a
+ * grid of thumbnails. Directories are listed and thumbnails made on worker
+ * threads, so that the browser stays smooth however many maps there are, with
+ * the thumbnails streaming in as they are ready.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef BROWSER_H
+#define BROWSER_H
+
+#include "core/common.h"
+#include "core/input.h"
+#include "core/mapfile.h"
+#include "core/pack.h"
+#include "core/utils.h"
+#include "graphics/color.h"
+#include "graphics/texture.h"
+#include "graphics/thumbnail.h"
+#include "graphics/window.h"
+#include "ui/label.h"
+
+/**
+ * \desc The maximum length of a path, and of the name of an entry.
+ */
+#define BROWSER_MAX_PATH THUMBNAIL_MAX_PATH
+#define BROWSER_MAX_NAME 128
+
+/**
+ * \desc The number of worker threads listing directories and making
+ * thumbnails.
+ */
+#define BROWSER_WORKERS 2
+
+/**
+ * \desc The width and height of a thumbnail in the browser in glyph units.
+ */
+#define BROWSER_THUMB_SIZE 4
+
+/**
+ * \desc The number of rows beyond those shown whose thumbnails are made ahead
+ * of time, and the number beyond which shown thumbnails are let go again.
+ */
+#define BROWSER_PREFETCH 2
+#define BROWSER_KEEP 8
+
+/**
+ * \desc The most thumbnails copied to textures in a single frame.
+ */
+#define BROWSER_UPLOADS 8
+
+/**
+ * \brief Describes how far along the thumbnail of an entry is.
+ */
+typedef enum
+{
+    BROWSER_THUMB_NONE,    /**< Not yet asked for. */
+    BROWSER_THUMB_PENDING, /**< Being made by a worker. */
+    BROWSER_THUMB_READY,   /**< Made, but not yet copied to a texture. */
+    BROWSER_THUMB_SHOWN,   /**< Copied to a texture. */
+    BROWSER_THUMB_FAILED   /**< The map could not be read. */
+} BrowserThumbState;
+
+/**
+ * \brief A map or subdirectory of the directory being browsed.
+ */
+typedef struct [[nodiscard]]
+{
+    char name[BROWSER_MAX_NAME]; /**< Name within the directory. */
+    bool is_dir;                 /**< Whether it is a subdirectory. */
+    BrowserThumbState state;     /**< How far along the thumbnail is. */
+    Thumbnail thumb;             /**< Pixels of the thumbnail, once ready. */
+    SDL_Texture* texture;        /**< Texture of the thumbnail, once shown. */
+} BrowserEntry;
+
+/**
+ * \brief A grid of the thumbnails of a directory.
+ *
+ * The entries are the parent directory, then the subdirectories and packs and
+ * then the maps, each in order of name. Workers wait on the condition for a
+ * directory to list or for thumbnails to make, taking those of the rows shown
+ * first and then those just beyond them. Textures are only made and destroyed
+ * on the thread which renders, so a fresh listing is handed over to it to
+ * replace the entries when next rendered. The generation changes whenever
+ * another directory is opened, so that the work of a worker on the old one is
+ * thrown away. The header row shows the name of the entry under the mouse, or
+ * else the directory. Clicking a subdirectory or pack opens it, and clicking a
+ * map sets the picked flag, which is cleared by whoever acts upon it.
+ */
+typedef struct [[nodiscard]]
+{
+    SDL_Rect rect;                        /**< Area in glyph units. */
+    char dir[BROWSER_MAX_PATH];           /**< Directory being browsed. */
+    char cache[BROWSER_MAX_PATH];         /**< Directory of thumbnails. */
+    BrowserEntry* entries;                /**< Entries of the directory. */
+    size_t count;                         /**< Number of entries. */
+    BrowserEntry* listing;                /**< Listing to replace them. */
+    size_t listing_count;                 /**< Number of listed entries. */
+    u32 generation;                       /**< Bumped on opening a dir. */
+    bool scan;                            /**< Whether to list the dir. */
+    bool scanning;                        /**< Whether it is being listed. */
+    i32 scroll;                           /**< First row shown. */
+    i32 hovered;                          /**< Entry under the mouse. */
+    Label* header;                        /**< Shows the hovered entry. */
+    char picked[BROWSER_MAX_PATH];        /**< Path of the picked map. */
+    bool pick;                            /**< Flag to check for a pick. */
+    SDL_Thread* workers[BROWSER_WORKERS]; /**< The worker threads. */
+    SDL_mutex* lock;                      /**< Guards all of the above. */
+    SDL_cond* wake;                       /**< Signalled when there is work. */
+    bool running;                         /**< Cleared to stop workers. */
+} Browser;
+
+/**
+ * \brief Creates a browser with no directory and starts its workers.
+ * \param [in] rect The area of the browser in glyph units.
+ * \returns Pointer to a browser object.
+ */
+[[nodiscard]] Browser* BrowserCreate(SDL_Rect rect);
+
+/**
+ * \brief Stops the workers and frees the browser memory.
+ * \param [in, out] browser The browser to be freed.
+ * \returns Void.
+ */
+void BrowserFree(Browser* browser);
+
+/**
+ * \brief Sets the directory thumbnails are cached in, creating it if need be.
+ * \param [in, out] browser The browser to set the cache of.
+ * \param [in] cache The directory of cached thumbnails.
+ * \returns Void.
+ */
+void BrowserSetCache(Browser* browser, const char* cache);
+
+/**
+ * \brief Browses another directory, which is listed in the background.
+ * \param [in, out] browser The browser to change the directory of.
+ * \param [in] dir The directory to browse.
+ * \returns Void.
+ */
+void BrowserOpen(Browser* browser, const char* dir);
+
+/**
+ * \brief Lists the directory of a browser again, such as after a map has been
+ * saved to it, keeping the rows shown.
+ * \param [in, out] browser The browser to refresh.
+ * \returns Void.
+ */
+void BrowserRefresh(Browser* browser);
+
+/**
+ * \brief Deals with the input of a browser.
+ * \param [in, out] browser The browser to test input from.
+ * \param [in] input An input handler.
+ * \returns Void.
+ */
+void BrowserHandleInput(Browser* browser, const Input* input);
+
+/**
+ * \brief Renders the thumbnails of a browser, copying those which are ready
+ * to textures first.
+ * \param [in, out] browser Browser to render.
+ * \param [in] wind Window to render to.
+ * \param [in] tex Texture to render from.
+ * \returns Void.
+ */
+void BrowserRender(Browser* browser, const Window* wind, const Texture* tex);
+
+#endif
@@ -16,13 +16,24 @@
 #define CANVAS_H
 
 #include "core/common.h"
+#include "core/history.h"
 #include "core/input.h"
+#include "core/journal.h"
+#include "core/macro.h"
 #include "core/utils.h"
+#include "graphics/animation.h"
+#include "graphics/brush.h"
 #include "graphics/color.h"
 #include "graphics/glyph.h"
+#include "graphics/gradient.h"
 #include "graphics/texture.h"
+#include "graphics/transform.h"
 #include "graphics/window.h"
+#include "memory/chunkstore.h"
+#include "memory/timingwheel.h"
 #include "memory/vector.h"
+#include "ui/minimap.h"
+#include "ui/stamps.h"
 
 /**
  * \brief Describes a canvas operation.
@@ -36,28 +47,208 @@ typedef enum
     CANVAS_NONE = 0,
     CANVAS_PLACE = 1,
     CANVAS_SELECT = 2,
-    CANVAS_ERASE = 3
+    CANVAS_ERASE = 3,
+    CANVAS_MARK = 4
 } CanvasOperation;
 
+/**
+ * \brief Describes the point of a canvas which stays put when it is resized.
+ *
+ * The anchors run across each row of a three by three grid, from the top left
+ * to the bottom right, so the column of an anchor is its value modulo three
+ * and the row its value divided by three.
+ */
+typedef enum
+{
+    CANVAS_ANCHOR_TOP_LEFT = 0,
+    CANVAS_ANCHOR_TOP = 1,
+    CANVAS_ANCHOR_TOP_RIGHT = 2,
+    CANVAS_ANCHOR_LEFT = 3,
+    CANVAS_ANCHOR_CENTRE = 4,
+    CANVAS_ANCHOR_RIGHT = 5,
+    CANVAS_ANCHOR_BOTTOM_LEFT = 6,
+    CANVAS_ANCHOR_BOTTOM = 7,
+    CANVAS_ANCHOR_BOTTOM_RIGHT = 8
+} CanvasAnchor;
+
+/**
+ * \desc The range of canvas zoom levels. From level zero up, cells are drawn
+ * one more times their size than the level, so that 7 draws them eight times
+ * larger; each level below zero halves them, so that -1 draws them at half
+ * size.
+ */
+#define CANVAS_ZOOM_MIN -2
+#define CANVAS_ZOOM_MAX (TEXTURE_MAX_SCALE - 1)
+
+/**
+ * \desc The resolution of the timing wheel of animated chunks in milliseconds.
+ */
+#define CANVAS_ANIMATION_RESOLUTION 16
+
+/**
+ * \brief A write of a cell staged by a canvas transaction.
+ *
+ * Writes are addressed by chunk and by cell within the chunk, so that sorting
+ * them groups the writes of each chunk together. The order in which writes
+ * were made settles which of several writes to the same cell wins.
+ */
+typedef struct [[nodiscard]]
+{
+    u32 chunk;  /**< Index of the chunk of the cell. */
+    u16 offset; /**< Index of the cell within its chunk. */
+    u32 order;  /**< Position of the write in the transaction. */
+    Cell cell;  /**< The value written. */
+} CanvasPending;
+
+/**
+ * \brief The writes of an open canvas transaction.
+ *
+ * Transactions nest: only the commit of the outermost applies the writes made
+ * since it began. The changes of each commit are kept until the next, so that
+ * listeners may read them.
+ */
+typedef struct [[nodiscard]]
+{
+    CanvasPending* writes; /**< Staged writes, in the order made. */
+    size_t count;          /**< Number of staged writes. */
+    size_t capacity;       /**< Number of writes allocated. */
+    u32 depth;             /**< Number of transactions open. */
+    bool record;           /**< Whether changes are recorded to the history. */
+    HistoryEdit* changes;  /**< Cells changed by the last commit. */
+    size_t num_changes;    /**< Number of cells changed by the last commit. */
+    size_t cap_changes;    /**< Number of changes allocated. */
+} CanvasTransaction;
+
+/**
+ * \brief The cells changed by the commit of a canvas transaction.
+ */
+typedef struct [[nodiscard]]
+{
+    const HistoryEdit* edits; /**< The changed cells, in order of chunk. */
+    size_t count;             /**< Number of changed cells. */
+    SDL_Rect bounds;          /**< Smallest area holding every change. */
+} CanvasChange;
+
+/**
+ * \brief A callback notified of every change of a canvas.
+ */
+typedef struct [[nodiscard]]
+{
+    void (*notify)(void* data, const CanvasChange* change); /**< Callback. */
+    void* data;                                             /**< Its data. */
+} CanvasListener;
+
+/**
+ * \desc The most memory the chunk caches of a canvas may take, in bytes. Only
+ * as many chunks as fit are cached at once, whatever the size of the map, and
+ * a chunk cached zoomed in takes the room of the square of its scale.
+ */
+#define CANVAS_CACHE_BYTES (128 * 1024 * 1024)
+
+/**
+ * \brief The cached rendering of a chunk of a canvas.
+ *
+ * Only chunks which are drawn by a view are rendered, each into a slot of a
+ * fixed number of them, at the scale of the zoom level they are drawn at, so
+ * that they are copied one to one. A chunk drawn at several scales has a slot
+ * for each. The slot used least recently is given over to a chunk which has
+ * none, keeping its texture when it is of the same scale. Animated cells are
+ * drawn with their frame at the frame time of their chunk. A chunk with
+ * animated cells is scheduled to be redrawn at the next change of frame
+ * whenever it is drawn by a view, so chunks which are not shown are never
+ * animated.
+ */
+typedef struct [[nodiscard]]
+{
+    SDL_Texture* texture;           /**< Rendered glyphs of the chunk. */
+    u64 animated[CHUNK_CELLS / 64]; /**< Bit mask of the animated cells. */
+    u64 dirty[CHUNK_CELLS / 64];    /**< Bit mask of the cells to redraw. */
+    i32 key;                        /**< Index of the chunk held, or -1. */
+    u32 used;                       /**< Frame the chunk was last drawn in. */
+    u32 frame_time;                 /**< Time the animations are drawn at. */
+    u16 num_dirty;                  /**< Number of cells to be redrawn. */
+    u8 scale;                       /**< Factor the glyphs are scaled by. */
+    bool scheduled;                 /**< Whether the chunk is to be animated. */
+} CanvasChunk;
+
+/**
+ * \brief A region of glyphs which can be drawn onto.
+ *
+ * The glyphs are stored as cells in a chunk store, and are addressed by index
+ * in row-major order. Every write goes through a transaction, whose commit
+ * applies its writes a chunk at a time and then publishes the cells which
+ * changed at once: to the cache, the minimap, the history and any listeners.
+ * The rectangle is the area of the window the canvas is shown in, scrolled by
+ * the offset; it need not match the size of the cells. Each chunk of cells
+ * shown by a view is rendered once into a cache texture of its own at each
+ * scale it is zoomed in to, and only cells marked as dirty are redrawn into it.
+ * Any number of views may then draw the canvas from the same caches, which are
+ * bounded in memory and recycled from the chunk drawn least recently. Edits
+ * are recorded into a history when one is attached, every change is logged to
+ * a journal when one is attached, each use of a tool is recorded to a macro
+ * when one is attached, and edits are drawn into a minimap when one is
+ * attached. Animated cells are only animated whilst a set of animations is
+ * attached. Glyphs are placed and erased a cell at a time, or by stamping a
+ * brush when one is set. With a stamp set, placing copies the whole block of
+ * the stamp instead, and with a gradient set, dragging fills the selection (or
+ * the whole canvas) with the gradient, which is refilled as the mouse moves. A
+ * rectangle of cells may be marked as the selection. The selection, or else
+ * the whole canvas, may be rotated, flipped or transposed. The cells may also
+ * be cropped or extended on any side.
+ */
 typedef struct [[nodiscard]]
 {
-    Vector* glyphs;     /**< List of glyphs within the canvas. */
-    CanvasOperation op; /**< Current canvas operation. */
-    size_t glyph_index; /**< Index of glyph to perform operation. */
-    SDL_Rect rect;      /**< Canvas dimensions in pixel units. */
-    i32 offset_x;       /**< Offset of the canvas in the x-direction. */
-    i32 offset_y;       /**< Offset of the canvas in the y-direction. */
-    bool writable;      /**< Determines whether the canvas can be edited. */
+    ChunkStore* cells;        /**< The cells of the canvas. */
+    CanvasOperation op;       /**< Current canvas operation. */
+    size_t glyph_index;       /**< Index of glyph to perform operation. */
+    SDL_Rect rect;            /**< Canvas dimensions in glyph units. */
+    i32 offset_x;             /**< Offset of the canvas in the x-direction. */
+    i32 offset_y;             /**< Offset of the canvas in the y-direction. */
+    bool writable;            /**< Whether the canvas can be edited. */
+    History* history;         /**< History edits are recorded to, if any. */
+    Journal* journal;         /**< Journal changes are logged to, if any. */
+    Macro* macro;             /**< Macro tools are recorded to, if any. */
+    Minimap* minimap;         /**< Minimap edits are drawn into, if any. */
+    CanvasChunk* cache;       /**< Rendered glyphs of the cached chunks. */
+    size_t num_cached;        /**< Number of cache slots. */
+    size_t cache_budget;      /**< Chunks at scale one the cache may hold. */
+    size_t cache_used;        /**< Chunks at scale one the slots take up. */
+    i32** resident;           /**< Slot of each chunk by scale, or -1. */
+    Texture** scaled;         /**< Copies of the texture by scale. */
+    const Texture* cache_tex; /**< Texture the cache was rendered from. */
+    u32 cache_frame;          /**< Number of times the cache was refreshed. */
+    size_t num_dirty;         /**< Number of cells to be redrawn. */
+    const Animations* anims;  /**< Animations previewed, if any. */
+    TimingWheel* wheel;       /**< Chunks to be animated, by frame change. */
+    const Brush* brush;       /**< Brush stamped by edits, if any. */
+    SDL_Point stroke;         /**< Cell the brush was last stamped at. */
+    bool stroking;            /**< Whether a stroke of the brush is underway. */
+    Stamp* stamp;             /**< Stamp placed by edits, if any. */
+    SDL_Rect selection;       /**< Marked cells, empty if there are none. */
+    SDL_Point anchor;         /**< Cell the selection was marked from. */
+    bool marking;             /**< Whether the selection is being marked. */
+    const Gradient* gradient; /**< Gradient filled by edits, if any. */
+    SDL_Point fill_end;       /**< Cell the gradient was last filled to. */
+    CanvasTransaction txn;    /**< Writes of the open transaction. */
+    Vector* listeners;        /**< Listeners notified of changes. */
 } Canvas;
 
 /**
- * \brief Create a canvas with initial dimensions.
+ * \brief Create a canvas with initial dimensions and blank cells.
  * \param [in] rect The dimensions of the canvas in glyph units.
  * \param [in] writable Sets whether the canvas can be written to.
  * \returns Pointer to a canvas object.
  */
 [[nodiscard]] Canvas* CanvasCreate(SDL_Rect rect, bool writable);
 
+/**
+ * \brief Create a copy of a canvas, sharing nothing but the attached history,
+ * journal and macro.
+ * \param [in, out] canvas The canvas to copy.
+ * \returns Pointer to a canvas object.
+ */
+[[nodiscard]] Canvas* CanvasClone(Canvas* canvas);
+
 /**
  * \brief Frees the canvas memory.
  * \param [in, out] canvas The canvas to be freed.
@@ -81,6 +272,59 @@ void CanvasHandleInput(Canvas* canvas, const Input* input);
  */
 void CanvasUpdate(Canvas* canvas, Glyph* cur_glyph);
 
+/**
+ * \brief Sets the operation of a canvas from the input over one of its cells.
+ * \param [in, out] canvas The canvas to test input from.
+ * \param [in] input An input handler.
+ * \param [in] index The index of the cell under the mouse.
+ * \returns Void.
+ */
+void CanvasHandleCellInput(Canvas* canvas, const Input* input, size_t index);
+
+/**
+ * \brief Finds the cell of a canvas under the mouse, as drawn in an area.
+ * \param [in] canvas The canvas drawn.
+ * \param [in] input An input handler.
+ * \param [in] rect The area the canvas is drawn in, in glyph units.
+ * \param [in] origin The cell drawn at the top-left of the area.
+ * \param [in] zoom The zoom level the canvas is drawn at.
+ * \param [out] index The index of the cell under the mouse.
+ * \returns Whether the mouse is over a cell of the canvas.
+ */
+[[nodiscard]] bool CanvasCellAt(const Canvas* canvas, const Input* input,
+                                SDL_Rect rect, SDL_Point origin, i32 zoom,
+                                size_t* index);
+
+/**
+ * \brief Brings the cache of a canvas up to date, creating it if required.
+ * \param [in, out] canvas Canvas to refresh.
+ * \param [in] wind Window to render with.
+ * \param [in] tex Texture to render from.
+ * \returns Whether the canvas has a cache.
+ */
+bool CanvasRefresh(Canvas* canvas, const Window* wind, const Texture* tex);
+
+/**
+ * \brief Draws a canvas from its cache into an area of a window.
+ * \param [in, out] canvas Canvas to draw.
+ * \param [in] wind Window to render to.
+ * \param [in] tex Texture to render the cells from.
+ * \param [in] rect The area to draw into, in glyph units.
+ * \param [in] origin The cell to draw at the top-left of the area.
+ * \param [in] zoom The zoom level to draw at.
+ * \returns Void.
+ */
+void CanvasBlit(Canvas* canvas, const Window* wind, const Texture* tex,
+                SDL_Rect rect, SDL_Point origin, i32 zoom);
+
+/**
+ * \brief Scales a glyph dimension by a zoom level.
+ * \param [in] size The glyph width or height in pixels.
+ * \param [in] zoom The zoom level.
+ * \returns The scaled size, which is never less than a pixel.
+ */
+[[nodiscard]] i32 CanvasZoomSize(i32 size, i32 zoom);
+
 /**
  * \brief Renders a canvas.
  * \param [in] canvas Canvas to render.
@@ -88,6 +332,259 @@ void CanvasUpdate(Canvas* canvas, Glyph* cur_glyph);
  * \param [in] tex Texture to render from.
  * \returns Void.
  */
-void CanvasRender(const Canvas* canvas, const Window* wind, const Texture* tex);
+void CanvasRender(Canvas* canvas, const Window* wind, const Texture* tex);
+
+/**
+ * \brief Scrolls the cells shown in the rectangle of a canvas.
+ * \param [in, out] canvas The canvas to scroll.
+ * \param [in] dx The number of cells to scroll by in the x-direction.
+ * \param [in] dy The number of cells to scroll by in the y-direction.
+ * \returns Void.
+ */
+void CanvasScroll(Canvas* canvas, i32 dx, i32 dy);
+
+/**
+ * \brief Gets a cell of a canvas.
+ * \param [in, out] canvas The canvas to read from.
+ * \param [in] index The index of the cell.
+ * \returns The cell, or a blank cell if the index is out of bounds.
+ */
+[[nodiscard]] Cell CanvasGetCell(Canvas* canvas, size_t index);
+
+/**
+ * \brief Opens a transaction, or nests one within the open transaction.
+ * \param [in, out] canvas The canvas to write to.
+ * \returns Void.
+ */
+void CanvasBegin(Canvas* canvas);
+
+/**
+ * \brief Stages a write of a single cell.
+ * \param [in, out] canvas The canvas to write to, with a transaction open.
+ * \param [in] x The x-position of the cell.
+ * \param [in] y The y-position of the cell.
+ * \param [in] cell The new value of the cell.
+ * \returns Void.
+ */
+void CanvasWrite(Canvas* canvas, i32 x, i32 y, Cell cell);
+
+/**
+ * \brief Stages a write of the same value to a run of cells along a row.
+ * \param [in, out] canvas The canvas to write to, with a transaction open.
+ * \param [in] x The x-position of the first cell of the run.
+ * \param [in] y The y-position of the row.
+ * \param [in] count The number of cells in the run.
+ * \param [in] cell The new value of every cell of the run.
+ * \returns Void.
+ */
+void CanvasWriteSpan(Canvas* canvas, i32 x, i32 y, i32 count, Cell cell);
+
+/**
+ * \brief Stages a write of a block of cells.
+ * \param [in, out] canvas The canvas to write to, with a transaction open.
+ * \param [in] cells The cells of the block in row-major order.
+ * \param [in] rect Where the block is written to.
+ * \returns Void.
+ */
+void CanvasWriteBlock(Canvas* canvas, const Cell* cells, SDL_Rect rect);
+
+/**
+ * \brief Closes a transaction, applying and publishing its writes if it is
+ * the outermost. Writes which fall outside the canvas are dropped.
+ * \param [in, out] canvas The canvas to write to, with a transaction open.
+ * \returns The number of cells changed, or 0 if the transaction is nested.
+ */
+size_t CanvasCommit(Canvas* canvas);
+
+/**
+ * \brief Adds a listener notified of the changes of every commit.
+ * \param [in, out] canvas The canvas to listen to.
+ * \param [in] notify The callback.
+ * \param [in] data Passed to the callback.
+ * \returns Void.
+ */
+void CanvasListen(Canvas* canvas,
+                  void (*notify)(void* data, const CanvasChange* change),
+                  void* data);
+
+/**
+ * \brief Removes a listener added with the same callback and data.
+ * \param [in, out] canvas The canvas listened to.
+ * \param [in] notify The callback.
+ * \param [in] data Passed to the callback.
+ * \returns Void.
+ */
+void CanvasUnlisten(Canvas* canvas,
+                    void (*notify)(void* data, const CanvasChange* change),
+                    void* data);
+
+/**
+ * \brief Stamps a brush onto a canvas, recording every changed cell.
+ * \param [in, out] canvas The canvas to write to.
+ * \param [in] brush The brush to stamp.
+ * \param [in] x The x-position of the centre of the stamp.
+ * \param [in] y The y-position of the centre of the stamp.
+ * \param [in] cell The value written to every cell covered.
+ * \returns The number of cells changed, or 0 within an open transaction.
+ */
+size_t CanvasStamp(Canvas* canvas, const Brush* brush, i32 x, i32 y, Cell cell);
+
+/**
+ * \brief Copies a block of cells out of a canvas.
+ * \param [in, out] canvas The canvas to read from.
+ * \param [in] rect The block of cells, which must lie within the canvas.
+ * \returns The cells of the block in row-major order, to be freed by the
+ * caller.
+ */
+[[nodiscard]] Cell* CanvasCopy(Canvas* canvas, SDL_Rect rect);
+
+/**
+ * \brief Copies a block of cells into a canvas, recording every changed cell.
+ * \param [in, out] canvas The canvas to write to.
+ * \param [in] cells The cells of the block in row-major order.
+ * \param [in] rect Where the block is copied to. Cells of the block which fall
+ * outside the canvas are skipped.
+ * \returns The number of cells changed, or 0 within an open transaction.
+ */
+size_t CanvasPaste(Canvas* canvas, const Cell* cells, SDL_Rect rect);
+
+/**
+ * \brief Replaces the parts of every cell of a canvas which match a query,
+ * recording every changed cell.
+ * \param [in, out] canvas The canvas to write to.
+ * \param [in] match The cells sought. The parts it names are replaced, and the
+ * rest of each cell kept.
+ * \param [in] cell The cell whose parts replace those matched.
+ * \returns The number of cells changed, or 0 within an open transaction.
+ */
+size_t CanvasReplace(Canvas* canvas, const CellMatch* match, Cell cell);
+
+/**
+ * \brief Transforms every cell of a canvas, which may swap its dimensions.
+ * \param [in, out] canvas The canvas to transform.
+ * \param [in] type The transform.
+ * \returns Void.
+ */
+void CanvasTransform(Canvas* canvas, TransformType type);
+
+/**
+ * \brief Transforms the selected cells of a canvas in place.
+ * \param [in, out] canvas The canvas to transform.
+ * \param [in] type The transform.
+ * \returns The number of cells changed.
+ */
+size_t CanvasTransformSelection(Canvas* canvas, TransformType type);
+
+/**
+ * \brief Crops or extends a canvas to an area of its cells.
+ * \param [in, out] canvas The canvas to resize.
+ * \param [in] rect The area of the cells to keep. It may reach beyond the
+ * cells on any side, in which case blank cells are added.
+ * \returns Void.
+ */
+void CanvasResize(Canvas* canvas, SDL_Rect rect);
+
+/**
+ * \brief Resizes a canvas, keeping an anchor point in place.
+ * \param [in, out] canvas The canvas to resize.
+ * \param [in] width The new width in cells.
+ * \param [in] height The new height in cells.
+ * \param [in] anchor The point of the canvas which stays put.
+ * \returns Void.
+ */
+void CanvasResizeAnchored(Canvas* canvas, i32 width, i32 height,
+                          CanvasAnchor anchor);
+
+/**
+ * \brief Crops a canvas to the smallest area holding every cell which is not
+ * blank.
+ * \param [in, out] canvas The canvas to crop.
+ * \returns Whether there was anything to crop to.
+ */
+bool CanvasCropToContent(Canvas* canvas);
+
+/**
+ * \brief Fills a block of cells of a canvas with a gradient, recording every
+ * changed cell.
+ * \param [in, out] canvas The canvas to fill.
+ * \param [in] gradient The gradient to fill with.
+ * \param [in] rect The block of cells, which is clipped to the canvas.
+ * \returns The number of cells changed.
+ */
+size_t CanvasFillGradient(Canvas* canvas, const Gradient* gradient,
+                          SDL_Rect rect);
+
+/**
+ * \brief Sets the gradient filled by a canvas, in place of glyphs.
+ * \param [in, out] canvas The canvas to fill.
+ * \param [in] gradient The gradient, or NULL to place glyphs again. Its
+ * colours and ends are set by each fill.
+ * \returns Void.
+ */
+void CanvasSetGradient(Canvas* canvas, const Gradient* gradient);
+
+/**
+ * \brief Sets the stamp placed by a canvas, in place of glyphs.
+ * \param [in, out] canvas The canvas to place the stamp on.
+ * \param [in] stamp The stamp, or NULL to place glyphs again.
+ * \returns Void.
+ */
+void CanvasSetStamp(Canvas* canvas, Stamp* stamp);
+
+/**
+ * \brief Sets the brush used to place and erase glyphs on a canvas.
+ * \param [in, out] canvas The canvas to paint with the brush.
+ * \param [in] brush The brush, or NULL to edit a single cell at a time.
+ * \returns Void.
+ */
+void CanvasSetBrush(Canvas* canvas, const Brush* brush);
+
+/**
+ * \brief Attaches a minimap to a canvas, drawing every cell into it.
+ * \param [in, out] canvas The canvas to attach the minimap to.
+ * \param [in, out] minimap The minimap, or NULL to detach the current one.
+ * \returns Void.
+ */
+void CanvasSetMinimap(Canvas* canvas, Minimap* minimap);
+
+/**
+ * \brief Attaches a set of animations to a canvas, or detaches them.
+ * \param [in, out] canvas The canvas to preview the animations on.
+ * \param [in] anims The animations, or NULL to stop animating.
+ * \returns Void.
+ */
+void CanvasSetAnimations(Canvas* canvas, const Animations* anims);
+
+/**
+ * \brief Marks a cell of a canvas to be redrawn into its cache.
+ * \param [in, out] canvas The canvas the cell belongs to.
+ * \param [in] index The index of the changed cell.
+ * \returns Void.
+ */
+void CanvasMarkDirty(Canvas* canvas, size_t index);
+
+/**
+ * \brief Reverts the last recorded stroke of a canvas.
+ * \param [in, out] canvas The canvas to undo an edit of.
+ * \returns Whether there was a stroke to undo.
+ */
+bool CanvasUndo(Canvas* canvas);
+
+/**
+ * \brief Reapplies the last undone stroke of a canvas.
+ * \param [in, out] canvas The canvas to redo an edit of.
+ * \returns Whether there was a stroke to redo.
+ */
+bool CanvasRedo(Canvas* canvas);
+
+/**
+ * \brief Plays each operation of a macro onto a canvas, in order, as if the
+ * tools had been used on it, clipped to the canvas.
+ * \param [in, out] canvas The canvas to play onto.
+ * \param [in] macro The macro to play.
+ * \returns The number of cells changed by the edits of the macro, not counting
+ * transforms and resizes.
+ */
+size_t CanvasPlayMacro(Canvas* canvas, const Macro* macro);
 
 #endif
\ No newline at end of file
@@ -18,29 +18,41 @@
 #include "core/common.h"
 #include "core/input.h"
 #include "core/utils.h"
+#include "generated/widget_ids.h"
 #include "graphics/color.h"
 #include "graphics/glyph.h"
+#include "memory/phash.h"
 #include "memory/vector.h"
 #include "ui/button.h"
 #include "ui/canvas.h"
 #include "ui/label.h"
+#include "ui/layout.h"
 #include "ui/panel.h"
 #include "ui/widget.h"
 
+/**
+ * \desc The layout from which the editor interface is built.
+ */
+#define INTERFACE_LAYOUT "./res/layouts/editor.layout"
+
 /**
  * \brief An interface is with what the user interacts with in the program.
  *
  * The UI contains a various widgets (labels, buttons etc.) which allow the user
  * to interact with the program. Stored also are the dimensions of the currently
  * loaded glyphs, whether a ghost glyph should be shown and  the currently
- * active tab.
+ * active tab. The ghost shows a whole stamp instead of a glyph whilst one is
+ * being placed. Widgets are additionally indexed by the perfect hash slot of
+ * their identifier, so that finding a widget by name is a single probe.
  */
 typedef struct [[nodiscard]]
 {
     Texture* tex;     /**< Texture to obtain glyph dimensions. */
-    Vector* widgets;  /**< List of UI widgets. TODO: Replace with a hashmap. */
+    Vector* widgets;  /**< List of UI widgets in render order. */
+    Widget* lookup[WIDGET_IDS_COUNT]; /**< Widgets by identifier slot. */
     Glyph* cur_glyph; /**< Currently selected glyph. */
     Glyph* ghost;     /**< Ghost glyph to be used as a visual aid. */
+    Stamp* ghost_stamp; /**< Stamp shown in place of the ghost, if any. */
     bool show_ghost;  /**< Flag to show current glyph on a canvas. */
     u32 active_tab;   /**< Currently activated tab. */
     SDL_Rect drawing_area; /**< The drawing area of the interface. */
@@ -86,10 +98,29 @@ void InterfaceRender(const Interface* itfc, const Window* wind,
                      const Texture* tex);
 
 /**
- * \brief Creates a set of widgets for an interface based on hard-coded values.
- * \param [in] itfc The interface to have the widgets created for.
- * \returns Void.
+ * \brief Creates the widgets of an interface from a layout file.
+ * \param [in, out] itfc The interface to have the widgets created for.
+ * \param [in] path The path to the layout text file.
+ * \returns True if the layout was loaded, false otherwise.
+ */
+bool InterfaceLoadLayout(Interface* itfc, const char* path);
+
+/**
+ * \brief Replaces the canvas shown by the main canvas widget of an interface.
+ * \param [in, out] itfc The interface to change the canvas of.
+ * \param [in] canvas The canvas to be shown.
+ * \returns The canvas which was previously shown, or NULL if the interface has
+ * no main canvas.
+ */
+Canvas* InterfaceSetCanvas(Interface* itfc, Canvas* canvas);
+
+/**
+ * \brief Finds a widget of an interface based on its identifier.
+ * \param [in] itfc The interface to search.
+ * \param [in] id The widget identifier, as listed in res/keys/widget_ids.keys.
+ * \returns A found widget, or otherwise NULL.
  */
-void InterfaceCreateWidgets(Interface* itfc);
+[[nodiscard]] Widget* InterfaceFindWidget(const Interface* itfc,
+                                          const char* id);
 
 #endif
\ No newline at end of file
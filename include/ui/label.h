@@ -57,6 +57,14 @@ typedef struct [[nodiscard]]
  */
 void LabelFree(Label* label);
 
+/**
+ * \brief Replaces the text of a label, rebuilding its glyphs.
+ * \param [in, out] label Label to change the text of.
+ * \param [in] text The new text.
+ * \returns Void.
+ */
+void LabelSetText(Label* label, const char* text);
+
 /**
  * \brief Renders a label.
  * \param [in] label Label to render.
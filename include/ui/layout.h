@@ -0,0 +1,134 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file layout.h
+ *
+ * \brief A layout describes the widgets of an interface in a text file. On
+ * first load the text is compiled into a binary blob with every glyph already
+ * built, which is cached next to the text file and memory-mapped on later
+ * loads. Widgets are then instantiated from the blob in a single pass.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "graphics/color.h"
+#include "graphics/glyph.h"
+#include "memory/vector.h"
+#include "ui/widget.h"
+
+/**
+ * \desc Identifies a compiled layout blob. The version must be increased
+ * whenever the blob structures below change, invalidating existing caches.
+ */
+#define LAYOUT_MAGIC "KLYT"
+#define LAYOUT_VERSION 1
+
+/**
+ * \desc The extension appended to a layout path to form its cache path.
+ */
+#define LAYOUT_CACHE_EXTENSION ".bin"
+
+/**
+ * \desc Maximum lengths of a widget identifier and text in a layout.
+ */
+#define LAYOUT_MAX_ID 32
+#define LAYOUT_MAX_TEXT 128
+
+/**
+ * \brief The header of a compiled layout.
+ *
+ * The size and modification time of the source text are stored so that a stale
+ * cache is recompiled. The structure sizes guard against caches written by a
+ * build with a different memory layout.
+ */
+typedef struct [[nodiscard]]
+{
+    char magic[4];    /**< Always LAYOUT_MAGIC. */
+    u32 version;      /**< Always LAYOUT_VERSION. */
+    u32 widget_size;  /**< sizeof(LayoutWidget) when compiled. */
+    u32 glyph_size;   /**< sizeof(Glyph) when compiled. */
+    i64 source_size;  /**< Size of the source text in bytes. */
+    i64 source_mtime; /**< Modification time of the source text. */
+    u32 num_widgets;  /**< Number of widgets following the header. */
+    u32 num_glyphs;   /**< Number of glyphs following the widgets. */
+} LayoutHeader;
+
+/**
+ * \brief A compiled widget description.
+ *
+ * The glyphs of a widget are stored contiguously in the glyph section of the
+ * blob. Buttons store their label glyphs first, followed by their border.
+ */
+typedef struct [[nodiscard]]
+{
+    char id[LAYOUT_MAX_ID];     /**< Widget identifier. */
+    char text[LAYOUT_MAX_TEXT]; /**< Label or button text. */
+    WidgetType type;            /**< The type of widget. */
+    u32 tab;                    /**< Tab number in which it belongs. */
+    i32 z;                      /**< Rendering priority. */
+    SDL_Rect rect;              /**< Bounds in glyph units. */
+    SDL_Color fg;               /**< Text or border colour. */
+    SDL_Color bg;               /**< Background colour. */
+    Border border;              /**< Border type of panels and buttons. */
+    SelectorType selector;      /**< Selection type of selectors. */
+    bool flag;                  /**< Button active or canvas writable. */
+    u32 first_glyph;            /**< Index of the first glyph. */
+    u32 num_glyphs;             /**< Number of content glyphs. */
+    u32 num_border_glyphs;      /**< Number of border glyphs (buttons). */
+} LayoutWidget;
+
+/**
+ * \brief A loaded layout blob.
+ *
+ * The blob is either memory-mapped from the cache or, if the cache could not
+ * be written, held in allocated memory.
+ */
+typedef struct [[nodiscard]]
+{
+    void* data;                  /**< The whole blob. */
+    size_t size;                 /**< Size of the blob in bytes. */
+    bool mapped;                 /**< Whether the blob is memory-mapped. */
+    const LayoutHeader* header;  /**< Header of the blob. */
+    const LayoutWidget* widgets; /**< Widget section of the blob. */
+    const Glyph* glyphs;         /**< Glyph section of the blob. */
+} Layout;
+
+/**
+ * \brief Loads a layout, compiling it if its cache is missing or stale.
+ * \param [in] path The path to the layout text file.
+ * \returns Pointer to a layout object, or NULL if it could not be loaded.
+ */
+[[nodiscard]] Layout* LayoutLoad(const char* path);
+
+/**
+ * \brief Frees (or unmaps) the layout memory.
+ * \param [in, out] layout The layout to be freed.
+ * \returns Void.
+ */
+void LayoutFree(Layout* layout);
+
+/**
+ * \brief Compiles a layout text file into a blob held in memory.
+ * \param [in] path The path to the layout text file.
+ * \param [out] size The size of the compiled blob in bytes.
+ * \returns The compiled blob, or NULL if the text file could not be read.
+ */
+[[nodiscard]] void* LayoutCompile(const char* path, size_t* size);
+
+/**
+ * \brief Creates the widgets of a layout and pushes them to a vector.
+ * \param [in] layout The layout to instantiate.
+ * \param [in, out] widgets The vector to push the created widgets to.
+ * \returns Void.
+ */
+void LayoutInstantiate(const Layout* layout, Vector* widgets);
+
+#endif
@@ -0,0 +1,104 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file minimap.h
+ *
+ * \brief A minimap shows the whole of a map at (at most) one pixel per cell,
+ * with the part of the map shown by the canvas outlined. Clicking on it moves
+ * the canvas to the clicked cell.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include "core/common.h"
+#include "core/input.h"
+#include "core/utils.h"
+#include "graphics/color.h"
+#include "graphics/glyph.h"
+#include "graphics/texture.h"
+#include "graphics/thumbnail.h"
+#include "graphics/window.h"
+
+/**
+ * \brief A downsampled picture of a map.
+ *
+ * The colour of each cell is kept in a pixel buffer, which is copied into a
+ * streaming texture as it changes. Only the changed columns of the changed rows
+ * are copied when the minimap is rendered; the whole buffer is copied only when
+ * the texture is created or the minimap resized.
+ */
+typedef struct [[nodiscard]]
+{
+    SDL_Rect rect;         /**< Area of the minimap in glyph units. */
+    SDL_Rect dest;         /**< Where the map was last drawn, in pixels. */
+    SDL_Texture* texture;  /**< Streaming texture of one pixel per cell. */
+    u32* pixels;           /**< Colour of each cell in row-major order. */
+    i32 width;             /**< Width of the map in cells. */
+    i32 height;            /**< Height of the map in cells. */
+    i32* span_min;         /**< First changed column of each row. */
+    i32* span_max;         /**< Last changed column of each row. */
+    i32 row_min;           /**< First row with changed columns. */
+    i32 row_max;           /**< Last row with changed columns. */
+    bool full;             /**< Whether the whole texture must be copied. */
+    SDL_Rect viewport;     /**< The cells to outline. */
+    SDL_Point target;      /**< The cell last clicked on. */
+    bool jump;             /**< Flag to check if a cell was clicked on. */
+} Minimap;
+
+/**
+ * \brief Create an empty minimap.
+ * \param [in] rect The area of the minimap in glyph units.
+ * \returns Pointer to a minimap object.
+ */
+[[nodiscard]] Minimap* MinimapCreate(SDL_Rect rect);
+
+/**
+ * \brief Frees the minimap memory.
+ * \param [in, out] minimap The minimap to be freed.
+ * \returns Void.
+ */
+void MinimapFree(Minimap* minimap);
+
+/**
+ * \brief Resizes a minimap for a map, clearing every cell.
+ * \param [in, out] minimap The minimap to resize.
+ * \param [in] width The width of the map in cells.
+ * \param [in] height The height of the map in cells.
+ * \returns Void.
+ */
+void MinimapResize(Minimap* minimap, i32 width, i32 height);
+
+/**
+ * \brief Sets the colour of a cell of a minimap from the cell of the map.
+ * \param [in, out] minimap The minimap to change.
+ * \param [in] x The x-position of the cell.
+ * \param [in] y The y-position of the cell.
+ * \param [in] cell The cell of the map.
+ * \returns Void.
+ */
+void MinimapSetCell(Minimap* minimap, i32 x, i32 y, Cell cell);
+
+/**
+ * \brief Deals with the input of a minimap.
+ * \param [in, out] minimap The minimap to test input from.
+ * \param [in] input An input handler.
+ * \returns Void.
+ */
+void MinimapHandleInput(Minimap* minimap, const Input* input);
+
+/**
+ * \brief Renders a minimap, copying the changed cells to its texture first.
+ * \param [in, out] minimap Minimap to render.
+ * \param [in] wind Window to render to.
+ * \param [in] tex Texture to obtain glyph dimensions.
+ * \returns Void.
+ */
+void MinimapRender(Minimap* minimap, const Window* wind, const Texture* tex);
+
+#endif
@@ -0,0 +1,165 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file stamps.h
+ *
+ * \brief A stamp is a block of cells copied from a canvas, kept so that it can
+ * be placed again elsewhere. The stamp library shows every stamp as a
+ * thumbnail, from which one may be picked to place.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef STAMPS_H
+#define STAMPS_H
+
+#include "core/common.h"
+#include "core/input.h"
+#include "core/utils.h"
+#include "graphics/color.h"
+#include "graphics/glyph.h"
+#include "graphics/texture.h"
+#include "graphics/window.h"
+
+/**
+ * \desc The number of stamps a library holds, and the largest stamp in cells.
+ */
+#define STAMPS_MAX 16
+#define STAMP_MAX_SIZE 64
+
+/**
+ * \desc The width and height of a thumbnail in the library in glyph units.
+ */
+#define STAMP_THUMB_SIZE 4
+
+/**
+ * \desc The opacity with which a stamp is previewed under the mouse.
+ */
+#define STAMP_GHOST_ALPHA 160
+
+/**
+ * \brief A block of cells.
+ *
+ * The cells are rendered once into a texture of their own, which is then used
+ * both for the thumbnail and for the preview. It is only rendered again if the
+ * glyphs are drawn from another texture.
+ */
+typedef struct [[nodiscard]]
+{
+    Cell* cells;          /**< The cells in row-major order. */
+    i32 width;            /**< Width of the stamp in cells. */
+    i32 height;           /**< Height of the stamp in cells. */
+    SDL_Texture* texture; /**< Rendered cells, or NULL until rendered. */
+    const Texture* tex;   /**< Texture the cells were rendered from. */
+} Stamp;
+
+/**
+ * \brief A grid of stamp thumbnails.
+ *
+ * Clicking a thumbnail selects its stamp, or deselects it if it was already
+ * selected. The changed flag is set whenever the selection changes, and is
+ * cleared by whoever acts upon it.
+ */
+typedef struct [[nodiscard]]
+{
+    SDL_Rect rect;               /**< Area of the library in glyph units. */
+    Stamp* stamps[STAMPS_MAX];   /**< The stamps, oldest first. */
+    size_t count;                /**< Number of stamps. */
+    i32 selected;                /**< Index of the selected stamp, or -1. */
+    bool changed;                /**< Flag to check if the selection changed. */
+} StampLibrary;
+
+/**
+ * \brief Creates a stamp from a block of cells.
+ * \param [in, out] cells The cells, which are owned by the stamp from then on.
+ * \param [in] width The width of the block of cells.
+ * \param [in] height The height of the block of cells.
+ * \returns Pointer to a stamp object.
+ */
+[[nodiscard]] Stamp* StampCreate(Cell* cells, i32 width, i32 height);
+
+/**
+ * \brief Frees the stamp memory.
+ * \param [in, out] stamp The stamp to be freed.
+ * \returns Void.
+ */
+void StampFree(Stamp* stamp);
+
+/**
+ * \brief Draws a stamp, rendering its cells first if required.
+ * \param [in, out] stamp Stamp to draw.
+ * \param [in] wind Window to render to.
+ * \param [in] tex Texture to render the cells from.
+ * \param [in] dest Where to draw the stamp, in pixels.
+ * \param [in] alpha The opacity to draw with.
+ * \returns Void.
+ */
+void StampRender(Stamp* stamp, const Window* wind, const Texture* tex,
+                 SDL_Rect dest, u8 alpha);
+
+/**
+ * \brief Create an empty stamp library.
+ * \param [in] rect The area of the library in glyph units.
+ * \returns Pointer to a stamp library object.
+ */
+[[nodiscard]] StampLibrary* StampLibraryCreate(SDL_Rect rect);
+
+/**
+ * \brief Frees the stamp library memory, including every stamp.
+ * \param [in, out] library The stamp library to be freed.
+ * \returns Void.
+ */
+void StampLibraryFree(StampLibrary* library);
+
+/**
+ * \brief Adds a stamp to a library and selects it.
+ * \param [in, out] library The library to add to.
+ * \param [in, out] stamp The stamp, which is owned by the library from then on.
+ * \returns Whether there was room for the stamp. If not, it is freed.
+ */
+bool StampLibraryAdd(StampLibrary* library, Stamp* stamp);
+
+/**
+ * \brief Removes the selected stamp of a library, if there is one.
+ * \param [in, out] library The library to remove from.
+ * \returns Void.
+ */
+void StampLibraryRemoveSelected(StampLibrary* library);
+
+/**
+ * \brief Changes the selected stamp of a library.
+ * \param [in, out] library The library to select from.
+ * \param [in] index The index of the stamp, or -1 to select none.
+ * \returns Void.
+ */
+void StampLibrarySelect(StampLibrary* library, i32 index);
+
+/**
+ * \brief Gets the selected stamp of a library.
+ * \param [in] library The library to search.
+ * \returns The selected stamp, or NULL if none is.
+ */
+[[nodiscard]] Stamp* StampLibrarySelected(const StampLibrary* library);
+
+/**
+ * \brief Deals with the input of a stamp library.
+ * \param [in, out] library The library to test input from.
+ * \param [in] input An input handler.
+ * \returns Void.
+ */
+void StampLibraryHandleInput(StampLibrary* library, const Input* input);
+
+/**
+ * \brief Renders the thumbnails of a stamp library.
+ * \param [in, out] library Library to render.
+ * \param [in] wind Window to render to.
+ * \param [in] tex Texture to render from.
+ * \returns Void.
+ */
+void StampLibraryRender(StampLibrary* library, const Window* wind,
+                        const Texture* tex);
+
+#endif
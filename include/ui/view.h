@@ -0,0 +1,101 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file view.h
+ *
+ * \brief A view is a pane onto a canvas, with its own area of the window,
+ * scroll position and zoom level. Views draw from the caches of their canvas,
+ * so that any number of them may show the same canvas for little more than the
+ * cost of copying the chunks they overlap.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#ifndef VIEW_H
+#define VIEW_H
+
+#include "core/common.h"
+#include "core/input.h"
+#include "core/utils.h"
+#include "graphics/texture.h"
+#include "graphics/window.h"
+#include "ui/canvas.h"
+
+/**
+ * \desc The number of cells scrolled for each step of the mouse wheel.
+ */
+#define VIEW_SCROLL_STEP 3
+
+/**
+ * \brief A pane showing part of a canvas.
+ *
+ * The view does not own its canvas. Input over the view is applied to the
+ * canvas as though it were over the canvas itself: the mouse wheel scrolls (or
+ * zooms, with control held) and the mouse buttons edit the cell under the
+ * mouse.
+ */
+typedef struct [[nodiscard]]
+{
+    Canvas* canvas;   /**< The canvas shown. */
+    SDL_Rect rect;    /**< Area of the view in glyph units. */
+    SDL_Point origin; /**< Cell shown at the top-left of the view. */
+    SDL_Point glyph;  /**< Size of a glyph in pixels at zoom level 0. */
+    i32 zoom;         /**< Zoom level the canvas is shown at. */
+} View;
+
+/**
+ * \brief Create a view onto a canvas.
+ * \param [in] canvas The canvas to show.
+ * \param [in] rect The area of the view in glyph units.
+ * \param [in] zoom The initial zoom level.
+ * \param [in] tex The texture the canvas is rendered from.
+ * \returns Pointer to a view object.
+ */
+[[nodiscard]] View* ViewCreate(Canvas* canvas, SDL_Rect rect, i32 zoom,
+                               const Texture* tex);
+
+/**
+ * \brief Frees the view memory, but not its canvas.
+ * \param [in, out] view The view to be freed.
+ * \returns Void.
+ */
+void ViewFree(View* view);
+
+/**
+ * \brief Deals with the input over a view.
+ * \param [in, out] view The view to test input from.
+ * \param [in] input An input handler.
+ * \returns Void.
+ */
+void ViewHandleInput(View* view, const Input* input);
+
+/**
+ * \brief Renders a view.
+ * \param [in, out] view View to render.
+ * \param [in] wind Window to render to.
+ * \param [in] tex Texture to render from.
+ * \returns Void.
+ */
+void ViewRender(View* view, const Window* wind, const Texture* tex);
+
+/**
+ * \brief Scrolls the cells shown by a view.
+ * \param [in, out] view The view to scroll.
+ * \param [in] dx The number of cells to scroll by in the x-direction.
+ * \param [in] dy The number of cells to scroll by in the y-direction.
+ * \returns Void.
+ */
+void ViewScroll(View* view, i32 dx, i32 dy);
+
+/**
+ * \brief Changes the zoom level of a view, keeping the centre cell in place.
+ * \param [in, out] view The view to zoom.
+ * \param [in] zoom The new zoom level.
+ * \returns Void.
+ */
+void ViewZoom(View* view, i32 zoom);
+
+#endif
@@ -21,11 +21,14 @@
 #include "graphics/color.h"
 #include "graphics/glyph.h"
 #include "memory/vector.h"
+#include "ui/browser.h"
 #include "ui/button.h"
 #include "ui/canvas.h"
 #include "ui/label.h"
+#include "ui/minimap.h"
 #include "ui/panel.h"
 #include "ui/selector.h"
+#include "ui/stamps.h"
 
 typedef enum
 {
@@ -34,6 +37,9 @@ typedef enum
     WIDGET_LABEL,
     WIDGET_PANEL,
     WIDGET_SELECTOR,
+    WIDGET_MINIMAP,
+    WIDGET_STAMPS,
+    WIDGET_BROWSER,
 } WidgetType;
 
 /**
@@ -44,6 +44,8 @@
     app->res = ResourcerCreate();
     app->wind = WindowCreate();
     app->editor = EditorCreate(app->wind, app->res);
+    app->recorder = NULL;
+    app->timelapse = NULL;
 
     app->input->conversion.x = app->editor->tex->glyph_w;
     app->input->conversion.y = app->editor->tex->glyph_h;
@@ -59,6 +61,16 @@
  */
 void ApplicationFree(Application* app)
 {
+    if (app->recorder)
+    {
+        RecorderFree(app->recorder);
+    }
+
+    if (app->timelapse)
+    {
+        TimelapseFinish(app->timelapse);
+    }
+
     IMG_Quit();
     TTF_Quit();
     SDL_AudioQuit();
@@ -98,7 +110,9 @@ void ApplicationRun(Application* app)
 
 /**
  * \desc Updates the application's input handler and checks for any global
- * input. This is where user input can result in the application closing.
+ * input. This is where user input can result in the application closing. F9
+ * starts and stops recording the window, and F10 renders a timelapse of the
+ * active document; with shift held, either writes raw RGBA frames.
  */
 void ApplicationHandleInput(Application* app)
 {
@@ -108,22 +122,129 @@ void ApplicationHandleInput(Application* app)
         app->running = false;
     }
 
+    if (InputKeyPressed(app->input, SDLK_F9))
+    {
+        ApplicationToggleRecording(app,
+                                   app->input->curr_mod_map & KMOD_SHIFT
+                                       ? RECORDER_RGBA
+                                       : RECORDER_Y4M);
+    }
+    else if (InputKeyPressed(app->input, SDLK_F10))
+    {
+        ApplicationRenderTimelapse(app, app->input->curr_mod_map & KMOD_SHIFT
+                                            ? RECORDER_RGBA
+                                            : RECORDER_Y4M);
+    }
+
     EditorHandleInput(app->editor, app->input);
 }
 
 /**
- * \desc Updates the application state i.e. where all logic is performed.
+ * \desc Names a file of the capture directory after the time now, creating the
+ * directory if need be.
  */
-void ApplicationUpdate(Application* app) { EditorUpdate(app->editor); }
+static bool ApplicationCapturePath(char* path, size_t size, const char* name,
+                                   RecorderFormat format)
+{
+    if (!DirCreate(APPLICATION_CAPTURE_DIR))
+    {
+        Log(LOG_ERROR, "Could not create capture directory %s",
+            APPLICATION_CAPTURE_DIR);
+        return false;
+    }
+
+    char stamp[32] = {0};
+    const time_t now = time(NULL);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+
+    snprintf(path, size, "%s/%s%s%s", APPLICATION_CAPTURE_DIR, stamp, name,
+             format == RECORDER_Y4M ? ".y4m" : ".rgba");
+    return true;
+}
+
+/**
+ * \desc Names the recording after the time it was started. Raw frames have no
+ * header, so their size is logged for playback when the recording stops.
+ */
+void ApplicationToggleRecording(Application* app, RecorderFormat format)
+{
+    if (app->recorder)
+    {
+        RecorderFree(app->recorder);
+        app->recorder = NULL;
+        return;
+    }
+
+    char path[256] = {0};
+    if (!ApplicationCapturePath(path, sizeof(path), "", format))
+    {
+        return;
+    }
+
+    app->recorder = RecorderCreate(app->wind, path, format);
+    if (app->recorder)
+    {
+        Log(LOG_NOTIFY, "Recording to %s", path);
+    }
+}
+
+/**
+ * \desc The timelapse is named after the time now and the document. Any stroke
+ * in progress has already been logged, as the journal logs each change as it
+ * is committed. Only one timelapse is rendered at a time.
+ */
+bool ApplicationRenderTimelapse(Application* app, RecorderFormat format)
+{
+    if (app->timelapse)
+    {
+        Log(LOG_NOTIFY, "A timelapse is still being rendered");
+        return false;
+    }
+
+    const Document* doc =
+        VectorAt(app->editor->documents, app->editor->active);
+
+    char name[DOCUMENT_MAX_NAME + 1] = {0};
+    snprintf(name, sizeof(name), "-%s", doc->name);
+
+    char path[256] = {0};
+    if (!ApplicationCapturePath(path, sizeof(path), name, format))
+    {
+        return false;
+    }
+
+    app->timelapse = TimelapseStart(doc->journal, path, format);
+    return app->timelapse != NULL;
+}
+
+/**
+ * \desc Updates the application state i.e. where all logic is performed. A
+ * timelapse which has finished rendering is freed, having logged its result.
+ */
+void ApplicationUpdate(Application* app)
+{
+    if (app->timelapse && TimelapseDone(app->timelapse))
+    {
+        TimelapseFinish(app->timelapse);
+        app->timelapse = NULL;
+    }
+
+    EditorUpdate(app->editor);
+}
 
 /**
  * \desc Renders the application by clearing the window, drawing to it and then
- * flipping the buffers.
+ * flipping the buffers. A frame being recorded is captured before the flip, as
+ * the back buffer is undefined once presented.
  */
 void ApplicationRender(const Application* app)
 {
     WindowClear(app->wind);
     EditorRender(app->editor, app->wind);
+    if (app->recorder)
+    {
+        RecorderCapture(app->recorder, app->wind);
+    }
     WindowFlip(app->wind);
 }
 
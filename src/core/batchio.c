@@ -0,0 +1,469 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file batchio.c
+ *
+ * \brief Batched file I/O reads or writes many whole files at once, keeping
+ * many of them in flight so that a directory of files is limited by the disk
+ * rather than by waiting on each call in turn. On Linux the files are read and
+ * written through io_uring, and elsewhere, or where io_uring is not allowed,
+ * by a pool of threads.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "core/batchio.h"
+
+/**
+ * \brief The requests of a batch shared between the threads which take them
+ * in turn.
+ */
+typedef struct
+{
+    BatchIoRequest* requests;
+    size_t count;
+    SDL_atomic_t next;
+} BatchIoPool;
+
+/**
+ * \desc Reads a whole file into a new buffer.
+ */
+static bool BatchIoReadFile(BatchIoRequest* request)
+{
+    FILE* file = fopen(request->path, "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    bool ok = fseek(file, 0, SEEK_END) == 0;
+    const long size = ok ? ftell(file) : -1;
+    ok = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+
+    if (ok)
+    {
+        request->size = (size_t)size;
+        request->data = Allocate(SDL_max(request->size, (size_t)1));
+        ok = fread(request->data, 1, request->size, file) == request->size;
+    }
+
+    fclose(file);
+
+    if (!ok && request->data)
+    {
+        Free(request->data);
+        request->data = NULL;
+    }
+
+    return ok;
+}
+
+/**
+ * \desc Replaces a file with the buffer.
+ */
+static bool BatchIoWriteFile(const BatchIoRequest* request)
+{
+    FILE* file = fopen(request->path, "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    const bool ok =
+        fwrite(request->data, 1, request->size, file) == request->size;
+    return fclose(file) == 0 && ok;
+}
+
+/**
+ * \desc Each thread takes the next file in turn until there are none left, so
+ * that a few large files do not hold up the rest.
+ */
+static i32 BatchIoRunPool(void* data)
+{
+    BatchIoPool* pool = data;
+    for (size_t i = (size_t)SDL_AtomicAdd(&pool->next, 1); i < pool->count;
+         i = (size_t)SDL_AtomicAdd(&pool->next, 1))
+    {
+        BatchIoRequest* request = &pool->requests[i];
+        request->ok = request->kind == BATCHIO_READ
+                          ? BatchIoReadFile(request)
+                          : BatchIoWriteFile(request);
+    }
+
+    return 0;
+}
+
+/**
+ * \desc The calling thread works alongside the pool, so that the batch is
+ * still done should no thread start.
+ */
+static void BatchIoRunThreads(BatchIoRequest* requests, size_t count)
+{
+    BatchIoPool pool = {requests, count, {0}};
+    const size_t num_workers = SDL_min(count, (size_t)BATCHIO_WORKERS);
+    SDL_Thread* workers[BATCHIO_WORKERS] = {0};
+
+    for (size_t i = 1; i < num_workers; ++i)
+    {
+        workers[i] = SDL_CreateThread(BatchIoRunPool, "batchio", &pool);
+    }
+
+    BatchIoRunPool(&pool);
+
+    for (size_t i = 1; i < num_workers; ++i)
+    {
+        if (workers[i])
+        {
+            SDL_WaitThread(workers[i], NULL);
+        }
+    }
+}
+
+#if BATCHIO_URING
+
+/**
+ * \desc Opens paths relative to the working directory. The value is that of
+ * Linux, for when the strict standard hides it.
+ */
+#ifndef AT_FDCWD
+#define AT_FDCWD -100
+#endif
+
+/**
+ * \brief Describes how far along a file in flight is.
+ */
+typedef enum
+{
+    BATCHIO_OPEN,
+    BATCHIO_TRANSFER,
+    BATCHIO_CLOSE
+} BatchIoStage;
+
+/**
+ * \brief A file in flight, with the descriptor it was opened with and how
+ * much of it has been read or written.
+ */
+typedef struct
+{
+    BatchIoStage stage;
+    i32 fd;
+    size_t done;
+    bool failed;
+} BatchIoFile;
+
+/**
+ * \brief An io_uring: the submission and completion rings shared with the
+ * kernel, and the submission entries.
+ */
+typedef struct
+{
+    i32 fd;
+    u8* sq;
+    size_t sq_size;
+    u8* cq;
+    size_t cq_size;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    u32* sq_tail;
+    u32* sq_mask;
+    u32* sq_array;
+    u32* cq_head;
+    u32* cq_tail;
+    u32* cq_mask;
+    struct io_uring_cqe* cqes;
+    u32 pending;
+} BatchIoRing;
+
+/**
+ * \desc Unmaps the rings and closes the ring itself.
+ */
+static void BatchIoRingFree(BatchIoRing* ring)
+{
+    if (ring->sqes)
+    {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq && ring->cq != ring->sq)
+    {
+        munmap(ring->cq, ring->cq_size);
+    }
+    if (ring->sq)
+    {
+        munmap(ring->sq, ring->sq_size);
+    }
+    close(ring->fd);
+}
+
+/**
+ * \desc Sets up a ring and maps its rings and entries. The ring is refused if
+ * the kernel is too old to open, read and close files through it, or if
+ * io_uring is not allowed at all, such as within some containers.
+ */
+static bool BatchIoRingCreate(BatchIoRing* ring)
+{
+    *ring = (BatchIoRing){0};
+
+    struct io_uring_params params = {0};
+    ring->fd = (i32)syscall(__NR_io_uring_setup, BATCHIO_DEPTH, &params);
+    if (ring->fd < 0)
+    {
+        return false;
+    }
+
+    if (!(params.features & IORING_FEAT_RW_CUR_POS))
+    {
+        close(ring->fd);
+        return false;
+    }
+
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+    ring->cq_size = params.cq_off.cqes +
+                    params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        ring->sq_size = ring->cq_size = SDL_max(ring->sq_size, ring->cq_size);
+    }
+
+    ring->sq = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    ring->cq = ring->sq;
+    if (ring->sq != MAP_FAILED && !(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        ring->cq = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_CQ_RING);
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+
+    if (ring->sq == MAP_FAILED || ring->cq == MAP_FAILED ||
+        ring->sqes == MAP_FAILED)
+    {
+        ring->sq = ring->sq == MAP_FAILED ? NULL : ring->sq;
+        ring->cq = ring->cq == MAP_FAILED ? NULL : ring->cq;
+        ring->sqes = ring->sqes == MAP_FAILED ? NULL : ring->sqes;
+        BatchIoRingFree(ring);
+        return false;
+    }
+
+    ring->sq_tail = (u32*)(ring->sq + params.sq_off.tail);
+    ring->sq_mask = (u32*)(ring->sq + params.sq_off.ring_mask);
+    ring->sq_array = (u32*)(ring->sq + params.sq_off.array);
+    ring->cq_head = (u32*)(ring->cq + params.cq_off.head);
+    ring->cq_tail = (u32*)(ring->cq + params.cq_off.tail);
+    ring->cq_mask = (u32*)(ring->cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(ring->cq + params.cq_off.cqes);
+
+    return true;
+}
+
+/**
+ * \desc Fills in the next submission entry, tagged with the number of the
+ * file. The kernel only sees it once the tail is published on submitting.
+ */
+static void BatchIoQueue(BatchIoRing* ring, u8 opcode, i32 fd, u64 addr,
+                         u32 length, u64 offset, u32 flags, size_t index)
+{
+    const u32 tail = *ring->sq_tail + ring->pending;
+    const u32 slot = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[slot];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = addr;
+    sqe->len = length;
+    sqe->off = offset;
+    sqe->open_flags = flags;
+    sqe->user_data = index;
+    ring->sq_array[slot] = slot;
+    ring->pending++;
+}
+
+/**
+ * \desc Publishes the queued entries, then submits them and waits for at
+ * least one completion in a single call. The entries in flight are never more
+ * than the completion ring holds, so the only failures to be retried are
+ * interruptions and a kernel short of memory; any other failure means the
+ * ring is being misused, and files in flight cannot be safely abandoned.
+ */
+static void BatchIoSubmit(BatchIoRing* ring)
+{
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + ring->pending,
+                     __ATOMIC_RELEASE);
+
+    u32 pending = ring->pending;
+    ring->pending = 0;
+
+    for (;;)
+    {
+        const long submitted = syscall(__NR_io_uring_enter, ring->fd, pending,
+                                       1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted >= 0)
+        {
+            pending -= (u32)submitted;
+            if (pending == 0)
+            {
+                return;
+            }
+        }
+        else if (errno != EINTR && errno != EAGAIN)
+        {
+            Log(LOG_FATAL, "Could not submit file I/O: %s", strerror(errno));
+        }
+    }
+}
+
+/**
+ * \desc Queues the next step of a file once its last one completes. An opened
+ * file which is read has its size looked up, which needs no disk access now
+ * that it is open, and a buffer made for it. A transfer which falls short is
+ * continued from where it stopped. A failure at any step still closes the
+ * file, if it was opened. Returns whether the file is finished.
+ */
+static bool BatchIoStep(BatchIoRing* ring, BatchIoRequest* request,
+                        BatchIoFile* file, i32 result, size_t index)
+{
+    const bool read = request->kind == BATCHIO_READ;
+
+    switch (file->stage)
+    {
+    case BATCHIO_OPEN:
+    {
+        if (result < 0)
+        {
+            return true;
+        }
+
+        file->fd = result;
+        struct stat info = {0};
+        if (read && fstat(file->fd, &info) == 0)
+        {
+            request->size = (size_t)info.st_size;
+            request->data = Allocate(SDL_max(request->size, (size_t)1));
+        }
+        file->failed = read && request->data == NULL;
+        file->stage = BATCHIO_TRANSFER;
+        break;
+    }
+
+    case BATCHIO_TRANSFER:
+        file->failed = result <= 0;
+        file->done += file->failed ? 0 : (size_t)result;
+        break;
+
+    case BATCHIO_CLOSE:
+        request->ok = !file->failed && result == 0;
+        if (!request->ok && request->data && read)
+        {
+            Free(request->data);
+            request->data = NULL;
+        }
+        return true;
+    }
+
+    if (file->failed || file->done == request->size)
+    {
+        file->stage = BATCHIO_CLOSE;
+        BatchIoQueue(ring, IORING_OP_CLOSE, file->fd, 0, 0, 0, 0, index);
+        return false;
+    }
+
+    const size_t length = SDL_min(request->size - file->done, (size_t)1 << 30);
+    BatchIoQueue(ring, read ? IORING_OP_READ : IORING_OP_WRITE, file->fd,
+                 (u64)(uintptr_t)(request->data + file->done), (u32)length,
+                 file->done, 0, index);
+    return false;
+}
+
+/**
+ * \desc Up to a ring's worth of files are in flight at once, each with one
+ * step queued at a time: opening, then reading or writing, then closing. Each
+ * completion queues the next step of its file, or lets the next file start,
+ * and the queued steps are submitted together.
+ */
+static void BatchIoRunUring(BatchIoRing* ring, BatchIoRequest* requests,
+                            size_t count)
+{
+    BatchIoFile* files =
+        Allocate(sizeof(BatchIoFile) * SDL_max(count, (size_t)1));
+    size_t next = 0, in_flight = 0;
+
+    while (next < count || in_flight > 0)
+    {
+        for (; next < count && in_flight < BATCHIO_DEPTH; ++next, ++in_flight)
+        {
+            const bool read = requests[next].kind == BATCHIO_READ;
+            const u32 flags = read ? O_RDONLY : O_WRONLY | O_CREAT | O_TRUNC;
+            files[next] = (BatchIoFile){BATCHIO_OPEN, -1, 0, false};
+            BatchIoQueue(ring, IORING_OP_OPENAT, AT_FDCWD,
+                         (u64)(uintptr_t)requests[next].path, 0644, 0, flags,
+                         next);
+        }
+
+        BatchIoSubmit(ring);
+
+        u32 head = *ring->cq_head;
+        const u32 tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            const struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+            const size_t index = (size_t)cqe->user_data;
+            if (BatchIoStep(ring, &requests[index], &files[index], cqe->res,
+                            index))
+            {
+                in_flight--;
+            }
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    Free(files);
+}
+
+#endif
+
+/**
+ * \desc The batch is run through io_uring where a ring can be set up, and
+ * otherwise by the pool of threads.
+ */
+bool BatchIoRun(BatchIoRequest* requests, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        requests[i].ok = false;
+        if (requests[i].kind == BATCHIO_READ)
+        {
+            requests[i].data = NULL;
+            requests[i].size = 0;
+        }
+    }
+
+#if BATCHIO_URING
+    BatchIoRing ring = {0};
+    if (count > 0 && BatchIoRingCreate(&ring))
+    {
+        BatchIoRunUring(&ring, requests, count);
+        BatchIoRingFree(&ring);
+    }
+    else
+    {
+        BatchIoRunThreads(requests, count);
+    }
+#else
+    BatchIoRunThreads(requests, count);
+#endif
+
+    bool ok = true;
+    for (size_t i = 0; i < count; ++i)
+    {
+        ok = ok && requests[i].ok;
+    }
+
+    return ok;
+}
@@ -0,0 +1,85 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file document.c
+ *
+ * \brief A document is a single map open in the editor. Each document owns its
+ * canvas, along with the cached canvas texture and the undo history, so that
+ * switching between documents does not reload or redraw anything.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "core/document.h"
+
+/**
+ * \desc Allocates the document with a clone of the template canvas. The history
+ * and journal are attached to the canvas so that its edits are recorded, and
+ * the journal is started from the cells of the clone.
+ */
+[[nodiscard]] Document* DocumentCreate(const char* name, Canvas* base)
+{
+    Document* doc = Allocate(sizeof(Document));
+    snprintf(doc->name, sizeof(doc->name), "%s", name);
+
+    doc->canvas = CanvasClone(base);
+    doc->history = HistoryCreate();
+    doc->canvas->history = doc->history;
+    doc->journal = JournalCreate();
+    doc->canvas->journal = doc->journal;
+    JournalStart(doc->journal, doc->canvas->cells);
+
+    return doc;
+}
+
+/**
+ * \desc The document is named after the map file, without its directory or
+ * extension. The cells of the template canvas are swapped for those of the
+ * map before the canvas has cached any of them, and the journal is started
+ * again from the cells of the map. A pack cannot be written to, so a map from
+ * a pack keeps no path and is saved as a map file of its own.
+ */
+[[nodiscard]] Document* DocumentLoad(const char* path, Canvas* base)
+{
+    ChunkStore* cells = PackLoadMap(path);
+    if (cells == NULL)
+    {
+        return NULL;
+    }
+
+    const char* slash = strrchr(path, '/');
+    const char* name = slash ? slash + 1 : path;
+    const char* ext = strrchr(name, '.');
+    const i32 length = ext ? (i32)(ext - name) : (i32)strlen(name);
+
+    char title[DOCUMENT_MAX_NAME] = {0};
+    snprintf(title, sizeof(title), "%.*s", length, name);
+
+    Document* doc = DocumentCreate(title, base);
+    char pack[PACK_MAX_PATH] = {0};
+    const char* entry = NULL;
+    if (!PackSplitPath(path, pack, sizeof(pack), &entry))
+    {
+        snprintf(doc->path, sizeof(doc->path), "%s", path);
+    }
+    ChunkStoreFree(doc->canvas->cells);
+    doc->canvas->cells = cells;
+    JournalStart(doc->journal, cells);
+
+    return doc;
+}
+
+/**
+ * \desc Frees the canvas (and with it the cache), the history and the journal,
+ * then the document itself.
+ */
+void DocumentFree(Document* doc)
+{
+    CanvasFree(doc->canvas);
+    HistoryFree(doc->history);
+    JournalFree(doc->journal);
+    Free(doc);
+}
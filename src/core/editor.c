@@ -16,60 +16,895 @@
 
 /**
  * \desc Allocates the memory for the editor via the creation of the texture and
- * the renderable glyphs.
+ * the renderable glyphs. The canvas of the interface layout is kept aside as a
+ * template, and a first document is opened from it.
  */
 [[nodiscard]] Editor* EditorCreate(const Window* wind, Resourcer* res)
 {
     Editor* editor = Allocate(sizeof(Editor));
 
-    ResourcerLoadTexture(res, wind, "./res/textures/boxy_16x16.png",
-                         "main_texture");
+    ResourcerLoadTileset(res, wind, EDITOR_TILESET);
 
-    editor->tex = ResourcerGetTexture(res, "main_texture");
+    editor->tex = ResourcerGetTileset(res, EDITOR_TILESET);
     editor->itfc = InterfaceCreate(editor->tex);
     editor->visible = true;
 
+    const Widget* cvs_main = InterfaceFindWidget(editor->itfc, "cvs_main");
+    if (cvs_main == NULL)
+    {
+        Log(LOG_FATAL, "The interface layout has no main canvas!");
+    }
+
+    editor->base = cvs_main->data;
+
+    const Widget* mmp_main = InterfaceFindWidget(editor->itfc, "mmp_main");
+    editor->minimap = mmp_main ? mmp_main->data : NULL;
+
+    const Widget* stp_main = InterfaceFindWidget(editor->itfc, "stp_main");
+    editor->stamps = stp_main ? stp_main->data : NULL;
+
+    const Widget* brw_main = InterfaceFindWidget(editor->itfc, "brw_main");
+    editor->browser = brw_main ? brw_main->data : NULL;
+    editor->documents = VectorCreate();
+    editor->active = 0;
+    editor->next_document = 1;
+    editor->compressor = CompressorCreate();
+    editor->views = VectorCreate();
+    editor->animations = AnimationsLoad(ANIMATIONS_PATH);
+    editor->animate = false;
+    editor->brush = NULL;
+    editor->gradient = (Gradient){0};
+    editor->filling = false;
+    editor->macro = NULL;
+    editor->recording = false;
+
+    if (!DirCreate(EDITOR_PROJECT_DIR))
+    {
+        Log(LOG_WARNING, "Could not create project directory %s",
+            EDITOR_PROJECT_DIR);
+    }
+    editor->indexer = MapIndexerCreate(EDITOR_PROJECT_DIR);
+
+    if (editor->browser)
+    {
+        BrowserSetCache(editor->browser, EDITOR_THUMB_DIR);
+        BrowserOpen(editor->browser, EDITOR_PROJECT_DIR);
+    }
+
+    EditorNewDocument(editor);
+    EditorSetBrush(editor, BRUSH_ROUND, BRUSH_MIN_RADIUS);
+    EditorSetGradient(editor, false, GRADIENT_LINEAR,
+                      GRADIENT_FG | GRADIENT_BG);
+
     return editor;
 }
 
 /**
  * \desc Frees the memory for an editor object, including texture and glyph
- * memory.
+ * memory. The template canvas is handed back to the interface first, so that
+ * it is freed along with the other widgets. The compressor is stopped before
+ * any of the documents it compresses are freed, and the indexer before it.
  */
 void EditorFree(Editor* editor)
 {
+    InterfaceSetCanvas(editor->itfc, editor->base);
+
+    for (size_t i = 0; i < VectorLength(editor->views); ++i)
+    {
+        ViewFree(VectorAt(editor->views, i));
+    }
+    VectorFree(editor->views);
+
+    MapIndexerFree(editor->indexer);
+    CompressorFree(editor->compressor);
+    for (size_t i = 0; i < VectorLength(editor->documents); ++i)
+    {
+        DocumentFree(VectorAt(editor->documents, i));
+    }
+    VectorFree(editor->documents);
+
+    if (editor->animations)
+    {
+        AnimationsFree(editor->animations);
+    }
+
+    if (editor->brush)
+    {
+        BrushFree(editor->brush);
+    }
+
+    if (editor->macro)
+    {
+        MacroFree(editor->macro);
+    }
+
     InterfaceFree(editor->itfc);
     Free(editor);
 }
 
+/**
+ * \desc Divides the drawing area into equal columns, one for the canvas of the
+ * active document and one for each view, and points the views at the canvas.
+ * The canvas and views are scrolled by nothing, which keeps them in bounds of
+ * their new areas. The ghost glyph is only shown over the canvas itself, as
+ * the views may be zoomed.
+ */
+static void EditorLayoutPanes(Editor* editor, Canvas* canvas)
+{
+    const SDL_Rect area = editor->base->rect;
+    const i32 panes = (i32)VectorLength(editor->views) + 1;
+    const i32 width = area.w / panes;
+
+    canvas->rect = area;
+    canvas->rect.w = area.w - width * (panes - 1);
+    CanvasScroll(canvas, 0, 0);
+
+    for (i32 i = 1; i < panes; ++i)
+    {
+        View* view = VectorAt(editor->views, i - 1);
+        view->canvas = canvas;
+        view->rect = area;
+        view->rect.x = canvas->rect.x + canvas->rect.w + width * (i - 1);
+        view->rect.w = width;
+        ViewScroll(view, 0, 0);
+    }
+
+    editor->itfc->drawing_area = canvas->rect;
+}
+
+/**
+ * \desc Shows the canvas of the active document in every pane and its name
+ * (along with its position amongst the open documents) in the document label.
+ * The minimap is detached from every other document and redrawn from the
+ * active one, which is animated if the animations are being previewed and
+ * painted with the brush, gradient and selected stamp of the editor. Only the
+ * active document records to the macro, whilst one is being recorded.
+ */
+static void EditorShowDocument(Editor* editor)
+{
+    Document* doc = VectorAt(editor->documents, editor->active);
+    InterfaceSetCanvas(editor->itfc, doc->canvas);
+    EditorLayoutPanes(editor, doc->canvas);
+    CanvasSetAnimations(doc->canvas,
+                        editor->animate ? editor->animations : NULL);
+    CanvasSetBrush(doc->canvas, editor->brush);
+    CanvasSetGradient(doc->canvas, editor->filling ? &editor->gradient : NULL);
+    CanvasSetStamp(doc->canvas,
+                   editor->stamps ? StampLibrarySelected(editor->stamps)
+                                  : NULL);
+
+    for (size_t i = 0; i < VectorLength(editor->documents); ++i)
+    {
+        const Document* other = VectorAt(editor->documents, i);
+        other->canvas->macro = NULL;
+    }
+    doc->canvas->macro = editor->recording ? editor->macro : NULL;
+
+    if (editor->minimap)
+    {
+        for (size_t i = 0; i < VectorLength(editor->documents); ++i)
+        {
+            const Document* other = VectorAt(editor->documents, i);
+            other->canvas->minimap = NULL;
+        }
+        CanvasSetMinimap(doc->canvas, editor->minimap);
+    }
+
+    Widget* lbl_document = InterfaceFindWidget(editor->itfc, "lbl_document");
+    if (lbl_document)
+    {
+        char text[DOCUMENT_MAX_NAME + 32] = {0};
+        snprintf(text, sizeof(text), " %s [%zu/%zu] ", doc->name,
+                 editor->active + 1, VectorLength(editor->documents));
+        LabelSetText((Label*)lbl_document->data, text);
+    }
+}
+
+/**
+ * \desc New documents are copies of the template canvas named in the order
+ * they were opened. Their cells are registered with the compressor.
+ */
+Document* EditorNewDocument(Editor* editor)
+{
+    char name[DOCUMENT_MAX_NAME] = {0};
+    snprintf(name, sizeof(name), "Untitled %u", editor->next_document++);
+
+    Document* doc = DocumentCreate(name, editor->base);
+    CompressorAdd(editor->compressor, doc->canvas->cells);
+    VectorPush(editor->documents, doc);
+    editor->active = VectorLength(editor->documents) - 1;
+    EditorShowDocument(editor);
+
+    return doc;
+}
+
+/**
+ * \desc Loaded documents are registered with the compressor like new ones.
+ * Should the map not load, the active document is left as it is.
+ */
+Document* EditorOpenDocument(Editor* editor, const char* path)
+{
+    Document* doc = DocumentLoad(path, editor->base);
+    if (doc == NULL)
+    {
+        return NULL;
+    }
+
+    CompressorAdd(editor->compressor, doc->canvas->cells);
+    VectorPush(editor->documents, doc);
+    editor->active = VectorLength(editor->documents) - 1;
+    EditorShowDocument(editor);
+
+    return doc;
+}
+
+/**
+ * \desc The last document is never closed, so that there is always a canvas to
+ * draw on. The document before the closed one becomes active.
+ */
+void EditorCloseDocument(Editor* editor)
+{
+    if (VectorLength(editor->documents) < 2)
+    {
+        return;
+    }
+
+    Document* doc = VectorAt(editor->documents, editor->active);
+    CompressorRemove(editor->compressor, doc->canvas->cells);
+    DocumentFree(doc);
+    VectorDelete(editor->documents, editor->active);
+    editor->active = editor->active ? editor->active - 1 : 0;
+    EditorShowDocument(editor);
+}
+
+/**
+ * \desc Only the canvas shown by the interface changes: the canvas of each
+ * document keeps its own cache, so nothing is redrawn on a switch. Any stroke
+ * in progress on the outgoing document is committed to its history.
+ */
+void EditorSwitchDocument(Editor* editor, size_t index)
+{
+    if (index >= VectorLength(editor->documents) || index == editor->active)
+    {
+        return;
+    }
+
+    const Document* doc = VectorAt(editor->documents, editor->active);
+    HistoryCommit(doc->history);
+
+    editor->active = index;
+    EditorShowDocument(editor);
+}
+
+/**
+ * \desc Any stroke in progress is committed first. A document without a map
+ * file is given one in the project directory, which it keeps from then on. The
+ * chunks are read without disturbing the compressor, so a large idle document
+ * is saved without being decompressed in place. The indexer is woken straight
+ * away so that the saved map can be searched for, and the browser listed again
+ * so that it shows the map.
+ */
+bool EditorSaveDocument(Editor* editor)
+{
+    Document* doc = VectorAt(editor->documents, editor->active);
+    HistoryCommit(doc->history);
+
+    if (doc->path[0] == '\0')
+    {
+        snprintf(doc->path, sizeof(doc->path), "%s/%s%s", EDITOR_PROJECT_DIR,
+                 doc->name, MAP_EXTENSION);
+    }
+
+    if (!MapSave(doc->canvas->cells, doc->path))
+    {
+        return false;
+    }
+
+    Log(LOG_NOTIFY, "Saved %s", doc->path);
+    MapIndexerWake(editor->indexer);
+    if (editor->browser)
+    {
+        BrowserRefresh(editor->browser);
+    }
+    return true;
+}
+
+/**
+ * \desc Any stroke in progress is committed first. Like saving, the chunks are
+ * read without disturbing the compressor. The tile map is drawn with the
+ * tileset of the editor.
+ */
+bool EditorExportDocument(Editor* editor)
+{
+    const Document* doc = VectorAt(editor->documents, editor->active);
+    HistoryCommit(doc->history);
+
+    if (!DirCreate(EDITOR_EXPORT_DIR))
+    {
+        Log(LOG_WARNING, "Could not create export directory %s",
+            EDITOR_EXPORT_DIR);
+        return false;
+    }
+
+    char html[DOCUMENT_MAX_PATH] = {0};
+    char svg[DOCUMENT_MAX_PATH] = {0};
+    char tiles[DOCUMENT_MAX_PATH] = {0};
+    snprintf(html, sizeof(html), "%s/%s%s", EDITOR_EXPORT_DIR, doc->name,
+             MAPEXPORT_HTML_EXTENSION);
+    snprintf(svg, sizeof(svg), "%s/%s%s", EDITOR_EXPORT_DIR, doc->name,
+             MAPEXPORT_SVG_EXTENSION);
+    snprintf(tiles, sizeof(tiles), "%s/%s%s", EDITOR_EXPORT_DIR, doc->name,
+             TILEATLAS_EXTENSION);
+
+    if (!MapExportHtml(doc->canvas->cells, html) ||
+        !MapExportSvg(doc->canvas->cells, svg) ||
+        !TileAtlasExport(doc->canvas->cells,
+                         TILESET_DIRECTORY EDITOR_TILESET ".png", tiles))
+    {
+        return false;
+    }
+
+    Log(LOG_NOTIFY, "Exported %s, %s and %s", html, svg, tiles);
+    return true;
+}
+
+/**
+ * \desc Views are added or removed from the end until there is one fewer than
+ * the number of panes. New views alternate between an overview zoomed out and
+ * a close-up zoomed in, as views at the same zoom level as the canvas would
+ * show nothing new.
+ */
+void EditorSplitView(Editor* editor, size_t panes)
+{
+    panes = SDL_min(SDL_max(panes, 1), EDITOR_MAX_PANES);
+
+    while (VectorLength(editor->views) + 1 > panes)
+    {
+        const size_t last = VectorLength(editor->views) - 1;
+        ViewFree(VectorAt(editor->views, last));
+        VectorDelete(editor->views, last);
+    }
+
+    const Document* doc = VectorAt(editor->documents, editor->active);
+    while (VectorLength(editor->views) + 1 < panes)
+    {
+        const i32 zoom = VectorLength(editor->views) % 2 ? 1 : -1;
+        VectorPush(editor->views, ViewCreate(doc->canvas, editor->base->rect,
+                                             zoom, editor->tex));
+    }
+
+    EditorLayoutPanes(editor, doc->canvas);
+}
+
+/**
+ * \desc Points every document and the ghost at the selected stamp, if any, so
+ * that a removed stamp is never placed.
+ */
+static void EditorApplyStamp(Editor* editor)
+{
+    Stamp* stamp = StampLibrarySelected(editor->stamps);
+    for (size_t i = 0; i < VectorLength(editor->documents); ++i)
+    {
+        const Document* doc = VectorAt(editor->documents, i);
+        CanvasSetStamp(doc->canvas, stamp);
+    }
+
+    editor->itfc->ghost_stamp = stamp;
+    editor->stamps->changed = false;
+}
+
+/**
+ * \desc Builds a custom brush from the cells of the selected stamp which are
+ * not blank, which is then deselected so that its shape is painted with rather
+ * than the stamp placed. Without a selected stamp, the brush is round.
+ */
+static Brush* EditorStampBrush(Editor* editor, i32 radius)
+{
+    const Stamp* stamp =
+        editor->stamps ? StampLibrarySelected(editor->stamps) : NULL;
+    if (stamp == NULL)
+    {
+        return BrushCreate(BRUSH_ROUND, radius);
+    }
+
+    const size_t num_cells = (size_t)(stamp->width * stamp->height);
+    bool* mask = Allocate(sizeof(bool) * num_cells);
+    for (size_t i = 0; i < num_cells; ++i)
+    {
+        mask[i] = stamp->cells[i].index != 0;
+    }
+
+    Brush* brush = BrushCreateStamp(mask, stamp->width, stamp->height);
+    Free(mask);
+
+    StampLibrarySelect(editor->stamps, -1);
+    EditorApplyStamp(editor);
+
+    return brush;
+}
+
+/**
+ * \desc The spans of the new brush are worked out once here, rather than on
+ * each stamp. Every document is pointed at the new brush before the old one is
+ * freed, and the brush label shows its shape and size.
+ */
+void EditorSetBrush(Editor* editor, BrushShape shape, i32 radius)
+{
+    Brush* brush = shape == BRUSH_CUSTOM ? EditorStampBrush(editor, radius)
+                                         : BrushCreate(shape, radius);
+    for (size_t i = 0; i < VectorLength(editor->documents); ++i)
+    {
+        const Document* doc = VectorAt(editor->documents, i);
+        CanvasSetBrush(doc->canvas, brush);
+    }
+
+    if (editor->brush)
+    {
+        BrushFree(editor->brush);
+    }
+    editor->brush = brush;
+
+    Widget* lbl_brush = InterfaceFindWidget(editor->itfc, "lbl_brush");
+    if (lbl_brush)
+    {
+        static const char* names[] = {"round", "square", "custom"};
+        char text[32] = {0};
+        snprintf(text, sizeof(text), "Brush: %s %d", names[brush->shape],
+                 brush->radius);
+        LabelSetText((Label*)lbl_brush->data, text);
+    }
+}
+
+/**
+ * \desc Every document fills the same gradient, so only the pointer to it is
+ * handed out. The gradient label shows its shape and the parts it fills.
+ */
+void EditorSetGradient(Editor* editor, bool filling, GradientType type,
+                       u8 targets)
+{
+    editor->filling = filling;
+    editor->gradient.type = type;
+    editor->gradient.targets = targets;
+
+    for (size_t i = 0; i < VectorLength(editor->documents); ++i)
+    {
+        const Document* doc = VectorAt(editor->documents, i);
+        CanvasSetGradient(doc->canvas, filling ? &editor->gradient : NULL);
+    }
+
+    Widget* lbl_gradient = InterfaceFindWidget(editor->itfc, "lbl_gradient");
+    if (lbl_gradient)
+    {
+        static const char* names[] = {"linear", "radial"};
+        char text[32] = {0};
+        snprintf(text, sizeof(text), "Fill: %s%s%s%s",
+                 filling ? names[type] : "off",
+                 filling && (targets & GRADIENT_FG) ? " fg" : "",
+                 filling && (targets & GRADIENT_BG) ? " bg" : "",
+                 filling && (targets & GRADIENT_SHADE) ? " shade" : "");
+        LabelSetText((Label*)lbl_gradient->data, text);
+    }
+}
+
+/**
+ * \desc The selection is copied a chunk row at a time, clamped to the largest
+ * size of stamp, and then cleared from the canvas.
+ */
+bool EditorKeepSelection(Editor* editor)
+{
+    const Document* doc = VectorAt(editor->documents, editor->active);
+    SDL_Rect rect = doc->canvas->selection;
+    if (editor->stamps == NULL || rect.w <= 0 || rect.h <= 0)
+    {
+        return false;
+    }
+
+    rect.w = SDL_min(rect.w, STAMP_MAX_SIZE);
+    rect.h = SDL_min(rect.h, STAMP_MAX_SIZE);
+    doc->canvas->selection = (SDL_Rect){0};
+
+    Stamp* stamp = StampCreate(CanvasCopy(doc->canvas, rect), rect.w, rect.h);
+    if (!StampLibraryAdd(editor->stamps, stamp))
+    {
+        return false;
+    }
+
+    EditorApplyStamp(editor);
+    return true;
+}
+
+/**
+ * \desc A whole canvas may change shape when transformed, or when a transform
+ * is undone or redone, so the panes are laid out again afterwards to keep
+ * every view in bounds.
+ */
+static void EditorTransform(Editor* editor, TransformType type)
+{
+    Document* doc = VectorAt(editor->documents, editor->active);
+    if (doc->canvas->selection.w > 0 && doc->canvas->selection.h > 0)
+    {
+        CanvasTransformSelection(doc->canvas, type);
+    }
+    else
+    {
+        CanvasTransform(doc->canvas, type);
+        EditorLayoutPanes(editor, doc->canvas);
+    }
+}
+
+/**
+ * \desc Crops the canvas of the active document to its selection, or to its
+ * content if nothing is selected, or else extends it by a chunk on the right
+ * and bottom (or on every side, keeping it centred). The panes are laid out
+ * again afterwards to keep every view in bounds.
+ */
+static void EditorResize(Editor* editor, bool crop, bool centred)
+{
+    Document* doc = VectorAt(editor->documents, editor->active);
+    Canvas* canvas = doc->canvas;
+
+    if (crop && canvas->selection.w > 0 && canvas->selection.h > 0)
+    {
+        CanvasResize(canvas, canvas->selection);
+    }
+    else if (crop)
+    {
+        CanvasCropToContent(canvas);
+    }
+    else
+    {
+        const i32 step = centred ? 2 * CHUNK_SIZE : CHUNK_SIZE;
+        CanvasResizeAnchored(canvas, canvas->cells->width + step,
+                             canvas->cells->height + step,
+                             centred ? CANVAS_ANCHOR_CENTRE
+                                     : CANVAS_ANCHOR_TOP_LEFT);
+    }
+
+    EditorLayoutPanes(editor, canvas);
+}
+
+/**
+ * \desc A new recording replaces the macro last recorded. On stopping, the
+ * macro is named after the time now; an empty macro is kept but not saved. Any
+ * stroke in progress is committed first, so that it is recorded whole.
+ */
+bool EditorRecordMacro(Editor* editor)
+{
+    const Document* doc = VectorAt(editor->documents, editor->active);
+    HistoryCommit(doc->history);
+
+    if (!editor->recording)
+    {
+        if (editor->macro)
+        {
+            MacroFree(editor->macro);
+        }
+        editor->macro = MacroCreate();
+        editor->recording = true;
+        doc->canvas->macro = editor->macro;
+        Log(LOG_NOTIFY, "Recording a macro");
+        return true;
+    }
+
+    editor->recording = false;
+    doc->canvas->macro = NULL;
+    if (editor->macro->count == 0)
+    {
+        return false;
+    }
+
+    if (!DirCreate(EDITOR_MACRO_DIR))
+    {
+        Log(LOG_WARNING, "Could not create macro directory %s",
+            EDITOR_MACRO_DIR);
+        return false;
+    }
+
+    char stamp[32] = {0};
+    const time_t now = time(NULL);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+
+    char path[256] = {0};
+    snprintf(path, sizeof(path), "%s/%s%s", EDITOR_MACRO_DIR, stamp,
+             MACRO_EXTENSION);
+    if (MacroSave(editor->macro, path))
+    {
+        Log(LOG_NOTIFY, "Saved a macro of %zu operations to %s",
+            editor->macro->count, path);
+    }
+    return false;
+}
+
+/**
+ * \desc A macro cannot be played whilst it is being recorded, as it would
+ * grow as it played. The panes are laid out again, as the macro may have
+ * resized the canvas.
+ */
+size_t EditorPlayMacro(Editor* editor)
+{
+    if (editor->macro == NULL || editor->recording)
+    {
+        return 0;
+    }
+
+    const Document* doc = VectorAt(editor->documents, editor->active);
+    HistoryCommit(doc->history);
+
+    const size_t changed = CanvasPlayMacro(doc->canvas, editor->macro);
+    EditorLayoutPanes(editor, doc->canvas);
+
+    return changed;
+}
+
 /**
  * \desc Handles the input pertaining to the editor. This requires an input
- * object to poll for events.
+ * object to poll for events. Holding control, N opens a new document, W closes
+ * the active one, S saves it (or exports it with shift held), tab (with shift
+ * to go backwards) cycles through them, Z and Y undo and redo on the active
+ * document, backslash cycles the number of panes, P toggles the preview of
+ * animated tiles, C keeps the selection as a stamp, D deselects both the
+ * selection and the selected stamp, T transposes, K crops to the selection (or
+ * to the content) and E extends the canvas by a chunk (on every side with shift
+ * held); resizing clears the history. M starts and stops recording a macro, and
+ * with shift held plays it. The square brackets shrink and grow the brush, and
+ * B cycles it from round to square to the shape of the selected stamp; custom
+ * brushes cannot be resized. Delete removes the selected stamp. R rotates
+ * clockwise (anticlockwise with shift held) and H flips horizontally
+ * (vertically with shift held); transforms act on the selection, or the whole
+ * canvas if there is none. G cycles the gradient fill from off to linear to
+ * radial, and with shift held cycles the parts of each cell it fills. The mouse
+ * wheel scrolls the canvas (horizontally with shift held) when over it; views
+ * deal with their own input after the interface. The save button saves the
+ * active document.
  */
 void EditorHandleInput(Editor* editor, Input* input)
 {
-    if (InputKeyPressed(input, SDLK_v))
+    const bool ctrl = input->curr_mod_map & KMOD_CTRL;
+    const size_t num_documents = VectorLength(editor->documents);
+
+    if (ctrl && InputKeyPressed(input, SDLK_n))
+    {
+        EditorNewDocument(editor);
+    }
+    else if (ctrl && InputKeyPressed(input, SDLK_w))
+    {
+        EditorCloseDocument(editor);
+    }
+    else if (ctrl && InputKeyPressed(input, SDLK_s))
+    {
+        if (input->curr_mod_map & KMOD_SHIFT)
+        {
+            EditorExportDocument(editor);
+        }
+        else
+        {
+            EditorSaveDocument(editor);
+        }
+    }
+    else if (ctrl && InputKeyPressed(input, SDLK_TAB))
+    {
+        const size_t step =
+            input->curr_mod_map & KMOD_SHIFT ? num_documents - 1 : 1;
+        EditorSwitchDocument(editor, (editor->active + step) % num_documents);
+    }
+    else if (ctrl && InputKeyPressed(input, SDLK_z))
+    {
+        const Document* doc = VectorAt(editor->documents, editor->active);
+        if (CanvasUndo(doc->canvas))
+        {
+            EditorLayoutPanes(editor, doc->canvas);
+        }
+    }
+    else if (ctrl && InputKeyPressed(input, SDLK_y))
+    {
+        const Document* doc = VectorAt(editor->documents, editor->active);
+        if (CanvasRedo(doc->canvas))
+        {
+            EditorLayoutPanes(editor, doc->canvas);
+        }
+    }
+    else if (ctrl && InputKeyPressed(input, SDLK_BACKSLASH))
+    {
+        const size_t panes = VectorLength(editor->views) + 1;
+        EditorSplitView(editor, panes % EDITOR_MAX_PANES + 1);
+    }
+    else if (ctrl && InputKeyPressed(input, SDLK_p) && editor->animations)
+    {
+        const Document* doc = VectorAt(editor->documents, editor->active);
+        editor->animate ^= 1;
+        CanvasSetAnimations(doc->canvas,
+                            editor->animate ? editor->animations : NULL);
+    }
+    else if (ctrl && InputKeyPressed(input, SDLK_c))
+    {
+        EditorKeepSelection(editor);
+    }
+    else if (ctrl && InputKeyPressed(input, SDLK_k))
+    {
+        EditorResize(editor, true, false);
+    }
+    else if (ctrl && InputKeyPressed(input, SDLK_e))
+    {
+        EditorResize(editor, false, input->curr_mod_map & KMOD_SHIFT);
+    }
+    else if (ctrl && InputKeyPressed(input, SDLK_m))
+    {
+        if (input->curr_mod_map & KMOD_SHIFT)
+        {
+            EditorPlayMacro(editor);
+        }
+        else
+        {
+            EditorRecordMacro(editor);
+        }
+    }
+    else if (ctrl && InputKeyPressed(input, SDLK_t))
+    {
+        EditorTransform(editor, TRANSFORM_TRANSPOSE);
+    }
+    else if (InputKeyPressed(input, SDLK_DELETE) && editor->stamps)
+    {
+        StampLibraryRemoveSelected(editor->stamps);
+    }
+    else if (ctrl && InputKeyPressed(input, SDLK_d))
+    {
+        Document* doc = VectorAt(editor->documents, editor->active);
+        doc->canvas->selection = (SDL_Rect){0};
+        if (editor->stamps)
+        {
+            StampLibrarySelect(editor->stamps, -1);
+        }
+    }
+    else if (InputKeyPressed(input, SDLK_LEFTBRACKET) &&
+             editor->brush->shape != BRUSH_CUSTOM &&
+             editor->brush->radius > BRUSH_MIN_RADIUS)
+    {
+        EditorSetBrush(editor, editor->brush->shape, editor->brush->radius - 1);
+    }
+    else if (InputKeyPressed(input, SDLK_RIGHTBRACKET) &&
+             editor->brush->shape != BRUSH_CUSTOM &&
+             editor->brush->radius < BRUSH_MAX_RADIUS)
+    {
+        EditorSetBrush(editor, editor->brush->shape, editor->brush->radius + 1);
+    }
+    else if (InputKeyPressed(input, SDLK_b))
+    {
+        EditorSetBrush(editor,
+                       (BrushShape)((editor->brush->shape + 1) %
+                                    (BRUSH_CUSTOM + 1)),
+                       editor->brush->radius);
+    }
+    else if (InputKeyPressed(input, SDLK_g) &&
+             input->curr_mod_map & KMOD_SHIFT)
+    {
+        static const u8 targets[] = {
+            GRADIENT_FG | GRADIENT_BG, GRADIENT_FG, GRADIENT_BG,
+            GRADIENT_SHADE, GRADIENT_SHADE | GRADIENT_FG};
+        const size_t num_targets = sizeof(targets) / sizeof(*targets);
+
+        size_t next = 0;
+        while (next < num_targets &&
+               targets[next] != editor->gradient.targets)
+        {
+            next++;
+        }
+        EditorSetGradient(editor, editor->filling, editor->gradient.type,
+                          targets[(next + 1) % num_targets]);
+    }
+    else if (InputKeyPressed(input, SDLK_g))
+    {
+        const bool radial = editor->gradient.type == GRADIENT_RADIAL;
+        EditorSetGradient(editor, !editor->filling || !radial,
+                          editor->filling && !radial ? GRADIENT_RADIAL
+                                                     : GRADIENT_LINEAR,
+                          editor->gradient.targets);
+    }
+    else if (InputKeyPressed(input, SDLK_r))
+    {
+        EditorTransform(editor, input->curr_mod_map & KMOD_SHIFT
+                                    ? TRANSFORM_ROTATE_270
+                                    : TRANSFORM_ROTATE_90);
+    }
+    else if (InputKeyPressed(input, SDLK_h))
+    {
+        EditorTransform(editor, input->curr_mod_map & KMOD_SHIFT
+                                    ? TRANSFORM_FLIP_V
+                                    : TRANSFORM_FLIP_H);
+    }
+    else if (InputKeyPressed(input, SDLK_v))
     {
         editor->visible ^= 1;
     }
 
+    const Document* doc = VectorAt(editor->documents, editor->active);
+    if (input->mouse_wheel && !ctrl &&
+        InputMouseWithin(input, doc->canvas->rect))
+    {
+        const i32 step = -input->mouse_wheel * VIEW_SCROLL_STEP;
+        if (input->curr_mod_map & KMOD_SHIFT)
+        {
+            CanvasScroll(doc->canvas, step, 0);
+        }
+        else
+        {
+            CanvasScroll(doc->canvas, 0, step);
+        }
+    }
+
     InterfaceHandleInput(editor->itfc, input);
+
+    Widget* btn_save = InterfaceFindWidget(editor->itfc, "btn_save");
+    if (btn_save && ButtonIsPressed((Button*)btn_save->data))
+    {
+        EditorSaveDocument(editor);
+    }
+
+    for (size_t i = 0; i < VectorLength(editor->views); ++i)
+    {
+        ViewHandleInput(VectorAt(editor->views, i), input);
+    }
 }
 
 /**
  * \desc Updates of all of the pertinent editor components, such as tool
- * selection and visible glyphs.
+ * selection and visible glyphs. A change of the selected stamp is passed on to
+ * every document, and a map picked in the browser is opened. A click on the
+ * minimap centres the canvas on the clicked cell, and the minimap then
+ * outlines wherever the canvas shows.
  */
-void EditorUpdate(Editor* editor) { InterfaceUpdate(editor->itfc); }
+void EditorUpdate(Editor* editor)
+{
+    InterfaceUpdate(editor->itfc);
+
+    if (editor->stamps && editor->stamps->changed)
+    {
+        EditorApplyStamp(editor);
+    }
+
+    if (editor->browser && editor->browser->pick)
+    {
+        editor->browser->pick = false;
+        EditorOpenDocument(editor, editor->browser->picked);
+    }
+
+    if (editor->minimap == NULL)
+    {
+        return;
+    }
+
+    const Document* doc = VectorAt(editor->documents, editor->active);
+    Canvas* canvas = doc->canvas;
+
+    if (editor->minimap->jump)
+    {
+        CanvasScroll(canvas,
+                     editor->minimap->target.x - canvas->rect.w / 2 -
+                         canvas->offset_x,
+                     editor->minimap->target.y - canvas->rect.h / 2 -
+                         canvas->offset_y);
+        editor->minimap->jump = false;
+    }
+
+    editor->minimap->viewport.x = canvas->offset_x;
+    editor->minimap->viewport.y = canvas->offset_y;
+    editor->minimap->viewport.w = canvas->rect.w;
+    editor->minimap->viewport.h = canvas->rect.h;
+}
 
 /**
  * \desc Renders of all of the pertinent editor components provided the visible
- * flag is true.
+ * flag is true. The views are rendered over the interface, after the canvas has
+ * brought the shared caches up to date.
  */
 void EditorRender(const Editor* editor, const Window* wind)
 {
     if (editor->visible)
     {
         InterfaceRender(editor->itfc, wind, editor->tex);
+
+        for (size_t i = 0; i < VectorLength(editor->views); ++i)
+        {
+            ViewRender(VectorAt(editor->views, i), wind, editor->tex);
+        }
     }
 }
\ No newline at end of file
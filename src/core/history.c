@@ -0,0 +1,250 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file history.c
+ *
+ * \brief The history of a document records the cell edits made to its canvas,
+ * and the transforms of the whole canvas, so that they can be undone and
+ * redone.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "core/history.h"
+
+/**
+ * \desc Frees the edits of an entry and then the entry itself.
+ */
+static void HistoryEntryFree(HistoryEntry* entry)
+{
+    if (entry->lookup)
+    {
+        Free(entry->lookup);
+    }
+    if (entry->edits)
+    {
+        Free(entry->edits);
+    }
+    Free(entry);
+}
+
+/**
+ * \desc Finds the slot of a cell in the lookup table of an entry: either the
+ * slot holding its edit, or the empty slot where its edit belongs.
+ */
+static size_t HistoryEntrySlot(const HistoryEntry* entry, size_t index)
+{
+    const size_t mask = entry->num_slots - 1;
+    size_t slot = (size_t)((index * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+
+    while (entry->lookup[slot] &&
+           entry->edits[entry->lookup[slot] - 1].index != index)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+/**
+ * \desc Doubles the lookup table of an entry and re-inserts every edit, which
+ * keeps the table at most half full.
+ */
+static void HistoryEntryGrowLookup(HistoryEntry* entry)
+{
+    if (entry->lookup)
+    {
+        Free(entry->lookup);
+    }
+    entry->num_slots = entry->num_slots ? entry->num_slots << 1 : 64;
+    entry->lookup = Allocate(sizeof(size_t) * entry->num_slots);
+
+    for (size_t i = 0; i < entry->count; ++i)
+    {
+        entry->lookup[HistoryEntrySlot(entry, entry->edits[i].index)] = i + 1;
+    }
+}
+
+/**
+ * \desc Allocates the history and its (empty) vector of entries.
+ */
+[[nodiscard]] History* HistoryCreate(void)
+{
+    History* history = Allocate(sizeof(History));
+    history->entries = VectorCreate();
+    history->position = 0;
+    history->open = NULL;
+
+    return history;
+}
+
+/**
+ * \desc Frees every committed entry, the open entry if there is one, and then
+ * the history itself.
+ */
+void HistoryFree(History* history)
+{
+    for (size_t i = 0; i < VectorLength(history->entries); ++i)
+    {
+        HistoryEntryFree(VectorAt(history->entries, i));
+    }
+    VectorFree(history->entries);
+
+    if (history->open)
+    {
+        HistoryEntryFree(history->open);
+    }
+
+    Free(history);
+}
+
+/**
+ * \desc Opens a new entry, discarding any entries which were undone, as they
+ * can no longer be redone.
+ */
+static void HistoryOpen(History* history)
+{
+    while (VectorLength(history->entries) > history->position)
+    {
+        const size_t last = VectorLength(history->entries) - 1;
+        HistoryEntryFree(VectorAt(history->entries, last));
+        VectorDelete(history->entries, last);
+    }
+
+    history->open = Allocate(sizeof(HistoryEntry));
+}
+
+/**
+ * \desc A cell edited more than once in the same entry keeps a single edit: the
+ * first before state and the latest after state.
+ */
+void HistoryRecord(History* history, size_t index, Cell before, Cell after)
+{
+    if (history->open == NULL)
+    {
+        HistoryOpen(history);
+    }
+
+    HistoryEntry* entry = history->open;
+    if (2 * (entry->count + 1) > entry->num_slots)
+    {
+        HistoryEntryGrowLookup(entry);
+    }
+
+    const size_t slot = HistoryEntrySlot(entry, index);
+    if (entry->lookup[slot])
+    {
+        entry->edits[entry->lookup[slot] - 1].after = after;
+        return;
+    }
+
+    if (entry->count == entry->capacity)
+    {
+        entry->capacity = entry->capacity ? entry->capacity << 1 : 16;
+        entry->edits =
+            Reallocate(entry->edits, sizeof(HistoryEdit) * entry->capacity);
+    }
+
+    entry->edits[entry->count++] =
+        (HistoryEdit){.index = index, .before = before, .after = after};
+    entry->lookup[slot] = entry->count;
+}
+
+/**
+ * \desc Cell indices depend upon the size of the canvas, which a transform may
+ * change, so the open entry is committed first and the transform never shares
+ * an entry with edits.
+ */
+void HistoryRecordTransform(History* history, TransformType type)
+{
+    HistoryCommit(history);
+    HistoryOpen(history);
+    history->open->transform = type;
+    HistoryCommit(history);
+}
+
+/**
+ * \desc Pushes the open entry onto the stack, dropping its lookup table as a
+ * committed entry is never added to. The oldest entry is discarded once the
+ * stack holds more than the maximum number of entries.
+ */
+void HistoryCommit(History* history)
+{
+    if (history->open == NULL)
+    {
+        return;
+    }
+
+    if (history->open->lookup)
+    {
+        Free(history->open->lookup);
+    }
+    history->open->lookup = NULL;
+    history->open->num_slots = 0;
+
+    VectorPush(history->entries, history->open);
+    history->open = NULL;
+    history->position++;
+
+    if (VectorLength(history->entries) > HISTORY_MAX_ENTRIES)
+    {
+        HistoryEntryFree(VectorAt(history->entries, 0));
+        VectorDelete(history->entries, 0);
+        history->position--;
+    }
+}
+
+/**
+ * \desc Leaves the history as it was created.
+ */
+void HistoryClear(History* history)
+{
+    while (VectorLength(history->entries) > 0)
+    {
+        const size_t last = VectorLength(history->entries) - 1;
+        HistoryEntryFree(VectorAt(history->entries, last));
+        VectorDelete(history->entries, last);
+    }
+    history->position = 0;
+
+    if (history->open)
+    {
+        HistoryEntryFree(history->open);
+        history->open = NULL;
+    }
+}
+
+/**
+ * \desc An entry still being recorded is committed first, so that undoing in
+ * the middle of a stroke reverts the stroke so far.
+ */
+[[nodiscard]] const HistoryEntry* HistoryUndo(History* history)
+{
+    HistoryCommit(history);
+
+    if (history->position == 0)
+    {
+        return NULL;
+    }
+
+    return VectorAt(history->entries, --history->position);
+}
+
+/**
+ * \desc Redo is only possible whilst no new entry has been recorded since the
+ * last undo.
+ */
+[[nodiscard]] const HistoryEntry* HistoryRedo(History* history)
+{
+    HistoryCommit(history);
+
+    if (history->position == VectorLength(history->entries))
+    {
+        return NULL;
+    }
+
+    return VectorAt(history->entries, history->position++);
+}
@@ -0,0 +1,211 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file journal.c
+ *
+ * \brief The journal of a document logs every change made to its canvas over
+ * the session, with the time it was made, from a copy of the cells as they
+ * were when the journal was started. Unlike the history, nothing is undone, so
+ * the session can be replayed; only once the journal is full are its oldest
+ * changes folded into the copy of the cells.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "core/journal.h"
+
+/**
+ * \desc The journal holds no cells until it is started.
+ */
+[[nodiscard]] Journal* JournalCreate(void)
+{
+    Journal* journal = Allocate(sizeof(Journal));
+    journal->start = NULL;
+    journal->started = 0;
+    journal->ops = NULL;
+    journal->count = 0;
+    journal->capacity = 0;
+
+    return journal;
+}
+
+/**
+ * \desc Frees the operations and the copy of the cells, then the journal.
+ */
+void JournalFree(Journal* journal)
+{
+    if (journal->start)
+    {
+        ChunkStoreFree(journal->start);
+    }
+    if (journal->ops)
+    {
+        Free(journal->ops);
+    }
+    Free(journal);
+}
+
+/**
+ * \desc Compresses every chunk of the copy of the cells, by compressing as if
+ * every chunk had gone cold. The copy is only used by the thread which owns
+ * the journal, so it is not registered with the compressor.
+ */
+static void JournalPack(ChunkStore* cells)
+{
+    ChunkStoreCompressCold(cells, SDL_GetTicks() + CHUNK_COLD_TICKS, SIZE_MAX);
+}
+
+/**
+ * \desc The cells are cloned, so compressed chunks are copied as they are, and
+ * the rest are then compressed. The operations logged so far are dropped, but
+ * their memory is kept for those to come.
+ */
+void JournalStart(Journal* journal, ChunkStore* cells)
+{
+    if (journal->start)
+    {
+        ChunkStoreFree(journal->start);
+    }
+
+    journal->start = ChunkStoreClone(cells);
+    journal->started = SDL_GetTicks();
+    journal->count = 0;
+    JournalPack(journal->start);
+}
+
+/**
+ * \desc The cells are cloned compressed, and only the operations logged are
+ * copied.
+ */
+[[nodiscard]] Journal* JournalClone(const Journal* journal)
+{
+    Journal* clone = JournalCreate();
+    clone->start = ChunkStoreClone(journal->start);
+    clone->started = journal->started;
+    clone->count = journal->count;
+    clone->capacity = journal->count;
+    if (journal->count)
+    {
+        clone->ops = Allocate(sizeof(JournalOp) * journal->count);
+        memcpy(clone->ops, journal->ops, sizeof(JournalOp) * journal->count);
+    }
+
+    return clone;
+}
+
+/**
+ * \desc Cells added by a resize are blank. An edit of a cell which does not
+ * exist is ignored.
+ */
+void JournalApply(ChunkStore* cells, const JournalOp* op)
+{
+    if (op->kind == JOURNAL_TRANSFORM)
+    {
+        ChunkStoreTransform(cells, op->transform);
+        return;
+    }
+
+    if (op->kind == JOURNAL_RESIZE)
+    {
+        ChunkStoreResize(cells, op->rect, (Cell){0});
+        return;
+    }
+
+    const size_t index = op->edit.index;
+    if (index < (size_t)cells->width * (size_t)cells->height)
+    {
+        ChunkStoreSet(cells, (i32)(index % (size_t)cells->width),
+                      (i32)(index / (size_t)cells->width), op->edit.cell);
+    }
+}
+
+/**
+ * \desc Folds the oldest half of the operations into the copy of the cells,
+ * which is compressed again, and moves the rest down. The times of the rest
+ * are kept, so the session still replays at its own pace from the first
+ * operation kept.
+ */
+static void JournalCompact(Journal* journal)
+{
+    const size_t folded = journal->count / 2;
+    for (size_t i = 0; i < folded; ++i)
+    {
+        JournalApply(journal->start, &journal->ops[i]);
+    }
+
+    memmove(journal->ops, &journal->ops[folded],
+            sizeof(JournalOp) * (journal->count - folded));
+    journal->count -= folded;
+    JournalPack(journal->start);
+}
+
+/**
+ * \desc Appends an operation of the given kind, timed now, and returns it to
+ * be filled in, compacting the journal first if it is full. A journal which
+ * has not been started logs nothing.
+ */
+static JournalOp* JournalPush(Journal* journal, JournalKind kind)
+{
+    if (journal->start == NULL)
+    {
+        return NULL;
+    }
+
+    if (journal->count == JOURNAL_MAX_OPS)
+    {
+        JournalCompact(journal);
+    }
+
+    if (journal->count == journal->capacity)
+    {
+        journal->capacity = journal->capacity ? journal->capacity << 1 : 256;
+        journal->ops =
+            Reallocate(journal->ops, sizeof(JournalOp) * journal->capacity);
+    }
+
+    JournalOp* op = &journal->ops[journal->count++];
+    op->kind = kind;
+    op->time = SDL_GetTicks() - journal->started;
+    return op;
+}
+
+/**
+ * \desc Only the cell after the edit is kept, as replaying never goes back.
+ */
+void JournalEdit(Journal* journal, size_t index, Cell cell)
+{
+    JournalOp* op = JournalPush(journal, JOURNAL_EDIT);
+    if (op)
+    {
+        op->edit.index = index;
+        op->edit.cell = cell;
+    }
+}
+
+/**
+ * \desc The cells are not logged, as replaying the transform restores them.
+ */
+void JournalTransform(Journal* journal, TransformType type)
+{
+    JournalOp* op = JournalPush(journal, JOURNAL_TRANSFORM);
+    if (op)
+    {
+        op->transform = type;
+    }
+}
+
+/**
+ * \desc Cells which are added by the resize are blank, so only the area kept
+ * is logged.
+ */
+void JournalResize(Journal* journal, SDL_Rect rect)
+{
+    JournalOp* op = JournalPush(journal, JOURNAL_RESIZE);
+    if (op)
+    {
+        op->rect = rect;
+    }
+}
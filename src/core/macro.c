@@ -0,0 +1,658 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file macro.c
+ *
+ * \brief A macro is a list of tool operations, such as stamping a brush,
+ * pasting a stamp or replacing one kind of cell with another, recorded from
+ * the canvas so that they can be played onto other maps. Macros are saved as
+ * text, one operation to a line, so they can also be written by hand.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "core/macro.h"
+
+/**
+ * \desc The most cells a single paste may hold.
+ */
+#define MACRO_MAX_PASTE (1 << 24)
+
+/**
+ * \desc The names of the operations, of the shapes of brushes, of gradients,
+ * of transforms and of anchors, in the order of their values.
+ */
+static const char* const macro_kinds[] = {
+    "place",     "brush",          "span",   "paste", "replace", "gradient",
+    "transform", "transform-area", "resize", "grow",  "crop"};
+static const char* const macro_shapes[] = {"round", "square"};
+static const char* const macro_gradients[] = {"linear", "radial"};
+static const char* const macro_transforms[] = {
+    "none",   "rotate-90", "rotate-180", "rotate-270",
+    "flip-h", "flip-v",    "transpose"};
+static const char* const macro_anchors[] = {
+    "top-left", "top",         "top-right", "left",        "centre",
+    "right",    "bottom-left", "bottom",    "bottom-right"};
+
+/**
+ * \desc The macro holds no operations until one is added.
+ */
+[[nodiscard]] Macro* MacroCreate(void)
+{
+    Macro* macro = Allocate(sizeof(Macro));
+    macro->ops = NULL;
+    macro->count = 0;
+    macro->capacity = 0;
+
+    return macro;
+}
+
+/**
+ * \desc Frees the cells of each paste, then the operations and the macro.
+ */
+void MacroFree(Macro* macro)
+{
+    for (size_t i = 0; i < macro->count; ++i)
+    {
+        if (macro->ops[i].cells)
+        {
+            Free(macro->ops[i].cells);
+        }
+    }
+    if (macro->ops)
+    {
+        Free(macro->ops);
+    }
+    Free(macro);
+}
+
+/**
+ * \desc The operations are grown by doubling, like the edits of the history.
+ */
+[[nodiscard]] MacroOp* MacroAdd(Macro* macro, MacroKind kind)
+{
+    if (macro->count == macro->capacity)
+    {
+        macro->capacity = macro->capacity ? macro->capacity << 1 : 64;
+        macro->ops = Reallocate(macro->ops, sizeof(MacroOp) * macro->capacity);
+    }
+
+    MacroOp* op = &macro->ops[macro->count++];
+    *op = (MacroOp){0};
+    op->kind = kind;
+    return op;
+}
+
+/**
+ * \desc Frees the cells of the operation, should it be a paste.
+ */
+void MacroRemoveLast(Macro* macro)
+{
+    if (macro->count == 0)
+    {
+        return;
+    }
+
+    MacroOp* op = &macro->ops[--macro->count];
+    if (op->cells)
+    {
+        Free(op->cells);
+    }
+}
+
+/**
+ * \desc Writes a colour as eight hexadecimal digits, in the order RGBA.
+ */
+static void MacroWriteColor(FILE* file, SDL_Color color)
+{
+    fprintf(file, "%02x%02x%02x%02x", color.r, color.g, color.b, color.a);
+}
+
+/**
+ * \desc Writes a cell as its glyph index and then its foreground and background
+ * colours, separated by colons.
+ */
+static void MacroWriteCell(FILE* file, Cell cell)
+{
+    fprintf(file, " %u:", cell.index);
+    MacroWriteColor(file, cell.fg);
+    fputc(':', file);
+    MacroWriteColor(file, cell.bg);
+}
+
+/**
+ * \desc Writes a rectangle as its position and then its size.
+ */
+static void MacroWriteRect(FILE* file, SDL_Rect rect)
+{
+    fprintf(file, " %d %d %d %d", rect.x, rect.y, rect.w, rect.h);
+}
+
+/**
+ * \desc Writes an operation as its name followed by its fields, on one line.
+ * The parts of a replaced cell which are not compared are written as stars.
+ */
+static void MacroWriteOp(FILE* file, const MacroOp* op)
+{
+    fputs(macro_kinds[op->kind], file);
+
+    switch (op->kind)
+    {
+    case MACRO_PLACE:
+        fprintf(file, " %d %d", op->rect.x, op->rect.y);
+        MacroWriteCell(file, op->cell);
+        break;
+
+    case MACRO_BRUSH:
+        fprintf(file, " %s %d %d %d", macro_shapes[op->shape], op->radius,
+                op->rect.x, op->rect.y);
+        MacroWriteCell(file, op->cell);
+        break;
+
+    case MACRO_SPAN:
+        fprintf(file, " %d %d %d", op->rect.x, op->rect.y, op->rect.w);
+        MacroWriteCell(file, op->cell);
+        break;
+
+    case MACRO_PASTE:
+        MacroWriteRect(file, op->rect);
+        for (size_t i = 0; i < (size_t)op->rect.w * (size_t)op->rect.h; ++i)
+        {
+            MacroWriteCell(file, op->cells[i]);
+        }
+        break;
+
+    case MACRO_REPLACE:
+        fputc(' ', file);
+        if (op->match.fields & CELL_MATCH_GLYPH)
+        {
+            fprintf(file, "%u", op->match.index);
+        }
+        else
+        {
+            fputc('*', file);
+        }
+        fputc(':', file);
+        if (op->match.fields & CELL_MATCH_FG)
+        {
+            MacroWriteColor(file, op->match.fg);
+        }
+        else
+        {
+            fputc('*', file);
+        }
+        fputc(':', file);
+        if (op->match.fields & CELL_MATCH_BG)
+        {
+            MacroWriteColor(file, op->match.bg);
+        }
+        else
+        {
+            fputc('*', file);
+        }
+        MacroWriteCell(file, op->cell);
+        break;
+
+    case MACRO_GRADIENT:
+        fprintf(file, " %s %s%s%s ", macro_gradients[op->gradient.type],
+                op->gradient.targets & GRADIENT_FG ? "f" : "",
+                op->gradient.targets & GRADIENT_BG ? "b" : "",
+                op->gradient.targets & GRADIENT_SHADE ? "s" : "");
+        MacroWriteColor(file, op->gradient.from);
+        fputc(' ', file);
+        MacroWriteColor(file, op->gradient.to);
+        fprintf(file, " %d %d %d %d", op->gradient.start.x,
+                op->gradient.start.y, op->gradient.end.x, op->gradient.end.y);
+        MacroWriteRect(file, op->rect);
+        break;
+
+    case MACRO_TRANSFORM:
+        fprintf(file, " %s", macro_transforms[op->transform]);
+        break;
+
+    case MACRO_TRANSFORM_AREA:
+        fprintf(file, " %s", macro_transforms[op->transform]);
+        MacroWriteRect(file, op->rect);
+        break;
+
+    case MACRO_RESIZE:
+        MacroWriteRect(file, op->rect);
+        break;
+
+    case MACRO_GROW:
+        fprintf(file, " %d %d %s", op->rect.w, op->rect.h,
+                macro_anchors[op->anchor]);
+        break;
+
+    case MACRO_CROP:
+        break;
+    }
+
+    fputc('\n', file);
+}
+
+/**
+ * \desc The file begins with a comment naming the format, which is ignored
+ * when it is read back.
+ */
+bool MacroSave(const Macro* macro, const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL)
+    {
+        Log(LOG_ERROR, "Could not open macro %s for writing", path);
+        return false;
+    }
+
+    fputs("# Karte macro: one tool operation to a line, played in order.\n",
+          file);
+    for (size_t i = 0; i < macro->count; ++i)
+    {
+        MacroWriteOp(file, &macro->ops[i]);
+    }
+
+    const bool ok = !ferror(file);
+    if (fclose(file) != 0 || !ok)
+    {
+        Log(LOG_ERROR, "Could not write macro %s", path);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \desc Takes the next token of the line being parsed.
+ */
+static char* MacroNext(void) { return strtok(NULL, " \t\r\n"); }
+
+/**
+ * \desc Parses a whole token as an integer.
+ */
+static bool MacroParseInt(const char* token, i32* value)
+{
+    if (token == NULL)
+    {
+        return false;
+    }
+
+    char* end = NULL;
+    const long long parsed = strtoll(token, &end, 10);
+    if (end == token || *end != '\0' || parsed < INT32_MIN ||
+        parsed > INT32_MAX)
+    {
+        return false;
+    }
+
+    *value = (i32)parsed;
+    return true;
+}
+
+/**
+ * \desc Parses a whole token as a position or size, which is at most the
+ * largest extent of a canvas either way, so that adding any two never
+ * overflows.
+ */
+static bool MacroParseCoord(const char* token, i32* value)
+{
+    return MacroParseInt(token, value) && *value >= -CHUNK_MAX_EXTENT &&
+           *value <= CHUNK_MAX_EXTENT;
+}
+
+/**
+ * \desc Parses a whole token as one of a list of names, giving its position.
+ */
+static bool MacroParseName(const char* token, const char* const* names,
+                           size_t count, u32* value)
+{
+    for (size_t i = 0; token && i < count; ++i)
+    {
+        if (strcmp(token, names[i]) == 0)
+        {
+            *value = (u32)i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * \desc Parses a whole token of eight hexadecimal digits as a colour, in the
+ * order RGBA.
+ */
+static bool MacroParseColor(const char* token, SDL_Color* color)
+{
+    if (token == NULL || strlen(token) != 8)
+    {
+        return false;
+    }
+
+    u32 packed = 0;
+    for (i32 i = 0; i < 8; ++i)
+    {
+        const char c = token[i];
+        const i32 digit = c >= '0' && c <= '9'   ? c - '0'
+                          : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                          : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                                 : -1;
+        if (digit < 0)
+        {
+            return false;
+        }
+        packed = packed << 4 | (u32)digit;
+    }
+
+    *color = (SDL_Color){(u8)(packed >> 24), (u8)(packed >> 16),
+                         (u8)(packed >> 8), (u8)packed};
+    return true;
+}
+
+/**
+ * \desc Parses a cell written as its glyph index and its foreground and
+ * background colours, separated by colons. Given the fields of a match, any
+ * part may instead be a star, which leaves it out of the match.
+ */
+static bool MacroParseCell(char* token, Cell* cell, u8* fields)
+{
+    char* parts[3] = {token, NULL, NULL};
+    for (i32 i = 1; i < 3 && parts[i - 1]; ++i)
+    {
+        char* colon = strchr(parts[i - 1], ':');
+        if (colon)
+        {
+            *colon = '\0';
+            parts[i] = colon + 1;
+        }
+    }
+    if (token == NULL || parts[2] == NULL)
+    {
+        return false;
+    }
+
+    if (fields)
+    {
+        *fields = 0;
+    }
+
+    const u8 flags[3] = {CELL_MATCH_GLYPH, CELL_MATCH_FG, CELL_MATCH_BG};
+    for (i32 i = 0; i < 3; ++i)
+    {
+        if (fields && strcmp(parts[i], "*") == 0)
+        {
+            continue;
+        }
+
+        bool ok = false;
+        if (i == 0)
+        {
+            i32 index = 0;
+            ok = MacroParseInt(parts[0], &index) && index >= 0 && index <= 255;
+            cell->index = (u8)index;
+        }
+        else
+        {
+            ok = MacroParseColor(parts[i], i == 1 ? &cell->fg : &cell->bg);
+        }
+
+        if (!ok)
+        {
+            return false;
+        }
+        if (fields)
+        {
+            *fields |= flags[i];
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \desc Parses the position and size of a rectangle, which must not be empty
+ * nor larger than a canvas may be.
+ */
+static bool MacroParseRect(SDL_Rect* rect)
+{
+    return MacroParseCoord(MacroNext(), &rect->x) &&
+           MacroParseCoord(MacroNext(), &rect->y) &&
+           MacroParseCoord(MacroNext(), &rect->w) &&
+           MacroParseCoord(MacroNext(), &rect->h) && rect->w > 0 &&
+           rect->h > 0;
+}
+
+/**
+ * \desc Parses the parts of each cell filled by a gradient, as any of the
+ * letters f, b and s, for the foreground, background and shade.
+ */
+static bool MacroParseTargets(const char* token, u8* targets)
+{
+    *targets = 0;
+    for (const char* c = token; c && *c; ++c)
+    {
+        const u8 target = *c == 'f'   ? GRADIENT_FG
+                          : *c == 'b' ? GRADIENT_BG
+                          : *c == 's' ? GRADIENT_SHADE
+                                      : 0;
+        if (target == 0)
+        {
+            return false;
+        }
+        *targets |= target;
+    }
+
+    return *targets != 0;
+}
+
+/**
+ * \desc Parses the fields of an operation, after its name, into the operation.
+ */
+static bool MacroParseOp(MacroOp* op)
+{
+    u32 value = 0;
+
+    switch (op->kind)
+    {
+    case MACRO_PLACE:
+        op->rect.w = 1;
+        op->rect.h = 1;
+        return MacroParseCoord(MacroNext(), &op->rect.x) &&
+               MacroParseCoord(MacroNext(), &op->rect.y) &&
+               MacroParseCell(MacroNext(), &op->cell, NULL);
+
+    case MACRO_BRUSH:
+        if (!MacroParseName(MacroNext(), macro_shapes, 2, &value))
+        {
+            return false;
+        }
+        op->shape = (BrushShape)value;
+        return MacroParseInt(MacroNext(), &op->radius) &&
+               op->radius >= BRUSH_MIN_RADIUS &&
+               op->radius <= BRUSH_MAX_RADIUS &&
+               MacroParseCoord(MacroNext(), &op->rect.x) &&
+               MacroParseCoord(MacroNext(), &op->rect.y) &&
+               MacroParseCell(MacroNext(), &op->cell, NULL);
+
+    case MACRO_SPAN:
+        op->rect.h = 1;
+        return MacroParseCoord(MacroNext(), &op->rect.x) &&
+               MacroParseCoord(MacroNext(), &op->rect.y) &&
+               MacroParseCoord(MacroNext(), &op->rect.w) && op->rect.w > 0 &&
+               MacroParseCell(MacroNext(), &op->cell, NULL);
+
+    case MACRO_PASTE:
+    {
+        if (!MacroParseRect(&op->rect) ||
+            (i64)op->rect.w * op->rect.h > MACRO_MAX_PASTE)
+        {
+            return false;
+        }
+
+        const size_t num_cells = (size_t)op->rect.w * (size_t)op->rect.h;
+        op->cells = Allocate(sizeof(Cell) * num_cells);
+        for (size_t i = 0; i < num_cells; ++i)
+        {
+            if (!MacroParseCell(MacroNext(), &op->cells[i], NULL))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    case MACRO_REPLACE:
+    {
+        Cell match = {0};
+        if (!MacroParseCell(MacroNext(), &match, &op->match.fields))
+        {
+            return false;
+        }
+        op->match.index = match.index;
+        op->match.fg = match.fg;
+        op->match.bg = match.bg;
+        return MacroParseCell(MacroNext(), &op->cell, NULL);
+    }
+
+    case MACRO_GRADIENT:
+    {
+        Gradient* gradient = &op->gradient;
+        if (!MacroParseName(MacroNext(), macro_gradients, 2, &value))
+        {
+            return false;
+        }
+        gradient->type = (GradientType)value;
+
+        return MacroParseTargets(MacroNext(), &gradient->targets) &&
+               MacroParseColor(MacroNext(), &gradient->from) &&
+               MacroParseColor(MacroNext(), &gradient->to) &&
+               MacroParseCoord(MacroNext(), &gradient->start.x) &&
+               MacroParseCoord(MacroNext(), &gradient->start.y) &&
+               MacroParseCoord(MacroNext(), &gradient->end.x) &&
+               MacroParseCoord(MacroNext(), &gradient->end.y) &&
+               MacroParseRect(&op->rect);
+    }
+
+    case MACRO_TRANSFORM:
+    case MACRO_TRANSFORM_AREA:
+        if (!MacroParseName(MacroNext(), macro_transforms, 7, &value) ||
+            value == TRANSFORM_NONE)
+        {
+            return false;
+        }
+        op->transform = (TransformType)value;
+        return op->kind == MACRO_TRANSFORM || MacroParseRect(&op->rect);
+
+    case MACRO_RESIZE:
+        return MacroParseRect(&op->rect);
+
+    case MACRO_GROW:
+        if (!MacroParseCoord(MacroNext(), &op->rect.w) ||
+            !MacroParseCoord(MacroNext(), &op->rect.h) ||
+            !MacroParseName(MacroNext(), macro_anchors, 9, &value))
+        {
+            return false;
+        }
+        op->anchor = (u8)value;
+        return true;
+
+    case MACRO_CROP:
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * \desc Parses a single line into a new operation, which is only added once
+ * the whole line is known to be valid. Blank lines and comments are skipped.
+ */
+static bool MacroParseLine(Macro* macro, char* line)
+{
+    const char* name = strtok(line, " \t\r\n");
+    if (name == NULL || name[0] == '#')
+    {
+        return true;
+    }
+
+    u32 kind = 0;
+    if (!MacroParseName(name, macro_kinds, MACRO_CROP + 1, &kind))
+    {
+        return false;
+    }
+
+    MacroOp op = {0};
+    op.kind = (MacroKind)kind;
+    const char* rest = NULL;
+    if (!MacroParseOp(&op) || ((rest = MacroNext()) && rest[0] != '#'))
+    {
+        if (op.cells)
+        {
+            Free(op.cells);
+        }
+        return false;
+    }
+
+    *MacroAdd(macro, op.kind) = op;
+    return true;
+}
+
+/**
+ * \desc Reads a whole line, however long, growing the buffer as need be. A
+ * paste holds all of its cells on one line, so lines may be long.
+ */
+static bool MacroReadLine(FILE* file, char** line, size_t* capacity)
+{
+    size_t length = 0;
+    while (fgets(*line + length, (i32)(*capacity - length), file))
+    {
+        length += strlen(*line + length);
+        if ((*line)[length - 1] == '\n' || length + 1 < *capacity)
+        {
+            return true;
+        }
+
+        *capacity <<= 1;
+        *line = Reallocate(*line, *capacity);
+    }
+
+    return length > 0;
+}
+
+/**
+ * \desc Reads the file a line at a time. Unlike the animations, an invalid line
+ * rejects the whole macro, as playing the rest of it could do more harm than
+ * good.
+ */
+[[nodiscard]] Macro* MacroLoad(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+        Log(LOG_ERROR, "Could not open macro %s!", path);
+        return NULL;
+    }
+
+    Macro* macro = MacroCreate();
+    size_t capacity = 512;
+    char* line = Allocate(capacity);
+
+    u32 line_number = 0;
+    while (macro && MacroReadLine(file, &line, &capacity))
+    {
+        line_number++;
+        if (!MacroParseLine(macro, line))
+        {
+            Log(LOG_ERROR, "%s:%u: invalid operation!", path, line_number);
+            MacroFree(macro);
+            macro = NULL;
+        }
+    }
+
+    Free(line);
+    fclose(file);
+
+    return macro;
+}
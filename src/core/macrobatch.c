@@ -0,0 +1,271 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file macrobatch.c
+ *
+ * \brief A macro batch plays a macro onto every map of a directory, without a
+ * window. The maps are read and written back in groups through batched file
+ * I/O, and in between each is loaded into a canvas of its own with no cache
+ * and played onto, on a thread for each processor.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "core/macrobatch.h"
+
+/**
+ * \brief A map to be played onto, and where it is saved, along with the file
+ * as read and then as it is to be written.
+ */
+typedef struct
+{
+    char path[MACROBATCH_MAX_PATH];
+    char out[MACROBATCH_MAX_PATH];
+    u8* data;
+    size_t size;
+    size_t changed;
+    bool ok;
+} MacroBatchItem;
+
+/**
+ * \brief The maps of a batch, shared between the workers which take those of
+ * the group being played onto in turn.
+ */
+typedef struct
+{
+    const Macro* macro;
+    const char* dir;
+    const char* out_dir;
+    MacroBatchItem* items;
+    size_t count;
+    size_t capacity;
+    size_t end;
+    SDL_atomic_t next;
+} MacroBatch;
+
+/**
+ * \desc Adds each map file of the directory whose paths are not too long.
+ */
+static void MacroBatchAddItem(void* data, const char* name, bool is_dir)
+{
+    MacroBatch* batch = data;
+    const size_t length = strlen(name);
+    const size_t ext = sizeof(MAP_EXTENSION) - 1;
+    if (is_dir || length <= ext ||
+        strcmp(name + length - ext, MAP_EXTENSION) != 0)
+    {
+        return;
+    }
+
+    MacroBatchItem item = {0};
+    const i32 path_length =
+        snprintf(item.path, sizeof(item.path), "%s/%s", batch->dir, name);
+    const i32 out_length =
+        snprintf(item.out, sizeof(item.out), "%s/%s",
+                 batch->out_dir ? batch->out_dir : batch->dir, name);
+    if (path_length < 0 || (size_t)path_length >= sizeof(item.path) ||
+        out_length < 0 || (size_t)out_length >= sizeof(item.out))
+    {
+        Log(LOG_WARNING, "The path of %s is too long", name);
+        return;
+    }
+
+    if (batch->count == batch->capacity)
+    {
+        batch->capacity = batch->capacity ? batch->capacity << 1 : 64;
+        batch->items = Reallocate(batch->items,
+                                  sizeof(MacroBatchItem) * batch->capacity);
+    }
+
+    batch->items[batch->count++] = item;
+}
+
+/**
+ * \desc The map read is swapped in for the blank cells of a headless canvas,
+ * which has no history, journal or cache, so that playing costs no more than
+ * the edits themselves. The file read is then replaced by the map to write.
+ * The cells written are those played onto, as a resize may have replaced the
+ * store the map was loaded into.
+ */
+static void MacroBatchPlayItem(const Macro* macro, MacroBatchItem* item)
+{
+    ChunkStore* cells = MapLoadMemory(item->data, item->size);
+    Free(item->data);
+    item->data = NULL;
+    if (cells == NULL)
+    {
+        Log(LOG_WARNING, "%s is not a valid map", item->path);
+        return;
+    }
+
+    Canvas* canvas = CanvasCreate((SDL_Rect){0, 0, 1, 1}, true);
+    ChunkStoreFree(canvas->cells);
+    canvas->cells = cells;
+
+    item->changed = CanvasPlayMacro(canvas, macro);
+    item->data = MapEncode(canvas->cells, &item->size);
+
+    CanvasFree(canvas);
+}
+
+/**
+ * \desc Each worker takes the next map of the group in turn until there are
+ * none left, so that a few large maps do not hold up the rest. A map which
+ * could not be read is passed over.
+ */
+static i32 MacroBatchRunWorker(void* data)
+{
+    MacroBatch* batch = data;
+    for (size_t i = (size_t)SDL_AtomicAdd(&batch->next, 1); i < batch->end;
+         i = (size_t)SDL_AtomicAdd(&batch->next, 1))
+    {
+        if (batch->items[i].data)
+        {
+            MacroBatchPlayItem(batch->macro, &batch->items[i]);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * \desc Plays onto the maps of the group read, by a worker on a thread for
+ * each processor with the calling thread working alongside them, so that the
+ * work is still done should no thread start.
+ */
+static void MacroBatchRunGroup(MacroBatch* batch, size_t first)
+{
+    const i32 num_workers =
+        SDL_min(SDL_max(SDL_GetCPUCount(), 1), MACROBATCH_WORKERS);
+    SDL_Thread* workers[MACROBATCH_WORKERS] = {0};
+    SDL_AtomicSet(&batch->next, (i32)first);
+
+    for (i32 i = 0; i < num_workers; ++i)
+    {
+        workers[i] = SDL_CreateThread(&MacroBatchRunWorker, "macro", batch);
+    }
+
+    MacroBatchRunWorker(batch);
+
+    for (i32 i = 0; i < num_workers; ++i)
+    {
+        if (workers[i])
+        {
+            SDL_WaitThread(workers[i], NULL);
+        }
+    }
+}
+
+/**
+ * \desc Reads a group of maps in one batch, plays onto them and writes back
+ * those played onto in another, freeing every file held as it goes.
+ */
+static void MacroBatchRunFiles(MacroBatch* batch, size_t first)
+{
+    BatchIoRequest requests[MACROBATCH_GROUP] = {0};
+    MacroBatchItem* items = &batch->items[first];
+    const size_t count = batch->end - first;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        requests[i] = (BatchIoRequest){.kind = BATCHIO_READ,
+                                       .path = items[i].path};
+    }
+
+    BatchIoRun(requests, count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        items[i].data = requests[i].ok ? requests[i].data : NULL;
+        items[i].size = requests[i].ok ? requests[i].size : 0;
+        if (!requests[i].ok)
+        {
+            Log(LOG_WARNING, "Could not read map %s", items[i].path);
+        }
+    }
+
+    MacroBatchRunGroup(batch, first);
+
+    size_t num_writes = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (items[i].data)
+        {
+            requests[num_writes++] = (BatchIoRequest){.kind = BATCHIO_WRITE,
+                                                      .path = items[i].out,
+                                                      .data = items[i].data,
+                                                      .size = items[i].size};
+        }
+    }
+
+    BatchIoRun(requests, num_writes);
+    for (size_t i = 0, w = 0; i < count; ++i)
+    {
+        if (items[i].data == NULL)
+        {
+            continue;
+        }
+
+        items[i].ok = requests[w++].ok;
+        if (!items[i].ok)
+        {
+            Log(LOG_WARNING, "Could not save map %s", items[i].out);
+        }
+        Free(items[i].data);
+        items[i].data = NULL;
+    }
+}
+
+/**
+ * \desc The maps are read, played onto and written back a group at a time,
+ * so that only a group of them is ever held in memory. A map which fails is
+ * logged and skipped, so that the rest are still played onto.
+ */
+bool MacroBatchRun(const Macro* macro, const char* dir, const char* out_dir)
+{
+    if (out_dir && !DirCreate(out_dir))
+    {
+        Log(LOG_ERROR, "Could not create directory %s", out_dir);
+        return false;
+    }
+
+    MacroBatch batch = {0};
+    batch.macro = macro;
+    batch.dir = dir;
+    batch.out_dir = out_dir;
+    if (!FileList(dir, &MacroBatchAddItem, &batch))
+    {
+        Log(LOG_ERROR, "Could not list the maps of %s", dir);
+        if (batch.items)
+        {
+            Free(batch.items);
+        }
+        return false;
+    }
+
+    for (size_t first = 0; first < batch.count; first += MACROBATCH_GROUP)
+    {
+        batch.end = SDL_min(first + MACROBATCH_GROUP, batch.count);
+        MacroBatchRunFiles(&batch, first);
+    }
+
+    size_t num_ok = 0;
+    size_t changed = 0;
+    for (size_t i = 0; i < batch.count; ++i)
+    {
+        num_ok += batch.items[i].ok;
+        changed += batch.items[i].changed;
+    }
+
+    Log(LOG_NOTIFY, "Played a macro onto %zu of %zu maps of %s (%zu cells)",
+        num_ok, batch.count, dir, changed);
+
+    if (batch.items)
+    {
+        Free(batch.items);
+    }
+
+    return num_ok == batch.count;
+}
@@ -18,12 +18,98 @@
 
 #include "core/application.h"
 #include "core/common.h"
+#include "core/macrobatch.h"
+#include "core/mapexport.h"
+#include "core/mapindex.h"
+#include "core/pack.h"
 #include "core/utils.h"
+#include "generated/tilesets.h"
+#include "graphics/tileatlas.h"
 
 u32 g_mem_allocs = 0;
 
-int main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
+/**
+ * \desc Run as "karte --pack <dir> <pack>", the maps of a directory are packed
+ * without opening the editor. Run as "karte --macro <macro> <dir> [<out>]", a
+ * macro is played onto the maps of a directory, which are saved to the output
+ * directory if one is given or replaced otherwise. Run as "karte --export
+ * <map> <file>", a map is exported as an HTML page or SVG image, by the
+ * extension of the file. Run as "karte --atlas <map> <tileset> <file>", a map
+ * is exported as a tile map with an atlas of only the tiles it uses, drawn
+ * with a built-in tileset. The tileset name is checked against the generated
+ * table before anything is loaded. Run as "karte --search <dir> <term>...",
+ * the maps of a directory using every term, each a glyph index or a "#rrggbb"
+ * colour, are listed from its map index.
+ */
+int main(int argc, char* argv[])
 {
+    if (argc == 4 && strcmp(argv[1], "--pack") == 0)
+    {
+        const bool ok = PackBuild(argv[2], argv[3]);
+        Log(LOG_NOTIFY, "Allocations remaining: %u", g_mem_allocs);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "--macro") == 0)
+    {
+        Macro* macro = MacroLoad(argv[2]);
+        const bool ok =
+            macro && MacroBatchRun(macro, argv[3], argc == 5 ? argv[4] : NULL);
+        if (macro)
+        {
+            MacroFree(macro);
+        }
+        Log(LOG_NOTIFY, "Allocations remaining: %u", g_mem_allocs);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (argc == 4 && strcmp(argv[1], "--export") == 0)
+    {
+        ChunkStore* cells = PackLoadMap(argv[2]);
+        const bool ok = cells && MapExport(cells, argv[3]);
+        if (cells)
+        {
+            ChunkStoreFree(cells);
+        }
+        Log(LOG_NOTIFY, "Allocations remaining: %u", g_mem_allocs);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (argc == 5 && strcmp(argv[1], "--atlas") == 0)
+    {
+        if (PerfectHashLookup(&TILESETS, argv[3]) < 0)
+        {
+            Log(LOG_ERROR, "No such tileset \"%s\"! Known tilesets are:",
+                argv[3]);
+            for (size_t i = 0; i < TILESETS_COUNT; ++i)
+            {
+                Log(LOG_ERROR, "    %s", TILESETS_KEYS[i]);
+            }
+            return EXIT_FAILURE;
+        }
+
+        char tileset[256] = {0};
+        snprintf(tileset, sizeof(tileset), "%s%s.png", TILESET_DIRECTORY,
+                 argv[3]);
+
+        ChunkStore* cells = PackLoadMap(argv[2]);
+        const bool ok = cells && TileAtlasExport(cells, tileset, argv[4]);
+        if (cells)
+        {
+            ChunkStoreFree(cells);
+        }
+        Log(LOG_NOTIFY, "Allocations remaining: %u", g_mem_allocs);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "--search") == 0)
+    {
+        const bool ok =
+            MapIndexSearch(argv[2], &argv[3], (size_t)(argc - 3));
+        Log(LOG_NOTIFY, "Allocations remaining: %u", g_mem_allocs);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     Application* app = ApplicationCreate();
 
     ApplicationRun(app);
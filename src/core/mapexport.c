@@ -0,0 +1,526 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file mapexport.c
+ *
+ * \brief Exports a map as a standalone HTML page or SVG image. Glyph indices
+ * are written as the code page 437 characters the tilesets are laid out in.
+ * Along each row, neighbouring cells of the same colours are merged into a
+ * single span or rectangle, so that large maps stay small and quick to show.
+ * Exports are written a band of chunk rows at a time through a buffer, without
+ * holding the whole map or the whole file in memory.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "core/mapexport.h"
+
+/**
+ * \desc The Unicode code point of each glyph index, as laid out in code page
+ * 437. Index zero is written as a space.
+ */
+static const u16 MAPEXPORT_CP437[256] = {
+    0x0000, 0x263A, 0x263B, 0x2665, 0x2666, 0x2663, 0x2660, 0x2022,
+    0x25D8, 0x25CB, 0x25D9, 0x2642, 0x2640, 0x266A, 0x266B, 0x263C,
+    0x25BA, 0x25C4, 0x2195, 0x203C, 0x00B6, 0x00A7, 0x25AC, 0x21A8,
+    0x2191, 0x2193, 0x2192, 0x2190, 0x221F, 0x2194, 0x25B2, 0x25BC,
+    0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027,
+    0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+    0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+    0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+    0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+    0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+    0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+    0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x005F,
+    0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+    0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+    0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+    0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x2302,
+    0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7,
+    0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+    0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9,
+    0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192,
+    0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA,
+    0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556,
+    0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F,
+    0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+    0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B,
+    0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+    0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4,
+    0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229,
+    0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248,
+    0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x00A0,
+};
+
+/**
+ * \desc The colours a page is shown in, which a span leaves out.
+ */
+static const SDL_Color MAPEXPORT_FG = {255, 255, 255, 255};
+static const SDL_Color MAPEXPORT_BG = {0, 0, 0, 255};
+
+/**
+ * \brief A file being written through a buffer.
+ */
+typedef struct
+{
+    FILE* file;    /**< The file being written. */
+    char* data;    /**< Text not yet written to the file. */
+    size_t length; /**< Number of bytes of text in the buffer. */
+    bool ok;       /**< Whether every write so far has succeeded. */
+} MapExportWriter;
+
+/**
+ * \desc Opens the file and its buffer, logging should it not open.
+ */
+static bool MapExportOpen(MapExportWriter* out, const char* path)
+{
+    out->file = fopen(path, "wb");
+    if (out->file == NULL)
+    {
+        Log(LOG_ERROR, "Could not open %s for writing", path);
+        return false;
+    }
+
+    out->data = Allocate(MAPEXPORT_BUFFER);
+    out->length = 0;
+    out->ok = true;
+    return true;
+}
+
+/**
+ * \desc Writes the buffer out and empties it. Once a write has failed nothing
+ * more is written, and the failure is reported when the file is closed.
+ */
+static void MapExportFlush(MapExportWriter* out)
+{
+    if (out->length && out->ok)
+    {
+        out->ok = fwrite(out->data, 1, out->length, out->file) == out->length;
+    }
+    out->length = 0;
+}
+
+/**
+ * \desc Writes what is left in the buffer and closes the file.
+ */
+static bool MapExportClose(MapExportWriter* out, const char* path)
+{
+    MapExportFlush(out);
+    out->ok = fclose(out->file) == 0 && out->ok;
+    Free(out->data);
+
+    if (!out->ok)
+    {
+        Log(LOG_ERROR, "Could not write %s", path);
+    }
+    return out->ok;
+}
+
+/**
+ * \desc Text is only ever appended in short pieces, so the buffer is flushed
+ * whenever a piece would not fit.
+ */
+static void MapExportPut(MapExportWriter* out, const char* text, size_t length)
+{
+    if (out->length + length > MAPEXPORT_BUFFER)
+    {
+        MapExportFlush(out);
+    }
+
+    memcpy(out->data + out->length, text, length);
+    out->length += length;
+}
+
+/**
+ * \desc Appends a string, which must not be longer than the buffer.
+ */
+static void MapExportText(MapExportWriter* out, const char* text)
+{
+    MapExportPut(out, text, strlen(text));
+}
+
+/**
+ * \desc Appends an integer in decimal.
+ */
+static void MapExportInt(MapExportWriter* out, i32 value)
+{
+    char text[16] = {0};
+    const i32 length = snprintf(text, sizeof(text), "%d", value);
+    MapExportPut(out, text, (size_t)length);
+}
+
+/**
+ * \desc Colours are written as #rrggbb, with the alpha channel added only for
+ * colours which are not opaque.
+ */
+static void MapExportColor(MapExportWriter* out, SDL_Color color)
+{
+    static const char digits[] = "0123456789abcdef";
+    const u8 channels[4] = {color.r, color.g, color.b, color.a};
+    const size_t num_channels = color.a == 255 ? 3 : 4;
+
+    char text[9] = {'#'};
+    for (size_t i = 0; i < num_channels; ++i)
+    {
+        text[1 + 2 * i] = digits[channels[i] >> 4];
+        text[2 + 2 * i] = digits[channels[i] & 15];
+    }
+    MapExportPut(out, text, 1 + 2 * num_channels);
+}
+
+/**
+ * \desc Writes the character of a glyph in UTF-8, escaping the characters
+ * which mean something to HTML and XML.
+ */
+static void MapExportGlyph(MapExportWriter* out, u8 index)
+{
+    const u32 code = index ? MAPEXPORT_CP437[index] : ' ';
+    if (code == '<' || code == '>' || code == '&')
+    {
+        MapExportText(out, code == '<' ? "&lt;" : code == '>' ? "&gt;"
+                                                               : "&amp;");
+        return;
+    }
+
+    char text[3] = {0};
+    size_t length = 0;
+    if (code < 0x80)
+    {
+        text[length++] = (char)code;
+    }
+    else if (code < 0x800)
+    {
+        text[length++] = (char)(0xC0 | code >> 6);
+        text[length++] = (char)(0x80 | (code & 0x3F));
+    }
+    else
+    {
+        text[length++] = (char)(0xE0 | code >> 12);
+        text[length++] = (char)(0x80 | (code >> 6 & 0x3F));
+        text[length++] = (char)(0x80 | (code & 0x3F));
+    }
+    MapExportPut(out, text, length);
+}
+
+/**
+ * \desc Colours are the same only if all four channels are.
+ */
+static bool MapExportSameColor(SDL_Color a, SDL_Color b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+/**
+ * \desc A blank cell shows only its background, so it may join a run of any
+ * foreground.
+ */
+static bool MapExportBlank(Cell cell)
+{
+    return cell.index == 0 || cell.index == ' ' || cell.index == 255 ||
+           cell.fg.a == 0;
+}
+
+/**
+ * \desc Reads a band of up to a chunk of rows, a chunk at a time without
+ * making any of them resident, so that exporting a large idle map does not
+ * decompress it in place.
+ * \returns The number of rows read.
+ */
+static i32 MapExportReadBand(ChunkStore* store, i32 cy, Cell* chunk,
+                             Cell* band)
+{
+    const i32 rows = SDL_min(CHUNK_SIZE, store->height - cy * CHUNK_SIZE);
+    for (i32 cx = 0; cx < store->chunks_w; ++cx)
+    {
+        ChunkStoreReadChunk(store, cx, cy, chunk);
+
+        const i32 columns =
+            SDL_min(CHUNK_SIZE, store->width - cx * CHUNK_SIZE);
+        for (i32 y = 0; y < rows; ++y)
+        {
+            memcpy(&band[(size_t)y * (size_t)store->width +
+                         (size_t)(cx * CHUNK_SIZE)],
+                   &chunk[y * CHUNK_SIZE], sizeof(Cell) * (size_t)columns);
+        }
+    }
+
+    return rows;
+}
+
+/**
+ * \desc Finds the end of the run of cells starting at x, which share a
+ * background and, unless they are blank, a foreground.
+ * \returns The cell after the last of the run.
+ */
+static i32 MapExportRun(const Cell* row, i32 width, i32 x, SDL_Color* fg,
+                        bool* has_fg)
+{
+    const SDL_Color bg = row[x].bg;
+    *has_fg = false;
+
+    i32 end = x;
+    for (; end < width; ++end)
+    {
+        const Cell cell = row[end];
+        if (!MapExportSameColor(cell.bg, bg))
+        {
+            break;
+        }
+
+        if (MapExportBlank(cell))
+        {
+            continue;
+        }
+
+        if (*has_fg && !MapExportSameColor(cell.fg, *fg))
+        {
+            break;
+        }
+        *fg = cell.fg;
+        *has_fg = true;
+    }
+
+    return end;
+}
+
+/**
+ * \desc A run in the colours of the page is written without a span, and a
+ * span only names the colours which differ from them. A clear background shows
+ * the page through, like the background of the page.
+ */
+static void MapExportHtmlRow(MapExportWriter* out, const Cell* row, i32 width)
+{
+    for (i32 x = 0; x < width;)
+    {
+        SDL_Color fg = MAPEXPORT_FG;
+        bool has_fg = false;
+        const i32 end = MapExportRun(row, width, x, &fg, &has_fg);
+        const SDL_Color bg = row[x].bg;
+
+        const bool color = has_fg && !MapExportSameColor(fg, MAPEXPORT_FG);
+        const bool background =
+            bg.a != 0 && !MapExportSameColor(bg, MAPEXPORT_BG);
+        if (color || background)
+        {
+            MapExportText(out, "<span style=\"");
+            if (color)
+            {
+                MapExportText(out, "color:");
+                MapExportColor(out, fg);
+                MapExportText(out, background ? ";" : "");
+            }
+            if (background)
+            {
+                MapExportText(out, "background:");
+                MapExportColor(out, bg);
+            }
+            MapExportText(out, "\">");
+        }
+
+        for (; x < end; ++x)
+        {
+            MapExportGlyph(out, MapExportBlank(row[x]) ? ' ' : row[x].index);
+        }
+
+        if (color || background)
+        {
+            MapExportText(out, "</span>");
+        }
+    }
+
+    MapExportText(out, "\n");
+}
+
+/**
+ * \desc The page sets the font and colours once, so that each span holds only
+ * what differs. Its line height matches the font size, so that rows of box
+ * drawing glyphs join up.
+ */
+bool MapExportHtml(ChunkStore* store, const char* path)
+{
+    MapExportWriter out = {0};
+    if (!MapExportOpen(&out, path))
+    {
+        return false;
+    }
+
+    MapExportText(&out, "<!DOCTYPE html>\n<html>\n<head>\n"
+                        "<meta charset=\"utf-8\">\n<style>\n"
+                        "body{margin:0;background:");
+    MapExportColor(&out, MAPEXPORT_BG);
+    MapExportText(&out, "}\npre{margin:0;font:16px/1 monospace;color:");
+    MapExportColor(&out, MAPEXPORT_FG);
+    MapExportText(&out, "}\n</style>\n</head>\n<body>\n<pre>");
+
+    Cell* chunk = Allocate(sizeof(Cell) * CHUNK_SIZE * CHUNK_SIZE);
+    Cell* band = Allocate(sizeof(Cell) * (size_t)store->width * CHUNK_SIZE);
+    for (i32 cy = 0; cy < store->chunks_h && out.ok; ++cy)
+    {
+        const i32 rows = MapExportReadBand(store, cy, chunk, band);
+        for (i32 y = 0; y < rows; ++y)
+        {
+            MapExportHtmlRow(&out, &band[(size_t)y * (size_t)store->width],
+                             store->width);
+        }
+    }
+    Free(band);
+    Free(chunk);
+
+    MapExportText(&out, "</pre>\n</body>\n</html>\n");
+    return MapExportClose(&out, path);
+}
+
+/**
+ * \desc Writes a rectangle for each run of a background, leaving out clear
+ * ones.
+ */
+static void MapExportSvgRects(MapExportWriter* out, const Cell* row, i32 width,
+                              i32 y)
+{
+    for (i32 x = 0; x < width;)
+    {
+        const SDL_Color bg = row[x].bg;
+        i32 end = x + 1;
+        while (end < width && MapExportSameColor(row[end].bg, bg))
+        {
+            ++end;
+        }
+
+        if (bg.a != 0)
+        {
+            MapExportText(out, "<rect x=\"");
+            MapExportInt(out, x * MAPEXPORT_CELL_W);
+            MapExportText(out, "\" y=\"");
+            MapExportInt(out, y * MAPEXPORT_CELL_H);
+            MapExportText(out, "\" width=\"");
+            MapExportInt(out, (end - x) * MAPEXPORT_CELL_W);
+            MapExportText(out, "\" height=\"");
+            MapExportInt(out, MAPEXPORT_CELL_H);
+            MapExportText(out, "\" fill=\"");
+            MapExportColor(out, bg);
+            MapExportText(out, "\"/>\n");
+        }
+        x = end;
+    }
+}
+
+/**
+ * \desc Writes a text element for each run of glyphs of a foreground, with the
+ * blank cells between them kept as spaces and those around them left out. The
+ * length of each run is fixed to its cells, so that it lines up with the
+ * backgrounds whatever the width of the font.
+ */
+static void MapExportSvgText(MapExportWriter* out, const Cell* row, i32 width,
+                             i32 y)
+{
+    for (i32 x = 0; x < width;)
+    {
+        if (MapExportBlank(row[x]))
+        {
+            ++x;
+            continue;
+        }
+
+        const SDL_Color fg = row[x].fg;
+        i32 end = x + 1;
+        for (i32 next = x + 1; next < width; ++next)
+        {
+            if (MapExportBlank(row[next]))
+            {
+                continue;
+            }
+            if (!MapExportSameColor(row[next].fg, fg))
+            {
+                break;
+            }
+            end = next + 1;
+        }
+
+        MapExportText(out, "<text x=\"");
+        MapExportInt(out, x * MAPEXPORT_CELL_W);
+        MapExportText(out, "\" y=\"");
+        MapExportInt(out, y * MAPEXPORT_CELL_H + MAPEXPORT_CELL_H * 4 / 5);
+        MapExportText(out, "\" textLength=\"");
+        MapExportInt(out, (end - x) * MAPEXPORT_CELL_W);
+        MapExportText(out, "\" fill=\"");
+        MapExportColor(out, fg);
+        MapExportText(out, "\">");
+        for (i32 i = x; i < end; ++i)
+        {
+            MapExportGlyph(out, MapExportBlank(row[i]) ? ' ' : row[i].index);
+        }
+        MapExportText(out, "</text>\n");
+        x = end;
+    }
+}
+
+/**
+ * \desc The backgrounds of each row are written before its glyphs, so that a
+ * glyph is never hidden behind the background of the next run.
+ */
+bool MapExportSvg(ChunkStore* store, const char* path)
+{
+    MapExportWriter out = {0};
+    if (!MapExportOpen(&out, path))
+    {
+        return false;
+    }
+
+    const i32 width = store->width * MAPEXPORT_CELL_W;
+    const i32 height = store->height * MAPEXPORT_CELL_H;
+    MapExportText(&out, "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"");
+    MapExportInt(&out, width);
+    MapExportText(&out, "\" height=\"");
+    MapExportInt(&out, height);
+    MapExportText(&out, "\" viewBox=\"0 0 ");
+    MapExportInt(&out, width);
+    MapExportText(&out, " ");
+    MapExportInt(&out, height);
+    MapExportText(&out, "\">\n<style>text{font-family:monospace;font-size:");
+    MapExportInt(&out, MAPEXPORT_FONT_SIZE);
+    MapExportText(&out, "px;white-space:pre}</style>\n");
+
+    Cell* chunk = Allocate(sizeof(Cell) * CHUNK_SIZE * CHUNK_SIZE);
+    Cell* band = Allocate(sizeof(Cell) * (size_t)store->width * CHUNK_SIZE);
+    for (i32 cy = 0; cy < store->chunks_h && out.ok; ++cy)
+    {
+        const i32 rows = MapExportReadBand(store, cy, chunk, band);
+        for (i32 y = 0; y < rows; ++y)
+        {
+            const Cell* row = &band[(size_t)y * (size_t)store->width];
+            MapExportSvgRects(&out, row, store->width, cy * CHUNK_SIZE + y);
+            MapExportSvgText(&out, row, store->width, cy * CHUNK_SIZE + y);
+        }
+    }
+    Free(band);
+    Free(chunk);
+
+    MapExportText(&out, "</svg>\n");
+    return MapExportClose(&out, path);
+}
+
+/**
+ * \desc The format is chosen by the extension of the path, which must be one
+ * of those exported; any other is logged and nothing is written.
+ */
+bool MapExport(ChunkStore* store, const char* path)
+{
+    const char* ext = strrchr(path, '.');
+    if (ext && strcmp(ext, MAPEXPORT_SVG_EXTENSION) == 0)
+    {
+        return MapExportSvg(store, path);
+    }
+    if (ext && strcmp(ext, MAPEXPORT_HTML_EXTENSION) == 0)
+    {
+        return MapExportHtml(store, path);
+    }
+
+    Log(LOG_ERROR, "Cannot export %s, as it is neither %s nor %s", path,
+        MAPEXPORT_HTML_EXTENSION, MAPEXPORT_SVG_EXTENSION);
+    return false;
+}
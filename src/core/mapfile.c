@@ -0,0 +1,507 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file mapfile.c
+ *
+ * \brief A map file holds the cells of a map, a compressed chunk at a time,
+ * along with a summary of the glyphs and colours the map uses. The summary can
+ * be read on its own, so that a map may be indexed without loading its cells.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "core/mapfile.h"
+
+/**
+ * \desc The size of the cells of a chunk in bytes, uncompressed.
+ */
+#define MAP_CHUNK_BYTES (sizeof(Cell) * CHUNK_CELLS)
+
+/**
+ * \brief A growable set of packed colours used whilst saving.
+ */
+typedef struct
+{
+    u32* colors;
+    size_t count;
+    size_t capacity;
+    size_t unique;
+} MapColors;
+
+/**
+ * \desc Shifts the channels into place one at a time, so that the packed
+ * value does not depend on the byte order of the platform.
+ */
+[[nodiscard]] u32 MapPackColor(SDL_Color color)
+{
+    return (u32)color.r << 24 | (u32)color.g << 16 | (u32)color.b << 8 |
+           (u32)color.a;
+}
+
+/**
+ * \desc Orders packed colours by value.
+ */
+static int MapColorSort(const void* a, const void* b)
+{
+    const u32 ca = *(const u32*)a;
+    const u32 cb = *(const u32*)b;
+    return ca < cb ? -1 : (ca > cb);
+}
+
+/**
+ * \desc Sorts a run of colours and drops the repeats, returning how many are
+ * left.
+ */
+static size_t MapColorsUnique(u32* colors, size_t count)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    qsort(colors, count, sizeof(u32), &MapColorSort);
+
+    size_t unique = 1;
+    for (size_t i = 1; i < count; ++i)
+    {
+        if (colors[i] != colors[unique - 1])
+        {
+            colors[unique++] = colors[i];
+        }
+    }
+
+    return unique;
+}
+
+/**
+ * \desc Adds the glyphs of the cells of a chunk which lie within the map to
+ * the bitset, and their distinct colours to the set. The set only drops its
+ * repeats once it has doubled since it last did, so that it stays in
+ * proportion to the number of distinct colours without sorting it for every
+ * chunk.
+ */
+static void MapSummarise(MapHeader* header, MapColors* set, const Cell* cells,
+                         i32 num_x, i32 num_y)
+{
+    u32 colors[2 * CHUNK_CELLS];
+    size_t count = 0;
+
+    for (i32 y = 0; y < num_y; ++y)
+    {
+        for (i32 x = 0; x < num_x; ++x)
+        {
+            const Cell cell = cells[x + y * CHUNK_SIZE];
+            header->glyphs[cell.index >> 5] |= 1u << (cell.index & 31);
+            colors[count++] = MapPackColor(cell.fg);
+            colors[count++] = MapPackColor(cell.bg);
+        }
+    }
+
+    count = MapColorsUnique(colors, count);
+    if (set->count + count > set->capacity)
+    {
+        set->capacity = SDL_max(set->capacity * 2, set->count + count);
+        set->colors = Reallocate(set->colors, sizeof(u32) * set->capacity);
+    }
+
+    memcpy(&set->colors[set->count], colors, sizeof(u32) * count);
+    set->count += count;
+
+    if (set->count > 2 * set->unique + 2 * CHUNK_CELLS)
+    {
+        set->count = MapColorsUnique(set->colors, set->count);
+        set->unique = set->count;
+    }
+}
+
+/**
+ * \desc Reads a chunk of the store without making it resident, adds it to the
+ * summary and compresses it into the buffer, returning the size and where the
+ * bytes to write are. A chunk which does not compress is written as it is,
+ * straight from the cells.
+ */
+static size_t MapPackChunk(ChunkStore* store, i32 i, MapHeader* header,
+                           MapColors* set, Cell* cells, u8* buffer,
+                           const u8** data)
+{
+    const i32 cx = i % store->chunks_w;
+    const i32 cy = i / store->chunks_w;
+    ChunkStoreReadChunk(store, cx, cy, cells);
+    MapSummarise(header, set, cells,
+                 SDL_min(CHUNK_SIZE, store->width - cx * CHUNK_SIZE),
+                 SDL_min(CHUNK_SIZE, store->height - cy * CHUNK_SIZE));
+
+    size_t size = LzCompress((const u8*)cells, MAP_CHUNK_BYTES, buffer,
+                             LZ_BOUND(MAP_CHUNK_BYTES));
+    *data = buffer;
+    if (size == 0 || size >= MAP_CHUNK_BYTES)
+    {
+        size = MAP_CHUNK_BYTES;
+        *data = (const u8*)cells;
+    }
+
+    return size;
+}
+
+/**
+ * \desc Fills in the header of a map of the store, less its summary.
+ */
+static MapHeader MapMakeHeader(const ChunkStore* store)
+{
+    MapHeader header = {0};
+    memcpy(header.magic, MAP_MAGIC, sizeof(header.magic));
+    header.version = MAP_VERSION;
+    header.cell_size = sizeof(Cell);
+    header.width = store->width;
+    header.height = store->height;
+
+    return header;
+}
+
+/**
+ * \desc The chunks are read one at a time without being made resident, so
+ * that an idle map is saved without decompressing it in place, and written
+ * out as soon as each is compressed. The glyphs and colours are gathered along
+ * the way and written after the chunks, and the header and chunk sizes are
+ * then written again over the placeholders left for them at the start.
+ */
+bool MapSave(ChunkStore* store, const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        Log(LOG_ERROR, "Could not open map %s for writing", path);
+        return false;
+    }
+
+    const i32 num_chunks = store->chunks_w * store->chunks_h;
+    u32* sizes = Allocate(sizeof(u32) * (size_t)SDL_max(num_chunks, 1));
+    MapHeader header = MapMakeHeader(store);
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(sizes, sizeof(u32), (size_t)num_chunks, file) ==
+                  (size_t)num_chunks;
+
+    MapColors set = {0};
+    Cell cells[CHUNK_CELLS];
+    u8 buffer[LZ_BOUND(MAP_CHUNK_BYTES)];
+    u64 offset = sizeof(header) + sizeof(u32) * (u64)num_chunks;
+
+    for (i32 i = 0; i < num_chunks && ok; ++i)
+    {
+        const u8* data = NULL;
+        const size_t size =
+            MapPackChunk(store, i, &header, &set, cells, buffer, &data);
+        sizes[i] = (u32)size;
+        offset += size;
+        ok = fwrite(data, 1, size, file) == size;
+    }
+
+    set.count = MapColorsUnique(set.colors, set.count);
+    header.num_colors = (u32)set.count;
+    header.colors_offset = offset;
+
+    ok = ok && fwrite(set.colors, sizeof(u32), set.count, file) == set.count;
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 &&
+         fwrite(&header, sizeof(header), 1, file) == 1 &&
+         fwrite(sizes, sizeof(u32), (size_t)num_chunks, file) ==
+             (size_t)num_chunks;
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok)
+    {
+        Log(LOG_ERROR, "Could not write map %s", path);
+    }
+
+    if (set.colors)
+    {
+        Free(set.colors);
+    }
+    Free(sizes);
+
+    return ok;
+}
+
+/**
+ * \desc Lays the map out as MapSave does, into a buffer grown by doubling as
+ * the chunks are compressed, with room left at the start for the header and
+ * chunk sizes, which are filled in last.
+ */
+[[nodiscard]] u8* MapEncode(ChunkStore* store, size_t* size)
+{
+    const i32 num_chunks = store->chunks_w * store->chunks_h;
+    MapHeader header = MapMakeHeader(store);
+
+    MapColors set = {0};
+    Cell cells[CHUNK_CELLS];
+    u8 buffer[LZ_BOUND(MAP_CHUNK_BYTES)];
+    const size_t start = sizeof(header) + sizeof(u32) * (size_t)num_chunks;
+    size_t capacity = start + MAP_CHUNK_BYTES;
+    size_t offset = start;
+    u8* out = Allocate(capacity);
+
+    for (i32 i = 0; i < num_chunks; ++i)
+    {
+        const u8* data = NULL;
+        const u32 chunk_size =
+            (u32)MapPackChunk(store, i, &header, &set, cells, buffer, &data);
+        memcpy(out + sizeof(header) + sizeof(u32) * (size_t)i, &chunk_size,
+               sizeof(u32));
+
+        if (offset + chunk_size > capacity)
+        {
+            capacity = SDL_max(capacity * 2, offset + chunk_size);
+            out = Reallocate(out, capacity);
+        }
+        memcpy(out + offset, data, chunk_size);
+        offset += chunk_size;
+    }
+
+    set.count = MapColorsUnique(set.colors, set.count);
+    header.num_colors = (u32)set.count;
+    header.colors_offset = offset;
+    memcpy(out, &header, sizeof(header));
+
+    *size = offset + sizeof(u32) * set.count;
+    if (*size > capacity)
+    {
+        out = Reallocate(out, *size);
+    }
+    if (set.colors)
+    {
+        memcpy(out + offset, set.colors, sizeof(u32) * set.count);
+        Free(set.colors);
+    }
+
+    return out;
+}
+
+/**
+ * \desc A map is only valid if it was written with the same cell layout, and
+ * if it is large enough to hold every section the header claims, including a
+ * size for each of its chunks, so that a corrupt size never makes a huge store.
+ * Neither side may be larger than a store may be.
+ */
+static bool MapValidate(const MapHeader* header, size_t size)
+{
+    if (memcmp(header->magic, MAP_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != MAP_VERSION || header->cell_size != sizeof(Cell) ||
+        header->width < 0 || header->height < 0 ||
+        header->width > CHUNK_MAX_EXTENT || header->height > CHUNK_MAX_EXTENT)
+    {
+        return false;
+    }
+
+    const u64 num_chunks =
+        ((u64)header->width + CHUNK_SIZE - 1) / CHUNK_SIZE *
+        (((u64)header->height + CHUNK_SIZE - 1) / CHUNK_SIZE);
+
+    return header->colors_offset <= size &&
+           header->colors_offset >=
+               sizeof(MapHeader) + sizeof(u32) * num_chunks &&
+           (size - header->colors_offset) / sizeof(u32) >= header->num_colors;
+}
+
+/**
+ * \desc Reads the header from the start of a map in memory and checks it.
+ */
+static bool MapReadHeader(const u8* data, size_t size, MapHeader* header)
+{
+    if (size < sizeof(MapHeader))
+    {
+        return false;
+    }
+
+    memcpy(header, data, sizeof(MapHeader));
+    return MapValidate(header, size);
+}
+
+/**
+ * \desc Decompresses the chunk at an offset into the cells, and moves the
+ * offset on past it. A chunk whose size runs past the colours, or which does
+ * not decompress, means the map is corrupt.
+ */
+static bool MapReadChunk(const u8* data, const MapHeader* header, u32 size,
+                         u64* offset, Cell* cells)
+{
+    if (*offset + size > header->colors_offset)
+    {
+        return false;
+    }
+
+    if (size == MAP_CHUNK_BYTES)
+    {
+        memcpy(cells, data + *offset, MAP_CHUNK_BYTES);
+    }
+    else if (!LzDecompress(data + *offset, size, (u8*)cells, MAP_CHUNK_BYTES))
+    {
+        return false;
+    }
+
+    *offset += size;
+    return true;
+}
+
+/**
+ * \desc Each chunk is decompressed straight from memory into the new store,
+ * and nothing is loaded if any of them is corrupt.
+ */
+[[nodiscard]] ChunkStore* MapLoadMemory(const u8* data, size_t size)
+{
+    MapHeader header = {0};
+    if (!MapReadHeader(data, size, &header))
+    {
+        return NULL;
+    }
+
+    ChunkStore* store =
+        ChunkStoreCreate(header.width, header.height, (Cell){0});
+    const i32 num_chunks = store->chunks_w * store->chunks_h;
+    const u32* sizes = (const u32*)(data + sizeof(header));
+    u64 offset = sizeof(header) + sizeof(u32) * (u64)num_chunks;
+    Cell cells[CHUNK_CELLS];
+
+    bool ok = offset <= header.colors_offset;
+    for (i32 i = 0; i < num_chunks && ok; ++i)
+    {
+        ok = MapReadChunk(data, &header, sizes[i], &offset, cells);
+        if (ok)
+        {
+            ChunkStoreWriteChunk(store, i % store->chunks_w,
+                                 i / store->chunks_w, cells);
+        }
+    }
+
+    if (!ok)
+    {
+        ChunkStoreFree(store);
+        return NULL;
+    }
+
+    return store;
+}
+
+/**
+ * \desc The file is mapped and loaded straight from the mapping.
+ */
+[[nodiscard]] ChunkStore* MapLoad(const char* path)
+{
+    size_t size = 0;
+    const u8* data = FileMap(path, &size);
+    if (data == NULL)
+    {
+        Log(LOG_ERROR, "Could not open map %s", path);
+        return NULL;
+    }
+
+    ChunkStore* store = MapLoadMemory(data, size);
+    FileUnmap((void*)data, size);
+
+    if (store == NULL)
+    {
+        Log(LOG_ERROR, "%s is not a valid map", path);
+    }
+
+    return store;
+}
+
+/**
+ * \desc The header, the chunk sizes and the colours are copied over as they
+ * are, other than the sizes and offset which change, and the chunks written
+ * one after another as they are decompressed.
+ */
+[[nodiscard]] u8* MapExpand(const u8* data, size_t size, size_t* expanded_size)
+{
+    MapHeader header = {0};
+    if (!MapReadHeader(data, size, &header))
+    {
+        return NULL;
+    }
+
+    const u64 chunks_w = ((u64)header.width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    const u64 chunks_h = ((u64)header.height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    const u64 num_chunks = chunks_w * chunks_h;
+    const u32* sizes = (const u32*)(data + sizeof(header));
+    u64 offset = sizeof(header) + sizeof(u32) * num_chunks;
+
+    MapHeader expanded = header;
+    expanded.colors_offset = offset + MAP_CHUNK_BYTES * num_chunks;
+    *expanded_size =
+        expanded.colors_offset + sizeof(u32) * (size_t)header.num_colors;
+
+    u8* out = Allocate(*expanded_size);
+    memcpy(out, &expanded, sizeof(expanded));
+    u8* chunk = out + offset;
+
+    bool ok = true;
+    for (u64 i = 0; i < num_chunks && ok; ++i)
+    {
+        const u32 chunk_size = MAP_CHUNK_BYTES;
+        memcpy(out + sizeof(header) + sizeof(u32) * i, &chunk_size,
+               sizeof(u32));
+        ok = MapReadChunk(data, &header, sizes[i], &offset, (Cell*)chunk);
+        chunk += MAP_CHUNK_BYTES;
+    }
+
+    if (!ok)
+    {
+        Free(out);
+        return NULL;
+    }
+
+    memcpy(chunk, data + header.colors_offset,
+           sizeof(u32) * (size_t)header.num_colors);
+
+    return out;
+}
+
+/**
+ * \desc Only the header and the colours at the end are read, skipping over
+ * the chunks, so that summarising a map costs the same however large it is.
+ */
+bool MapReadSummary(const char* path, MapSummary* summary)
+{
+    *summary = (MapSummary){0};
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    MapHeader header = {0};
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              fseek(file, 0, SEEK_END) == 0;
+    const long size = ok ? ftell(file) : -1;
+    ok = ok && size >= 0 && MapValidate(&header, (size_t)size);
+
+    if (ok)
+    {
+        summary->colors = Allocate(sizeof(u32) * (header.num_colors + 1));
+        ok = fseek(file, (long)header.colors_offset, SEEK_SET) == 0 &&
+             fread(summary->colors, sizeof(u32), header.num_colors, file) ==
+                 header.num_colors;
+    }
+
+    fclose(file);
+
+    if (!ok)
+    {
+        if (summary->colors)
+        {
+            Free(summary->colors);
+        }
+        *summary = (MapSummary){0};
+        return false;
+    }
+
+    memcpy(summary->glyphs, header.glyphs, sizeof(summary->glyphs));
+    summary->num_colors = header.num_colors;
+    summary->width = header.width;
+    summary->height = header.height;
+
+    return true;
+}
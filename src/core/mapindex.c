@@ -0,0 +1,776 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file mapindex.c
+ *
+ * \brief A map index lists which of the maps of a project directory use each
+ * glyph and colour, so that a search across thousands of maps need not open
+ * any of them. The index is kept on disk in the project directory, and kept up
+ * to date by a background indexer which only summarises the maps that change.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "core/mapindex.h"
+
+/**
+ * \brief A map found whilst refreshing an index, with the keys of its terms.
+ */
+typedef struct
+{
+    MapIndexMap map;
+    const u64* keys;
+    u64* owned;
+} MapIndexEntry;
+
+/**
+ * \brief A growable list of the names of the maps of a directory.
+ */
+typedef struct
+{
+    char (*names)[MAPINDEX_MAX_NAME];
+    size_t count;
+    size_t capacity;
+} MapIndexNames;
+
+/**
+ * \brief A posting of a term, paired with its key whilst it is sorted.
+ */
+typedef struct
+{
+    u64 key;
+    u32 map;
+} MapIndexPair;
+
+/**
+ * \desc The kind goes in the upper half of the key, so that the terms of each
+ * kind sort together.
+ */
+[[nodiscard]] u64 MapIndexGlyph(u8 index)
+{
+    return (u64)MAPINDEX_GLYPH << 32 | index;
+}
+
+/**
+ * \desc Colours are keyed by their packed value.
+ */
+[[nodiscard]] u64 MapIndexColor(SDL_Color color)
+{
+    return (u64)MAPINDEX_COLOR << 32 | MapPackColor(color);
+}
+
+/**
+ * \desc Works out where each section of a blob starts, and how large the blob
+ * is, from the counts of its header.
+ */
+static size_t MapIndexLayout(const MapIndexHeader* header, size_t* offsets)
+{
+    offsets[0] = sizeof(MapIndexHeader);
+    offsets[1] = offsets[0] + sizeof(MapIndexMap) * header->num_maps;
+    offsets[2] = offsets[1] + sizeof(u64) * header->num_postings;
+    offsets[3] = offsets[2] + sizeof(MapIndexTerm) * header->num_terms;
+
+    return offsets[3] + sizeof(u32) * header->num_postings;
+}
+
+/**
+ * \desc Points each section of the index into its blob.
+ */
+static void MapIndexBind(MapIndex* index)
+{
+    size_t offsets[4] = {0};
+    index->header = (const MapIndexHeader*)index->data;
+    MapIndexLayout(index->header, offsets);
+
+    index->maps = (const MapIndexMap*)(index->data + offsets[0]);
+    index->keys = (const u64*)(index->data + offsets[1]);
+    index->terms = (const MapIndexTerm*)(index->data + offsets[2]);
+    index->postings = (const u32*)(index->data + offsets[3]);
+}
+
+/**
+ * \desc Allocates an index holding a blob of the given counts, with its header
+ * filled in and every section bound, ready to be filled.
+ */
+static MapIndex* MapIndexAllocate(u32 num_maps, u32 num_terms,
+                                  u32 num_postings)
+{
+    MapIndexHeader header = {0};
+    memcpy(header.magic, MAPINDEX_MAGIC, sizeof(header.magic));
+    header.version = MAPINDEX_VERSION;
+    header.num_maps = num_maps;
+    header.num_terms = num_terms;
+    header.num_postings = num_postings;
+
+    size_t offsets[4] = {0};
+    MapIndex* index = Allocate(sizeof(MapIndex));
+    index->size = MapIndexLayout(&header, offsets);
+    index->data = Allocate(index->size);
+    memcpy(index->data, &header, sizeof(header));
+    MapIndexBind(index);
+
+    return index;
+}
+
+/**
+ * \desc A blob is only valid if it is large enough to hold every section the
+ * header claims, and every run of keys and postings lies within its section,
+ * so that a corrupt file can never be read out of bounds. The maps must be in
+ * order of name and the terms in order of key, as both are binary searched,
+ * and each run of postings must be in ascending order with no map twice, as a
+ * search merges them and may copy a whole run into a buffer of one posting
+ * for each map.
+ */
+static bool MapIndexValidate(const u8* data, size_t size)
+{
+    if (size < sizeof(MapIndexHeader))
+    {
+        return false;
+    }
+
+    const MapIndexHeader* header = (const MapIndexHeader*)data;
+    size_t offsets[4] = {0};
+    if (memcmp(header->magic, MAPINDEX_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != MAPINDEX_VERSION ||
+        MapIndexLayout(header, offsets) > size)
+    {
+        return false;
+    }
+
+    const MapIndexMap* maps = (const MapIndexMap*)(data + offsets[0]);
+    for (u32 i = 0; i < header->num_maps; ++i)
+    {
+        if ((u64)maps[i].first_key + maps[i].num_keys > header->num_postings ||
+            maps[i].name[MAPINDEX_MAX_NAME - 1] != '\0' ||
+            (i > 0 && strcmp(maps[i - 1].name, maps[i].name) >= 0))
+        {
+            return false;
+        }
+    }
+
+    const MapIndexTerm* terms = (const MapIndexTerm*)(data + offsets[2]);
+    const u32* postings = (const u32*)(data + offsets[3]);
+    for (u32 i = 0; i < header->num_terms; ++i)
+    {
+        if ((u64)terms[i].first + terms[i].count > header->num_postings ||
+            terms[i].count > header->num_maps ||
+            (i > 0 && terms[i - 1].key >= terms[i].key))
+        {
+            return false;
+        }
+
+        const u32* run = &postings[terms[i].first];
+        for (u32 j = 0; j < terms[i].count; ++j)
+        {
+            if (run[j] >= header->num_maps || (j > 0 && run[j - 1] >= run[j]))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \desc Maps the index file if it is valid. Otherwise the index starts empty,
+ * and is filled in by the first refresh.
+ */
+[[nodiscard]] MapIndex* MapIndexLoad(const char* dir)
+{
+    char path[MAPINDEX_MAX_PATH] = {0};
+    snprintf(path, sizeof(path), "%s/%s", dir, MAPINDEX_FILE);
+
+    size_t size = 0;
+    u8* data = FileMap(path, &size);
+    if (data && MapIndexValidate(data, size))
+    {
+        MapIndex* index = Allocate(sizeof(MapIndex));
+        index->data = data;
+        index->size = size;
+        index->mapped = true;
+        MapIndexBind(index);
+        return index;
+    }
+
+    if (data)
+    {
+        Log(LOG_WARNING, "Discarding the invalid map index %s", path);
+        FileUnmap(data, size);
+    }
+
+    return MapIndexAllocate(0, 0, 0);
+}
+
+/**
+ * \desc Unmaps a mapped blob, or frees a built one, then the index itself.
+ */
+void MapIndexFree(MapIndex* index)
+{
+    if (index->mapped)
+    {
+        FileUnmap(index->data, index->size);
+    }
+    else
+    {
+        Free(index->data);
+    }
+
+    Free(index);
+}
+
+/**
+ * \desc Keeps the name of each map file, leaving out subdirectories, any other
+ * file and any name too long to be held.
+ */
+static void MapIndexAddName(void* data, const char* name, bool is_dir)
+{
+    MapIndexNames* list = data;
+    const size_t length = strlen(name);
+    const size_t ext = sizeof(MAP_EXTENSION) - 1;
+    if (is_dir || length <= ext || length >= MAPINDEX_MAX_NAME ||
+        strcmp(name + length - ext, MAP_EXTENSION) != 0)
+    {
+        return;
+    }
+
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity << 1 : 64;
+        list->names =
+            Reallocate(list->names, sizeof(*list->names) * list->capacity);
+    }
+
+    memset(list->names[list->count], 0, MAPINDEX_MAX_NAME);
+    memcpy(list->names[list->count++], name, length);
+}
+
+/**
+ * \desc Orders names as strcmp does.
+ */
+static int MapIndexNameSort(const void* a, const void* b)
+{
+    return strcmp(a, b);
+}
+
+/**
+ * \desc Orders pairs by key, then by map.
+ */
+static int MapIndexPairSort(const void* a, const void* b)
+{
+    const MapIndexPair* pa = a;
+    const MapIndexPair* pb = b;
+    if (pa->key != pb->key)
+    {
+        return pa->key < pb->key ? -1 : 1;
+    }
+
+    return pa->map < pb->map ? -1 : (pa->map > pb->map);
+}
+
+/**
+ * \desc Finds a map of an index by name with a binary search, as the maps are
+ * in order of name.
+ */
+static const MapIndexMap* MapIndexFind(const MapIndex* index, const char* name)
+{
+    size_t lo = 0, hi = index->header->num_maps;
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        const i32 cmp = strcmp(index->maps[mid].name, name);
+        if (cmp == 0)
+        {
+            return &index->maps[mid];
+        }
+
+        if (cmp < 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * \desc Turns the summary of a map into the keys of its terms. Glyph keys
+ * sort before colour keys, and the colours of a summary are in order, so the
+ * keys come out in order.
+ */
+static u64* MapIndexSummarise(const MapSummary* summary, u32* num_keys)
+{
+    u64* keys = Allocate(sizeof(u64) * (256 + summary->num_colors));
+    u32 count = 0;
+
+    for (u32 i = 0; i < 256; ++i)
+    {
+        if (summary->glyphs[i >> 5] & (1u << (i & 31)))
+        {
+            keys[count++] = MapIndexGlyph((u8)i);
+        }
+    }
+
+    for (u32 i = 0; i < summary->num_colors; ++i)
+    {
+        keys[count++] = (u64)MAPINDEX_COLOR << 32 | summary->colors[i];
+    }
+
+    *num_keys = count;
+    return keys;
+}
+
+/**
+ * \desc Builds a new blob from the maps found, in order of name. The keys of
+ * each map are copied in as they are, and then every key is paired with its
+ * map and the pairs sorted, which turns the keys of the maps into the
+ * postings of the terms.
+ */
+static MapIndex* MapIndexBuild(const MapIndexEntry* entries, size_t count)
+{
+    size_t num_postings = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        num_postings += entries[i].map.num_keys;
+    }
+
+    MapIndexPair* pairs =
+        Allocate(sizeof(MapIndexPair) * SDL_max(num_postings, 1));
+    for (size_t i = 0, k = 0; i < count; ++i)
+    {
+        for (u32 j = 0; j < entries[i].map.num_keys; ++j, ++k)
+        {
+            pairs[k] = (MapIndexPair){entries[i].keys[j], (u32)i};
+        }
+    }
+    qsort(pairs, num_postings, sizeof(MapIndexPair), &MapIndexPairSort);
+
+    u32 num_terms = 0;
+    for (size_t i = 0; i < num_postings; ++i)
+    {
+        num_terms += i == 0 || pairs[i].key != pairs[i - 1].key;
+    }
+
+    MapIndex* index =
+        MapIndexAllocate((u32)count, num_terms, (u32)num_postings);
+    MapIndexMap* maps = (MapIndexMap*)index->maps;
+    u64* keys = (u64*)index->keys;
+    MapIndexTerm* terms = (MapIndexTerm*)index->terms;
+    u32* postings = (u32*)index->postings;
+
+    for (size_t i = 0, k = 0; i < count; ++i)
+    {
+        maps[i] = entries[i].map;
+        maps[i].first_key = (u32)k;
+        memcpy(&keys[k], entries[i].keys, sizeof(u64) * maps[i].num_keys);
+        k += maps[i].num_keys;
+    }
+
+    for (size_t i = 0, t = 0; i < num_postings; ++i)
+    {
+        if (i > 0 && pairs[i].key != pairs[i - 1].key)
+        {
+            t++;
+        }
+
+        if (terms[t].count == 0)
+        {
+            terms[t].key = pairs[i].key;
+            terms[t].first = (u32)i;
+        }
+
+        terms[t].count++;
+        postings[i] = pairs[i].map;
+    }
+
+    Free(pairs);
+
+    return index;
+}
+
+/**
+ * \desc Lists the map files of the directory and checks the size and
+ * modification time of each against the older index. Only maps which are new
+ * or have changed have their summary read, and even then only their header and
+ * colours; every other map keeps its keys from the older index. Should no map
+ * have been added, changed or removed, nothing is built at all.
+ */
+[[nodiscard]] MapIndex* MapIndexRefresh(const MapIndex* index,
+                                        const char* dir)
+{
+    MapIndexNames list = {0};
+    if (!FileList(dir, &MapIndexAddName, &list))
+    {
+        Log(LOG_WARNING, "Could not list the maps of %s", dir);
+        return NULL;
+    }
+
+    if (list.count > 0)
+    {
+        qsort(list.names, list.count, sizeof(*list.names), &MapIndexNameSort);
+    }
+
+    MapIndexEntry* entries =
+        Allocate(sizeof(MapIndexEntry) * SDL_max(list.count, 1));
+    size_t count = 0;
+    bool changed = false;
+    char path[MAPINDEX_MAX_PATH] = {0};
+
+    for (size_t i = 0; i < list.count; ++i)
+    {
+        MapIndexEntry* entry = &entries[count];
+        snprintf(path, sizeof(path), "%s/%s", dir, list.names[i]);
+        memcpy(entry->map.name, list.names[i], MAPINDEX_MAX_NAME);
+        if (!FileStat(path, &entry->map.size, &entry->map.mtime))
+        {
+            continue;
+        }
+
+        const MapIndexMap* old = MapIndexFind(index, list.names[i]);
+        if (old && old->size == entry->map.size &&
+            old->mtime == entry->map.mtime)
+        {
+            entry->map.num_keys = old->num_keys;
+            entry->keys = &index->keys[old->first_key];
+            count++;
+            continue;
+        }
+
+        MapSummary summary = {0};
+        if (!MapReadSummary(path, &summary))
+        {
+            continue;
+        }
+
+        entry->owned = MapIndexSummarise(&summary, &entry->map.num_keys);
+        entry->keys = entry->owned;
+        Free(summary.colors);
+        changed = true;
+        count++;
+    }
+
+    changed = changed || count != index->header->num_maps;
+    MapIndex* fresh = changed ? MapIndexBuild(entries, count) : NULL;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (entries[i].owned)
+        {
+            Free(entries[i].owned);
+        }
+    }
+    Free(entries);
+    if (list.names)
+    {
+        Free(list.names);
+    }
+
+    return fresh;
+}
+
+/**
+ * \desc The blob is written to a temporary file which then replaces the index
+ * file, so that a reader never sees a partly written index.
+ */
+bool MapIndexSave(const MapIndex* index, const char* dir)
+{
+    char path[MAPINDEX_MAX_PATH] = {0};
+    char temp[MAPINDEX_MAX_PATH + 4] = {0};
+    snprintf(path, sizeof(path), "%s/%s", dir, MAPINDEX_FILE);
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+
+    FILE* file = fopen(temp, "wb");
+    if (file == NULL)
+    {
+        Log(LOG_WARNING, "Could not write map index %s", path);
+        return false;
+    }
+
+    bool ok = fwrite(index->data, 1, index->size, file) == index->size;
+    ok = fclose(file) == 0 && ok;
+
+#if _WIN32
+    ok = ok && (remove(path) == 0 || !FileExists(path));
+#endif
+
+    if (!ok || rename(temp, path) != 0)
+    {
+        Log(LOG_WARNING, "Could not write map index %s", path);
+        remove(temp);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \desc Finds a term by key with a binary search, as the terms are in order of
+ * key.
+ */
+static const MapIndexTerm* MapIndexTermFind(const MapIndex* index, u64 key)
+{
+    size_t lo = 0, hi = index->header->num_terms;
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (index->terms[mid].key == key)
+        {
+            return &index->terms[mid];
+        }
+
+        if (index->terms[mid].key < key)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * \desc The postings of the rarest term are taken first, and then narrowed
+ * down by the postings of each other term in turn; as every run of postings is
+ * in order, each narrowing is a single merge. A term no map uses ends the
+ * search straight away.
+ */
+size_t MapIndexQuery(const MapIndex* index, const u64* keys, size_t num_keys,
+                     u32* maps)
+{
+    if (num_keys == 0)
+    {
+        for (u32 i = 0; i < index->header->num_maps; ++i)
+        {
+            maps[i] = i;
+        }
+        return index->header->num_maps;
+    }
+
+    const MapIndexTerm* rarest = NULL;
+    for (size_t i = 0; i < num_keys; ++i)
+    {
+        const MapIndexTerm* term = MapIndexTermFind(index, keys[i]);
+        if (term == NULL)
+        {
+            return 0;
+        }
+
+        if (rarest == NULL || term->count < rarest->count)
+        {
+            rarest = term;
+        }
+    }
+
+    size_t count = rarest->count;
+    memcpy(maps, &index->postings[rarest->first], sizeof(u32) * count);
+
+    for (size_t i = 0; i < num_keys && count > 0; ++i)
+    {
+        const MapIndexTerm* term = MapIndexTermFind(index, keys[i]);
+        const u32* postings = &index->postings[term->first];
+        size_t kept = 0;
+
+        for (size_t a = 0, b = 0; a < count && b < term->count;)
+        {
+            if (maps[a] < postings[b])
+            {
+                a++;
+            }
+            else if (maps[a] > postings[b])
+            {
+                b++;
+            }
+            else
+            {
+                maps[kept++] = maps[a++];
+                b++;
+            }
+        }
+
+        count = kept;
+    }
+
+    return count;
+}
+
+/**
+ * \desc Reads a term of a search: a glyph by its index in decimal, or a colour
+ * in hexadecimal after a hash, whose alpha is opaque unless given.
+ */
+static bool MapIndexParseTerm(const char* text, u64* key)
+{
+    char* end = NULL;
+    if (text[0] == '#')
+    {
+        const size_t length = strlen(text + 1);
+        const u32 value = (u32)strtoul(text + 1, &end, 16);
+        if ((length != 6 && length != 8) ||
+            strspn(text + 1, "0123456789abcdefABCDEF") != length)
+        {
+            return false;
+        }
+
+        *key = (u64)MAPINDEX_COLOR << 32 |
+               (length == 6 ? value << 8 | 0xFF : value);
+        return true;
+    }
+
+    const unsigned long value = strtoul(text, &end, 10);
+    if (text[0] < '0' || text[0] > '9' || *end != '\0' || value > 255)
+    {
+        return false;
+    }
+
+    *key = MapIndexGlyph((u8)value);
+    return true;
+}
+
+/**
+ * \desc The index file is refreshed as the indexer would, and saved should
+ * any map have changed, so that the search sees every map as it is now. The
+ * old index is freed before the new one is saved, as it may be a mapping of
+ * the very file being replaced.
+ */
+bool MapIndexSearch(const char* dir, char* const* terms, size_t num_terms)
+{
+    u64* keys = Allocate(sizeof(u64) * SDL_max(num_terms, 1));
+    for (size_t i = 0; i < num_terms; ++i)
+    {
+        if (!MapIndexParseTerm(terms[i], &keys[i]))
+        {
+            Log(LOG_ERROR, "Invalid search term \"%s\"!", terms[i]);
+            Free(keys);
+            return false;
+        }
+    }
+
+    MapIndex* index = MapIndexLoad(dir);
+    MapIndex* fresh = MapIndexRefresh(index, dir);
+    if (fresh)
+    {
+        MapIndexFree(index);
+        index = fresh;
+        MapIndexSave(index, dir);
+    }
+
+    const u32 num_maps = index->header->num_maps;
+    u32* maps = Allocate(sizeof(u32) * SDL_max(num_maps, 1));
+    const size_t count = MapIndexQuery(index, keys, num_terms, maps);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Log(LOG_NOTIFY, "%s", index->maps[maps[i]].name);
+    }
+    Log(LOG_NOTIFY, "Found %zu of %u maps of %s", count, num_maps, dir);
+
+    Free(maps);
+    Free(keys);
+    MapIndexFree(index);
+
+    return true;
+}
+
+/**
+ * \desc The older index is only ever replaced by this thread, so it is read
+ * without the lock whilst the maps are checked; the lock is only taken to swap
+ * in the new index. The old index is freed before the new one is written, as
+ * it may be a mapping of the very file being replaced. Between passes the
+ * thread sleeps on the condition, which also lets it be woken to refresh or to
+ * stop straight away.
+ */
+static i32 MapIndexerRun(void* data)
+{
+    MapIndexer* indexer = data;
+
+    SDL_LockMutex(indexer->lock);
+    while (indexer->running)
+    {
+        const MapIndex* index = indexer->index;
+        SDL_UnlockMutex(indexer->lock);
+
+        MapIndex* fresh = MapIndexRefresh(index, indexer->dir);
+
+        SDL_LockMutex(indexer->lock);
+        if (fresh)
+        {
+            MapIndexFree(indexer->index);
+            indexer->index = fresh;
+            MapIndexSave(fresh, indexer->dir);
+        }
+
+        if (indexer->running)
+        {
+            SDL_CondWaitTimeout(indexer->wake, indexer->lock,
+                                MAPINDEX_INTERVAL);
+        }
+    }
+    SDL_UnlockMutex(indexer->lock);
+
+    return 0;
+}
+
+/**
+ * \desc Loads the index file, if there is one, so that searches can be
+ * answered straight away, and starts the thread to bring it up to date.
+ */
+[[nodiscard]] MapIndexer* MapIndexerCreate(const char* dir)
+{
+    MapIndexer* indexer = Allocate(sizeof(MapIndexer));
+    snprintf(indexer->dir, sizeof(indexer->dir), "%s", dir);
+    indexer->index = MapIndexLoad(dir);
+    indexer->running = true;
+    indexer->lock = SDL_CreateMutex();
+    indexer->wake = SDL_CreateCond();
+
+    if (indexer->lock == NULL || indexer->wake == NULL)
+    {
+        Log(LOG_FATAL, "Could not create map indexer: %s", SDL_GetError());
+    }
+
+    indexer->thread = SDL_CreateThread(MapIndexerRun, "indexer", indexer);
+    if (indexer->thread == NULL)
+    {
+        Log(LOG_FATAL, "Could not start map indexer: %s", SDL_GetError());
+    }
+
+    return indexer;
+}
+
+/**
+ * \desc Clears the running flag, wakes the thread and waits for it to finish
+ * any pass underway before freeing anything it uses.
+ */
+void MapIndexerFree(MapIndexer* indexer)
+{
+    SDL_LockMutex(indexer->lock);
+    indexer->running = false;
+    SDL_CondSignal(indexer->wake);
+    SDL_UnlockMutex(indexer->lock);
+
+    SDL_WaitThread(indexer->thread, NULL);
+
+    MapIndexFree(indexer->index);
+    SDL_DestroyCond(indexer->wake);
+    SDL_DestroyMutex(indexer->lock);
+    Free(indexer);
+}
+
+/**
+ * \desc A wake whilst a pass is underway is lost, but the next pass is never
+ * more than an interval away.
+ */
+void MapIndexerWake(MapIndexer* indexer)
+{
+    SDL_LockMutex(indexer->lock);
+    SDL_CondSignal(indexer->wake);
+    SDL_UnlockMutex(indexer->lock);
+}
@@ -0,0 +1,582 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file pack.c
+ *
+ * \brief A pack holds many maps in a single file, each compressed on its own
+ * against a dictionary trained from them all, behind an index which finds any
+ * map by name in constant time. A pack is mapped into memory rather than read,
+ * so opening one costs the same however many maps it holds.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "core/pack.h"
+
+/**
+ * \desc Rounds an offset up to a multiple of eight bytes.
+ */
+#define PACK_ALIGN(offset) (((offset) + 7) & ~(u64)7)
+
+/**
+ * \brief A map being added to a pack, with its data as it is expanded and
+ * then compressed.
+ */
+typedef struct
+{
+    char name[PACK_MAX_NAME];
+    char path[PACK_MAX_PATH];
+    u8* raw;
+    size_t raw_size;
+    u8* data;
+    size_t size;
+} PackItem;
+
+/**
+ * \brief The maps being added to a pack, shared between the workers which
+ * take them in turn.
+ */
+typedef struct
+{
+    const char* dir;
+    PackItem* items;
+    BatchIoRequest* reads;
+    size_t count;
+    size_t capacity;
+    const u8* dict;
+    size_t dict_size;
+    SDL_atomic_t next;
+} PackBuilder;
+
+/**
+ * \desc Adds each map file of the directory whose name fits in an entry, and
+ * whose path is not too long to read.
+ */
+static void PackAddItem(void* data, const char* name, bool is_dir)
+{
+    PackBuilder* builder = data;
+    const size_t length = strlen(name);
+    const size_t ext = sizeof(MAP_EXTENSION) - 1;
+    if (is_dir || length >= PACK_MAX_NAME || length <= ext ||
+        strcmp(name + length - ext, MAP_EXTENSION) != 0)
+    {
+        return;
+    }
+
+    char path[PACK_MAX_PATH] = {0};
+    const i32 path_length =
+        snprintf(path, sizeof(path), "%s/%s", builder->dir, name);
+    if (path_length < 0 || (size_t)path_length >= sizeof(path))
+    {
+        Log(LOG_WARNING, "The path of %s is too long", name);
+        return;
+    }
+
+    if (builder->count == builder->capacity)
+    {
+        builder->capacity = builder->capacity ? builder->capacity << 1 : 64;
+        builder->items =
+            Reallocate(builder->items, sizeof(PackItem) * builder->capacity);
+    }
+
+    PackItem* item = &builder->items[builder->count++];
+    *item = (PackItem){0};
+    memcpy(item->name, name, length + 1);
+    memcpy(item->path, path, (size_t)path_length + 1);
+}
+
+/**
+ * \desc Orders maps by name, so that the same maps always make the same pack.
+ */
+static int PackItemSort(const void* a, const void* b)
+{
+    return strcmp(((const PackItem*)a)->name, ((const PackItem*)b)->name);
+}
+
+/**
+ * \desc Expands a map which has been read, leaving it without data if it
+ * could not be read or is not a valid map.
+ */
+static void PackExpandItem(PackItem* item, BatchIoRequest* read)
+{
+    if (!read->ok)
+    {
+        Log(LOG_WARNING, "Could not open map %s", item->path);
+        return;
+    }
+
+    item->raw = MapExpand(read->data, read->size, &item->raw_size);
+    Free(read->data);
+    read->data = NULL;
+
+    if (item->raw == NULL)
+    {
+        Log(LOG_WARNING, "%s is not a valid map", item->path);
+    }
+}
+
+/**
+ * \desc Compresses an expanded map against the dictionary, keeping it as it is
+ * if it would not compress.
+ */
+static void PackCompressItem(PackBuilder* builder, PackItem* item)
+{
+    const size_t capacity = LZ_BOUND(item->raw_size);
+    item->data = Allocate(capacity);
+    item->size = LzCompressDict(item->raw, item->raw_size, builder->dict,
+                                builder->dict_size, item->data, capacity);
+
+    if (item->size == 0 || item->size >= item->raw_size)
+    {
+        Free(item->data);
+        item->data = item->raw;
+        item->size = item->raw_size;
+    }
+    else
+    {
+        Free(item->raw);
+    }
+    item->raw = NULL;
+}
+
+/**
+ * \desc Each worker takes the next map in turn until there are none left, so
+ * that a few large maps do not hold up the rest.
+ */
+static i32 PackRunExpand(void* data)
+{
+    PackBuilder* builder = data;
+    for (size_t i = (size_t)SDL_AtomicAdd(&builder->next, 1);
+         i < builder->count; i = (size_t)SDL_AtomicAdd(&builder->next, 1))
+    {
+        PackExpandItem(&builder->items[i], &builder->reads[i]);
+    }
+
+    return 0;
+}
+
+/**
+ * \desc Each worker compresses the next map in turn until there are none left,
+ * like the workers which expand them.
+ */
+static i32 PackRunCompress(void* data)
+{
+    PackBuilder* builder = data;
+    for (size_t i = (size_t)SDL_AtomicAdd(&builder->next, 1);
+         i < builder->count; i = (size_t)SDL_AtomicAdd(&builder->next, 1))
+    {
+        PackCompressItem(builder, &builder->items[i]);
+    }
+
+    return 0;
+}
+
+/**
+ * \desc Runs a worker on a thread for each processor and waits for them all.
+ * The calling thread works alongside them, so that the work is still done
+ * should no thread start.
+ */
+static void PackRunWorkers(PackBuilder* builder, SDL_ThreadFunction run)
+{
+    const i32 num_workers =
+        SDL_min(SDL_max(SDL_GetCPUCount(), 1), PACK_WORKERS);
+    SDL_Thread* workers[PACK_WORKERS] = {0};
+    SDL_AtomicSet(&builder->next, 0);
+
+    for (i32 i = 0; i < num_workers; ++i)
+    {
+        workers[i] = SDL_CreateThread(run, "pack", builder);
+    }
+
+    run(builder);
+
+    for (i32 i = 0; i < num_workers; ++i)
+    {
+        if (workers[i])
+        {
+            SDL_WaitThread(workers[i], NULL);
+        }
+    }
+}
+
+/**
+ * \desc Writes the header, the displacements, the entries in slot order, the
+ * dictionary and then the data of each entry in the same order.
+ */
+static bool PackWrite(const PackBuilder* builder, const char* path,
+                      const u32* displacements, size_t num_buckets,
+                      const u32* slots)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        Log(LOG_ERROR, "Could not open pack %s for writing", path);
+        return false;
+    }
+
+    PackHeader header = {0};
+    memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+    header.version = PACK_VERSION;
+    header.count = (u32)builder->count;
+    header.num_buckets = (u32)num_buckets;
+    header.dict_size = (u32)builder->dict_size;
+    header.entries_offset =
+        PACK_ALIGN(sizeof(header) + sizeof(u32) * (u64)num_buckets);
+    header.dict_offset =
+        header.entries_offset + sizeof(PackEntry) * (u64)builder->count;
+
+    const u64 padding[1] = {0};
+    const size_t num_padding =
+        header.entries_offset - sizeof(header) - sizeof(u32) * num_buckets;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(displacements, sizeof(u32), num_buckets, file) ==
+                  num_buckets &&
+              fwrite(padding, 1, num_padding, file) == num_padding;
+
+    u64 offset = header.dict_offset + builder->dict_size;
+    for (size_t i = 0; i < builder->count && ok; ++i)
+    {
+        const PackItem* item = &builder->items[slots[i]];
+        PackEntry entry = {0};
+        memcpy(entry.name, item->name, sizeof(entry.name));
+        entry.offset = offset;
+        entry.size = item->size;
+        entry.raw_size = item->raw_size;
+        offset += item->size;
+        ok = fwrite(&entry, sizeof(entry), 1, file) == 1;
+    }
+
+    ok = ok && fwrite(builder->dict, 1, builder->dict_size, file) ==
+                   builder->dict_size;
+    for (size_t i = 0; i < builder->count && ok; ++i)
+    {
+        const PackItem* item = &builder->items[slots[i]];
+        ok = fwrite(item->data, 1, item->size, file) == item->size;
+    }
+
+    ok = fclose(file) == 0 && ok;
+    if (!ok)
+    {
+        Log(LOG_ERROR, "Could not write pack %s", path);
+        remove(path);
+    }
+
+    return ok;
+}
+
+/**
+ * \desc The maps are read as a batch, with many reads in flight at once, then
+ * expanded in parallel, and the dictionary trained from all of them, so that
+ * it holds what they have in common. They are then compressed in parallel
+ * against the dictionary. Maps which could not be read are left out, and the
+ * perfect hash of the names of the rest gives the order of the entries.
+ */
+bool PackBuild(const char* dir, const char* path)
+{
+    PackBuilder builder = {0};
+    builder.dir = dir;
+    if (!FileList(dir, &PackAddItem, &builder))
+    {
+        Log(LOG_ERROR, "Could not list the maps of %s", dir);
+        if (builder.items)
+        {
+            Free(builder.items);
+        }
+        return false;
+    }
+
+    if (builder.count > 1)
+    {
+        qsort(builder.items, builder.count, sizeof(PackItem), &PackItemSort);
+    }
+
+    builder.reads =
+        Allocate(sizeof(BatchIoRequest) * SDL_max(builder.count, (size_t)1));
+    for (size_t i = 0; i < builder.count; ++i)
+    {
+        builder.reads[i].kind = BATCHIO_READ;
+        builder.reads[i].path = builder.items[i].path;
+    }
+
+    BatchIoRun(builder.reads, builder.count);
+    PackRunWorkers(&builder, &PackRunExpand);
+    Free(builder.reads);
+
+    size_t count = 0;
+    for (size_t i = 0; i < builder.count; ++i)
+    {
+        if (builder.items[i].raw)
+        {
+            builder.items[count++] = builder.items[i];
+        }
+    }
+    builder.count = count;
+
+    const u8** samples = Allocate(sizeof(u8*) * SDL_max(count, (size_t)1));
+    size_t* sizes = Allocate(sizeof(size_t) * SDL_max(count, (size_t)1));
+    const char** names = Allocate(sizeof(char*) * SDL_max(count, (size_t)1));
+    for (size_t i = 0; i < count; ++i)
+    {
+        samples[i] = builder.items[i].raw;
+        sizes[i] = builder.items[i].raw_size;
+        names[i] = builder.items[i].name;
+    }
+
+    u8* dict = Allocate(PACK_DICT_SIZE);
+    builder.dict = dict;
+    builder.dict_size = LzTrain(samples, sizes, count, dict, PACK_DICT_SIZE);
+    PackRunWorkers(&builder, &PackRunCompress);
+
+    const size_t num_buckets = count > 1 ? (count + 1) / 2 : 1;
+    u32* displacements = Allocate(sizeof(u32) * num_buckets);
+    u32* slots = Allocate(sizeof(u32) * SDL_max(count, (size_t)1));
+    bool ok = PerfectHashGenerate(names, count, num_buckets, displacements,
+                                  slots);
+
+    if (!ok)
+    {
+        Log(LOG_ERROR, "Could not index the maps of %s", dir);
+    }
+    ok = ok && PackWrite(&builder, path, displacements, num_buckets, slots);
+
+    if (ok)
+    {
+        Log(LOG_NOTIFY, "Packed %zu maps of %s into %s", count, dir, path);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        Free(builder.items[i].data);
+    }
+    if (builder.items)
+    {
+        Free(builder.items);
+    }
+    Free(slots);
+    Free(displacements);
+    Free(dict);
+    Free(names);
+    Free(sizes);
+    Free(samples);
+
+    return ok;
+}
+
+/**
+ * \desc Only the header is checked, along with the sections it points to
+ * fitting within the file, so that a pack opens in the same time however many
+ * maps it holds. Each entry is checked as it is used.
+ */
+[[nodiscard]] Pack* PackOpen(const char* path)
+{
+    size_t size = 0;
+    const u8* data = FileMap(path, &size);
+    if (data == NULL)
+    {
+        Log(LOG_ERROR, "Could not open pack %s", path);
+        return NULL;
+    }
+
+    PackHeader header = {0};
+    if (size >= sizeof(header))
+    {
+        memcpy(&header, data, sizeof(header));
+    }
+
+    // The offsets are untrusted, so they are only compared, or subtracted once
+    // known to be in order, and never added, lest a sum wrap around.
+    const u64 displacements_end =
+        sizeof(header) + sizeof(u32) * (u64)header.num_buckets;
+    const bool ok =
+        size >= sizeof(header) &&
+        memcmp(header.magic, PACK_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version == PACK_VERSION && header.num_buckets > 0 &&
+        header.entries_offset % 8 == 0 &&
+        displacements_end <= header.entries_offset &&
+        header.entries_offset <= size &&
+        header.entries_offset <= header.dict_offset &&
+        header.dict_offset <= size &&
+        header.count <= (header.dict_offset - header.entries_offset) /
+                            sizeof(PackEntry) &&
+        header.dict_size <= size - header.dict_offset;
+
+    if (!ok)
+    {
+        FileUnmap((void*)data, size);
+        Log(LOG_ERROR, "%s is not a valid pack", path);
+        return NULL;
+    }
+
+    Pack* pack = Allocate(sizeof(Pack));
+    pack->data = data;
+    pack->size = size;
+    pack->header = header;
+    pack->displacements = (const u32*)(data + sizeof(header));
+    pack->entries = (const PackEntry*)(data + header.entries_offset);
+    pack->dict = data + header.dict_offset;
+
+    return pack;
+}
+
+/**
+ * \desc Unmaps the file, then frees the pack itself.
+ */
+void PackFree(Pack* pack)
+{
+    FileUnmap((void*)pack->data, pack->size);
+    Free(pack);
+}
+
+/**
+ * \desc The name in the only slot the map could occupy is compared against
+ * the name searched for, without reading past the end of its entry.
+ */
+[[nodiscard]] i32 PackFind(const Pack* pack, const char* name)
+{
+    const i32 slot =
+        PerfectHashSlot(pack->displacements, pack->header.num_buckets,
+                        pack->header.count, name);
+    if (slot < 0 || strlen(name) >= PACK_MAX_NAME ||
+        strncmp(pack->entries[slot].name, name, PACK_MAX_NAME) != 0)
+    {
+        return -1;
+    }
+
+    return slot;
+}
+
+/**
+ * \desc The data of the entry is decompressed into a buffer of its own size,
+ * and the map loaded from there. An entry whose data runs past the end of the
+ * file, which claims to expand further than any block can, or which does not
+ * decompress, is not a valid map.
+ */
+[[nodiscard]] ChunkStore* PackLoad(const Pack* pack, i32 index)
+{
+    if (index < 0 || (u32)index >= pack->header.count)
+    {
+        return NULL;
+    }
+
+    const PackEntry* entry = &pack->entries[index];
+    if (entry->offset > pack->size ||
+        entry->size > pack->size - entry->offset ||
+        entry->raw_size / LZ_MAX_RATIO > entry->size)
+    {
+        return NULL;
+    }
+
+    const u8* data = pack->data + entry->offset;
+    if (entry->size == entry->raw_size)
+    {
+        return MapLoadMemory(data, entry->raw_size);
+    }
+
+    u8* raw = Allocate(SDL_max(entry->raw_size, (u64)1));
+    ChunkStore* store =
+        LzDecompressDict(data, entry->size, pack->dict, pack->header.dict_size,
+                         raw, entry->raw_size)
+            ? MapLoadMemory(raw, entry->raw_size)
+            : NULL;
+    Free(raw);
+
+    return store;
+}
+
+/**
+ * \desc Names which are not terminated within their entry are skipped.
+ */
+bool PackList(const char* path,
+              void (*visit)(void* data, const char* name, bool is_dir),
+              void* data)
+{
+    Pack* pack = PackOpen(path);
+    if (pack == NULL)
+    {
+        return false;
+    }
+
+    for (u32 i = 0; i < pack->header.count; ++i)
+    {
+        const char* name = pack->entries[i].name;
+        if (memchr(name, '\0', PACK_MAX_NAME))
+        {
+            visit(data, name, false);
+        }
+    }
+
+    PackFree(pack);
+
+    return true;
+}
+
+/**
+ * \desc Compares the end of the path with the extension.
+ */
+[[nodiscard]] bool PackIsPath(const char* path)
+{
+    const size_t length = strlen(path);
+    const size_t ext = sizeof(PACK_EXTENSION) - 1;
+    return length > ext && strcmp(path + length - ext, PACK_EXTENSION) == 0;
+}
+
+/**
+ * \desc The path is split after the extension of the pack, which must be
+ * followed by the name of a map and nothing more.
+ */
+bool PackSplitPath(const char* path, char* pack, size_t size,
+                   const char** name)
+{
+    const char* split = strstr(path, PACK_EXTENSION "/");
+    if (split == NULL)
+    {
+        return false;
+    }
+
+    split += sizeof(PACK_EXTENSION) - 1;
+    const size_t length = (size_t)(split - path);
+    if (length >= size || split[1] == '\0' || strchr(split + 1, '/'))
+    {
+        return false;
+    }
+
+    memcpy(pack, path, length);
+    pack[length] = '\0';
+    *name = split + 1;
+
+    return true;
+}
+
+/**
+ * \desc A map within a pack is loaded from a pack opened just for it, which
+ * only costs a mapping of the file and a lookup of the name.
+ */
+[[nodiscard]] ChunkStore* PackLoadMap(const char* path)
+{
+    char pack_path[PACK_MAX_PATH] = {0};
+    const char* name = NULL;
+    if (!PackSplitPath(path, pack_path, sizeof(pack_path), &name))
+    {
+        return MapLoad(path);
+    }
+
+    Pack* pack = PackOpen(pack_path);
+    if (pack == NULL)
+    {
+        return NULL;
+    }
+
+    const i32 index = PackFind(pack, name);
+    ChunkStore* store = PackLoad(pack, index);
+    PackFree(pack);
+
+    if (store == NULL)
+    {
+        Log(LOG_ERROR, "Could not load %s from pack %s", name, pack_path);
+    }
+
+    return store;
+}
@@ -20,25 +20,33 @@
 [[nodiscard]] Resourcer* ResourcerCreate(void)
 {
     Resourcer* res = Allocate(sizeof(Resourcer));
-    res->textures = HashmapCreate(HASHMAP_INITIAL_BASE_SIZE, TextureFree);
+    res->textures = ConcurrentMapCreate(TextureFree);
 
     return res;
 }
 
 /**
- * \desc Frees all of the data concerned with the resourcer. Beware freeing
- * memory outside of the resourcer!
+ * \desc Frees all of the data concerned with the resourcer, including any
+ * loaded tilesets. Beware freeing memory outside of the resourcer!
  */
 void ResourcerFree(Resourcer* res)
 {
-    HashmapFree(res->textures, true);
+    for (size_t i = 0; i < TILESETS_COUNT; ++i)
+    {
+        if (res->tilesets[i])
+        {
+            TextureFree(res->tilesets[i]);
+        }
+    }
+
+    ConcurrentMapFree(res->textures, true);
     Free(res);
 }
 
 /**
- * \desc Loads a texture into the resourcer texture hashmap. This requires a
- * Window with an SDL rendering context, and of course, a filepath to the
- * texture.
+ * \desc Loads a texture into the resourcer texture map. This requires a Window
+ * with an SDL rendering context, and of course, a filepath to the texture. The
+ * texture is only published to the map once it has been fully loaded.
  */
 void ResourcerLoadTexture(Resourcer* res, const Window* wind, const char* path,
                           const char* key)
@@ -46,21 +54,22 @@ void ResourcerLoadTexture(Resourcer* res, const Window* wind, const char* path,
     Texture* tex = TextureCreate();
     if (!TextureLoad(tex, wind, path))
     {
+        TextureFree(tex);
         return;
     }
 
-    HashmapInsert(res->textures, key, tex);
+    ConcurrentMapInsert(res->textures, key, tex);
 }
 
 /**
- * \desc Retrieves a texture from a resourcer via a hashmap look-up based on a
- * given key. If the texture is not found within the hashmap, an error is
- * logged.
+ * \desc Retrieves a texture from a resourcer via a lock-free look-up of the
+ * concurrent texture map based on a given key. If the texture is not found
+ * within the map, an error is logged.
  */
 [[nodiscard]] Texture* ResourcerGetTexture(const Resourcer* res,
                                            const char* key)
 {
-    Texture* tex = HashmapSearch(res->textures, "main_texture");
+    Texture* tex = ConcurrentMapSearch(res->textures, key);
     if (tex == NULL)
     {
         Log(LOG_ERROR, "Could not retrieve texture \"%s\" from resourcer!",
@@ -69,4 +78,54 @@ void ResourcerLoadTexture(Resourcer* res, const Window* wind, const char* path,
     }
 
     return tex;
-}
\ No newline at end of file
+}
+
+/**
+ * \desc Loads a built-in tileset into its perfect hash slot. The name must be
+ * one of those known at build time, and the texture path is derived from it. A
+ * tileset which is already loaded is left untouched.
+ */
+void ResourcerLoadTileset(Resourcer* res, const Window* wind, const char* name)
+{
+    const i32 slot = PerfectHashLookup(&TILESETS, name);
+    if (slot < 0)
+    {
+        Log(LOG_ERROR, "No such tileset \"%s\"!", name);
+        return;
+    }
+
+    if (res->tilesets[slot])
+    {
+        return;
+    }
+
+    char path[256] = {0};
+    snprintf(path, sizeof(path), "%s%s.png", TILESET_DIRECTORY, name);
+
+    Texture* tex = TextureCreate();
+    if (!TextureLoad(tex, wind, path))
+    {
+        TextureFree(tex);
+        return;
+    }
+
+    res->tilesets[slot] = tex;
+}
+
+/**
+ * \desc Retrieves a tileset with a single perfect hash probe. If the tileset is
+ * unknown or has not been loaded, an error is logged.
+ */
+[[nodiscard]] Texture* ResourcerGetTileset(const Resourcer* res,
+                                           const char* name)
+{
+    const i32 slot = PerfectHashLookup(&TILESETS, name);
+    if (slot < 0 || res->tilesets[slot] == NULL)
+    {
+        Log(LOG_ERROR, "Could not retrieve tileset \"%s\" from resourcer!",
+            name);
+        return NULL;
+    }
+
+    return res->tilesets[slot];
+}
@@ -32,6 +32,189 @@
 #endif
 }
 
+/**
+ * \desc Queries the file system for the size and modification time of a file.
+ * Both platforms provide a stat function with the same fields.
+ */
+[[nodiscard]] bool FileStat(const char* path, i64* size, i64* mtime)
+{
+#if _WIN32
+    struct _stat64 info = {0};
+    if (_stat64(path, &info) != 0)
+    {
+        return false;
+    }
+#else
+    struct stat info = {0};
+    if (stat(path, &info) != 0)
+    {
+        return false;
+    }
+#endif
+
+    *size = (i64)info.st_size;
+    *mtime = (i64)info.st_mtime;
+    return true;
+}
+
+/**
+ * \desc Maps a file read-only into the address space of the program, so that
+ * its contents are paged in on demand rather than read and copied up front. The
+ * file handle is closed straight away, as the mapping keeps the file alive.
+ * Empty files cannot be mapped and are treated as a failure.
+ */
+[[nodiscard]] void* FileMap(const char* path, size_t* size)
+{
+    *size = 0;
+
+#if _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return NULL;
+    }
+
+    LARGE_INTEGER length = {0};
+    if (!GetFileSizeEx(file, &length) || length.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+    {
+        return NULL;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (data == NULL)
+    {
+        return NULL;
+    }
+
+    *size = (size_t)length.QuadPart;
+#else
+    const i32 fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    struct stat info = {0};
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    void* data =
+        mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    *size = (size_t)info.st_size;
+#endif
+
+    return data;
+}
+
+/**
+ * \desc Releases a mapping made by FileMap.
+ */
+void FileUnmap(void* data, size_t size)
+{
+#if _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+/**
+ * \desc Walks the entries of the directory with the listing functions of each
+ * platform. Links are followed, and the entries for the directory itself and
+ * its parent are skipped, as is anything which is neither a regular file nor a
+ * directory.
+ */
+bool FileList(const char* dir,
+              void (*visit)(void* data, const char* name, bool is_dir),
+              void* data)
+{
+#if _WIN32
+    char pattern[MAX_PATH] = {0};
+    snprintf(pattern, sizeof(pattern), "%s\\*", dir);
+
+    WIN32_FIND_DATAA entry = {0};
+    HANDLE find = FindFirstFileA(pattern, &entry);
+    if (find == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    do
+    {
+        if (strcmp(entry.cFileName, ".") != 0 &&
+            strcmp(entry.cFileName, "..") != 0)
+        {
+            visit(data, entry.cFileName,
+                  entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY);
+        }
+    } while (FindNextFileA(find, &entry));
+
+    FindClose(find);
+#else
+    DIR* handle = opendir(dir);
+    if (handle == NULL)
+    {
+        return false;
+    }
+
+    char path[1024] = {0};
+    struct dirent* entry = NULL;
+    while ((entry = readdir(handle)) != NULL)
+    {
+        struct stat info = {0};
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (strcmp(entry->d_name, ".") == 0 ||
+            strcmp(entry->d_name, "..") == 0 || stat(path, &info) != 0)
+        {
+            continue;
+        }
+
+        if (S_ISREG(info.st_mode) || S_ISDIR(info.st_mode))
+        {
+            visit(data, entry->d_name, S_ISDIR(info.st_mode));
+        }
+    }
+
+    closedir(handle);
+#endif
+
+    return true;
+}
+
+/**
+ * \desc Only the last directory of the path is created, so its parent must
+ * already exist.
+ */
+bool DirCreate(const char* dir)
+{
+#if _WIN32
+    return CreateDirectoryA(dir, NULL) ||
+           GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    return mkdir(dir, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
 /* -------------------------------------------------------------------------- */
 /* LOGGING                                                                    */
 /* -------------------------------------------------------------------------- */
@@ -115,6 +298,28 @@ void* Allocate(size_t size)
     return mem;
 }
 
+/**
+ * \desc Resizes memory from Allocate, or allocates it afresh when there is
+ * none, keeping its contents up to the smaller of the two sizes. Any memory
+ * gained is not initialised. If the memory cannot be resized, the program
+ * exits. Only fresh memory increases the number of global memory allocations,
+ * as a resize neither adds nor removes one.
+ */
+void* Reallocate(void* mem, size_t size)
+{
+    void* grown = realloc(mem, size);
+    if (grown == NULL)
+    {
+        Log(LOG_FATAL, "Could not reallocate memory of size %i!", size);
+    }
+
+    if (mem == NULL)
+    {
+        g_mem_allocs++;
+    }
+    return grown;
+}
+
 /**
  * \desc Checks to see if the memory is first valid, and if it is, then it is
  * freed and the number of global memory allocations is decreased. Otherwise,
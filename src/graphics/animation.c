@@ -0,0 +1,176 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file animation.c
+ *
+ * \brief Animated tile types, such as water or torches, cycle the glyph shown
+ * for a cell through a set of frames. Every animation runs from the same clock,
+ * so the frame of a cell depends only on its glyph and the time.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "graphics/animation.h"
+
+/**
+ * \desc Parses a whole token as a non-negative integer no greater than a limit.
+ */
+static bool AnimationsParse(const char* token, u32 limit, u32* value)
+{
+    char* end = NULL;
+    const long long parsed = strtoll(token, &end, 10);
+    if (end == token || *end != '\0' || parsed < 0 ||
+        parsed > (long long)limit)
+    {
+        return false;
+    }
+
+    *value = (u32)parsed;
+    return true;
+}
+
+/**
+ * \desc Parses a single line into a new tile type. The glyphs of the frames are
+ * only claimed once the whole line is known to be valid, and a glyph claimed
+ * by an earlier tile type invalidates the line.
+ */
+static bool AnimationsParseLine(Animations* anims, char* line)
+{
+    const char* delims = " \t\r\n";
+    char* name = strtok(line, delims);
+    if (name == NULL || name[0] == '#')
+    {
+        return true;
+    }
+
+    if (anims->count == ANIMATIONS_MAX || strlen(name) >= ANIMATION_MAX_NAME)
+    {
+        return false;
+    }
+
+    Animation* anim = &anims->animations[anims->count];
+    *anim = (Animation){0};
+
+    char* token = strtok(NULL, delims);
+    if (token == NULL || !AnimationsParse(token, UINT32_MAX, &anim->period) ||
+        anim->period == 0)
+    {
+        return false;
+    }
+    strcpy(anim->name, name);
+
+    while ((token = strtok(NULL, delims)) && token[0] != '#')
+    {
+        u32 index = 0;
+        if (anim->num_frames == ANIMATION_MAX_FRAMES ||
+            !AnimationsParse(token, 255, &index) || anims->lookup[index])
+        {
+            return false;
+        }
+
+        for (u8 i = 0; i < anim->num_frames; ++i)
+        {
+            if (anim->frames[i] == index)
+            {
+                return false;
+            }
+        }
+        anim->frames[anim->num_frames++] = (u8)index;
+    }
+
+    if (anim->num_frames < 2)
+    {
+        return false;
+    }
+
+    for (u8 i = 0; i < anim->num_frames; ++i)
+    {
+        anims->lookup[anim->frames[i]] = (u8)(anims->count + 1);
+        anims->position[anim->frames[i]] = i;
+    }
+    anims->count++;
+
+    return true;
+}
+
+/**
+ * \desc Reads the file a line at a time. Invalid lines are logged and skipped,
+ * so that one bad tile type does not lose the rest.
+ */
+[[nodiscard]] Animations* AnimationsLoad(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+        Log(LOG_ERROR, "Could not open animations %s!", path);
+        return NULL;
+    }
+
+    Animations* anims = Allocate(sizeof(Animations));
+    char line[512] = {0};
+    u32 line_number = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        line_number++;
+        if (!AnimationsParseLine(anims, line))
+        {
+            Log(LOG_ERROR, "%s:%u: invalid tile type!", path, line_number);
+        }
+    }
+    fclose(file);
+
+    return anims;
+}
+
+/**
+ * \desc The animations hold no other memory.
+ */
+void AnimationsFree(Animations* anims) { Free(anims); }
+
+/**
+ * \desc A single lookup into the table of tile types.
+ */
+[[nodiscard]] bool AnimationsHas(const Animations* anims, u8 index)
+{
+    return anims->lookup[index] != 0;
+}
+
+/**
+ * \desc The frame is offset by the position of the glyph within its tile type,
+ * so that a cell drawn with any frame starts from that frame.
+ */
+[[nodiscard]] u8 AnimationsFrame(const Animations* anims, u8 index, u32 time)
+{
+    if (anims->lookup[index] == 0)
+    {
+        return index;
+    }
+
+    const Animation* anim = &anims->animations[anims->lookup[index] - 1];
+    const u32 frame = time / anim->period + anims->position[index];
+
+    return anim->frames[frame % anim->num_frames];
+}
+
+/**
+ * \desc Each tile type changes frame at every multiple of its period, so the
+ * next change is the soonest of the next multiples.
+ */
+[[nodiscard]] u32 AnimationsNextChange(const Animations* anims, u32 time)
+{
+    u32 next = UINT32_MAX;
+    for (size_t i = 0; i < anims->count; ++i)
+    {
+        const u32 period = anims->animations[i].period;
+        const u64 change = ((u64)time / period + 1) * period;
+        if (change < next)
+        {
+            next = (u32)change;
+        }
+    }
+
+    return next;
+}
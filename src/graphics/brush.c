@@ -0,0 +1,173 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file brush.c
+ *
+ * \brief A brush is the footprint of a single stamp onto a canvas. The shape is
+ * worked out once, when the brush is created, as a list of row spans, so that
+ * stamping a brush is no more than a run of writes along each of its rows.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "graphics/brush.h"
+
+/**
+ * \desc Finds the half-width of a row of a round brush: the largest column
+ * whose cell centre lies within the circle. The circle has a diameter of 2r - 1
+ * cells, so the comparison is made in quarter cells to stay in integers.
+ */
+static i32 BrushRoundHalfWidth(i32 radius, i32 dy)
+{
+    const i64 limit = (i64)(2 * radius - 1) * (2 * radius - 1);
+    i32 half = (i32)sqrt((f64)limit / 4.0 - (f64)dy * dy);
+
+    while (half > 0 && 4 * ((i64)half * half + (i64)dy * dy) > limit)
+    {
+        half--;
+    }
+    while (4 * ((i64)(half + 1) * (half + 1) + (i64)dy * dy) <= limit)
+    {
+        half++;
+    }
+
+    return half;
+}
+
+/**
+ * \desc Every row of a round or square brush is a single span, so the spans
+ * are allocated up front. The rows of a square brush all share its radius.
+ */
+[[nodiscard]] Brush* BrushCreate(BrushShape shape, i32 radius)
+{
+    if (shape == BRUSH_CUSTOM)
+    {
+        Log(LOG_ERROR, "Custom brushes are created from a mask!");
+        shape = BRUSH_ROUND;
+    }
+
+    if (radius < BRUSH_MIN_RADIUS)
+    {
+        radius = BRUSH_MIN_RADIUS;
+    }
+    else if (radius > BRUSH_MAX_RADIUS)
+    {
+        radius = BRUSH_MAX_RADIUS;
+    }
+
+    Brush* brush = Allocate(sizeof(Brush));
+    brush->shape = shape;
+    brush->radius = radius;
+    brush->spans = Allocate(sizeof(BrushSpan) * (size_t)(2 * radius - 1));
+
+    for (i32 dy = -(radius - 1); dy < radius; ++dy)
+    {
+        const i32 half = shape == BRUSH_SQUARE
+                             ? radius - 1
+                             : BrushRoundHalfWidth(radius, dy);
+
+        brush->spans[brush->num_spans++] =
+            (BrushSpan){.dy = (i16)dy, .x0 = (i16)-half, .x1 = (i16)(half + 1)};
+        brush->num_cells += (size_t)(2 * half + 1);
+    }
+
+    return brush;
+}
+
+/**
+ * \desc Two passes over the mask: the first counts the runs, so the spans can
+ * be allocated exactly, and the second records them. The radius is that of the
+ * smallest square brush which holds the mask.
+ */
+[[nodiscard]] Brush* BrushCreateStamp(const bool* mask, i32 width, i32 height)
+{
+    const i32 extent = 2 * BRUSH_MAX_RADIUS;
+    width = width < 0 ? 0 : (width > extent ? extent : width);
+    height = height < 0 ? 0 : (height > extent ? extent : height);
+
+    Brush* brush = Allocate(sizeof(Brush));
+    brush->shape = BRUSH_CUSTOM;
+    brush->radius = ((width > height ? width : height) + 1) / 2;
+    brush->radius = brush->radius ? brush->radius : BRUSH_MIN_RADIUS;
+
+    size_t count = 0;
+    for (i32 y = 0; y < height; ++y)
+    {
+        for (i32 x = 0; x < width; ++x)
+        {
+            const bool starts = x == 0 || !mask[x - 1 + y * width];
+            count += mask[x + y * width] && starts;
+        }
+    }
+
+    brush->spans = Allocate(sizeof(BrushSpan) * (count ? count : 1));
+
+    for (i32 y = 0; y < height; ++y)
+    {
+        for (i32 x = 0; x < width;)
+        {
+            if (!mask[x + y * width])
+            {
+                x++;
+                continue;
+            }
+
+            const i32 start = x;
+            while (x < width && mask[x + y * width])
+            {
+                x++;
+            }
+
+            brush->spans[brush->num_spans++] =
+                (BrushSpan){.dy = (i16)(y - height / 2),
+                            .x0 = (i16)(start - width / 2),
+                            .x1 = (i16)(x - width / 2)};
+            brush->num_cells += (size_t)(x - start);
+        }
+    }
+
+    return brush;
+}
+
+/**
+ * \desc Frees the spans and then the brush itself.
+ */
+void BrushFree(Brush* brush)
+{
+    Free(brush->spans);
+    Free(brush);
+}
+
+/**
+ * \desc The spans are sorted by row, so the first span of the row is found by
+ * a binary search and then the spans of the row are checked in turn.
+ */
+[[nodiscard]] bool BrushCovers(const Brush* brush, i32 dx, i32 dy)
+{
+    size_t lo = 0, hi = brush->num_spans;
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (brush->spans[mid].dy < dy)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    for (; lo < brush->num_spans && brush->spans[lo].dy == dy; ++lo)
+    {
+        if (dx >= brush->spans[lo].x0 && dx < brush->spans[lo].x1)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
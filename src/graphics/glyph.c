@@ -26,23 +26,32 @@ void GlyphFree(Glyph* glyph) { Free(glyph); }
 
 /**
  * \desc Glyph rendering requires a window to render to and a base texture. The
- * foreground source rectangle from the texture is that based on the glyph
- * index. The background source rectangle is always the same: that of the filled
- * ASCII character. The destination rectangle is based on the glyph position, as
- * well as the textures glyph dimensions. The background is drawn first,
- * followed by the foreground. Alpha blending is enabled for both of these.
+ * destination rectangle is based on the glyph position, as well as the
+ * textures glyph dimensions.
  */
 void GlyphRender(const Glyph* glyph, const Window* wind, const Texture* tex)
 {
-    const SDL_Rect fsrc = tex->rects[glyph->index];
-    const SDL_Rect bsrc = tex->rects[FILLED];
-
     SDL_Rect dest = {0};
     dest.x = (u32)glyph->x * tex->glyph_w;
     dest.y = (u32)glyph->y * tex->glyph_h;
     dest.w = tex->glyph_w;
     dest.h = tex->glyph_h;
 
+    GlyphRenderTo(glyph, wind, tex, dest);
+}
+
+/**
+ * \desc The foreground source rectangle from the texture is that based on the
+ * glyph index. The background source rectangle is always the same: that of the
+ * filled ASCII character. The background is drawn first, followed by the
+ * foreground. Alpha blending is enabled for both of these.
+ */
+void GlyphRenderTo(const Glyph* glyph, const Window* wind, const Texture* tex,
+                   SDL_Rect dest)
+{
+    const SDL_Rect fsrc = tex->rects[glyph->index];
+    const SDL_Rect bsrc = tex->rects[FILLED];
+
     SDL_SetTextureColorMod(tex->sdl_texture, glyph->bg.r, glyph->bg.g,
                            glyph->bg.b);
     SDL_SetTextureAlphaMod(tex->sdl_texture, glyph->bg.a);
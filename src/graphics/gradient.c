@@ -0,0 +1,333 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file gradient.c
+ *
+ * \brief A gradient blends from one colour to another across a block of cells,
+ * along a line or outwards from a point. It may colour the foreground and/or
+ * background of the cells, and may shade them with glyphs of increasing
+ * coverage, dithered so that the shades blend smoothly.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "graphics/gradient.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * \desc The weight of the end colour is held in sixteen bits of fraction, so
+ * that the whole of the end colour is one more than the largest u16.
+ */
+#define GRADIENT_ONE 65536u
+
+/**
+ * \desc The glyphs shading from none to full coverage: blank, light, medium
+ * and dark shade, and the full block.
+ */
+static const u8 GRADIENT_SHADES[] = {0, 176, 177, 178, 219};
+
+/**
+ * \desc A 4x4 ordered dither matrix: each cell of a repeating tile has its own
+ * threshold, so that a level part way between two shades picks the brighter
+ * one in a share of the cells in proportion to how far it is.
+ */
+static const u8 GRADIENT_BAYER[4][4] = {
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5},
+};
+
+/**
+ * \desc The bits of fraction below a weight that a linear gradient is stepped
+ * in, so that the whole of the end colour is 1 << 30 and any point of a ramp
+ * fits an i32.
+ */
+#define GRADIENT_FRACTION 14
+#define GRADIENT_RAMP_ONE ((i64)GRADIENT_ONE << GRADIENT_FRACTION)
+
+/**
+ * \desc Sets a run of cells to the same weight.
+ */
+static void GradientFlat(u32 weight, i32 count, u32* weights)
+{
+    for (i32 i = 0; i < count; ++i)
+    {
+        weights[i] = weight;
+    }
+}
+
+/**
+ * \desc Rounds a point of a linear gradient to a whole weight.
+ */
+static u32 GradientRound(i64 acc)
+{
+    return (u32)((acc + (1 << (GRADIENT_FRACTION - 1))) >> GRADIENT_FRACTION);
+}
+
+/**
+ * \desc Steps a ramp which stays between the ends of a linear gradient, so
+ * that no cell of it needs clamping and every point of it fits an i32. Where
+ * SSE2 is available, four cells are stepped to an add.
+ */
+static void GradientRamp(i64 acc, i64 step, i32 count, u32* weights)
+{
+    i32 i = 0;
+
+#if defined(__SSE2__)
+    if (count >= 4)
+    {
+        __m128i total = _mm_add_epi32(
+            _mm_set_epi32((i32)(acc + step * 3), (i32)(acc + step * 2),
+                          (i32)(acc + step), (i32)acc),
+            _mm_set1_epi32(1 << (GRADIENT_FRACTION - 1)));
+        const __m128i step4 = _mm_set1_epi32((i32)(step * 4));
+        for (; i + 4 <= count; i += 4)
+        {
+            _mm_storeu_si128((__m128i*)&weights[i],
+                             _mm_srai_epi32(total, GRADIENT_FRACTION));
+            total = _mm_add_epi32(total, step4);
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        weights[i] = GradientRound(acc + step * i);
+    }
+}
+
+/**
+ * \desc Scales a projection onto a linear gradient by the whole of the ramp
+ * over its squared length without overflowing, as the product overflows 64
+ * bits for a projection beyond 1 << 33. The whole ramps are taken apart from
+ * the remainder, and a length beyond 32 bits is halved along with the
+ * projection until the remainder scaled fits; the ratio keeps 32 bits.
+ */
+static i64 GradientScale(i64 projection, i64 length)
+{
+    while (length >= (i64)1 << 32)
+    {
+        projection /= 2;
+        length /= 2;
+    }
+
+    return projection / length * GRADIENT_RAMP_ONE +
+           projection % length * GRADIENT_RAMP_ONE / length;
+}
+
+/**
+ * \desc Works out the weight of the end colour for each cell of a batch of a
+ * linear gradient, in fixed point. Along a row the projection of a cell onto
+ * the gradient grows by the same step each cell, so the batch splits into at
+ * most three runs: flat at one end, a ramp, and flat at the other. Where the
+ * runs meet is found by division, leaving the ramp to be stepped by adds. The
+ * offsets are taken in 64 bits, so that no subtraction of coordinates wraps.
+ */
+static void GradientLinear(const Gradient* gradient, i32 x, i32 y, i32 count,
+                           u32* weights)
+{
+    const i64 dx = (i64)gradient->end.x - gradient->start.x;
+    const i64 dy = (i64)gradient->end.y - gradient->start.y;
+    const i64 length = dx * dx + dy * dy;
+    if (length == 0)
+    {
+        GradientFlat(0, count, weights);
+        return;
+    }
+
+    const i64 projection = ((i64)x - gradient->start.x) * dx +
+                           ((i64)y - gradient->start.y) * dy;
+    const i64 base = GradientScale(projection, length);
+    const i64 step = dx * GRADIENT_RAMP_ONE / length;
+    if (step == 0)
+    {
+        const i64 flat = SDL_min(SDL_max(base, (i64)0), GRADIENT_RAMP_ONE);
+        GradientFlat(GradientRound(flat), count, weights);
+        return;
+    }
+
+    // The cells before the ramp are at the start colour when the gradient
+    // rises along the row, or at the end colour when it falls.
+    const i64 near = step > 0 ? base : GRADIENT_RAMP_ONE - base;
+    const i64 far = step > 0 ? GRADIENT_RAMP_ONE - base : base;
+    const i64 rate = step > 0 ? step : -step;
+    const i64 first = near > 0 ? 0 : -near / rate + 1;
+    const i64 last = far <= 0 ? 0 : (far + rate - 1) / rate;
+    const i32 ramp_start = (i32)SDL_min(first, (i64)count);
+    const i32 ramp_end = (i32)SDL_max(SDL_min(last, (i64)count),
+                                      (i64)ramp_start);
+
+    GradientFlat(step > 0 ? 0 : GRADIENT_ONE, ramp_start, weights);
+    GradientRamp(base + step * ramp_start, step,
+                 ramp_end - ramp_start, &weights[ramp_start]);
+    GradientFlat(step > 0 ? GRADIENT_ONE : 0, count - ramp_end,
+                 &weights[ramp_end]);
+}
+
+/**
+ * \desc Works out the weight of the end colour for each cell of a batch of a
+ * radial gradient. The squared distance of each cell is scaled so that its
+ * square root is the weight, which takes a square root per cell; SSE2 takes
+ * four at once, and the scalar loop rounds the same way.
+ */
+static void GradientRadial(const Gradient* gradient, i32 x, i32 y, i32 count,
+                           u32* weights)
+{
+    const f32 dx = (f32)(gradient->end.x - gradient->start.x);
+    const f32 dy = (f32)(gradient->end.y - gradient->start.y);
+    const f32 rx = (f32)(x - gradient->start.x);
+    const f32 ry = (f32)(y - gradient->start.y);
+    const f32 length = dx * dx + dy * dy;
+    const f32 scale =
+        length > 0.0f ? (f32)GRADIENT_ONE * (f32)GRADIENT_ONE / length : 0.0f;
+    const f32 ry2 = ry * ry;
+    i32 i = 0;
+
+#if defined(__SSE2__)
+    const __m128 scales = _mm_set1_ps(scale);
+    const __m128 ry2s = _mm_set1_ps(ry2);
+    __m128 px = _mm_set_ps(rx + 3.0f, rx + 2.0f, rx + 1.0f, rx);
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 d2 = _mm_add_ps(_mm_mul_ps(px, px), ry2s);
+        const __m128 t = _mm_min_ps(_mm_sqrt_ps(_mm_mul_ps(d2, scales)),
+                                    _mm_set1_ps((f32)GRADIENT_ONE));
+        _mm_storeu_si128((__m128i*)&weights[i], _mm_cvtps_epi32(t));
+        px = _mm_add_ps(px, _mm_set1_ps(4.0f));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        const f32 px = rx + (f32)i;
+        const f32 t = fminf(sqrtf((px * px + ry2) * scale), (f32)GRADIENT_ONE);
+        weights[i] = (u32)lrintf(t);
+    }
+}
+
+/**
+ * \desc Blends a single channel of the two colours for each cell of a batch,
+ * into an array of its own. The weight is rounded to eight bits of fraction,
+ * so that both products of the blend and their sum fit sixteen bits; SSE2
+ * then blends eight cells to a multiply.
+ */
+static void GradientBlend(u8 from, u8 to, const u32* weights, i32 count,
+                          u8* out)
+{
+    i32 i = 0;
+
+#if defined(__SSE2__)
+    const __m128i froms = _mm_set1_epi16(from);
+    const __m128i tos = _mm_set1_epi16(to);
+    const __m128i whole = _mm_set1_epi16(256);
+    const __m128i round = _mm_set1_epi32(128);
+    const __m128i half = _mm_set1_epi16(128);
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i lo = _mm_srli_epi32(
+            _mm_add_epi32(_mm_loadu_si128((const __m128i*)&weights[i]), round),
+            8);
+        const __m128i hi = _mm_srli_epi32(
+            _mm_add_epi32(_mm_loadu_si128((const __m128i*)&weights[i + 4]),
+                          round),
+            8);
+        const __m128i t = _mm_packs_epi32(lo, hi);
+        const __m128i sum =
+            _mm_add_epi16(_mm_mullo_epi16(froms, _mm_sub_epi16(whole, t)),
+                          _mm_mullo_epi16(tos, t));
+        const __m128i blend = _mm_srli_epi16(_mm_add_epi16(sum, half), 8);
+        _mm_storel_epi64((__m128i*)&out[i], _mm_packus_epi16(blend, blend));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        const u32 t = (weights[i] + 128) >> 8;
+        out[i] = (u8)((from * (256 - t) + to * t + 128) >> 8);
+    }
+}
+
+/**
+ * \desc The row is worked through in batches. The weights of a batch are found
+ * first, then each channel of the blended colour is found across the whole
+ * batch, held apart from the cells so that each loop works on packed bytes;
+ * only then are the colours and shades written into the cells.
+ */
+void GradientFillRow(const Gradient* gradient, i32 x, i32 y, i32 count,
+                     Cell* cells)
+{
+    u32 weights[GRADIENT_BATCH];
+    u8 r[GRADIENT_BATCH], g[GRADIENT_BATCH], b[GRADIENT_BATCH];
+    u8 a[GRADIENT_BATCH];
+    const u8 targets = gradient->targets;
+    const SDL_Color from = gradient->from;
+    const SDL_Color to = gradient->to;
+    const u8* bayer = GRADIENT_BAYER[y & 3];
+
+    for (i32 done = 0; done < count; done += GRADIENT_BATCH)
+    {
+        const i32 num = SDL_min(GRADIENT_BATCH, count - done);
+        Cell* batch = &cells[done];
+        if (gradient->type == GRADIENT_LINEAR)
+        {
+            GradientLinear(gradient, x + done, y, num, weights);
+        }
+        else
+        {
+            GradientRadial(gradient, x + done, y, num, weights);
+        }
+
+        if (targets & (GRADIENT_FG | GRADIENT_BG))
+        {
+            GradientBlend(from.r, to.r, weights, num, r);
+            GradientBlend(from.g, to.g, weights, num, g);
+            GradientBlend(from.b, to.b, weights, num, b);
+            GradientBlend(from.a, to.a, weights, num, a);
+        }
+
+        for (i32 i = 0; i < num; ++i)
+        {
+            if (targets & GRADIENT_SHADE)
+            {
+                const u32 level = weights[i] * 4;
+                const u32 threshold =
+                    bayer[(x + done + i) & 3] * (GRADIENT_ONE / 16) +
+                    GRADIENT_ONE / 32;
+                const u32 shade = (level >> 16) +
+                                  ((level & (GRADIENT_ONE - 1)) > threshold);
+                batch[i].index = GRADIENT_SHADES[SDL_min(shade, 4u)];
+                batch[i].fg = to;
+                batch[i].bg = from;
+            }
+
+            if (targets & GRADIENT_FG)
+            {
+                batch[i].fg = (SDL_Color){r[i], g[i], b[i], a[i]};
+            }
+
+            if (targets & GRADIENT_BG)
+            {
+                batch[i].bg = (SDL_Color){r[i], g[i], b[i], a[i]};
+            }
+        }
+    }
+}
+
+/**
+ * \desc Fills each row of the block in turn.
+ */
+void GradientFill(const Gradient* gradient, SDL_Rect rect, Cell* cells)
+{
+    for (i32 j = 0; j < rect.h; ++j)
+    {
+        GradientFillRow(gradient, rect.x, rect.y + j, rect.w,
+                        &cells[j * rect.w]);
+    }
+}
@@ -0,0 +1,236 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file recorder.c
+ *
+ * \brief A recorder captures every frame of a window to a video file, as
+ * YUV4MPEG2 or as raw RGBA. Frames are copied into a ring of buffers made up
+ * front and written out by a background thread, so that recording does not
+ * slow the frame rate. Should the writer fall behind, frames are dropped and
+ * counted rather than making the window wait.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "graphics/recorder.h"
+
+/**
+ * \desc Converts to BT.601 at studio range, which is what players assume of
+ * YUV4MPEG2, in fixed point.
+ */
+void RecorderConvert(const u8* frame, size_t num_pixels, u8* planes)
+{
+    u8* y = planes;
+    u8* u = planes + num_pixels;
+    u8* v = planes + 2 * num_pixels;
+
+    for (size_t i = 0; i < num_pixels; ++i)
+    {
+        const i32 r = frame[4 * i + 0];
+        const i32 g = frame[4 * i + 1];
+        const i32 b = frame[4 * i + 2];
+        y[i] = (u8)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        u[i] = (u8)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v[i] = (u8)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+}
+
+/**
+ * \desc Writes a frame in the format of the file. Once a write has failed no
+ * more are tried, though frames are still taken from the ring.
+ */
+static bool RecorderWriteFrame(Recorder* rec, const u8* frame)
+{
+    const size_t num_pixels = (size_t)rec->width * (size_t)rec->height;
+
+    if (rec->format == RECORDER_RGBA)
+    {
+        return fwrite(frame, 4, num_pixels, rec->file) == num_pixels;
+    }
+
+    RecorderConvert(frame, num_pixels, rec->planes);
+    return fputs("FRAME\n", rec->file) >= 0 &&
+           fwrite(rec->planes, 3, num_pixels, rec->file) == num_pixels;
+}
+
+/**
+ * \desc The writer takes frames from the tail of the ring, writing each
+ * without the lock so that the next can be captured meanwhile, and sleeps on
+ * the condition whilst the ring is empty. Once stopped, it writes whatever is
+ * left in the ring before finishing.
+ */
+static i32 RecorderRun(void* data)
+{
+    Recorder* rec = data;
+
+    SDL_LockMutex(rec->lock);
+    while (rec->running || rec->count > 0)
+    {
+        if (rec->count == 0)
+        {
+            SDL_CondWait(rec->wake, rec->lock);
+            continue;
+        }
+
+        const u8* frame = rec->frames[rec->tail];
+        const bool failed = rec->failed;
+        SDL_UnlockMutex(rec->lock);
+
+        const bool ok = failed || RecorderWriteFrame(rec, frame);
+
+        SDL_LockMutex(rec->lock);
+        if (!ok)
+        {
+            Log(LOG_ERROR, "Could not write recorded frame");
+        }
+        rec->failed = failed || !ok;
+        rec->tail = (rec->tail + 1) % RECORDER_SLOTS;
+        rec->count--;
+    }
+    SDL_UnlockMutex(rec->lock);
+
+    return 0;
+}
+
+/**
+ * \desc The size of the frames is that of the output of the renderer, which
+ * may be larger than the window on a high density display. Every buffer is
+ * allocated here, so that none is allocated whilst recording.
+ */
+[[nodiscard]] Recorder* RecorderCreate(const Window* wind, const char* path,
+                                       RecorderFormat format)
+{
+    i32 width = 0, height = 0;
+    if (SDL_GetRendererOutputSize(wind->sdl_renderer, &width, &height) != 0 ||
+        width <= 0 || height <= 0)
+    {
+        Log(LOG_ERROR, "Could not get the size of the window to record");
+        return NULL;
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        Log(LOG_ERROR, "Could not open recording %s for writing", path);
+        return NULL;
+    }
+
+    if (format == RECORDER_Y4M)
+    {
+        fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height,
+                RECORDER_FPS);
+    }
+
+    Recorder* rec = Allocate(sizeof(Recorder));
+    rec->file = file;
+    rec->format = format;
+    rec->width = width;
+    rec->height = height;
+    rec->head = 0;
+    rec->tail = 0;
+    rec->count = 0;
+    rec->captured = 0;
+    rec->dropped = 0;
+    rec->failed = false;
+    rec->running = true;
+
+    const size_t num_pixels = (size_t)width * (size_t)height;
+    for (size_t i = 0; i < RECORDER_SLOTS; ++i)
+    {
+        rec->frames[i] = Allocate(4 * num_pixels);
+    }
+    rec->planes = format == RECORDER_Y4M ? Allocate(3 * num_pixels) : NULL;
+
+    rec->lock = SDL_CreateMutex();
+    rec->wake = SDL_CreateCond();
+    if (rec->lock == NULL || rec->wake == NULL)
+    {
+        Log(LOG_FATAL, "Could not create recorder: %s", SDL_GetError());
+    }
+
+    rec->writer = SDL_CreateThread(RecorderRun, "recorder", rec);
+    if (rec->writer == NULL)
+    {
+        Log(LOG_FATAL, "Could not start recorder: %s", SDL_GetError());
+    }
+
+    return rec;
+}
+
+/**
+ * \desc Clears the running flag and waits for the writer to drain the ring,
+ * then reports how many frames were recorded and dropped.
+ */
+void RecorderFree(Recorder* rec)
+{
+    SDL_LockMutex(rec->lock);
+    rec->running = false;
+    SDL_CondSignal(rec->wake);
+    SDL_UnlockMutex(rec->lock);
+
+    SDL_WaitThread(rec->writer, NULL);
+
+    const bool ok = fclose(rec->file) == 0 && !rec->failed;
+    Log(ok ? LOG_NOTIFY : LOG_ERROR,
+        "Recorded %llu frames of %dx%d, dropping %llu",
+        (unsigned long long)rec->captured, rec->width, rec->height,
+        (unsigned long long)rec->dropped);
+
+    for (size_t i = 0; i < RECORDER_SLOTS; ++i)
+    {
+        Free(rec->frames[i]);
+    }
+    if (rec->planes)
+    {
+        Free(rec->planes);
+    }
+
+    SDL_DestroyCond(rec->wake);
+    SDL_DestroyMutex(rec->lock);
+    Free(rec);
+}
+
+/**
+ * \desc The slot at the head is read into without the lock, as the writer
+ * never touches a slot until it has been added to the ring. A frame is dropped
+ * when every slot is still waiting to be written, or when the window is no
+ * longer the size being recorded.
+ */
+void RecorderCapture(Recorder* rec, const Window* wind)
+{
+    i32 width = 0, height = 0;
+    SDL_GetRendererOutputSize(wind->sdl_renderer, &width, &height);
+
+    SDL_LockMutex(rec->lock);
+    const u32 slot = rec->head;
+    const bool drop = rec->count == RECORDER_SLOTS || width != rec->width ||
+                      height != rec->height;
+    rec->dropped += drop;
+    SDL_UnlockMutex(rec->lock);
+
+    if (drop)
+    {
+        return;
+    }
+
+    const bool ok =
+        SDL_RenderReadPixels(wind->sdl_renderer, NULL, SDL_PIXELFORMAT_RGBA32,
+                             rec->frames[slot], 4 * rec->width) == 0;
+
+    SDL_LockMutex(rec->lock);
+    if (ok)
+    {
+        rec->head = (rec->head + 1) % RECORDER_SLOTS;
+        rec->count++;
+        rec->captured++;
+        SDL_CondSignal(rec->wake);
+    }
+    else
+    {
+        rec->dropped++;
+    }
+    SDL_UnlockMutex(rec->lock);
+}
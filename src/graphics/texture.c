@@ -7,7 +7,8 @@
  *
  * \brief Textures hold a set of 16x16 glyphs that are used for most rendering.
  * The texture holds some data about the SDL_Texture it contains, such as glyph
- * width and height.
+ * width and height. Copies of it scaled up by whole factors may be made, so
+ * that glyphs are drawn larger without being scaled as they are drawn.
  *
  * \author Anthony Mercer
  *
@@ -76,6 +77,7 @@ bool TextureLoad(Texture* tex, const Window* wind, const char* path)
 
     SDL_FreeSurface(surf);
     SDL_SetTextureBlendMode(tex->sdl_texture, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureScaleMode(tex->sdl_texture, SDL_ScaleModeNearest);
 
     for (u32 i = 0; i < 256; ++i)
     {
@@ -86,4 +88,66 @@ bool TextureLoad(Texture* tex, const Window* wind, const char* path)
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+/**
+ * \desc The copy is made by rendering the texture into a target of the scaled
+ * size, once, without blending and untinted, so that every pixel is copied as
+ * it is. The texture is always sampled at the nearest pixel, so each pixel
+ * becomes a block of the factor squared. The glyph rectangles of the copy are
+ * those of the texture scaled by the factor, so that a glyph is drawn from it
+ * one to one. The previous render target is restored afterwards.
+ */
+[[nodiscard]] Texture* TextureScale(const Texture* tex, const Window* wind,
+                                    i32 scale)
+{
+    if (scale <= 1 || scale > TEXTURE_MAX_SCALE)
+    {
+        return NULL;
+    }
+
+    SDL_Texture* copy = SDL_CreateTexture(
+        wind->sdl_renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+        (i32)tex->width * scale, (i32)tex->height * scale);
+    if (copy == NULL)
+    {
+        Log(LOG_WARNING, "Could not scale texture by %d: %s", scale,
+            SDL_GetError());
+        return NULL;
+    }
+
+    u8 r = 0, g = 0, b = 0, a = 0;
+    SDL_Texture* target = SDL_GetRenderTarget(wind->sdl_renderer);
+    SDL_GetRenderDrawColor(wind->sdl_renderer, &r, &g, &b, &a);
+
+    SDL_SetRenderTarget(wind->sdl_renderer, copy);
+    SDL_SetRenderDrawColor(wind->sdl_renderer, 0, 0, 0, 0);
+    SDL_RenderClear(wind->sdl_renderer);
+
+    SDL_SetTextureColorMod(tex->sdl_texture, 255, 255, 255);
+    SDL_SetTextureAlphaMod(tex->sdl_texture, 255);
+    SDL_SetTextureBlendMode(tex->sdl_texture, SDL_BLENDMODE_NONE);
+    SDL_RenderCopy(wind->sdl_renderer, tex->sdl_texture, NULL, NULL);
+    SDL_SetTextureBlendMode(tex->sdl_texture, SDL_BLENDMODE_BLEND);
+
+    SDL_SetRenderTarget(wind->sdl_renderer, target);
+    SDL_SetRenderDrawColor(wind->sdl_renderer, r, g, b, a);
+    SDL_SetTextureBlendMode(copy, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureScaleMode(copy, SDL_ScaleModeNearest);
+
+    Texture* scaled = TextureCreate();
+    scaled->sdl_texture = copy;
+    scaled->width = tex->width * (u32)scale;
+    scaled->height = tex->height * (u32)scale;
+    scaled->glyph_w = tex->glyph_w * (u32)scale;
+    scaled->glyph_h = tex->glyph_h * (u32)scale;
+    for (u32 i = 0; i < 256; ++i)
+    {
+        scaled->rects[i].x = tex->rects[i].x * scale;
+        scaled->rects[i].y = tex->rects[i].y * scale;
+        scaled->rects[i].w = tex->rects[i].w * scale;
+        scaled->rects[i].h = tex->rects[i].h * scale;
+    }
+
+    return scaled;
+}
@@ -0,0 +1,298 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file thumbnail.c
+ *
+ * \brief A thumbnail is a small picture of a map, composited on the CPU from
+ * the colours of its cells so that it can be made on any thread. Thumbnails
+ * are cached on disk, so that a map is only read again once it changes.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "graphics/thumbnail.h"
+
+/**
+ * \desc The FNV-1a offset basis and prime for 64-bit hashes.
+ */
+#define THUMBNAIL_FNV_OFFSET 14695981039346656037ull
+#define THUMBNAIL_FNV_PRIME 1099511628211ull
+
+/**
+ * \desc The glyphs which draw nothing are nul, space and non-breaking space.
+ */
+[[nodiscard]] SDL_Color ThumbnailCellColor(Cell cell)
+{
+    const bool empty =
+        cell.index == 0 || cell.index == ' ' || cell.index == 255;
+    return empty ? cell.bg : cell.fg;
+}
+
+/**
+ * \desc Packs a colour in the format of the pixels.
+ */
+static u32 ThumbnailPack(u32 r, u32 g, u32 b, u32 a)
+{
+    return r << 24 | g << 16 | b << 8 | a;
+}
+
+/**
+ * \desc A map no larger than a thumbnail is scaled up by the largest whole
+ * factor which fits, each cell filling a square of pixels. A larger map is
+ * scaled down to fit, keeping its aspect ratio, and each pixel takes the mean
+ * colour of the cells it covers. The chunks are read one at a time without
+ * being made resident, so that compressed chunks stay compressed.
+ */
+bool ThumbnailRender(ChunkStore* store, Thumbnail* thumb)
+{
+    *thumb = (Thumbnail){0};
+
+    const i32 w = store->width;
+    const i32 h = store->height;
+    if (w <= 0 || h <= 0)
+    {
+        return false;
+    }
+
+    const bool up = w <= THUMBNAIL_SIZE && h <= THUMBNAIL_SIZE;
+    const i32 factor =
+        up ? SDL_min(THUMBNAIL_SIZE / w, THUMBNAIL_SIZE / h) : 1;
+    thumb->width = up ? w * factor
+                      : SDL_max((i32)((i64)w * THUMBNAIL_SIZE / SDL_max(w, h)),
+                                1);
+    thumb->height = up ? h * factor
+                       : SDL_max((i32)((i64)h * THUMBNAIL_SIZE / SDL_max(w, h)),
+                                 1);
+
+    const size_t num_pixels = (size_t)(thumb->width * thumb->height);
+    thumb->pixels = Allocate(sizeof(u32) * num_pixels);
+    u32* sums = up ? NULL : Allocate(sizeof(u32) * 4 * num_pixels);
+    u32* counts = up ? NULL : Allocate(sizeof(u32) * num_pixels);
+    Cell cells[CHUNK_CELLS];
+
+    for (i32 cy = 0; cy < store->chunks_h; ++cy)
+    {
+        for (i32 cx = 0; cx < store->chunks_w; ++cx)
+        {
+            ChunkStoreReadChunk(store, cx, cy, cells);
+            const i32 num_x = SDL_min(CHUNK_SIZE, w - cx * CHUNK_SIZE);
+            const i32 num_y = SDL_min(CHUNK_SIZE, h - cy * CHUNK_SIZE);
+
+            for (i32 j = 0; j < num_y; ++j)
+            {
+                for (i32 i = 0; i < num_x; ++i)
+                {
+                    const i32 x = cx * CHUNK_SIZE + i;
+                    const i32 y = cy * CHUNK_SIZE + j;
+                    const SDL_Color col =
+                        ThumbnailCellColor(cells[i + j * CHUNK_SIZE]);
+
+                    if (up)
+                    {
+                        const u32 pixel = ThumbnailPack(col.r, col.g, col.b,
+                                                        col.a);
+                        for (i32 fy = 0; fy < factor; ++fy)
+                        {
+                            u32* row = &thumb->pixels[x * factor +
+                                                      (y * factor + fy) *
+                                                          thumb->width];
+                            for (i32 fx = 0; fx < factor; ++fx)
+                            {
+                                row[fx] = pixel;
+                            }
+                        }
+                        continue;
+                    }
+
+                    const i32 px = (i32)((i64)x * thumb->width / w);
+                    const i32 py = (i32)((i64)y * thumb->height / h);
+                    const size_t p = (size_t)(px + py * thumb->width);
+                    sums[4 * p + 0] += col.r;
+                    sums[4 * p + 1] += col.g;
+                    sums[4 * p + 2] += col.b;
+                    sums[4 * p + 3] += col.a;
+                    counts[p]++;
+                }
+            }
+        }
+    }
+
+    if (!up)
+    {
+        for (size_t p = 0; p < num_pixels; ++p)
+        {
+            const u32 n = SDL_max(counts[p], 1);
+            thumb->pixels[p] =
+                ThumbnailPack(sums[4 * p + 0] / n, sums[4 * p + 1] / n,
+                              sums[4 * p + 2] / n, sums[4 * p + 3] / n);
+        }
+
+        Free(sums);
+        Free(counts);
+    }
+
+    return true;
+}
+
+/**
+ * \desc Names the cached thumbnail of a map by the hash of its path, so that
+ * a map which changes replaces its old thumbnail rather than adding another.
+ */
+static void ThumbnailCachePath(const char* path, const char* cache,
+                               char* dest, size_t size)
+{
+    u64 hash = THUMBNAIL_FNV_OFFSET;
+    for (const char* c = path; *c; ++c)
+    {
+        hash = (hash ^ (u8)*c) * THUMBNAIL_FNV_PRIME;
+    }
+
+    snprintf(dest, size, "%s/%016llx%s", cache, (unsigned long long)hash,
+             THUMBNAIL_EXTENSION);
+}
+
+/**
+ * \desc A cached thumbnail is only used if it was made from a map of the same
+ * size and modification time, and holds every pixel its header claims.
+ */
+static bool ThumbnailCacheRead(const char* path, i64 size, i64 mtime,
+                               Thumbnail* thumb)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    ThumbnailHeader header = {0};
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, THUMBNAIL_MAGIC, sizeof(header.magic)) ==
+                  0 &&
+              header.version == THUMBNAIL_VERSION && header.size == size &&
+              header.mtime == mtime && header.width > 0 &&
+              header.width <= THUMBNAIL_SIZE && header.height > 0 &&
+              header.height <= THUMBNAIL_SIZE;
+
+    if (ok)
+    {
+        const size_t num_pixels = (size_t)(header.width * header.height);
+        thumb->pixels = Allocate(sizeof(u32) * num_pixels);
+        thumb->width = header.width;
+        thumb->height = header.height;
+        ok = fread(thumb->pixels, sizeof(u32), num_pixels, file) ==
+             num_pixels;
+    }
+
+    fclose(file);
+
+    if (!ok)
+    {
+        ThumbnailClear(thumb);
+    }
+
+    return ok;
+}
+
+/**
+ * \desc The thumbnail is written to a temporary file of the calling thread
+ * which then replaces the cached one, so that a reader on another thread never
+ * sees a partly written thumbnail.
+ */
+static void ThumbnailCacheWrite(const char* path, i64 size, i64 mtime,
+                                const Thumbnail* thumb)
+{
+    char temp[THUMBNAIL_MAX_PATH + 32] = {0};
+    snprintf(temp, sizeof(temp), "%s.%lu.tmp", path,
+             (unsigned long)SDL_ThreadID());
+
+    FILE* file = fopen(temp, "wb");
+    if (file == NULL)
+    {
+        return;
+    }
+
+    ThumbnailHeader header = {0};
+    memcpy(header.magic, THUMBNAIL_MAGIC, sizeof(header.magic));
+    header.version = THUMBNAIL_VERSION;
+    header.size = size;
+    header.mtime = mtime;
+    header.width = thumb->width;
+    header.height = thumb->height;
+
+    const size_t num_pixels = (size_t)(thumb->width * thumb->height);
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(thumb->pixels, sizeof(u32), num_pixels, file) ==
+                  num_pixels;
+    ok = fclose(file) == 0 && ok;
+
+#if _WIN32
+    ok = ok && (remove(path) == 0 || !FileExists(path));
+#endif
+
+    if (!ok || rename(temp, path) != 0)
+    {
+        remove(temp);
+    }
+}
+
+/**
+ * \desc Only the header and pixels of a cached thumbnail are read, however
+ * large the map. A map without a cached thumbnail is read in full and pictured,
+ * and the thumbnail cached for next time; failing to cache it is not an error.
+ * A map within a pack is checked against the size and time of the pack, which
+ * only changes by being built again.
+ */
+bool ThumbnailFetch(const char* path, const char* cache, Thumbnail* thumb)
+{
+    *thumb = (Thumbnail){0};
+
+    char pack[PACK_MAX_PATH] = {0};
+    const char* name = NULL;
+    const char* file = PackSplitPath(path, pack, sizeof(pack), &name) ? pack
+                                                                     : path;
+
+    i64 size = 0, mtime = 0;
+    if (!FileStat(file, &size, &mtime))
+    {
+        return false;
+    }
+
+    char cached[THUMBNAIL_MAX_PATH] = {0};
+    ThumbnailCachePath(path, cache, cached, sizeof(cached));
+    if (ThumbnailCacheRead(cached, size, mtime, thumb))
+    {
+        return true;
+    }
+
+    ChunkStore* store = PackLoadMap(path);
+    if (store == NULL)
+    {
+        return false;
+    }
+
+    const bool ok = ThumbnailRender(store, thumb);
+    ChunkStoreFree(store);
+
+    if (ok)
+    {
+        ThumbnailCacheWrite(cached, size, mtime, thumb);
+    }
+
+    return ok;
+}
+
+/**
+ * \desc Frees the pixels, if there are any, and empties the thumbnail.
+ */
+void ThumbnailClear(Thumbnail* thumb)
+{
+    if (thumb->pixels)
+    {
+        Free(thumb->pixels);
+    }
+
+    *thumb = (Thumbnail){0};
+}
@@ -0,0 +1,606 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file tileatlas.c
+ *
+ * \brief A tile atlas holds only the tiles a map uses, for runtimes which
+ * cannot spare the memory for a whole tileset. Each tile is a glyph already
+ * drawn in its colours over its background, trimmed to the pixels it covers
+ * and packed into a single image along with the rest. The map is exported
+ * beside the image with each cell holding the index of its tile.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "graphics/tileatlas.h"
+
+/**
+ * \brief The pixels of a tileset, and the bounds of each glyph measured so
+ * far.
+ */
+typedef struct
+{
+    u8* pixels;           /**< RGBA pixels, with magenta made clear. */
+    i32 width;            /**< Width of the tileset in pixels. */
+    i32 glyph_w;          /**< Width of a glyph in pixels. */
+    i32 glyph_h;          /**< Height of a glyph in pixels. */
+    u32 measured[8];      /**< Bitset of the glyphs measured. */
+    SDL_Rect bounds[256]; /**< Pixels each measured glyph covers. */
+} TileAtlasGlyphs;
+
+/**
+ * \brief The distinct tiles of a map, found through an open addressed table
+ * of their indices.
+ */
+typedef struct
+{
+    Cell* keys;           /**< The cell drawn by each tile. */
+    TileAtlasTile* tiles; /**< Where each tile lies, once packed. */
+    size_t count;         /**< Number of tiles. */
+    size_t capacity;      /**< Number of tiles allocated. */
+    u32* slots;           /**< Index of a tile plus one, or zero if empty. */
+    size_t num_slots;     /**< Number of slots, a power of two. */
+} TileAtlasSet;
+
+/**
+ * \desc Reads the tileset as RGBA, turning magenta clear as its texture does.
+ */
+static bool TileAtlasLoadGlyphs(TileAtlasGlyphs* glyphs, const char* path)
+{
+    SDL_Surface* surf = IMG_Load(path);
+    if (surf == NULL)
+    {
+        Log(LOG_ERROR, "Could not load tileset %s", path);
+        return false;
+    }
+
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_RGBA32,
+                                                 0);
+    SDL_FreeSurface(surf);
+    if (rgba == NULL || rgba->w % 16 != 0 || rgba->h % 16 != 0)
+    {
+        Log(LOG_ERROR, "Incorrect tileset dimensions for %s", path);
+        if (rgba)
+        {
+            SDL_FreeSurface(rgba);
+        }
+        return false;
+    }
+
+    glyphs->width = rgba->w;
+    glyphs->glyph_w = rgba->w / 16;
+    glyphs->glyph_h = rgba->h / 16;
+    glyphs->pixels = Allocate((size_t)rgba->w * (size_t)rgba->h * 4);
+
+    for (i32 y = 0; y < rgba->h; ++y)
+    {
+        u8* row = &glyphs->pixels[(size_t)y * (size_t)rgba->w * 4];
+        memcpy(row, (const u8*)rgba->pixels + (size_t)y * (size_t)rgba->pitch,
+               (size_t)rgba->w * 4);
+
+        for (i32 x = 0; x < rgba->w; ++x)
+        {
+            u8* pixel = &row[x * 4];
+            if (pixel[0] == 255 && pixel[1] == 0 && pixel[2] == 255)
+            {
+                pixel[3] = 0;
+            }
+        }
+    }
+
+    SDL_FreeSurface(rgba);
+    return true;
+}
+
+/**
+ * \desc Measures a glyph the first time it is used, so that only the glyphs
+ * a map uses are ever scanned.
+ */
+static SDL_Rect TileAtlasBounds(TileAtlasGlyphs* glyphs, u8 index)
+{
+    if (glyphs->measured[index >> 5] & 1u << (index & 31))
+    {
+        return glyphs->bounds[index];
+    }
+
+    const i32 left = (index % 16) * glyphs->glyph_w;
+    const i32 top = (index / 16) * glyphs->glyph_h;
+    i32 x0 = glyphs->glyph_w;
+    i32 y0 = glyphs->glyph_h;
+    i32 x1 = 0;
+    i32 y1 = 0;
+
+    for (i32 y = 0; y < glyphs->glyph_h; ++y)
+    {
+        const u8* row =
+            &glyphs->pixels[((size_t)(top + y) * (size_t)glyphs->width +
+                             (size_t)left) * 4];
+        for (i32 x = 0; x < glyphs->glyph_w; ++x)
+        {
+            if (row[x * 4 + 3])
+            {
+                x0 = SDL_min(x0, x);
+                y0 = SDL_min(y0, y);
+                x1 = SDL_max(x1, x + 1);
+                y1 = SDL_max(y1, y + 1);
+            }
+        }
+    }
+
+    const SDL_Rect bounds = x0 < x1 ? (SDL_Rect){x0, y0, x1 - x0, y1 - y0}
+                                    : (SDL_Rect){0};
+    glyphs->measured[index >> 5] |= 1u << (index & 31);
+    glyphs->bounds[index] = bounds;
+    return bounds;
+}
+
+/**
+ * \desc The parts of a cell which draw nothing are cleared, so that cells
+ * which look the same share a tile, and a cell which draws nothing at all
+ * becomes the empty tile.
+ */
+static Cell TileAtlasKey(TileAtlasGlyphs* glyphs, Cell cell)
+{
+    if (cell.fg.a == 0 || TileAtlasBounds(glyphs, cell.index).w == 0)
+    {
+        cell.index = 0;
+        cell.fg = (SDL_Color){0};
+    }
+
+    if (cell.bg.a == 0 || TileAtlasBounds(glyphs, FILLED).w == 0)
+    {
+        cell.bg = (SDL_Color){0};
+    }
+
+    return cell;
+}
+
+/**
+ * \desc Two cells make the same tile only if their glyphs match and both
+ * colours match in every channel, alpha included.
+ */
+static bool TileAtlasSameKey(Cell a, Cell b)
+{
+    return a.index == b.index && a.fg.r == b.fg.r && a.fg.g == b.fg.g &&
+           a.fg.b == b.fg.b && a.fg.a == b.fg.a && a.bg.r == b.bg.r &&
+           a.bg.g == b.bg.g && a.bg.b == b.bg.b && a.bg.a == b.bg.a;
+}
+
+/**
+ * \desc Mixes the glyph and each colour, packed into a word, by a different
+ * odd multiplier, then folds the high bits down, as the slot is taken from the
+ * low bits of the hash.
+ */
+static u32 TileAtlasHash(Cell key)
+{
+    u32 hash = key.index * 0x9E3779B1u;
+    hash ^= ((u32)key.fg.r << 24 | (u32)key.fg.g << 16 | (u32)key.fg.b << 8 |
+             key.fg.a) * 0x85EBCA77u;
+    hash ^= ((u32)key.bg.r << 24 | (u32)key.bg.g << 16 | (u32)key.bg.b << 8 |
+             key.bg.a) * 0xC2B2AE3Du;
+    return hash ^ hash >> 15;
+}
+
+/**
+ * \desc Doubles the table and places every tile again.
+ */
+static void TileAtlasGrowSlots(TileAtlasSet* set)
+{
+    Free(set->slots);
+    set->num_slots <<= 1;
+    set->slots = Allocate(sizeof(u32) * set->num_slots);
+
+    for (size_t i = 0; i < set->count; ++i)
+    {
+        size_t slot = TileAtlasHash(set->keys[i]) & (set->num_slots - 1);
+        while (set->slots[slot])
+        {
+            slot = (slot + 1) & (set->num_slots - 1);
+        }
+        set->slots[slot] = (u32)i + 1;
+    }
+}
+
+/**
+ * \desc Finds the tile of a key, adding it if it is new. The table is kept at
+ * most half full.
+ * \returns The index of the tile, or TILEATLAS_MAX_TILES if there is no room
+ * for another.
+ */
+static size_t TileAtlasFind(TileAtlasSet* set, Cell key)
+{
+    size_t slot = TileAtlasHash(key) & (set->num_slots - 1);
+    while (set->slots[slot])
+    {
+        const size_t tile = set->slots[slot] - 1;
+        if (TileAtlasSameKey(set->keys[tile], key))
+        {
+            return tile;
+        }
+        slot = (slot + 1) & (set->num_slots - 1);
+    }
+
+    if (set->count == TILEATLAS_MAX_TILES)
+    {
+        return TILEATLAS_MAX_TILES;
+    }
+
+    if (set->count == set->capacity)
+    {
+        set->capacity = set->capacity ? set->capacity << 1 : 256;
+        set->keys = Reallocate(set->keys, sizeof(Cell) * set->capacity);
+    }
+
+    set->keys[set->count] = key;
+    set->slots[slot] = (u32)++set->count;
+    if (set->count * 2 > set->num_slots)
+    {
+        TileAtlasGrowSlots(set);
+    }
+
+    return set->count - 1;
+}
+
+/**
+ * \desc Finds the tile of every cell in a single pass, a chunk at a time
+ * without making any of them resident.
+ */
+static bool TileAtlasFindTiles(ChunkStore* store, TileAtlasGlyphs* glyphs,
+                               TileAtlasSet* set, u16* cells)
+{
+    Cell* chunk = Allocate(sizeof(Cell) * CHUNK_CELLS);
+    bool ok = true;
+
+    for (i32 cy = 0; cy < store->chunks_h && ok; ++cy)
+    {
+        for (i32 cx = 0; cx < store->chunks_w && ok; ++cx)
+        {
+            ChunkStoreReadChunk(store, cx, cy, chunk);
+
+            const i32 x0 = cx * CHUNK_SIZE;
+            const i32 y0 = cy * CHUNK_SIZE;
+            const i32 num_x = SDL_min(CHUNK_SIZE, store->width - x0);
+            const i32 num_y = SDL_min(CHUNK_SIZE, store->height - y0);
+            for (i32 y = 0; y < num_y && ok; ++y)
+            {
+                for (i32 x = 0; x < num_x; ++x)
+                {
+                    const Cell key =
+                        TileAtlasKey(glyphs, chunk[x + y * CHUNK_SIZE]);
+                    const size_t tile = TileAtlasFind(set, key);
+                    if (tile == TILEATLAS_MAX_TILES)
+                    {
+                        ok = false;
+                        break;
+                    }
+                    cells[(size_t)(y0 + y) * (size_t)store->width +
+                          (size_t)(x0 + x)] = (u16)tile;
+                }
+            }
+        }
+    }
+
+    Free(chunk);
+    return ok;
+}
+
+/**
+ * \desc Trims each tile to the pixels its background and glyph cover. The
+ * empty tile covers none.
+ */
+static void TileAtlasTrim(TileAtlasGlyphs* glyphs, TileAtlasSet* set)
+{
+    set->tiles = Allocate(sizeof(TileAtlasTile) * SDL_max(set->count, 1));
+
+    for (size_t i = 1; i < set->count; ++i)
+    {
+        const Cell key = set->keys[i];
+        SDL_Rect bounds = {0};
+        if (key.bg.a)
+        {
+            bounds = TileAtlasBounds(glyphs, FILLED);
+        }
+        if (key.fg.a)
+        {
+            const SDL_Rect glyph = TileAtlasBounds(glyphs, key.index);
+            if (bounds.w == 0)
+            {
+                bounds = glyph;
+            }
+            else
+            {
+                SDL_UnionRect(&bounds, &glyph, &bounds);
+            }
+        }
+
+        set->tiles[i] = (TileAtlasTile){0, 0, (u16)bounds.w, (u16)bounds.h,
+                                        (u16)bounds.x, (u16)bounds.y};
+    }
+}
+
+/**
+ * \desc Orders tiles from the tallest down, and then from the widest, so that
+ * each shelf is filled with tiles of much the same height.
+ */
+static int TileAtlasSort(const void* a, const void* b)
+{
+    const TileAtlasTile* ta = *(const TileAtlasTile* const*)a;
+    const TileAtlasTile* tb = *(const TileAtlasTile* const*)b;
+    if (ta->h != tb->h)
+    {
+        return tb->h - ta->h;
+    }
+    if (ta->w != tb->w)
+    {
+        return tb->w - ta->w;
+    }
+    return ta < tb ? -1 : (ta > tb);
+}
+
+/**
+ * \desc Packs the tiles onto shelves, each as tall as its first tile, across
+ * an atlas about as wide as it is tall. As the tiles are all much the same
+ * size, little is wasted, and the atlas is only as tall as the shelves.
+ * \returns Whether the atlas fits the positions of its tiles.
+ */
+static bool TileAtlasPack(TileAtlasSet* set, u32* atlas_w, u32* atlas_h)
+{
+    TileAtlasTile** order =
+        Allocate(sizeof(TileAtlasTile*) * SDL_max(set->count, 1));
+    size_t num_order = 0;
+    u64 area = 0;
+    i32 widest = 1;
+    for (size_t i = 1; i < set->count; ++i)
+    {
+        TileAtlasTile* tile = &set->tiles[i];
+        if (tile->w && tile->h)
+        {
+            order[num_order++] = tile;
+            area += (u64)tile->w * tile->h;
+            widest = SDL_max(widest, tile->w);
+        }
+    }
+
+    qsort(order, num_order, sizeof(TileAtlasTile*), &TileAtlasSort);
+
+    const i32 width = SDL_max(widest, (i32)ceil(sqrt((f64)area)));
+    i32 x = 0;
+    i32 y = 0;
+    i32 shelf = 0;
+    for (size_t i = 0; i < num_order; ++i)
+    {
+        TileAtlasTile* tile = order[i];
+        if (x + tile->w > width)
+        {
+            x = 0;
+            y += shelf;
+            shelf = 0;
+        }
+
+        tile->x = (u16)SDL_min(x, 65535);
+        tile->y = (u16)SDL_min(y, 65535);
+        x += tile->w;
+        shelf = SDL_max(shelf, tile->h);
+    }
+
+    Free(order);
+
+    *atlas_w = (u32)width;
+    *atlas_h = (u32)SDL_max(y + shelf, 1);
+    return *atlas_w <= 65535 && *atlas_h <= 65535;
+}
+
+/**
+ * \desc Blends a pixel of the tileset, tinted by a colour as its texture is,
+ * over a pixel of the atlas. The atlas is not premultiplied, so that it blends
+ * over whatever it is drawn onto as the tileset would.
+ */
+static void TileAtlasBlend(u8* dest, const u8* src, SDL_Color tint)
+{
+    const u32 sa = (u32)src[3] * tint.a / 255;
+    if (sa == 0)
+    {
+        return;
+    }
+
+    const u32 da = (u32)dest[3] * (255 - sa) / 255;
+    const u32 out = sa + da;
+    const u8 channels[3] = {tint.r, tint.g, tint.b};
+    for (i32 c = 0; c < 3; ++c)
+    {
+        const u32 s = (u32)src[c] * channels[c] / 255;
+        dest[c] = (u8)((s * sa + (u32)dest[c] * da + out / 2) / out);
+    }
+    dest[3] = (u8)out;
+}
+
+/**
+ * \desc Draws each tile into its place in the atlas, background first, as a
+ * glyph is drawn onto a canvas.
+ */
+static void TileAtlasDraw(const TileAtlasGlyphs* glyphs,
+                          const TileAtlasSet* set, u8* atlas, u32 atlas_w)
+{
+    for (size_t i = 1; i < set->count; ++i)
+    {
+        const Cell key = set->keys[i];
+        const TileAtlasTile* tile = &set->tiles[i];
+        const u8 layers[2] = {FILLED, key.index};
+        const SDL_Color tints[2] = {key.bg, key.fg};
+
+        for (i32 layer = 0; layer < 2; ++layer)
+        {
+            if (tints[layer].a == 0)
+            {
+                continue;
+            }
+
+            const i32 left = (layers[layer] % 16) * glyphs->glyph_w + tile->ox;
+            const i32 top = (layers[layer] / 16) * glyphs->glyph_h + tile->oy;
+            for (i32 y = 0; y < tile->h; ++y)
+            {
+                const u8* src = &glyphs->pixels[((size_t)(top + y) *
+                                                     (size_t)glyphs->width +
+                                                 (size_t)left) * 4];
+                u8* dest = &atlas[((size_t)(tile->y + y) * atlas_w +
+                                   tile->x) * 4];
+                for (i32 x = 0; x < tile->w; ++x)
+                {
+                    TileAtlasBlend(&dest[x * 4], &src[x * 4], tints[layer]);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * \desc The atlas image is written as a PNG through a surface of its pixels.
+ */
+static bool TileAtlasSaveImage(const u8* atlas, u32 atlas_w, u32 atlas_h,
+                               const char* path)
+{
+    SDL_Surface* surf = SDL_CreateRGBSurfaceWithFormat(
+        0, (i32)atlas_w, (i32)atlas_h, 32, SDL_PIXELFORMAT_RGBA32);
+    if (surf == NULL)
+    {
+        Log(LOG_ERROR, "Could not create the surface of atlas %s", path);
+        return false;
+    }
+
+    for (u32 y = 0; y < atlas_h; ++y)
+    {
+        memcpy((u8*)surf->pixels + (size_t)y * (size_t)surf->pitch,
+               &atlas[(size_t)y * atlas_w * 4], (size_t)atlas_w * 4);
+    }
+
+    const bool ok = IMG_SavePNG(surf, path) == 0;
+    SDL_FreeSurface(surf);
+    if (!ok)
+    {
+        Log(LOG_ERROR, "Could not write atlas %s", path);
+    }
+    return ok;
+}
+
+/**
+ * \desc Writes the header, then where each tile lies in the atlas and within
+ * its cell, then the tile of each cell in row-major order, logging should any
+ * write fail.
+ */
+static bool TileAtlasSaveMap(const TileAtlasHeader* header,
+                             const TileAtlasTile* tiles, const u16* cells,
+                             const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        Log(LOG_ERROR, "Could not open tile map %s for writing", path);
+        return false;
+    }
+
+    const size_t num_cells = (size_t)header->width * (size_t)header->height;
+    bool ok = fwrite(header, sizeof(*header), 1, file) == 1 &&
+              fwrite(tiles, sizeof(TileAtlasTile), header->num_tiles, file) ==
+                  header->num_tiles &&
+              fwrite(cells, sizeof(u16), num_cells, file) == num_cells;
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok)
+    {
+        Log(LOG_ERROR, "Could not write tile map %s", path);
+    }
+    return ok;
+}
+
+/**
+ * \desc The tiles are found in a single pass over the map, during which each
+ * glyph used is measured the first time it is met. They are then trimmed,
+ * packed and drawn, and the atlas is written beside the tile map.
+ */
+bool TileAtlasExport(ChunkStore* store, const char* tileset, const char* path)
+{
+    char image[512] = {0};
+    const char* slash = strrchr(path, '/');
+    const char* ext = strrchr(slash ? slash : path, '.');
+    const i32 stem = ext ? (i32)(ext - path) : (i32)strlen(path);
+    const i32 length = snprintf(image, sizeof(image), "%.*s%s", stem, path,
+                                TILEATLAS_IMAGE_EXTENSION);
+    if (length < 0 || (size_t)length >= sizeof(image))
+    {
+        Log(LOG_ERROR, "The path of %s is too long", path);
+        return false;
+    }
+
+    TileAtlasGlyphs glyphs = {0};
+    if (!TileAtlasLoadGlyphs(&glyphs, tileset))
+    {
+        return false;
+    }
+
+    TileAtlasSet set = {0};
+    set.num_slots = 512;
+    set.slots = Allocate(sizeof(u32) * set.num_slots);
+    TileAtlasFind(&set, (Cell){0});
+
+    const size_t num_cells = (size_t)store->width * (size_t)store->height;
+    u16* cells = Allocate(sizeof(u16) * SDL_max(num_cells, (size_t)1));
+    bool ok = TileAtlasFindTiles(store, &glyphs, &set, cells);
+    if (!ok)
+    {
+        Log(LOG_ERROR, "%s uses more than %d tiles", path,
+            TILEATLAS_MAX_TILES);
+    }
+
+    TileAtlasHeader header = {0};
+    if (ok)
+    {
+        TileAtlasTrim(&glyphs, &set);
+        ok = TileAtlasPack(&set, &header.atlas_w, &header.atlas_h);
+        if (!ok)
+        {
+            Log(LOG_ERROR, "The atlas of %s is too large", path);
+        }
+    }
+
+    if (ok)
+    {
+        u8* atlas =
+            Allocate((size_t)header.atlas_w * (size_t)header.atlas_h * 4);
+        TileAtlasDraw(&glyphs, &set, atlas, header.atlas_w);
+
+        memcpy(header.magic, TILEATLAS_MAGIC, sizeof(header.magic));
+        header.version = TILEATLAS_VERSION;
+        header.width = store->width;
+        header.height = store->height;
+        header.tile_w = (u32)glyphs.glyph_w;
+        header.tile_h = (u32)glyphs.glyph_h;
+        header.num_tiles = (u32)set.count;
+        ok = TileAtlasSaveImage(atlas, header.atlas_w, header.atlas_h,
+                                image) &&
+             TileAtlasSaveMap(&header, set.tiles, cells, path);
+        Free(atlas);
+    }
+
+    if (ok)
+    {
+        Log(LOG_NOTIFY, "Exported %s with %u tiles in a %ux%u atlas", path,
+            header.num_tiles, header.atlas_w, header.atlas_h);
+    }
+
+    if (set.tiles)
+    {
+        Free(set.tiles);
+    }
+    if (set.keys)
+    {
+        Free(set.keys);
+    }
+    Free(set.slots);
+    Free(cells);
+    Free(glyphs.pixels);
+
+    return ok;
+}
@@ -0,0 +1,475 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file timelapse.c
+ *
+ * \brief A timelapse replays the journal of a document into a video of the
+ * session, without a window. Each frame is composited on the CPU from the
+ * colours of the cells, in the manner of a thumbnail, and only the cells which
+ * changed since the frame before are drawn again. Frames are encoded in
+ * batches on a thread for each processor. A timelapse may be rendered in the
+ * background from a copy of the journal, whilst the session goes on.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "graphics/timelapse.h"
+
+/**
+ * \brief A timelapse being rendered: the cells as replayed so far, the frame
+ * composited from them, and the batch of frames waiting to be encoded, which
+ * the workers take in turn.
+ */
+typedef struct
+{
+    ChunkStore* cells;
+    RecorderFormat format;
+    FILE* file;
+    i32 scale;
+    i32 stride;
+    i32 width;
+    i32 height;
+    u8* pixels;
+    bool* dirty;
+    size_t* marked;
+    size_t num_marked;
+    bool redraw;
+    u8* frames[TIMELAPSE_BATCH];
+    u8* planes[TIMELAPSE_BATCH];
+    size_t num_frames;
+    SDL_atomic_t next;
+    bool ok;
+} Timelapse;
+
+/**
+ * \desc Finds the largest size the canvas had over the session, which is the
+ * size every frame must hold, by following the transforms and resizes.
+ */
+static void TimelapseMeasure(const Journal* journal, i32* width, i32* height)
+{
+    i32 w = journal->start->width;
+    i32 h = journal->start->height;
+    *width = w;
+    *height = h;
+
+    for (size_t i = 0; i < journal->count; ++i)
+    {
+        const JournalOp* op = &journal->ops[i];
+        if (op->kind == JOURNAL_TRANSFORM)
+        {
+            TransformSize(op->transform, w, h, &w, &h);
+        }
+        else if (op->kind == JOURNAL_RESIZE)
+        {
+            w = op->rect.w;
+            h = op->rect.h;
+        }
+        *width = SDL_max(*width, w);
+        *height = SDL_max(*height, h);
+    }
+}
+
+/**
+ * \desc Finds the time of each operation with every pause cut short to the
+ * longest played, which is how far into the session it falls.
+ */
+static u64 TimelapseActiveTime(const Journal* journal, size_t index, u64 active)
+{
+    const u32 prev = index ? journal->ops[index - 1].time : 0;
+    return active + SDL_min(journal->ops[index].time - prev, TIMELAPSE_IDLE);
+}
+
+/**
+ * \desc Fills the square of pixels of a cell, if the cell is one of those
+ * sampled.
+ */
+static void TimelapseDrawCell(Timelapse* tl, i32 x, i32 y, SDL_Color col)
+{
+    if (x % tl->stride || y % tl->stride)
+    {
+        return;
+    }
+
+    const i32 px = x / tl->stride * tl->scale;
+    const i32 py = y / tl->stride * tl->scale;
+    for (i32 j = 0; j < tl->scale; ++j)
+    {
+        u8* row = &tl->pixels[4 * ((size_t)px + (size_t)(py + j) * tl->width)];
+        for (i32 i = 0; i < tl->scale; ++i)
+        {
+            row[4 * i + 0] = col.r;
+            row[4 * i + 1] = col.g;
+            row[4 * i + 2] = col.b;
+            row[4 * i + 3] = 255;
+        }
+    }
+}
+
+/**
+ * \desc After a transform or resize, the frame is cleared to black, so that the
+ * area outside of a smaller canvas is empty, and every cell is drawn again. The
+ * chunks are read one at a time without being made resident. Otherwise only the
+ * cells marked since the last frame are drawn.
+ */
+static void TimelapseComposite(Timelapse* tl)
+{
+    ChunkStore* store = tl->cells;
+
+    if (!tl->redraw)
+    {
+        for (size_t i = 0; i < tl->num_marked; ++i)
+        {
+            const i32 x = (i32)(tl->marked[i] % (size_t)store->width);
+            const i32 y = (i32)(tl->marked[i] / (size_t)store->width);
+            tl->dirty[tl->marked[i]] = false;
+            TimelapseDrawCell(tl, x, y,
+                              ThumbnailCellColor(ChunkStoreGet(store, x, y)));
+        }
+        tl->num_marked = 0;
+        return;
+    }
+
+    const size_t num_pixels = (size_t)tl->width * (size_t)tl->height;
+    for (size_t p = 0; p < num_pixels; ++p)
+    {
+        memcpy(&tl->pixels[4 * p], (u8[4]){0, 0, 0, 255}, 4);
+    }
+
+    Cell cells[CHUNK_CELLS];
+    for (i32 cy = 0; cy < store->chunks_h; ++cy)
+    {
+        for (i32 cx = 0; cx < store->chunks_w; ++cx)
+        {
+            ChunkStoreReadChunk(store, cx, cy, cells);
+            const i32 num_x =
+                SDL_min(CHUNK_SIZE, store->width - cx * CHUNK_SIZE);
+            const i32 num_y =
+                SDL_min(CHUNK_SIZE, store->height - cy * CHUNK_SIZE);
+
+            for (i32 j = 0; j < num_y; ++j)
+            {
+                for (i32 i = 0; i < num_x; ++i)
+                {
+                    TimelapseDrawCell(
+                        tl, cx * CHUNK_SIZE + i, cy * CHUNK_SIZE + j,
+                        ThumbnailCellColor(cells[i + j * CHUNK_SIZE]));
+                }
+            }
+        }
+    }
+
+    tl->redraw = false;
+}
+
+/**
+ * \desc The marks are sized to the cells, so they are made again whenever the
+ * shape of the cells changes, which also redraws the whole frame.
+ */
+static void TimelapseReshape(Timelapse* tl)
+{
+    const size_t num_cells =
+        (size_t)tl->cells->width * (size_t)tl->cells->height;
+
+    if (tl->dirty)
+    {
+        Free(tl->dirty);
+        Free(tl->marked);
+    }
+    tl->dirty = Allocate(sizeof(bool) * SDL_max(num_cells, (size_t)1));
+    tl->marked = Allocate(sizeof(size_t) * SDL_max(num_cells, (size_t)1));
+    tl->num_marked = 0;
+    tl->redraw = true;
+}
+
+/**
+ * \desc Applies an operation to the cells as they were when it was made. An
+ * edit marks its cell, once, to be drawn into the next frame.
+ */
+static void TimelapseApply(Timelapse* tl, const JournalOp* op)
+{
+    ChunkStore* store = tl->cells;
+    JournalApply(store, op);
+
+    if (op->kind != JOURNAL_EDIT)
+    {
+        TimelapseReshape(tl);
+        return;
+    }
+
+    const size_t index = op->edit.index;
+    if (index >= (size_t)store->width * (size_t)store->height)
+    {
+        return;
+    }
+
+    if (!tl->redraw && !tl->dirty[index])
+    {
+        tl->dirty[index] = true;
+        tl->marked[tl->num_marked++] = index;
+    }
+}
+
+/**
+ * \desc Converts the frames of the batch in turn, until none are left.
+ */
+static i32 TimelapseRunEncode(void* data)
+{
+    Timelapse* tl = data;
+    const size_t num_pixels = (size_t)tl->width * (size_t)tl->height;
+    for (size_t i = (size_t)SDL_AtomicAdd(&tl->next, 1); i < tl->num_frames;
+         i = (size_t)SDL_AtomicAdd(&tl->next, 1))
+    {
+        RecorderConvert(tl->frames[i], num_pixels, tl->planes[i]);
+    }
+
+    return 0;
+}
+
+/**
+ * \desc Raw frames need no encoding. Frames of YUV4MPEG2 are converted on a
+ * thread for each processor, with the calling thread working alongside them so
+ * that the work is still done should no thread start, and then written in
+ * order.
+ */
+static void TimelapseFlush(Timelapse* tl)
+{
+    const size_t num_pixels = (size_t)tl->width * (size_t)tl->height;
+
+    if (tl->format == RECORDER_Y4M)
+    {
+        const i32 num_workers = SDL_min(
+            SDL_min(SDL_max(SDL_GetCPUCount(), 1), TIMELAPSE_WORKERS),
+            (i32)tl->num_frames - 1);
+        SDL_Thread* workers[TIMELAPSE_WORKERS] = {0};
+        SDL_AtomicSet(&tl->next, 0);
+
+        for (i32 i = 0; i < num_workers; ++i)
+        {
+            workers[i] = SDL_CreateThread(TimelapseRunEncode, "timelapse", tl);
+        }
+
+        TimelapseRunEncode(tl);
+
+        for (i32 i = 0; i < num_workers; ++i)
+        {
+            if (workers[i])
+            {
+                SDL_WaitThread(workers[i], NULL);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < tl->num_frames && tl->ok; ++i)
+    {
+        if (tl->format == RECORDER_RGBA)
+        {
+            tl->ok = fwrite(tl->frames[i], 4, num_pixels, tl->file) ==
+                     num_pixels;
+            continue;
+        }
+
+        tl->ok = fputs("FRAME\n", tl->file) >= 0 &&
+                 fwrite(tl->planes[i], 3, num_pixels, tl->file) == num_pixels;
+    }
+
+    tl->num_frames = 0;
+}
+
+/**
+ * \desc Composites the cells into the frame and copies it into the batch,
+ * which is encoded and written once it is full.
+ */
+static void TimelapseEmit(Timelapse* tl)
+{
+    TimelapseComposite(tl);
+
+    const size_t size = 4 * (size_t)tl->width * (size_t)tl->height;
+    memcpy(tl->frames[tl->num_frames++], tl->pixels, size);
+    if (tl->num_frames == TIMELAPSE_BATCH)
+    {
+        TimelapseFlush(tl);
+    }
+}
+
+/**
+ * \desc The session is played at its own pace with every pause cut short, in
+ * frames of equal time, but sped up to fit in the most frames allowed. The
+ * first frame shows the cells as they were when the journal was started, and
+ * the last is held. Every buffer is allocated up front.
+ */
+bool TimelapseRender(const Journal* journal, const char* path,
+                     RecorderFormat format)
+{
+    if (journal->start == NULL)
+    {
+        return false;
+    }
+
+    const u32 began = SDL_GetTicks();
+
+    i32 max_w = 0, max_h = 0;
+    TimelapseMeasure(journal, &max_w, &max_h);
+    if (max_w <= 0 || max_h <= 0)
+    {
+        return false;
+    }
+
+    Timelapse tl = {0};
+    tl.format = format;
+    tl.stride = SDL_max((max_w + TIMELAPSE_WIDTH - 1) / TIMELAPSE_WIDTH,
+                        (max_h + TIMELAPSE_HEIGHT - 1) / TIMELAPSE_HEIGHT);
+    tl.scale = SDL_max(
+        SDL_min(TIMELAPSE_WIDTH / max_w, TIMELAPSE_HEIGHT / max_h), 1);
+    tl.width = (max_w + tl.stride - 1) / tl.stride * tl.scale;
+    tl.height = (max_h + tl.stride - 1) / tl.stride * tl.scale;
+    tl.ok = true;
+
+    tl.file = fopen(path, "wb");
+    if (tl.file == NULL)
+    {
+        Log(LOG_ERROR, "Could not open timelapse %s for writing", path);
+        return false;
+    }
+
+    if (format == RECORDER_Y4M)
+    {
+        fprintf(tl.file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", tl.width,
+                tl.height, TIMELAPSE_FPS);
+    }
+
+    const size_t num_pixels = (size_t)tl.width * (size_t)tl.height;
+    tl.pixels = Allocate(4 * num_pixels);
+    for (size_t i = 0; i < TIMELAPSE_BATCH; ++i)
+    {
+        tl.frames[i] = Allocate(4 * num_pixels);
+        tl.planes[i] = format == RECORDER_Y4M ? Allocate(3 * num_pixels) : NULL;
+    }
+
+    tl.cells = ChunkStoreClone(journal->start);
+    TimelapseReshape(&tl);
+    TimelapseEmit(&tl);
+
+    u64 total = 0;
+    for (size_t i = 0; i < journal->count; ++i)
+    {
+        total = TimelapseActiveTime(journal, i, total);
+    }
+
+    const u64 num_frames =
+        SDL_max(SDL_min((total * TIMELAPSE_FPS + 999) / 1000,
+                        (u64)TIMELAPSE_MAX_FRAMES),
+                (u64)1);
+
+    size_t op = 0;
+    u64 active = 0;
+    for (u64 frame = 1; frame <= num_frames && tl.ok; ++frame)
+    {
+        const u64 until = total * frame / num_frames;
+        while (op < journal->count)
+        {
+            const u64 at = TimelapseActiveTime(journal, op, active);
+            if (at > until)
+            {
+                break;
+            }
+            TimelapseApply(&tl, &journal->ops[op++]);
+            active = at;
+        }
+        TimelapseEmit(&tl);
+    }
+
+    for (i32 i = 0; i < TIMELAPSE_HOLD && tl.ok; ++i)
+    {
+        TimelapseEmit(&tl);
+    }
+    TimelapseFlush(&tl);
+
+    const bool ok = fclose(tl.file) == 0 && tl.ok;
+    if (ok)
+    {
+        Log(LOG_NOTIFY, "Rendered %zu operations to %s in %.2f s",
+            journal->count, path, (SDL_GetTicks() - began) / 1000.0);
+    }
+    else
+    {
+        Log(LOG_ERROR, "Could not write timelapse %s", path);
+    }
+
+    ChunkStoreFree(tl.cells);
+    Free(tl.dirty);
+    Free(tl.marked);
+    Free(tl.pixels);
+    for (size_t i = 0; i < TIMELAPSE_BATCH; ++i)
+    {
+        Free(tl.frames[i]);
+        if (tl.planes[i])
+        {
+            Free(tl.planes[i]);
+        }
+    }
+
+    return ok;
+}
+
+/**
+ * \desc Renders the copy of the journal, then sets done for the thread which
+ * started the job.
+ */
+static i32 TimelapseRun(void* data)
+{
+    TimelapseJob* job = data;
+    job->ok = TimelapseRender(job->journal, job->path, job->format);
+    SDL_AtomicSet(&job->done, 1);
+    return 0;
+}
+
+/**
+ * \desc The journal is copied, so that the copy of its cells is not replayed
+ * whilst it is compacted and the document goes on logging.
+ */
+[[nodiscard]] TimelapseJob* TimelapseStart(const Journal* journal,
+                                           const char* path,
+                                           RecorderFormat format)
+{
+    if (journal->start == NULL || strlen(path) >= TIMELAPSE_MAX_PATH)
+    {
+        return NULL;
+    }
+
+    TimelapseJob* job = Allocate(sizeof(TimelapseJob));
+    job->journal = JournalClone(journal);
+    snprintf(job->path, sizeof(job->path), "%s", path);
+    job->format = format;
+    job->ok = false;
+    SDL_AtomicSet(&job->done, 0);
+
+    job->thread = SDL_CreateThread(TimelapseRun, "timelapse", job);
+    if (job->thread == NULL)
+    {
+        Log(LOG_FATAL, "Could not start timelapse: %s", SDL_GetError());
+    }
+
+    return job;
+}
+
+/**
+ * \desc Done is only ever set by the thread which renders.
+ */
+bool TimelapseDone(TimelapseJob* job) { return SDL_AtomicGet(&job->done); }
+
+/**
+ * \desc Waits on the thread which renders, which also makes its result
+ * visible, then frees the copy of the journal.
+ */
+bool TimelapseFinish(TimelapseJob* job)
+{
+    SDL_WaitThread(job->thread, NULL);
+
+    const bool ok = job->ok;
+    JournalFree(job->journal);
+    Free(job);
+    return ok;
+}
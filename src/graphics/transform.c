@@ -0,0 +1,267 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file transform.c
+ *
+ * \brief Transforms rotate, flip or transpose blocks of cells. Glyphs which
+ * point in a direction, such as box drawing lines and arrows, are remapped so
+ * that they still join up and point the right way once moved.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "graphics/transform.h"
+
+/**
+ * \desc The glyph each glyph becomes under a clockwise quarter rotation. Box
+ * drawing glyphs map to the glyph with their arms rotated, whether single or
+ * double lines; arrows, triangles, half blocks and carets point the next way
+ * round; and slashes, bars and dashes swap. Every other glyph is unchanged.
+ * The table is constant, so that it is shared by every thread without being
+ * built.
+ */
+static const u8 TRANSFORM_ROTATE[256] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 31, 30, 29, 19, 20,
+    21, 22, 23, 26, 27, 25, 24, 28, 18, 16, 17, 32, 33, 34, 35, 36, 37, 38, 39,
+    40, 41, 42, 43, 44, 124, 46, 92, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58,
+    59, 94, 61, 118, 63, 64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77,
+    78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 47, 93, 62, 95, 96,
+    97, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112,
+    113, 114, 115, 116, 117, 60, 119, 120, 121, 122, 123, 45, 125, 126, 127,
+    128, 129, 130, 131, 132, 133, 134, 135, 136, 137, 138, 139, 140, 141, 142,
+    143, 144, 145, 146, 147, 148, 149, 150, 151, 152, 153, 154, 155, 156, 157,
+    158, 159, 160, 161, 162, 163, 164, 165, 166, 167, 168, 169, 170, 171, 172,
+    173, 174, 175, 176, 177, 178, 196, 193, 208, 207, 190, 189, 202, 205, 188,
+    200, 212, 211, 217, 218, 195, 180, 194, 179, 197, 210, 209, 201, 187, 204,
+    185, 203, 186, 206, 199, 198, 182, 181, 213, 214, 183, 184, 216, 215, 192,
+    191, 219, 221, 223, 220, 222, 224, 225, 226, 227, 228, 229, 230, 231, 232,
+    233, 234, 235, 236, 237, 238, 239, 240, 241, 242, 243, 244, 245, 246, 247,
+    248, 249, 250, 251, 252, 253, 254, 255,
+};
+
+/**
+ * \desc The glyph each glyph becomes under a horizontal flip. Box drawing
+ * glyphs map to the glyph with their arms mirrored; and arrows, triangles, half
+ * blocks, slashes and brackets which point left or right swap. Every other
+ * glyph is unchanged.
+ */
+static const u8 TRANSFORM_FLIP[256] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 17, 16, 18, 19, 20,
+    21, 22, 23, 24, 25, 27, 26, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39,
+    41, 40, 42, 43, 44, 45, 46, 92, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58,
+    59, 62, 61, 60, 63, 64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77,
+    78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 93, 47, 91, 94, 95, 96,
+    97, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112,
+    113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 125, 124, 123, 126, 127,
+    128, 129, 130, 131, 132, 133, 134, 135, 136, 137, 138, 139, 140, 141, 142,
+    143, 144, 145, 146, 147, 148, 149, 150, 151, 152, 153, 154, 155, 156, 157,
+    158, 159, 160, 161, 162, 163, 164, 165, 166, 167, 168, 169, 170, 171, 172,
+    173, 174, 175, 176, 177, 178, 179, 195, 198, 199, 214, 213, 204, 186, 201,
+    200, 211, 212, 218, 217, 193, 194, 180, 196, 197, 181, 182, 188, 187, 202,
+    203, 185, 205, 206, 207, 208, 209, 210, 189, 190, 184, 183, 215, 216, 192,
+    191, 219, 220, 222, 221, 223, 224, 225, 226, 227, 228, 229, 230, 231, 232,
+    233, 234, 235, 236, 237, 238, 239, 240, 241, 242, 243, 244, 245, 246, 247,
+    248, 249, 250, 251, 252, 253, 254, 255,
+};
+
+/**
+ * \desc Quarter rotations undo each other; every other transform undoes
+ * itself.
+ */
+[[nodiscard]] TransformType TransformInverse(TransformType type)
+{
+    switch (type)
+    {
+    case TRANSFORM_ROTATE_90:
+        return TRANSFORM_ROTATE_270;
+
+    case TRANSFORM_ROTATE_270:
+        return TRANSFORM_ROTATE_90;
+
+    default:
+        return type;
+    }
+}
+
+/**
+ * \desc Quarter rotations and transposes swap the width and height.
+ */
+void TransformSize(TransformType type, i32 width, i32 height, i32* out_w,
+                   i32* out_h)
+{
+    const bool swap = type == TRANSFORM_ROTATE_90 ||
+                      type == TRANSFORM_ROTATE_270 ||
+                      type == TRANSFORM_TRANSPOSE;
+
+    *out_w = swap ? height : width;
+    *out_h = swap ? width : height;
+}
+
+/**
+ * \desc Finds where a single cell of a block ends up once transformed.
+ */
+static SDL_Point TransformPoint(TransformType type, i32 x, i32 y, i32 width,
+                                i32 height)
+{
+    switch (type)
+    {
+    case TRANSFORM_ROTATE_90:
+        return (SDL_Point){height - 1 - y, x};
+
+    case TRANSFORM_ROTATE_180:
+        return (SDL_Point){width - 1 - x, height - 1 - y};
+
+    case TRANSFORM_ROTATE_270:
+        return (SDL_Point){y, width - 1 - x};
+
+    case TRANSFORM_FLIP_H:
+        return (SDL_Point){width - 1 - x, y};
+
+    case TRANSFORM_FLIP_V:
+        return (SDL_Point){x, height - 1 - y};
+
+    case TRANSFORM_TRANSPOSE:
+        return (SDL_Point){y, x};
+
+    default:
+        return (SDL_Point){x, y};
+    }
+}
+
+/**
+ * \desc Every transform keeps a rectangle a rectangle, so it is enough to
+ * transform two opposite corners.
+ */
+[[nodiscard]] SDL_Rect TransformRect(TransformType type, SDL_Rect rect,
+                                     i32 width, i32 height)
+{
+    const SDL_Point a = TransformPoint(type, rect.x, rect.y, width, height);
+    const SDL_Point b = TransformPoint(type, rect.x + rect.w - 1,
+                                       rect.y + rect.h - 1, width, height);
+
+    SDL_Rect out = {0};
+    out.x = SDL_min(a.x, b.x);
+    out.y = SDL_min(a.y, b.y);
+    out.w = abs(a.x - b.x) + 1;
+    out.h = abs(a.y - b.y) + 1;
+
+    return out;
+}
+
+/**
+ * \desc Every transform is the quarter rotation, the horizontal flip or a
+ * composition of them, so at most three lookups are made into their tables.
+ */
+[[nodiscard]] u8 TransformGlyph(TransformType type, u8 index)
+{
+    switch (type)
+    {
+    case TRANSFORM_ROTATE_90:
+        return TRANSFORM_ROTATE[index];
+
+    case TRANSFORM_ROTATE_180:
+        return TRANSFORM_ROTATE[TRANSFORM_ROTATE[index]];
+
+    case TRANSFORM_ROTATE_270:
+        return TRANSFORM_ROTATE[TRANSFORM_ROTATE[TRANSFORM_ROTATE[index]]];
+
+    case TRANSFORM_FLIP_H:
+        return TRANSFORM_FLIP[index];
+
+    case TRANSFORM_FLIP_V:
+        return TRANSFORM_FLIP[TRANSFORM_ROTATE[TRANSFORM_ROTATE[index]]];
+
+    case TRANSFORM_TRANSPOSE:
+        return TRANSFORM_FLIP[TRANSFORM_ROTATE[index]];
+
+    default:
+        return index;
+    }
+}
+
+/**
+ * \desc The glyphs are remapped through a table of the transform, composed on
+ * the stack, so that concurrent transforms share nothing but constant tables.
+ * The destination index of every transform is an affine function of the
+ * source position, so each cell is written by a multiply-add with no branches.
+ * The block is walked a tile at a time: a transpose or quarter rotation writes
+ * each source row down a destination column, and in tiles the columns being
+ * written stay in cache rather than each write missing a fresh cache line.
+ */
+void TransformCells(TransformType type, const Cell* src, i32 width, i32 height,
+                    Cell* dst)
+{
+    u8 lut[256] = {0};
+    for (size_t i = 0; i < 256; ++i)
+    {
+        lut[i] = TransformGlyph(type, (u8)i);
+    }
+
+    const i64 w = width, h = height;
+    i64 base = 0, step_x = 1, step_y = w;
+
+    switch (type)
+    {
+    case TRANSFORM_ROTATE_90:
+        base = h - 1;
+        step_x = h;
+        step_y = -1;
+        break;
+
+    case TRANSFORM_ROTATE_180:
+        base = (w - 1) + (h - 1) * w;
+        step_x = -1;
+        step_y = -w;
+        break;
+
+    case TRANSFORM_ROTATE_270:
+        base = (w - 1) * h;
+        step_x = -h;
+        step_y = 1;
+        break;
+
+    case TRANSFORM_FLIP_H:
+        base = w - 1;
+        step_x = -1;
+        step_y = w;
+        break;
+
+    case TRANSFORM_FLIP_V:
+        base = (h - 1) * w;
+        step_x = 1;
+        step_y = -w;
+        break;
+
+    case TRANSFORM_TRANSPOSE:
+        base = 0;
+        step_x = h;
+        step_y = 1;
+        break;
+
+    default:
+        break;
+    }
+
+    for (i32 by = 0; by < height; by += TRANSFORM_BLOCK)
+    {
+        const i32 ey = SDL_min(by + TRANSFORM_BLOCK, height);
+        for (i32 bx = 0; bx < width; bx += TRANSFORM_BLOCK)
+        {
+            const i32 ex = SDL_min(bx + TRANSFORM_BLOCK, width);
+            for (i32 y = by; y < ey; ++y)
+            {
+                const Cell* row = &src[y * w];
+                const i64 start = base + y * step_y;
+                for (i32 x = bx; x < ex; ++x)
+                {
+                    Cell cell = row[x];
+                    cell.index = lut[cell.index];
+                    dst[start + x * step_x] = cell;
+                }
+            }
+        }
+    }
+}
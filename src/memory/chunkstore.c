@@ -0,0 +1,1145 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file chunkstore.c
+ *
+ * \brief A chunk store holds a grid of cells split into square chunks. Chunks
+ * which have not been accessed for a while may be compressed in place, and are
+ * decompressed again on their next access, so that large maps which are open
+ * but idle take up little memory.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "memory/chunkstore.h"
+
+/**
+ * \desc The size of the cells of a chunk in bytes, uncompressed.
+ */
+#define CHUNK_BYTES (sizeof(Cell) * CHUNK_CELLS)
+
+/**
+ * \desc Unlinks a resident chunk from the least recently used list.
+ */
+static void ChunkStoreUnlink(ChunkStore* store, i32 index)
+{
+    Chunk* chunk = &store->chunks[index];
+
+    if (chunk->prev >= 0)
+    {
+        store->chunks[chunk->prev].next = chunk->next;
+    }
+    else
+    {
+        store->lru_head = chunk->next;
+    }
+
+    if (chunk->next >= 0)
+    {
+        store->chunks[chunk->next].prev = chunk->prev;
+    }
+    else
+    {
+        store->lru_tail = chunk->prev;
+    }
+
+    chunk->prev = -1;
+    chunk->next = -1;
+}
+
+/**
+ * \desc Links a resident chunk at the head of the least recently used list.
+ */
+static void ChunkStoreLink(ChunkStore* store, i32 index)
+{
+    Chunk* chunk = &store->chunks[index];
+    chunk->prev = -1;
+    chunk->next = store->lru_head;
+
+    if (store->lru_head >= 0)
+    {
+        store->chunks[store->lru_head].prev = index;
+    }
+    else
+    {
+        store->lru_tail = index;
+    }
+
+    store->lru_head = index;
+}
+
+/**
+ * \desc Makes a chunk resident and the most recently used. A compressed chunk
+ * is decompressed first; as the data never leaves memory, a chunk which fails
+ * to decompress means memory has been corrupted. Must be called with the lock
+ * held.
+ */
+static Chunk* ChunkStoreTouch(ChunkStore* store, i32 index)
+{
+    Chunk* chunk = &store->chunks[index];
+
+    if (chunk->cells == NULL)
+    {
+        chunk->cells = Allocate(CHUNK_BYTES);
+        if (!LzDecompress(chunk->packed, chunk->packed_size,
+                          (u8*)chunk->cells, CHUNK_BYTES))
+        {
+            Log(LOG_FATAL, "Could not decompress chunk %d!", index);
+        }
+
+        Free(chunk->packed);
+        chunk->packed = NULL;
+        chunk->packed_size = 0;
+        store->num_resident++;
+    }
+    else
+    {
+        ChunkStoreUnlink(store, index);
+    }
+
+    ChunkStoreLink(store, index);
+    chunk->last_access = SDL_GetTicks();
+
+    return chunk;
+}
+
+/**
+ * \desc Adds a colour to the set of a usage, unless it is already held. Once
+ * the set is full, any colour not held overflows it.
+ */
+static void ChunkUsageAddColor(ChunkUsage* usage, SDL_Color color)
+{
+    for (u8 i = 0; i < usage->num_colors; ++i)
+    {
+        if (memcmp(&usage->colors[i], &color, sizeof(SDL_Color)) == 0)
+        {
+            return;
+        }
+    }
+
+    if (usage->num_colors == CHUNK_USAGE_COLORS)
+    {
+        usage->overflow = true;
+        return;
+    }
+
+    usage->colors[usage->num_colors++] = color;
+}
+
+/**
+ * \desc Adds the glyph and both colours of a cell to a usage.
+ */
+static void ChunkUsageAdd(ChunkUsage* usage, Cell cell)
+{
+    usage->glyphs[cell.index >> 5] |= 1u << (cell.index & 31);
+    ChunkUsageAddColor(usage, cell.fg);
+    ChunkUsageAddColor(usage, cell.bg);
+}
+
+/**
+ * \desc Checks whether a usage holds a colour. An overflowed set may hold any.
+ */
+static bool ChunkUsageHasColor(const ChunkUsage* usage, SDL_Color color)
+{
+    if (usage->overflow)
+    {
+        return true;
+    }
+
+    for (u8 i = 0; i < usage->num_colors; ++i)
+    {
+        if (memcmp(&usage->colors[i], &color, sizeof(SDL_Color)) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * \desc Checks whether a chunk with a usage may hold a cell which matches. Only
+ * a whole cell can prove a match, so this may pass chunks with none.
+ */
+static bool ChunkUsageMayMatch(const ChunkUsage* usage, const CellMatch* match)
+{
+    if ((match->fields & CELL_MATCH_GLYPH) &&
+        !(usage->glyphs[match->index >> 5] & (1u << (match->index & 31))))
+    {
+        return false;
+    }
+
+    if ((match->fields & CELL_MATCH_FG) &&
+        !ChunkUsageHasColor(usage, match->fg))
+    {
+        return false;
+    }
+
+    return !(match->fields & CELL_MATCH_BG) ||
+           ChunkUsageHasColor(usage, match->bg);
+}
+
+/**
+ * \desc Builds the usage of a chunk afresh from its cells, leaving out those
+ * which lie beyond the edge of the grid. Must be called with the lock held.
+ */
+static void ChunkStoreScan(ChunkStore* store, i32 index, const Cell* cells)
+{
+    const i32 cx = index % store->chunks_w;
+    const i32 cy = index / store->chunks_w;
+    const i32 num_x = SDL_min(CHUNK_SIZE, store->width - cx * CHUNK_SIZE);
+    const i32 num_y = SDL_min(CHUNK_SIZE, store->height - cy * CHUNK_SIZE);
+
+    ChunkUsage* usage = &store->chunks[index].usage;
+    *usage = (ChunkUsage){0};
+
+    for (i32 y = 0; y < num_y; ++y)
+    {
+        const Cell* row = &cells[y * CHUNK_SIZE];
+        for (i32 x = 0; x < num_x; ++x)
+        {
+            ChunkUsageAdd(usage, row[x]);
+        }
+    }
+}
+
+/**
+ * \desc Allocates the store and every chunk, with each cell set to the fill.
+ * The cells of edge chunks which lie outside of the grid are filled too, so
+ * that every chunk compresses alike.
+ */
+[[nodiscard]] ChunkStore* ChunkStoreCreate(i32 width, i32 height, Cell fill)
+{
+    ChunkStore* store = Allocate(sizeof(ChunkStore));
+    store->width = width;
+    store->height = height;
+    store->chunks_w = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    store->chunks_h = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    store->lru_head = -1;
+    store->lru_tail = -1;
+    store->lock = SDL_CreateMutex();
+
+    if (store->lock == NULL)
+    {
+        Log(LOG_FATAL, "Could not create chunk store lock: %s", SDL_GetError());
+    }
+
+    const i32 num_chunks = store->chunks_w * store->chunks_h;
+    store->chunks = Allocate(sizeof(Chunk) * (num_chunks ? num_chunks : 1));
+
+    ChunkUsage usage = {0};
+    ChunkUsageAdd(&usage, fill);
+
+    const u32 now = SDL_GetTicks();
+    for (i32 i = 0; i < num_chunks; ++i)
+    {
+        Chunk* chunk = &store->chunks[i];
+        chunk->cells = Allocate(CHUNK_BYTES);
+        for (size_t j = 0; j < CHUNK_CELLS; ++j)
+        {
+            chunk->cells[j] = fill;
+        }
+
+        chunk->usage = usage;
+        chunk->last_access = now;
+        ChunkStoreLink(store, i);
+        store->num_resident++;
+    }
+
+    return store;
+}
+
+/**
+ * \desc Copies every chunk as it currently is, compressed or not. The resident
+ * chunks are linked in the same order of use as the original.
+ */
+[[nodiscard]] ChunkStore* ChunkStoreClone(ChunkStore* store)
+{
+    SDL_LockMutex(store->lock);
+
+    ChunkStore* clone = Allocate(sizeof(ChunkStore));
+    *clone = *store;
+    clone->lru_head = -1;
+    clone->lru_tail = -1;
+    clone->num_resident = 0;
+    clone->lock = SDL_CreateMutex();
+
+    if (clone->lock == NULL)
+    {
+        Log(LOG_FATAL, "Could not create chunk store lock: %s", SDL_GetError());
+    }
+
+    const i32 num_chunks = store->chunks_w * store->chunks_h;
+    clone->chunks = Allocate(sizeof(Chunk) * (num_chunks ? num_chunks : 1));
+
+    for (i32 i = 0; i < num_chunks; ++i)
+    {
+        const Chunk* chunk = &store->chunks[i];
+        Chunk* copy = &clone->chunks[i];
+        copy->last_access = chunk->last_access;
+        copy->usage = chunk->usage;
+        copy->prev = -1;
+        copy->next = -1;
+
+        if (chunk->cells == NULL)
+        {
+            copy->packed = Allocate(chunk->packed_size);
+            copy->packed_size = chunk->packed_size;
+            memcpy(copy->packed, chunk->packed, chunk->packed_size);
+        }
+    }
+
+    for (i32 i = store->lru_tail; i >= 0; i = store->chunks[i].prev)
+    {
+        clone->chunks[i].cells = Allocate(CHUNK_BYTES);
+        memcpy(clone->chunks[i].cells, store->chunks[i].cells, CHUNK_BYTES);
+        ChunkStoreLink(clone, i);
+        clone->num_resident++;
+    }
+
+    SDL_UnlockMutex(store->lock);
+
+    return clone;
+}
+
+/**
+ * \desc Frees the cells of every chunk, whichever form they are in, followed
+ * by the chunks, lock and store.
+ */
+void ChunkStoreFree(ChunkStore* store)
+{
+    const i32 num_chunks = store->chunks_w * store->chunks_h;
+    for (i32 i = 0; i < num_chunks; ++i)
+    {
+        if (store->chunks[i].cells)
+        {
+            Free(store->chunks[i].cells);
+        }
+
+        if (store->chunks[i].packed)
+        {
+            Free(store->chunks[i].packed);
+        }
+    }
+
+    Free(store->chunks);
+    SDL_DestroyMutex(store->lock);
+    Free(store);
+}
+
+/**
+ * \desc The pin keeps the background compressor away from the chunk until it
+ * is released, so the cells may be used without holding the lock.
+ */
+[[nodiscard]] Cell* ChunkStoreAcquire(ChunkStore* store, i32 cx, i32 cy)
+{
+    SDL_LockMutex(store->lock);
+
+    Chunk* chunk = ChunkStoreTouch(store, cx + cy * store->chunks_w);
+    chunk->pins++;
+
+    SDL_UnlockMutex(store->lock);
+
+    return chunk->cells;
+}
+
+/**
+ * \desc Releasing also counts as an access, as the chunk was in use until now.
+ */
+void ChunkStoreRelease(ChunkStore* store, i32 cx, i32 cy)
+{
+    SDL_LockMutex(store->lock);
+
+    Chunk* chunk = &store->chunks[cx + cy * store->chunks_w];
+    chunk->pins--;
+    chunk->last_access = SDL_GetTicks();
+
+    SDL_UnlockMutex(store->lock);
+}
+
+/**
+ * \desc Reads the cell from its chunk whilst holding the lock.
+ */
+[[nodiscard]] Cell ChunkStoreGet(ChunkStore* store, i32 x, i32 y)
+{
+    if (x < 0 || y < 0 || x >= store->width || y >= store->height)
+    {
+        return (Cell){0};
+    }
+
+    SDL_LockMutex(store->lock);
+
+    const i32 index = x / CHUNK_SIZE + y / CHUNK_SIZE * store->chunks_w;
+    const Chunk* chunk = ChunkStoreTouch(store, index);
+    const Cell cell =
+        chunk->cells[x % CHUNK_SIZE + y % CHUNK_SIZE * CHUNK_SIZE];
+
+    SDL_UnlockMutex(store->lock);
+
+    return cell;
+}
+
+/**
+ * \desc Writes the cell to its chunk whilst holding the lock, and adds it to
+ * the usage of the chunk.
+ */
+void ChunkStoreSet(ChunkStore* store, i32 x, i32 y, Cell cell)
+{
+    if (x < 0 || y < 0 || x >= store->width || y >= store->height)
+    {
+        return;
+    }
+
+    SDL_LockMutex(store->lock);
+
+    const i32 index = x / CHUNK_SIZE + y / CHUNK_SIZE * store->chunks_w;
+    Chunk* chunk = ChunkStoreTouch(store, index);
+    chunk->cells[x % CHUNK_SIZE + y % CHUNK_SIZE * CHUNK_SIZE] = cell;
+    ChunkUsageAdd(&chunk->usage, cell);
+    chunk->usage.loose = true;
+
+    SDL_UnlockMutex(store->lock);
+}
+
+/**
+ * \desc The cell it overwrote may have been the last of its glyph or colours
+ * in the chunk, so the usage is marked as loose.
+ */
+void ChunkStoreNote(ChunkStore* store, i32 cx, i32 cy, Cell cell)
+{
+    SDL_LockMutex(store->lock);
+
+    ChunkUsage* usage = &store->chunks[cx + cy * store->chunks_w].usage;
+    ChunkUsageAdd(usage, cell);
+    usage->loose = true;
+
+    SDL_UnlockMutex(store->lock);
+}
+
+/**
+ * \desc Compresses a resident chunk in place, unless it would not shrink. A
+ * loose usage is built again first, as the cells cannot change whilst they are
+ * compressed. Must be called with the lock held.
+ */
+static bool ChunkStorePack(ChunkStore* store, i32 index)
+{
+    u8 buffer[LZ_BOUND(CHUNK_BYTES)];
+    Chunk* chunk = &store->chunks[index];
+    if (chunk->usage.loose)
+    {
+        ChunkStoreScan(store, index, chunk->cells);
+    }
+
+    const size_t size = LzCompress((const u8*)chunk->cells, CHUNK_BYTES, buffer,
+                                   sizeof(buffer));
+
+    if (size == 0 || size >= CHUNK_BYTES)
+    {
+        return false;
+    }
+
+    chunk->packed = Allocate(size);
+    chunk->packed_size = (u32)size;
+    memcpy(chunk->packed, buffer, size);
+
+    Free(chunk->cells);
+    chunk->cells = NULL;
+    ChunkStoreUnlink(store, index);
+    store->num_resident--;
+
+    return true;
+}
+
+/**
+ * \desc Gives the cells of a chunk without making it resident: a compressed
+ * chunk is decompressed into the buffer, and stays compressed. Must be called
+ * with the lock held.
+ */
+static const Cell* ChunkStorePeek(const ChunkStore* store, i32 index,
+                                  Cell* buffer)
+{
+    const Chunk* chunk = &store->chunks[index];
+    if (chunk->cells)
+    {
+        return chunk->cells;
+    }
+
+    if (!LzDecompress(chunk->packed, chunk->packed_size, (u8*)buffer,
+                      CHUNK_BYTES))
+    {
+        Log(LOG_FATAL, "Could not decompress chunk %d!", index);
+    }
+
+    return buffer;
+}
+
+/**
+ * \desc Copies the part of each chunk which overlaps the block, so that every
+ * chunk is visited once, with a copy for each of its rows within the block.
+ * With peek set, compressed chunks are read without being made resident. Must
+ * be called with the lock held.
+ */
+static void ChunkStoreGather(ChunkStore* store, SDL_Rect rect, Cell* cells,
+                             bool peek)
+{
+    Cell buffer[CHUNK_CELLS];
+
+    for (i32 cy = rect.y / CHUNK_SIZE; cy <= (rect.y + rect.h - 1) / CHUNK_SIZE;
+         ++cy)
+    {
+        const i32 y0 = SDL_max(rect.y, cy * CHUNK_SIZE);
+        const i32 y1 = SDL_min(rect.y + rect.h, (cy + 1) * CHUNK_SIZE);
+
+        for (i32 cx = rect.x / CHUNK_SIZE;
+             cx <= (rect.x + rect.w - 1) / CHUNK_SIZE; ++cx)
+        {
+            const i32 x0 = SDL_max(rect.x, cx * CHUNK_SIZE);
+            const i32 x1 = SDL_min(rect.x + rect.w, (cx + 1) * CHUNK_SIZE);
+            const i32 index = cx + cy * store->chunks_w;
+            const Cell* chunk = peek ? ChunkStorePeek(store, index, buffer)
+                                     : ChunkStoreTouch(store, index)->cells;
+
+            for (i32 y = y0; y < y1; ++y)
+            {
+                memcpy(&cells[(x0 - rect.x) + (y - rect.y) * rect.w],
+                       &chunk[x0 % CHUNK_SIZE + (y % CHUNK_SIZE) * CHUNK_SIZE],
+                       sizeof(Cell) * (size_t)(x1 - x0));
+            }
+        }
+    }
+}
+
+/**
+ * \desc The whole block is read under a single hold of the lock.
+ */
+void ChunkStoreRead(ChunkStore* store, SDL_Rect rect, Cell* cells)
+{
+    if (rect.w <= 0 || rect.h <= 0)
+    {
+        return;
+    }
+
+    SDL_LockMutex(store->lock);
+    ChunkStoreGather(store, rect, cells, false);
+    SDL_UnlockMutex(store->lock);
+}
+
+/**
+ * \desc A compressed chunk is decompressed straight into the cells, and stays
+ * compressed.
+ */
+void ChunkStoreReadChunk(ChunkStore* store, i32 cx, i32 cy, Cell* cells)
+{
+    SDL_LockMutex(store->lock);
+
+    const i32 index = cx + cy * store->chunks_w;
+    const Cell* chunk = ChunkStorePeek(store, index, cells);
+    if (chunk != cells)
+    {
+        memcpy(cells, chunk, CHUNK_BYTES);
+    }
+
+    SDL_UnlockMutex(store->lock);
+}
+
+/**
+ * \desc The chunk is made resident and its cells replaced whilst holding the
+ * lock, so its usage is exact again afterwards.
+ */
+void ChunkStoreWriteChunk(ChunkStore* store, i32 cx, i32 cy,
+                          const Cell* cells)
+{
+    SDL_LockMutex(store->lock);
+
+    const i32 index = cx + cy * store->chunks_w;
+    Chunk* chunk = ChunkStoreTouch(store, index);
+    memcpy(chunk->cells, cells, CHUNK_BYTES);
+    ChunkStoreScan(store, index, chunk->cells);
+
+    SDL_UnlockMutex(store->lock);
+}
+
+/**
+ * \desc Compares each part of the cell named by the match.
+ */
+[[nodiscard]] bool ChunkStoreMatches(const CellMatch* match, Cell cell)
+{
+    if ((match->fields & CELL_MATCH_GLYPH) && cell.index != match->index)
+    {
+        return false;
+    }
+
+    if ((match->fields & CELL_MATCH_FG) &&
+        memcmp(&cell.fg, &match->fg, sizeof(SDL_Color)) != 0)
+    {
+        return false;
+    }
+
+    return !(match->fields & CELL_MATCH_BG) ||
+           memcmp(&cell.bg, &match->bg, sizeof(SDL_Color)) == 0;
+}
+
+/**
+ * \desc Checks the usage of a chunk against a query. A resident chunk whose
+ * usage is loose is scanned again first, which is cheap as its cells are at
+ * hand; a compressed chunk always has a tight usage. Must be called with the
+ * lock held.
+ */
+static bool ChunkStoreMayMatch(ChunkStore* store, i32 index,
+                               const CellMatch* match)
+{
+    Chunk* chunk = &store->chunks[index];
+    if (!ChunkUsageMayMatch(&chunk->usage, match))
+    {
+        return false;
+    }
+
+    if (chunk->cells == NULL || !chunk->usage.loose)
+    {
+        return true;
+    }
+
+    ChunkStoreScan(store, index, chunk->cells);
+    return ChunkUsageMayMatch(&chunk->usage, match);
+}
+
+/**
+ * \desc Every chunk is checked under a single hold of the lock, without
+ * touching the cells of any compressed chunk.
+ */
+size_t ChunkStoreFind(ChunkStore* store, const CellMatch* match, i32* chunks)
+{
+    size_t count = 0;
+
+    SDL_LockMutex(store->lock);
+
+    const i32 num_chunks = store->chunks_w * store->chunks_h;
+    for (i32 i = 0; i < num_chunks; ++i)
+    {
+        if (ChunkStoreMayMatch(store, i, match))
+        {
+            chunks[count++] = i;
+        }
+    }
+
+    SDL_UnlockMutex(store->lock);
+
+    return count;
+}
+
+/**
+ * \desc Chunks whose usage rules out a match are skipped; the others are read
+ * in place, compressed ones into a buffer, and their cells within the grid
+ * compared.
+ */
+[[nodiscard]] size_t ChunkStoreCount(ChunkStore* store, const CellMatch* match)
+{
+    Cell buffer[CHUNK_CELLS];
+    size_t count = 0;
+
+    SDL_LockMutex(store->lock);
+
+    const i32 num_chunks = store->chunks_w * store->chunks_h;
+    for (i32 i = 0; i < num_chunks; ++i)
+    {
+        if (!ChunkStoreMayMatch(store, i, match))
+        {
+            continue;
+        }
+
+        const i32 cx = i % store->chunks_w;
+        const i32 cy = i / store->chunks_w;
+        const i32 num_x = SDL_min(CHUNK_SIZE, store->width - cx * CHUNK_SIZE);
+        const i32 num_y = SDL_min(CHUNK_SIZE, store->height - cy * CHUNK_SIZE);
+        const Cell* cells = ChunkStorePeek(store, i, buffer);
+
+        for (i32 y = 0; y < num_y; ++y)
+        {
+            for (i32 x = 0; x < num_x; ++x)
+            {
+                count += ChunkStoreMatches(match, cells[x + y * CHUNK_SIZE]);
+            }
+        }
+    }
+
+    SDL_UnlockMutex(store->lock);
+
+    return count;
+}
+
+/**
+ * \desc Checks whether every chunk which overlaps a block is compressed. Must
+ * be called with the lock held.
+ */
+static bool ChunkStoreIsCold(const ChunkStore* store, SDL_Rect rect)
+{
+    for (i32 cy = rect.y / CHUNK_SIZE; cy <= (rect.y + rect.h - 1) / CHUNK_SIZE;
+         ++cy)
+    {
+        for (i32 cx = rect.x / CHUNK_SIZE;
+             cx <= (rect.x + rect.w - 1) / CHUNK_SIZE; ++cx)
+        {
+            if (store->chunks[cx + cy * store->chunks_w].cells)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \desc Sets up the fields of a store of the given size, with every chunk
+ * allocated but empty and no lock of its own. The chunks are filled in and the
+ * store then swapped into a real one by ChunkStoreReplace.
+ */
+static ChunkStore ChunkStoreBlank(i32 width, i32 height)
+{
+    ChunkStore out = {0};
+    out.width = width;
+    out.height = height;
+    out.chunks_w = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    out.chunks_h = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    out.lru_head = -1;
+    out.lru_tail = -1;
+
+    const i32 num_chunks = out.chunks_w * out.chunks_h;
+    out.chunks = Allocate(sizeof(Chunk) * (num_chunks ? num_chunks : 1));
+
+    return out;
+}
+
+/**
+ * \desc Frees whatever cells are left in the chunks of the store, and then
+ * takes the chunks and list of the new one in their place, keeping the lock.
+ * Must be called with the lock held.
+ */
+static void ChunkStoreReplace(ChunkStore* store, const ChunkStore* out)
+{
+    const i32 num_chunks = store->chunks_w * store->chunks_h;
+    for (i32 i = 0; i < num_chunks; ++i)
+    {
+        if (store->chunks[i].cells)
+        {
+            Free(store->chunks[i].cells);
+        }
+
+        if (store->chunks[i].packed)
+        {
+            Free(store->chunks[i].packed);
+        }
+    }
+    Free(store->chunks);
+
+    SDL_mutex* lock = store->lock;
+    *store = *out;
+    store->lock = lock;
+}
+
+/**
+ * \desc The transformed grid is built a chunk at a time into a new set of
+ * chunks. For each new chunk, the block of the old grid which lands in it is
+ * gathered and put through the transform kernel, so no more than a few chunks
+ * are ever handled at once, however large the grid. Old chunks are read
+ * without being decompressed in place, and a new chunk is compressed straight
+ * away if every old chunk it came from was compressed, so that a large idle map
+ * does not balloon whilst it is transformed. As glyphs are remapped, the usage
+ * of each new chunk is built from its cells. The new chunks then replace the
+ * old ones under the lock, so the store may be in use by the compressor
+ * throughout.
+ */
+void ChunkStoreTransform(ChunkStore* store, TransformType type)
+{
+    SDL_LockMutex(store->lock);
+
+    i32 width = 0, height = 0;
+    TransformSize(type, store->width, store->height, &width, &height);
+    ChunkStore out = ChunkStoreBlank(width, height);
+
+    const TransformType inverse = TransformInverse(type);
+    const u32 now = SDL_GetTicks();
+    Cell block[CHUNK_CELLS];
+    Cell tile[CHUNK_CELLS];
+
+    for (i32 cy = 0; cy < out.chunks_h; ++cy)
+    {
+        for (i32 cx = 0; cx < out.chunks_w; ++cx)
+        {
+            SDL_Rect dest = {0};
+            dest.x = cx * CHUNK_SIZE;
+            dest.y = cy * CHUNK_SIZE;
+            dest.w = SDL_min(CHUNK_SIZE, out.width - dest.x);
+            dest.h = SDL_min(CHUNK_SIZE, out.height - dest.y);
+
+            const SDL_Rect src =
+                TransformRect(inverse, dest, out.width, out.height);
+            ChunkStoreGather(store, src, block, true);
+            TransformCells(type, block, src.w, src.h, tile);
+
+            const i32 index = cx + cy * out.chunks_w;
+            Chunk* chunk = &out.chunks[index];
+            chunk->cells = Allocate(CHUNK_BYTES);
+            chunk->last_access = now;
+            for (i32 y = 0; y < dest.h; ++y)
+            {
+                memcpy(&chunk->cells[y * CHUNK_SIZE], &tile[y * dest.w],
+                       sizeof(Cell) * (size_t)dest.w);
+            }
+            ChunkStoreScan(&out, index, chunk->cells);
+
+            ChunkStoreLink(&out, index);
+            out.num_resident++;
+
+            if (ChunkStoreIsCold(store, src))
+            {
+                ChunkStorePack(&out, index);
+            }
+        }
+    }
+
+    ChunkStoreReplace(store, &out);
+    SDL_UnlockMutex(store->lock);
+}
+
+/**
+ * \desc Sets every cell of a chunk which lies outside of a grid to the fill.
+ * The chunk must be resident.
+ */
+static void ChunkStoreClearOutside(Chunk* chunk, i32 x, i32 y, i32 width,
+                                   i32 height, Cell fill)
+{
+    for (i32 j = 0; j < CHUNK_SIZE; ++j)
+    {
+        for (i32 i = 0; i < CHUNK_SIZE; ++i)
+        {
+            if (x + i >= width || y + j >= height)
+            {
+                chunk->cells[i + j * CHUNK_SIZE] = fill;
+            }
+        }
+    }
+}
+
+/**
+ * \desc When the area starts on a chunk boundary, as it does whenever the grid
+ * is cropped or extended on its right and bottom sides, the chunks which are
+ * kept are moved into the new grid as they are, compressed or not, and keep
+ * their order of use; only the chunks which are added are allocated, and those
+ * which are dropped freed. Only the kept chunks which straddled the old edge
+ * are decompressed, to clear the cells beyond it, which may hold cells from
+ * before an earlier crop. Otherwise every chunk is shifted, so each new chunk
+ * gathers the rows of the old chunks it overlaps, and is compressed straight
+ * away if they all were. Kept chunks keep their usage, and the usage of every
+ * other chunk is built from its new cells.
+ */
+void ChunkStoreResize(ChunkStore* store, SDL_Rect rect, Cell fill)
+{
+    SDL_LockMutex(store->lock);
+
+    ChunkStore out = ChunkStoreBlank(SDL_max(rect.w, 0), SDL_max(rect.h, 0));
+    const bool aligned = rect.x % CHUNK_SIZE == 0 && rect.y % CHUNK_SIZE == 0;
+    const i32 ox = rect.x / CHUNK_SIZE;
+    const i32 oy = rect.y / CHUNK_SIZE;
+    const u32 now = SDL_GetTicks();
+
+    if (aligned)
+    {
+        for (i32 i = store->lru_tail; i >= 0; i = store->chunks[i].prev)
+        {
+            const i32 cx = i % store->chunks_w - ox;
+            const i32 cy = i / store->chunks_w - oy;
+            if (cx >= 0 && cx < out.chunks_w && cy >= 0 && cy < out.chunks_h)
+            {
+                ChunkStoreLink(&out, cx + cy * out.chunks_w);
+                out.num_resident++;
+            }
+        }
+
+        for (i32 cy = 0; cy < out.chunks_h; ++cy)
+        {
+            for (i32 cx = 0; cx < out.chunks_w; ++cx)
+            {
+                const i32 x = cx + ox;
+                const i32 y = cy + oy;
+                if (x < 0 || x >= store->chunks_w || y < 0 ||
+                    y >= store->chunks_h)
+                {
+                    continue;
+                }
+
+                const i32 index = cx + cy * out.chunks_w;
+                Chunk* chunk = &store->chunks[x + y * store->chunks_w];
+                out.chunks[index].cells = chunk->cells;
+                out.chunks[index].packed = chunk->packed;
+                out.chunks[index].packed_size = chunk->packed_size;
+                out.chunks[index].last_access = chunk->last_access;
+                out.chunks[index].usage = chunk->usage;
+                chunk->cells = NULL;
+                chunk->packed = NULL;
+
+                if ((x + 1) * CHUNK_SIZE > store->width ||
+                    (y + 1) * CHUNK_SIZE > store->height)
+                {
+                    Chunk* kept = ChunkStoreTouch(&out, index);
+                    ChunkStoreClearOutside(kept, x * CHUNK_SIZE,
+                                           y * CHUNK_SIZE, store->width,
+                                           store->height, fill);
+                    ChunkStoreScan(&out, index, kept->cells);
+                }
+            }
+        }
+    }
+
+    Cell block[CHUNK_CELLS];
+    for (i32 cy = 0; cy < out.chunks_h; ++cy)
+    {
+        for (i32 cx = 0; cx < out.chunks_w; ++cx)
+        {
+            const i32 index = cx + cy * out.chunks_w;
+            Chunk* chunk = &out.chunks[index];
+            if (chunk->cells || chunk->packed)
+            {
+                continue;
+            }
+
+            chunk->cells = Allocate(CHUNK_BYTES);
+            chunk->last_access = now;
+            for (size_t i = 0; i < CHUNK_CELLS; ++i)
+            {
+                chunk->cells[i] = fill;
+            }
+            ChunkUsageAdd(&chunk->usage, fill);
+
+            ChunkStoreLink(&out, index);
+            out.num_resident++;
+
+            SDL_Rect src = {0};
+            src.x = SDL_max(rect.x + cx * CHUNK_SIZE, 0);
+            src.y = SDL_max(rect.y + cy * CHUNK_SIZE, 0);
+            src.w = SDL_min(rect.x + (cx + 1) * CHUNK_SIZE, store->width) -
+                    src.x;
+            src.h = SDL_min(rect.y + (cy + 1) * CHUNK_SIZE, store->height) -
+                    src.y;
+            if (aligned || src.w <= 0 || src.h <= 0)
+            {
+                continue;
+            }
+
+            ChunkStoreGather(store, src, block, true);
+            const i32 dx = src.x - (rect.x + cx * CHUNK_SIZE);
+            const i32 dy = src.y - (rect.y + cy * CHUNK_SIZE);
+            for (i32 y = 0; y < src.h; ++y)
+            {
+                memcpy(&chunk->cells[dx + (dy + y) * CHUNK_SIZE],
+                       &block[y * src.w], sizeof(Cell) * (size_t)src.w);
+            }
+            ChunkStoreScan(&out, index, chunk->cells);
+
+            if (ChunkStoreIsCold(store, src))
+            {
+                ChunkStorePack(&out, index);
+            }
+        }
+    }
+
+    ChunkStoreReplace(store, &out);
+    SDL_UnlockMutex(store->lock);
+}
+
+/**
+ * \desc Widens the bounds to hold the cells of a chunk which differ from the
+ * blank cell. A compressed chunk whose packed cells match those of a blank
+ * chunk is skipped without being decompressed. Must be called with the lock
+ * held.
+ */
+static void ChunkStoreChunkBounds(ChunkStore* store, i32 cx, i32 cy,
+                                  Cell blank, const u8* packed_blank,
+                                  size_t packed_size, i32* bounds)
+{
+    const i32 index = cx + cy * store->chunks_w;
+    const Chunk* chunk = &store->chunks[index];
+    if (chunk->cells == NULL && chunk->packed_size == packed_size &&
+        memcmp(chunk->packed, packed_blank, packed_size) == 0)
+    {
+        return;
+    }
+
+    Cell buffer[CHUNK_CELLS];
+    const Cell* cells = ChunkStorePeek(store, index, buffer);
+    const i32 num_x = SDL_min(CHUNK_SIZE, store->width - cx * CHUNK_SIZE);
+    const i32 num_y = SDL_min(CHUNK_SIZE, store->height - cy * CHUNK_SIZE);
+
+    for (i32 j = 0; j < num_y; ++j)
+    {
+        const Cell* row = &cells[j * CHUNK_SIZE];
+        i32 first = 0;
+        while (first < num_x && memcmp(&row[first], &blank, sizeof(Cell)) == 0)
+        {
+            first++;
+        }
+
+        if (first == num_x)
+        {
+            continue;
+        }
+
+        i32 last = num_x - 1;
+        while (memcmp(&row[last], &blank, sizeof(Cell)) == 0)
+        {
+            last--;
+        }
+
+        const i32 y = cy * CHUNK_SIZE + j;
+        bounds[0] = SDL_min(bounds[0], cx * CHUNK_SIZE + first);
+        bounds[1] = SDL_min(bounds[1], y);
+        bounds[2] = SDL_max(bounds[2], cx * CHUNK_SIZE + last + 1);
+        bounds[3] = SDL_max(bounds[3], y + 1);
+    }
+}
+
+/**
+ * \desc The grid is swept inwards from each side a row or column of chunks at a
+ * time, and each sweep stops at the first row or column with anything in it:
+ * the top and bottom sweeps find the rows, and the left and right sweeps need
+ * only look between them, and no further in than the columns already found.
+ * Only the chunks at the edges of the content are
+ * ever read, and blank chunks which are compressed are never decompressed.
+ */
+[[nodiscard]] SDL_Rect ChunkStoreBounds(ChunkStore* store, Cell blank)
+{
+    Cell cells[CHUNK_CELLS];
+    u8 packed_blank[LZ_BOUND(CHUNK_BYTES)];
+    for (size_t i = 0; i < CHUNK_CELLS; ++i)
+    {
+        cells[i] = blank;
+    }
+    const size_t packed_size = LzCompress((const u8*)cells, CHUNK_BYTES,
+                                          packed_blank, sizeof(packed_blank));
+
+    i32 bounds[4] = {INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN};
+    SDL_LockMutex(store->lock);
+
+    i32 top = 0;
+    for (; top < store->chunks_h && bounds[3] < 0; ++top)
+    {
+        for (i32 cx = 0; cx < store->chunks_w; ++cx)
+        {
+            ChunkStoreChunkBounds(store, cx, top, blank, packed_blank,
+                                  packed_size, bounds);
+        }
+    }
+
+    i32 bottom = store->chunks_h - 1;
+    for (const i32 found = bounds[3]; bottom >= top && bounds[3] == found;
+         --bottom)
+    {
+        for (i32 cx = 0; cx < store->chunks_w; ++cx)
+        {
+            ChunkStoreChunkBounds(store, cx, bottom, blank, packed_blank,
+                                  packed_size, bounds);
+        }
+    }
+
+    i32 left = 0;
+    for (const i32 found = bounds[0];
+         top <= bottom && left * CHUNK_SIZE < found && bounds[0] == found;
+         ++left)
+    {
+        for (i32 cy = top; cy <= bottom; ++cy)
+        {
+            ChunkStoreChunkBounds(store, left, cy, blank, packed_blank,
+                                  packed_size, bounds);
+        }
+    }
+
+    for (i32 right = store->chunks_w - 1, found = bounds[2];
+         top <= bottom && right >= left && (right + 1) * CHUNK_SIZE > found &&
+         bounds[2] == found;
+         --right)
+    {
+        for (i32 cy = top; cy <= bottom; ++cy)
+        {
+            ChunkStoreChunkBounds(store, right, cy, blank, packed_blank,
+                                  packed_size, bounds);
+        }
+    }
+
+    SDL_UnlockMutex(store->lock);
+
+    if (bounds[3] < 0)
+    {
+        return (SDL_Rect){0};
+    }
+
+    return (SDL_Rect){bounds[0], bounds[1], bounds[2] - bounds[0],
+                      bounds[3] - bounds[1]};
+}
+
+/**
+ * \desc Walks the least recently used list from its tail, so the coldest chunks
+ * are compressed first; the walk ends at the first chunk which is not yet cold,
+ * as every chunk after it was used more recently. Pinned chunks are skipped.
+ * The lock is taken for one chunk at a time so that the owning thread is never
+ * held up for more than a single compression. A chunk which does not compress
+ * is treated as accessed, so it is not retried on every pass.
+ */
+size_t ChunkStoreCompressCold(ChunkStore* store, u32 now, size_t budget)
+{
+    size_t count = 0;
+
+    while (count < budget)
+    {
+        SDL_LockMutex(store->lock);
+
+        i32 index = store->lru_tail;
+        while (index >= 0 && store->chunks[index].pins > 0)
+        {
+            index = store->chunks[index].prev;
+        }
+
+        if (index < 0 ||
+            now - store->chunks[index].last_access < CHUNK_COLD_TICKS)
+        {
+            SDL_UnlockMutex(store->lock);
+            break;
+        }
+
+        if (!ChunkStorePack(store, index))
+        {
+            ChunkStoreUnlink(store, index);
+            ChunkStoreLink(store, index);
+            store->chunks[index].last_access = now;
+            SDL_UnlockMutex(store->lock);
+            continue;
+        }
+
+        count++;
+        SDL_UnlockMutex(store->lock);
+    }
+
+    return count;
+}
+
+/**
+ * \desc Resident chunks count their full size; compressed ones their packed
+ * size.
+ */
+[[nodiscard]] size_t ChunkStoreMemory(ChunkStore* store)
+{
+    SDL_LockMutex(store->lock);
+
+    size_t bytes = store->num_resident * CHUNK_BYTES;
+    const i32 num_chunks = store->chunks_w * store->chunks_h;
+    for (i32 i = 0; i < num_chunks; ++i)
+    {
+        bytes += store->chunks[i].packed_size;
+    }
+
+    SDL_UnlockMutex(store->lock);
+
+    return bytes;
+}
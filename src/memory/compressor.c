@@ -0,0 +1,116 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file compressor.c
+ *
+ * \brief The compressor is a background thread which periodically compresses
+ * the cold chunks of every chunk store registered with it.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "memory/compressor.h"
+
+/**
+ * \desc The thread sleeps on the condition between passes, which also lets it
+ * be woken straight away when it is to stop. Each pass compresses a bounded
+ * number of chunks per store.
+ */
+static i32 CompressorRun(void* data)
+{
+    Compressor* comp = data;
+
+    SDL_LockMutex(comp->lock);
+    while (comp->running)
+    {
+        SDL_CondWaitTimeout(comp->wake, comp->lock, COMPRESSOR_INTERVAL);
+        if (!comp->running)
+        {
+            break;
+        }
+
+        const u32 now = SDL_GetTicks();
+        for (size_t i = 0; i < VectorLength(comp->stores); ++i)
+        {
+            ChunkStoreCompressCold(VectorAt(comp->stores, i), now,
+                                   COMPRESSOR_BUDGET);
+        }
+    }
+    SDL_UnlockMutex(comp->lock);
+
+    return 0;
+}
+
+/**
+ * \desc Allocates the compressor with no stores and starts the thread.
+ */
+[[nodiscard]] Compressor* CompressorCreate(void)
+{
+    Compressor* comp = Allocate(sizeof(Compressor));
+    comp->stores = VectorCreate();
+    comp->running = true;
+    comp->lock = SDL_CreateMutex();
+    comp->wake = SDL_CreateCond();
+
+    if (comp->lock == NULL || comp->wake == NULL)
+    {
+        Log(LOG_FATAL, "Could not create compressor: %s", SDL_GetError());
+    }
+
+    comp->thread = SDL_CreateThread(CompressorRun, "compressor", comp);
+    if (comp->thread == NULL)
+    {
+        Log(LOG_FATAL, "Could not start compressor: %s", SDL_GetError());
+    }
+
+    return comp;
+}
+
+/**
+ * \desc Clears the running flag, wakes the thread and waits for it to finish
+ * before freeing anything it uses.
+ */
+void CompressorFree(Compressor* comp)
+{
+    SDL_LockMutex(comp->lock);
+    comp->running = false;
+    SDL_CondSignal(comp->wake);
+    SDL_UnlockMutex(comp->lock);
+
+    SDL_WaitThread(comp->thread, NULL);
+
+    VectorFree(comp->stores);
+    SDL_DestroyCond(comp->wake);
+    SDL_DestroyMutex(comp->lock);
+    Free(comp);
+}
+
+/**
+ * \desc Adds the store under the lock, i.e. between passes.
+ */
+void CompressorAdd(Compressor* comp, ChunkStore* store)
+{
+    SDL_LockMutex(comp->lock);
+    VectorPush(comp->stores, store);
+    SDL_UnlockMutex(comp->lock);
+}
+
+/**
+ * \desc Removes the store under the lock, i.e. between passes.
+ */
+void CompressorRemove(Compressor* comp, const ChunkStore* store)
+{
+    SDL_LockMutex(comp->lock);
+    for (size_t i = 0; i < VectorLength(comp->stores); ++i)
+    {
+        if (VectorAt(comp->stores, i) == store)
+        {
+            VectorDelete(comp->stores, i);
+            break;
+        }
+    }
+    SDL_UnlockMutex(comp->lock);
+}
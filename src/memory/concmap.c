@@ -0,0 +1,374 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file concmap.c
+ *
+ * \brief A concurrent map is a read-mostly hashmap which may be searched from
+ * any thread without taking a lock. Writers are serialised by a mutex and never
+ * modify a record in place: records and tables are replaced atomically and the
+ * old ones are only freed once no reader can still be looking at them.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "memory/concmap.h"
+
+/**
+ * \desc Marks a slot whose record was deleted. Probing continues past it, and
+ * inserts may reuse the slot.
+ */
+static ConcurrentRecord CONCMAP_DELETED_RECORD = {0};
+
+/**
+ * \desc Allocates a record and copies the key. Records are never modified once
+ * they have been published to a table.
+ */
+[[nodiscard]] ConcurrentRecord* ConcurrentRecordCreate(const char* key,
+                                                       void* value, u32 hash)
+{
+    ConcurrentRecord* record = Allocate(sizeof(ConcurrentRecord));
+    record->key = Allocate(strlen(key) + 1);
+    strcpy(record->key, key);
+    record->value = value;
+    record->hash = hash;
+
+    return record;
+}
+
+/**
+ * \desc Frees the key copy and the record itself.
+ */
+void ConcurrentRecordFree(ConcurrentRecord* record)
+{
+    Free(record->key);
+    Free(record);
+}
+
+/**
+ * \desc Allocates a table along with its zeroed (empty) record slots.
+ */
+[[nodiscard]] ConcurrentTable* ConcurrentTableCreate(size_t size)
+{
+    ConcurrentTable* table = Allocate(sizeof(ConcurrentTable));
+    table->size = size;
+    table->used = 0;
+    table->records = Allocate(sizeof(ConcurrentRecord*) * size);
+
+    return table;
+}
+
+/**
+ * \desc Frees the slots and the table. The records may still be referenced by
+ * another table, so they are left alone.
+ */
+void ConcurrentTableFree(ConcurrentTable* table)
+{
+    Free(table->records);
+    Free(table);
+}
+
+/**
+ * \desc Creates the map with an empty table of the initial size, and the mutex
+ * which serialises writers. A free function is also passed in so that values
+ * can be freed when replaced, deleted or when the map itself is freed.
+ */
+[[nodiscard]] ConcurrentMap* ConcurrentMapCreate(void (*free)())
+{
+    ConcurrentMap* map = Allocate(sizeof(ConcurrentMap));
+    map->table = ConcurrentTableCreate(CONCMAP_INITIAL_SIZE);
+    map->count = 0;
+    map->write_lock = SDL_CreateMutex();
+    map->functions.free = free;
+
+    if (map->write_lock == NULL)
+    {
+        Log(LOG_FATAL, "Could not create concurrent map lock: %s",
+            SDL_GetError());
+    }
+
+    return map;
+}
+
+/**
+ * \desc As no other thread may use the map, there is no need to synchronise:
+ * every live record is freed (along with its value if recursive is set), then
+ * the table, lock and map.
+ */
+void ConcurrentMapFree(ConcurrentMap* map, bool recursive)
+{
+    ConcurrentTable* table = map->table;
+    for (size_t i = 0; i < table->size; ++i)
+    {
+        ConcurrentRecord* record = table->records[i];
+        if (record == NULL || record == &CONCMAP_DELETED_RECORD)
+        {
+            continue;
+        }
+
+        if (recursive)
+        {
+            if (map->functions.free)
+            {
+                (*map->functions.free)(record->value);
+            }
+            else
+            {
+                Free(record->value);
+            }
+        }
+
+        ConcurrentRecordFree(record);
+    }
+
+    ConcurrentTableFree(table);
+    SDL_DestroyMutex(map->write_lock);
+    Free(map);
+}
+
+/**
+ * \desc Frees a value which has been unlinked from the map, using the map free
+ * function if one was provided.
+ */
+static void ConcurrentMapFreeValue(const ConcurrentMap* map, void* value)
+{
+    if (map->functions.free)
+    {
+        (*map->functions.free)(value);
+    }
+    else
+    {
+        Free(value);
+    }
+}
+
+/**
+ * \desc Rebuilds the table once the used slots (live or deleted) exceed the
+ * load limit. The new table is sized so that the live records take up at most
+ * half of the load limit, and is filled before it is published, so readers see
+ * either the complete old table or the complete new one. The records are
+ * shared between both tables, so only the old slots are freed afterwards.
+ */
+static void ConcurrentMapGrow(ConcurrentMap* map)
+{
+    ConcurrentTable* table = map->table;
+    if ((table->used + 1) * 100 <= table->size * CONCMAP_LOAD_INCREASE)
+    {
+        return;
+    }
+
+    size_t size = table->size;
+    while ((map->count + 1) * 200 > size * CONCMAP_LOAD_INCREASE)
+    {
+        size <<= 1;
+    }
+
+    ConcurrentTable* new_table = ConcurrentTableCreate(size);
+    const size_t mask = size - 1;
+    for (size_t i = 0; i < table->size; ++i)
+    {
+        ConcurrentRecord* record = table->records[i];
+        if (record == NULL || record == &CONCMAP_DELETED_RECORD)
+        {
+            continue;
+        }
+
+        size_t index = record->hash & mask;
+        while (new_table->records[index] != NULL)
+        {
+            index = (index + 1) & mask;
+        }
+
+        new_table->records[index] = record;
+        new_table->used++;
+    }
+
+    SDL_AtomicSetPtr((void**)&map->table, new_table);
+    ConcurrentMapSynchronise(map);
+    ConcurrentTableFree(table);
+}
+
+/**
+ * \desc Inserts under the write lock. The probe runs until an empty slot so
+ * that an existing record for the key is always found; the first deleted slot
+ * along the way is remembered for reuse. An existing record is replaced by a
+ * new one, and the old record and value are freed once the readers which may
+ * have seen them have finished. Records are fully built before they are stored,
+ * and the atomic store acts as a full barrier, so readers never see a partially
+ * initialised record.
+ */
+void ConcurrentMapInsert(ConcurrentMap* map, const char* key, void* value)
+{
+    SDL_LockMutex(map->write_lock);
+
+    ConcurrentMapGrow(map);
+
+    ConcurrentTable* table = map->table;
+    const u32 hash = PerfectHashFunction(key, 0);
+    const size_t mask = table->size - 1;
+
+    size_t index = hash & mask;
+    size_t reuse = table->size;
+    ConcurrentRecord* record = table->records[index];
+    while (record != NULL)
+    {
+        if (record == &CONCMAP_DELETED_RECORD)
+        {
+            reuse = reuse == table->size ? index : reuse;
+        }
+        else if (record->hash == hash && strcmp(record->key, key) == 0)
+        {
+            break;
+        }
+
+        index = (index + 1) & mask;
+        record = table->records[index];
+    }
+
+    ConcurrentRecord* new_record = ConcurrentRecordCreate(key, value, hash);
+
+    if (record != NULL)
+    {
+        SDL_AtomicSetPtr((void**)&table->records[index], new_record);
+        ConcurrentMapSynchronise(map);
+        ConcurrentMapFreeValue(map, record->value);
+        ConcurrentRecordFree(record);
+    }
+    else if (reuse != table->size)
+    {
+        SDL_AtomicSetPtr((void**)&table->records[reuse], new_record);
+        map->count++;
+    }
+    else
+    {
+        SDL_AtomicSetPtr((void**)&table->records[index], new_record);
+        table->used++;
+        map->count++;
+    }
+
+    SDL_UnlockMutex(map->write_lock);
+}
+
+/**
+ * \desc Probes the currently published table without taking the write lock. The
+ * reader is counted for the duration of the probe so that no writer frees the
+ * table, or a record within it, whilst it is being read. A full table cannot
+ * occur due to the load limit, but the probe is bounded regardless.
+ */
+void* ConcurrentMapSearch(ConcurrentMap* map, const char* key)
+{
+    const u32 hash = PerfectHashFunction(key, 0);
+    const i32 parity = ConcurrentMapEnter(map);
+
+    ConcurrentTable* table = SDL_AtomicGetPtr((void**)&map->table);
+    const size_t mask = table->size - 1;
+    void* value = NULL;
+
+    size_t index = hash & mask;
+    for (size_t i = 0; i < table->size; ++i)
+    {
+        ConcurrentRecord* record =
+            SDL_AtomicGetPtr((void**)&table->records[index]);
+        if (record == NULL)
+        {
+            break;
+        }
+
+        if (record != &CONCMAP_DELETED_RECORD && record->hash == hash &&
+            strcmp(record->key, key) == 0)
+        {
+            value = record->value;
+            break;
+        }
+
+        index = (index + 1) & mask;
+    }
+
+    ConcurrentMapExit(map, parity);
+    return value;
+}
+
+/**
+ * \desc Replaces the record of the key with the deleted marker under the write
+ * lock, then frees the record and its value once no reader can hold it.
+ */
+void ConcurrentMapDelete(ConcurrentMap* map, const char* key)
+{
+    SDL_LockMutex(map->write_lock);
+
+    ConcurrentTable* table = map->table;
+    const u32 hash = PerfectHashFunction(key, 0);
+    const size_t mask = table->size - 1;
+
+    size_t index = hash & mask;
+    ConcurrentRecord* record = table->records[index];
+    while (record != NULL)
+    {
+        if (record != &CONCMAP_DELETED_RECORD && record->hash == hash &&
+            strcmp(record->key, key) == 0)
+        {
+            SDL_AtomicSetPtr((void**)&table->records[index],
+                             &CONCMAP_DELETED_RECORD);
+            map->count--;
+            ConcurrentMapSynchronise(map);
+            ConcurrentMapFreeValue(map, record->value);
+            ConcurrentRecordFree(record);
+
+            SDL_UnlockMutex(map->write_lock);
+            return;
+        }
+
+        index = (index + 1) & mask;
+        record = table->records[index];
+    }
+
+    SDL_UnlockMutex(map->write_lock);
+    Log(LOG_NOTIFY, "Could not delete record with key %s from concurrent map!",
+        key);
+}
+
+/**
+ * \desc A reader is counted against the parity of the epoch it observed. If a
+ * writer advanced the epoch between reading it and being counted, the writer
+ * may already have stopped waiting on that parity, so the reader withdraws and
+ * tries again with the new epoch. SDL atomic operations are full barriers.
+ */
+[[nodiscard]] i32 ConcurrentMapEnter(ConcurrentMap* map)
+{
+    for (;;)
+    {
+        const i32 epoch = SDL_AtomicGet(&map->epoch);
+        SDL_AtomicAdd(&map->readers[epoch & 1], 1);
+        if (SDL_AtomicGet(&map->epoch) == epoch)
+        {
+            return epoch & 1;
+        }
+
+        SDL_AtomicAdd(&map->readers[epoch & 1], -1);
+    }
+}
+
+/**
+ * \desc Withdraws the reader from the parity it was counted in.
+ */
+void ConcurrentMapExit(ConcurrentMap* map, i32 parity)
+{
+    SDL_AtomicAdd(&map->readers[parity], -1);
+}
+
+/**
+ * \desc Advances the epoch so that new readers are counted against the other
+ * parity, and then waits for the readers of the previous parity to finish.
+ * Those are the only readers which could have seen what the writer unlinked
+ * before calling this function.
+ */
+void ConcurrentMapSynchronise(ConcurrentMap* map)
+{
+    const i32 epoch = SDL_AtomicAdd(&map->epoch, 1);
+    while (SDL_AtomicGet(&map->readers[epoch & 1]) != 0)
+    {
+        SDL_Delay(0);
+    }
+}
@@ -0,0 +1,427 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file lz.c
+ *
+ * \brief A small, fast LZ77 block codec in the style of LZ4. It trades ratio
+ * for speed: compression is a single greedy pass with a hash table of recent
+ * positions, and decompression is little more than a sequence of copies.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "memory/lz.h"
+
+/**
+ * \brief A piece of a sample, scored whilst training a dictionary.
+ */
+typedef struct
+{
+    const u8* data;
+    u64 score;
+} LzSegment;
+
+/**
+ * \desc Reads four bytes without any alignment requirement.
+ */
+static u32 LzRead32(const u8* src)
+{
+    u32 value = 0;
+    memcpy(&value, src, sizeof(value));
+    return value;
+}
+
+/**
+ * \desc Multiplicative hash of four bytes down to the table size.
+ */
+static u32 LzHash(u32 sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/**
+ * \desc Multiplicative hash of the sequence of bytes counted whilst training,
+ * down to the size of its table.
+ */
+static u32 LzTrainHash(const u8* src)
+{
+    u64 sequence = 0;
+    memcpy(&sequence, src, sizeof(sequence));
+    return (u32)((sequence * 0x9E3779B97F4A7C15ull) >> (64 - LZ_TRAIN_BITS));
+}
+
+/**
+ * \desc Writes the extra bytes of a length which did not fit in its nibble:
+ * runs of 255 followed by the remainder.
+ */
+static bool LzWriteLength(u8* dst, size_t capacity, size_t* op, size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        if (*op >= capacity)
+        {
+            return false;
+        }
+        dst[(*op)++] = 255;
+    }
+
+    if (*op >= capacity)
+    {
+        return false;
+    }
+    dst[(*op)++] = (u8)length;
+
+    return true;
+}
+
+/**
+ * \desc Writes a token with its literals and, if the length is non-zero, a
+ * match. Returns false if the output would overflow.
+ */
+static bool LzWriteSequence(u8* dst, size_t capacity, size_t* op,
+                            const u8* literals, size_t num_literals,
+                            size_t offset, size_t match)
+{
+    if (*op >= capacity)
+    {
+        return false;
+    }
+
+    const size_t match_code = match ? match - LZ_MIN_MATCH : 0;
+    u8* token = &dst[(*op)++];
+    *token = (u8)((num_literals < 15 ? num_literals : 15) << 4 |
+                  (match_code < 15 ? match_code : 15));
+
+    if (num_literals >= 15 &&
+        !LzWriteLength(dst, capacity, op, num_literals - 15))
+    {
+        return false;
+    }
+
+    if (*op + num_literals > capacity)
+    {
+        return false;
+    }
+    memcpy(&dst[*op], literals, num_literals);
+    *op += num_literals;
+
+    if (match == 0)
+    {
+        return true;
+    }
+
+    if (*op + 2 > capacity)
+    {
+        return false;
+    }
+    dst[(*op)++] = (u8)(offset & 0xFF);
+    dst[(*op)++] = (u8)(offset >> 8);
+
+    return match_code < 15 || LzWriteLength(dst, capacity, op, match_code - 15);
+}
+
+/**
+ * \desc A greedy parse of the window from the start onwards, the bytes before
+ * it being a dictionary which is only matched against. At each position the
+ * hash table gives the last position with the same four bytes. If those bytes
+ * really match and are close enough, the match is extended as far as possible
+ * and emitted along with the literals since the previous match; otherwise the
+ * position becomes a literal. Matches never extend into the last few bytes,
+ * which are emitted as literals.
+ */
+static size_t LzCompressWindow(const u8* window, size_t start, size_t end,
+                               u8* dst, size_t capacity)
+{
+    u32 table[1 << LZ_HASH_BITS] = {0};
+    size_t ip = start, anchor = start, op = 0;
+
+    for (size_t p = 0; p + LZ_MIN_MATCH <= start; ++p)
+    {
+        table[LzHash(LzRead32(&window[p]))] = (u32)(p + 1);
+    }
+
+    const size_t match_end =
+        end > LZ_LAST_LITERALS ? end - LZ_LAST_LITERALS : 0;
+
+    while (ip + LZ_MIN_MATCH <= match_end)
+    {
+        const u32 sequence = LzRead32(&window[ip]);
+        const u32 hash = LzHash(sequence);
+        const size_t ref = table[hash];
+        table[hash] = (u32)(ip + 1);
+
+        if (ref == 0 || ip - (ref - 1) > LZ_MAX_OFFSET ||
+            LzRead32(&window[ref - 1]) != sequence)
+        {
+            ip++;
+            continue;
+        }
+
+        const size_t match = ref - 1;
+        size_t length = LZ_MIN_MATCH;
+        while (ip + length < match_end &&
+               window[match + length] == window[ip + length])
+        {
+            length++;
+        }
+
+        if (!LzWriteSequence(dst, capacity, &op, &window[anchor], ip - anchor,
+                             ip - match, length))
+        {
+            return 0;
+        }
+
+        ip += length;
+        anchor = ip;
+    }
+
+    if (!LzWriteSequence(dst, capacity, &op, &window[anchor], end - anchor, 0,
+                         0))
+    {
+        return 0;
+    }
+
+    return op;
+}
+
+/**
+ * \desc A block without a dictionary is a window which starts at the
+ * beginning.
+ */
+[[nodiscard]] size_t LzCompress(const u8* src, size_t size, u8* dst,
+                                size_t capacity)
+{
+    return LzCompressWindow(src, 0, size, dst, capacity);
+}
+
+/**
+ * \desc The end of the dictionary and the block are copied into one window,
+ * so that matches may run on from the dictionary into the block. Only as much
+ * of the dictionary as a match can reach back to is used.
+ */
+[[nodiscard]] size_t LzCompressDict(const u8* src, size_t size, const u8* dict,
+                                    size_t dict_size, u8* dst,
+                                    size_t capacity)
+{
+    if (dict_size == 0)
+    {
+        return LzCompressWindow(src, 0, size, dst, capacity);
+    }
+
+    const size_t start = SDL_min(dict_size, (size_t)LZ_MAX_OFFSET);
+    u8* window = Allocate(start + size);
+    memcpy(window, dict + dict_size - start, start);
+    memcpy(window + start, src, size);
+
+    const size_t written =
+        LzCompressWindow(window, start, start + size, dst, capacity);
+    Free(window);
+
+    return written;
+}
+
+/**
+ * \desc Reads the extra bytes of a length whose nibble was 15.
+ */
+static bool LzReadLength(const u8* src, size_t size, size_t* ip,
+                         size_t* length)
+{
+    u8 byte = 255;
+    while (byte == 255)
+    {
+        if (*ip >= size)
+        {
+            return false;
+        }
+        byte = src[(*ip)++];
+        *length += byte;
+    }
+
+    return true;
+}
+
+/**
+ * \desc Every length and offset is checked against the input and output before
+ * it is used, so a corrupt block fails rather than reading or writing out of
+ * bounds. Matches are copied byte by byte as they may overlap their output,
+ * and any bytes before the start of the output are taken from the end of the
+ * dictionary.
+ */
+[[nodiscard]] bool LzDecompressDict(const u8* src, size_t size,
+                                    const u8* dict, size_t dict_size, u8* dst,
+                                    size_t dst_size)
+{
+    size_t ip = 0, op = 0;
+    const size_t reach = SDL_min(dict_size, (size_t)LZ_MAX_OFFSET);
+    dict = reach ? dict + dict_size - reach : dict;
+
+    while (ip < size)
+    {
+        const u8 token = src[ip++];
+
+        size_t num_literals = token >> 4;
+        if (num_literals == 15 && !LzReadLength(src, size, &ip, &num_literals))
+        {
+            return false;
+        }
+
+        if (num_literals > size - ip || num_literals > dst_size - op)
+        {
+            return false;
+        }
+        memcpy(&dst[op], &src[ip], num_literals);
+        ip += num_literals;
+        op += num_literals;
+
+        if (ip == size)
+        {
+            break;
+        }
+
+        if (size - ip < 2)
+        {
+            return false;
+        }
+        const size_t offset = src[ip] | (size_t)src[ip + 1] << 8;
+        ip += 2;
+
+        size_t length = (token & 0x0F) + LZ_MIN_MATCH;
+        if ((token & 0x0F) == 15 && !LzReadLength(src, size, &ip, &length))
+        {
+            return false;
+        }
+
+        if (offset == 0 || offset > op + reach || length > dst_size - op)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < length; ++i, ++op)
+        {
+            dst[op] = offset > op ? dict[reach - (offset - op)]
+                                  : dst[op - offset];
+        }
+    }
+
+    return op == dst_size;
+}
+
+/**
+ * \desc A block without a dictionary may only refer back into its own output.
+ */
+[[nodiscard]] bool LzDecompress(const u8* src, size_t size, u8* dst,
+                                size_t dst_size)
+{
+    return LzDecompressDict(src, size, NULL, 0, dst, dst_size);
+}
+
+/**
+ * \desc Orders segments by descending score.
+ */
+static int LzSegmentSort(const void* a, const void* b)
+{
+    const LzSegment* sa = a;
+    const LzSegment* sb = b;
+    return sa->score > sb->score ? -1 : (sa->score < sb->score);
+}
+
+/**
+ * \desc Sums the counts of the sequences starting within a segment.
+ */
+static u64 LzSegmentScore(const u8* data, const u32* counts)
+{
+    u64 score = 0;
+    for (size_t p = 0; p + LZ_TRAIN_SEQUENCE <= LZ_TRAIN_SEGMENT; ++p)
+    {
+        score += counts[LzTrainHash(&data[p])];
+    }
+
+    return score;
+}
+
+/**
+ * \desc Each sequence is counted once for every sample it appears in, so that
+ * a sequence repeated within a single sample, which compresses well enough
+ * without a dictionary, does not outweigh one shared by many samples. The
+ * segments of every sample are scored by the counts of their sequences and
+ * taken best first. Once a segment is taken the counts of its sequences are
+ * cleared, and a later segment whose score has since fallen by half is mostly
+ * covered already and is skipped. A segment whose sequences each appear in a
+ * single sample has nothing to share and is never taken. The dictionary is
+ * filled from the end backwards.
+ */
+[[nodiscard]] size_t LzTrain(const u8* const* samples, const size_t* sizes,
+                             size_t count, u8* dict, size_t capacity)
+{
+    const size_t table_size = (size_t)1 << LZ_TRAIN_BITS;
+    u32* counts = Allocate(sizeof(u32) * table_size);
+    u32* seen = Allocate(sizeof(u32) * table_size);
+    size_t num_segments = 0;
+
+    for (size_t s = 0; s < count; ++s)
+    {
+        for (size_t p = 0; p + LZ_TRAIN_SEQUENCE <= sizes[s]; ++p)
+        {
+            const u32 hash = LzTrainHash(&samples[s][p]);
+            if (seen[hash] != s + 1)
+            {
+                seen[hash] = (u32)(s + 1);
+                counts[hash]++;
+            }
+        }
+
+        num_segments += sizes[s] / LZ_TRAIN_SEGMENT;
+    }
+
+    LzSegment* segments =
+        Allocate(sizeof(LzSegment) * SDL_max(num_segments, (size_t)1));
+    for (size_t s = 0, n = 0; s < count; ++s)
+    {
+        for (size_t p = 0; p + LZ_TRAIN_SEGMENT <= sizes[s];
+             p += LZ_TRAIN_SEGMENT)
+        {
+            segments[n].data = &samples[s][p];
+            segments[n].score = LzSegmentScore(&samples[s][p], counts);
+            n++;
+        }
+    }
+
+    qsort(segments, num_segments, sizeof(LzSegment), &LzSegmentSort);
+
+    const u64 unshared = LZ_TRAIN_SEGMENT - LZ_TRAIN_SEQUENCE + 1;
+    capacity = SDL_min(capacity, (size_t)LZ_MAX_OFFSET);
+    size_t filled = 0;
+
+    for (size_t i = 0; i < num_segments; ++i)
+    {
+        if (filled + LZ_TRAIN_SEGMENT > capacity ||
+            segments[i].score <= unshared)
+        {
+            break;
+        }
+
+        const u64 score = LzSegmentScore(segments[i].data, counts);
+        if (score <= unshared || 2 * score < segments[i].score)
+        {
+            continue;
+        }
+
+        filled += LZ_TRAIN_SEGMENT;
+        memcpy(&dict[capacity - filled], segments[i].data, LZ_TRAIN_SEGMENT);
+        for (size_t p = 0; p + LZ_TRAIN_SEQUENCE <= LZ_TRAIN_SEGMENT; ++p)
+        {
+            counts[LzTrainHash(&segments[i].data[p])] = 0;
+        }
+    }
+
+    memmove(dict, &dict[capacity - filled], filled);
+
+    Free(segments);
+    Free(seen);
+    Free(counts);
+
+    return filled;
+}
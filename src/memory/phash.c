@@ -0,0 +1,190 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file phash.c
+ *
+ * \brief A perfect hash is a read-only lookup table for a set of keys which is
+ * known at build time. The tables are emitted by the phashgen tool so that each
+ * key maps to its own slot: a lookup is a single probe with no collisions and
+ * no allocation.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "memory/phash.h"
+
+/**
+ * \desc An FNV-1a hash where the seed is folded into the offset basis. Small
+ * seeds only differ in the lower bits, so the result is finalised with an
+ * avalanche step to spread every seed across the whole 32-bit range. The
+ * phashgen tool uses this exact function, so changing it requires regenerating
+ * every table.
+ */
+[[nodiscard]] u32 PerfectHashFunction(const char* str, u32 seed)
+{
+    u32 hash = PHASH_OFFSET ^ (seed * PHASH_PRIME);
+    for (const u8* c = (const u8*)str; *c; ++c)
+    {
+        hash ^= *c;
+        hash *= PHASH_PRIME;
+    }
+
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+/**
+ * \brief The size of a bucket, for ordering the buckets whilst generating.
+ */
+typedef struct
+{
+    u32 size;
+    u32 index;
+} PerfectHashBucket;
+
+/**
+ * \desc Orders buckets by descending size, and otherwise by index, so that the
+ * order does not depend on how qsort breaks ties.
+ */
+static int PerfectHashBucketSort(const void* a, const void* b)
+{
+    const PerfectHashBucket* ba = a;
+    const PerfectHashBucket* bb = b;
+    if (ba->size != bb->size)
+    {
+        return ba->size > bb->size ? -1 : 1;
+    }
+
+    return ba->index < bb->index ? -1 : (ba->index > bb->index);
+}
+
+/**
+ * \desc The keys are grouped by bucket, and the buckets resolved largest
+ * first, as these are the hardest to place while the slot table is still
+ * sparse. For each bucket, displacement seeds are tried in turn until every key
+ * of the bucket lands in a free slot distinct from the others in the same
+ * bucket. Grouping the keys means each attempt only hashes the keys of its own
+ * bucket, so that tables of many thousands of keys are built quickly.
+ */
+[[nodiscard]] bool PerfectHashGenerate(const char* const* keys, size_t count,
+                                       size_t num_buckets, u32* displacements,
+                                       u32* slots)
+{
+    u32* offsets = Allocate(sizeof(u32) * (num_buckets + 1));
+    u32* members = Allocate(sizeof(u32) * (count ? count : 1));
+    u32* taken = Allocate(sizeof(u32) * (count ? count : 1));
+    bool* used = Allocate(sizeof(bool) * (count ? count : 1));
+    PerfectHashBucket* order =
+        Allocate(sizeof(PerfectHashBucket) * num_buckets);
+
+    u32* buckets = Allocate(sizeof(u32) * (count ? count : 1));
+    for (size_t i = 0; i < count; ++i)
+    {
+        buckets[i] = PerfectHashFunction(keys[i], 0) % num_buckets;
+        offsets[buckets[i] + 1]++;
+    }
+
+    for (size_t b = 0; b < num_buckets; ++b)
+    {
+        order[b] = (PerfectHashBucket){offsets[b + 1], (u32)b};
+        offsets[b + 1] += offsets[b];
+        displacements[b] = 0;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        members[offsets[buckets[i]]++] = (u32)i;
+    }
+
+    qsort(order, num_buckets, sizeof(PerfectHashBucket),
+          &PerfectHashBucketSort);
+
+    bool placed = true;
+    for (size_t k = 0; k < num_buckets && order[k].size && placed; ++k)
+    {
+        const u32* bucket =
+            &members[offsets[order[k].index] - order[k].size];
+        placed = false;
+
+        for (u32 d = 1; d < PHASH_MAX_ATTEMPTS && !placed; ++d)
+        {
+            placed = true;
+            for (u32 i = 0; i < order[k].size && placed; ++i)
+            {
+                taken[i] = PerfectHashFunction(keys[bucket[i]], d) % count;
+                placed = !used[taken[i]];
+                for (u32 j = 0; j < i && placed; ++j)
+                {
+                    placed = taken[j] != taken[i];
+                }
+            }
+
+            if (placed)
+            {
+                displacements[order[k].index] = d;
+            }
+        }
+
+        for (u32 i = 0; i < order[k].size && placed; ++i)
+        {
+            used[taken[i]] = true;
+            slots[taken[i]] = bucket[i];
+        }
+    }
+
+    Free(buckets);
+    Free(order);
+    Free(used);
+    Free(taken);
+    Free(members);
+    Free(offsets);
+
+    return placed;
+}
+
+/**
+ * \desc The bucket for the key is found from its unseeded hash, and the
+ * displacement of that bucket gives the only slot the key could occupy.
+ */
+[[nodiscard]] i32 PerfectHashSlot(const u32* displacements,
+                                  size_t num_buckets, size_t count,
+                                  const char* key)
+{
+    if (count == 0)
+    {
+        return -1;
+    }
+
+    const u32 bucket = PerfectHashFunction(key, 0) % num_buckets;
+    const u32 displacement = displacements[bucket];
+    if (displacement == 0)
+    {
+        return -1;
+    }
+
+    return (i32)(PerfectHashFunction(key, displacement) % count);
+}
+
+/**
+ * \desc The key stored in the only slot the key could occupy is compared
+ * against the searched key, as keys outside of the set still hash to some slot.
+ */
+[[nodiscard]] i32 PerfectHashLookup(const PerfectHash* phash, const char* key)
+{
+    const i32 slot = PerfectHashSlot(phash->displacements, phash->num_buckets,
+                                     phash->count, key);
+    if (slot < 0 || strcmp(phash->keys[slot], key) != 0)
+    {
+        return -1;
+    }
+
+    return slot;
+}
@@ -0,0 +1,159 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file timingwheel.c
+ *
+ * \brief A timing wheel schedules keys to expire at given times. Time is split
+ * into slots of a fixed resolution which wrap around the wheel, so scheduling
+ * is constant time and advancing the wheel only visits the slots which have
+ * passed, however many keys are scheduled further ahead.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "memory/timingwheel.h"
+
+/**
+ * \desc The initial number of entries in the pool.
+ */
+#define TIMING_WHEEL_CAPACITY 64
+
+/**
+ * \desc Links a run of new entries, from first up to the capacity, onto the
+ * free list.
+ */
+static void TimingWheelFreeEntries(TimingWheel* wheel, size_t first)
+{
+    for (size_t i = wheel->capacity; i-- > first;)
+    {
+        wheel->entries[i].next = wheel->free;
+        wheel->free = (i32)i;
+    }
+}
+
+/**
+ * \desc Allocates the wheel with every slot empty and every entry free.
+ */
+[[nodiscard]] TimingWheel* TimingWheelCreate(u32 resolution, u32 now)
+{
+    TimingWheel* wheel = Allocate(sizeof(TimingWheel));
+    wheel->capacity = TIMING_WHEEL_CAPACITY;
+    wheel->entries = Allocate(sizeof(TimingEntry) * wheel->capacity);
+    wheel->count = 0;
+    wheel->free = -1;
+    wheel->resolution = resolution ? resolution : 1;
+    wheel->now = now;
+
+    for (size_t i = 0; i < TIMING_WHEEL_SLOTS; ++i)
+    {
+        wheel->slots[i] = -1;
+    }
+    TimingWheelFreeEntries(wheel, 0);
+
+    return wheel;
+}
+
+/**
+ * \desc Frees the pool, then the wheel itself.
+ */
+void TimingWheelFree(TimingWheel* wheel)
+{
+    Free(wheel->entries);
+    Free(wheel);
+}
+
+/**
+ * \desc Takes an entry from the free list, doubling the pool when it is empty,
+ * and pushes it onto the front of the slot of its due time.
+ */
+void TimingWheelSchedule(TimingWheel* wheel, u32 key, u32 due)
+{
+    if (wheel->free < 0)
+    {
+        TimingEntry* entries =
+            Allocate(sizeof(TimingEntry) * wheel->capacity * 2);
+        memcpy(entries, wheel->entries, sizeof(TimingEntry) * wheel->capacity);
+        Free(wheel->entries);
+        wheel->entries = entries;
+        wheel->capacity *= 2;
+        TimingWheelFreeEntries(wheel, wheel->capacity / 2);
+    }
+
+    if (due < wheel->now)
+    {
+        due = wheel->now;
+    }
+
+    const i32 index = wheel->free;
+    const size_t slot = (due / wheel->resolution) & (TIMING_WHEEL_SLOTS - 1);
+
+    TimingEntry* entry = &wheel->entries[index];
+    wheel->free = entry->next;
+    entry->key = key;
+    entry->due = due;
+    entry->next = wheel->slots[slot];
+    wheel->slots[slot] = index;
+    wheel->count++;
+}
+
+/**
+ * \desc Visits each slot passed since the last advance (at most one turn of the
+ * wheel, which covers every slot) and unlinks the entries that are due onto a
+ * list of their own. Only then are they expired and freed, so that a key
+ * scheduled again whilst expiring is not expired twice in the same advance.
+ */
+size_t TimingWheelAdvance(TimingWheel* wheel, u32 now,
+                          void (*expire)(void* data, u32 key), void* data)
+{
+    if (now < wheel->now)
+    {
+        return 0;
+    }
+
+    const u32 first = wheel->now / wheel->resolution;
+    const u32 last =
+        SDL_min(now / wheel->resolution, first + TIMING_WHEEL_SLOTS - 1);
+    i32 expired = -1;
+
+    for (u32 tick = first; tick <= last; ++tick)
+    {
+        i32* link = &wheel->slots[tick & (TIMING_WHEEL_SLOTS - 1)];
+        while (*link >= 0)
+        {
+            TimingEntry* entry = &wheel->entries[*link];
+            if (entry->due > now)
+            {
+                link = &entry->next;
+                continue;
+            }
+
+            const i32 index = *link;
+            *link = entry->next;
+            entry->next = expired;
+            expired = index;
+        }
+    }
+
+    wheel->now = now;
+
+    size_t count = 0;
+    while (expired >= 0)
+    {
+        TimingEntry* entry = &wheel->entries[expired];
+        const i32 next = entry->next;
+        const u32 key = entry->key;
+
+        entry->next = wheel->free;
+        wheel->free = expired;
+        wheel->count--;
+        count++;
+
+        expire(data, key);
+        expired = next;
+    }
+
+    return count;
+}
@@ -152,7 +152,7 @@ void VectorDelete(Vector* vec, size_t index)
 
     vec->data[index] = NULL;
 
-    for (size_t i = 0; i < vec->size - 1; ++i)
+    for (size_t i = index; i < vec->size - 1; ++i)
     {
         vec->data[i] = vec->data[i + 1];
         vec->data[i + 1] = NULL;
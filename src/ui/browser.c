@@ -0,0 +1,697 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file browser.c
+ *
+ * \brief A file browser shows the maps and subdirectories of a directory as a
+ * grid of thumbnails. Directories are listed and thumbnails made on worker
+ * threads, so that the browser stays smooth however many maps there are, with
+ * the thumbnails streaming in as they are ready.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "ui/browser.h"
+
+/**
+ * \brief A growable list of entries, filled whilst a directory is listed.
+ */
+typedef struct
+{
+    BrowserEntry* entries;
+    size_t count;
+    size_t capacity;
+} BrowserList;
+
+/**
+ * \desc Works out how many thumbnails fit across the browser, never fewer
+ * than one.
+ */
+static i32 BrowserColumns(const Browser* browser)
+{
+    return SDL_max(browser->rect.w / BROWSER_THUMB_SIZE, 1);
+}
+
+/**
+ * \desc Works out how many rows of thumbnails fit below the header, never
+ * fewer than one.
+ */
+static i32 BrowserRows(const Browser* browser)
+{
+    return SDL_max((browser->rect.h - 1) / BROWSER_THUMB_SIZE, 1);
+}
+
+/**
+ * \desc Works out the range of entries in the rows shown, widened by a number
+ * of rows either side and clamped to the entries there are.
+ */
+static void BrowserRange(const Browser* browser, i32 margin, size_t* first,
+                         size_t* last)
+{
+    const i32 columns = BrowserColumns(browser);
+    const i32 top = SDL_max(browser->scroll - margin, 0);
+    const i32 bottom = browser->scroll + BrowserRows(browser) + margin;
+
+    *first = SDL_min((size_t)(top * columns), browser->count);
+    *last = SDL_min((size_t)(bottom * columns), browser->count);
+}
+
+/**
+ * \desc Joins the name of an entry onto the path of its directory, failing if
+ * the path would be too long.
+ */
+static bool BrowserJoin(const char* dir, const char* name, char* dest,
+                        size_t size)
+{
+    const i32 length = snprintf(dest, size, "%s/%s", dir, name);
+    if (length < 0 || (size_t)length >= size)
+    {
+        Log(LOG_WARNING, "The path of %s is too long", name);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \desc Frees the pixels and texture of every entry, then the entries
+ * themselves, if there are any.
+ */
+static void BrowserClear(Browser* browser)
+{
+    for (size_t i = 0; i < browser->count; ++i)
+    {
+        BrowserEntry* entry = &browser->entries[i];
+        ThumbnailClear(&entry->thumb);
+        if (entry->texture)
+        {
+            SDL_DestroyTexture(entry->texture);
+        }
+    }
+
+    if (browser->entries)
+    {
+        Free(browser->entries);
+    }
+    browser->entries = NULL;
+    browser->count = 0;
+}
+
+/**
+ * \desc Adds an entry to the end of a list.
+ */
+static void BrowserPush(BrowserList* list, const char* name, bool is_dir)
+{
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity << 1 : 64;
+        list->entries =
+            Reallocate(list->entries, sizeof(BrowserEntry) * list->capacity);
+    }
+
+    BrowserEntry* entry = &list->entries[list->count++];
+    *entry = (BrowserEntry){0};
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    entry->is_dir = is_dir;
+}
+
+/**
+ * \desc Keeps each subdirectory, pack and map file, leaving out hidden entries
+ * (such as the thumbnail cache), any other file and any name too long to be
+ * held. A pack is browsed into like a subdirectory.
+ */
+static void BrowserAddEntry(void* data, const char* name, bool is_dir)
+{
+    const size_t length = strlen(name);
+    const size_t ext = sizeof(MAP_EXTENSION) - 1;
+    if (name[0] == '.' || length >= BROWSER_MAX_NAME)
+    {
+        return;
+    }
+
+    if (!is_dir && PackIsPath(name))
+    {
+        is_dir = true;
+    }
+    else if (!is_dir && (length <= ext ||
+                         strcmp(name + length - ext, MAP_EXTENSION) != 0))
+    {
+        return;
+    }
+
+    BrowserPush(data, name, is_dir);
+}
+
+/**
+ * \desc Orders subdirectories before maps, then by name.
+ */
+static int BrowserEntrySort(const void* a, const void* b)
+{
+    const BrowserEntry* ea = a;
+    const BrowserEntry* eb = b;
+    if (ea->is_dir != eb->is_dir)
+    {
+        return ea->is_dir ? -1 : 1;
+    }
+
+    return strcmp(ea->name, eb->name);
+}
+
+/**
+ * \desc Lists the directory, or the maps of a pack, without the lock, as it
+ * may take a while. The listing is only handed over if no other directory has
+ * been opened in the meantime, replacing any listing not yet taken up. Called
+ * and returns with the lock held.
+ */
+static void BrowserScan(Browser* browser)
+{
+    char dir[BROWSER_MAX_PATH] = {0};
+    memcpy(dir, browser->dir, sizeof(dir));
+    const u32 generation = browser->generation;
+    browser->scan = false;
+    browser->scanning = true;
+    SDL_UnlockMutex(browser->lock);
+
+    BrowserList list = {0};
+    BrowserPush(&list, "..", true);
+    const bool ok = PackIsPath(dir) ? PackList(dir, &BrowserAddEntry, &list)
+                                    : FileList(dir, &BrowserAddEntry, &list);
+    if (!ok)
+    {
+        Log(LOG_WARNING, "Could not list the files of %s", dir);
+    }
+    qsort(&list.entries[1], list.count - 1, sizeof(BrowserEntry),
+          &BrowserEntrySort);
+
+    SDL_LockMutex(browser->lock);
+    browser->scanning = false;
+    if (generation == browser->generation)
+    {
+        if (browser->listing)
+        {
+            Free(browser->listing);
+        }
+        browser->listing = list.entries;
+        browser->listing_count = list.count;
+    }
+    else if (list.entries)
+    {
+        Free(list.entries);
+    }
+}
+
+/**
+ * \desc Finds the next map without a thumbnail, taking those in the rows shown
+ * before those just beyond them.
+ */
+static bool BrowserNextThumb(const Browser* browser, size_t* index)
+{
+    size_t first = 0, last = 0, near_first = 0, near_last = 0;
+    BrowserRange(browser, 0, &first, &last);
+    BrowserRange(browser, BROWSER_PREFETCH, &near_first, &near_last);
+
+    for (size_t pass = 0; pass < 2; ++pass)
+    {
+        const size_t from = pass ? near_first : first;
+        const size_t to = pass ? near_last : last;
+        for (size_t i = from; i < to; ++i)
+        {
+            const BrowserEntry* entry = &browser->entries[i];
+            if (!entry->is_dir && entry->state == BROWSER_THUMB_NONE)
+            {
+                *index = i;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/**
+ * \desc Makes the thumbnail of an entry without the lock. The thumbnail is only
+ * kept if the entry is still waiting for it, which it is not if another
+ * directory has been opened in the meantime. Called and returns with the lock
+ * held.
+ */
+static void BrowserMakeThumb(Browser* browser, size_t index)
+{
+    char path[BROWSER_MAX_PATH] = {0};
+    char cache[BROWSER_MAX_PATH] = {0};
+    BrowserEntry* entry = &browser->entries[index];
+    BrowserJoin(browser->dir, entry->name, path, sizeof(path));
+    memcpy(cache, browser->cache, sizeof(cache));
+    const u32 generation = browser->generation;
+    entry->state = BROWSER_THUMB_PENDING;
+    SDL_UnlockMutex(browser->lock);
+
+    Thumbnail thumb = {0};
+    const bool ok = ThumbnailFetch(path, cache, &thumb);
+
+    SDL_LockMutex(browser->lock);
+    if (generation != browser->generation || index >= browser->count ||
+        browser->entries[index].state != BROWSER_THUMB_PENDING)
+    {
+        ThumbnailClear(&thumb);
+        return;
+    }
+
+    entry = &browser->entries[index];
+    entry->thumb = thumb;
+    entry->state = ok ? BROWSER_THUMB_READY : BROWSER_THUMB_FAILED;
+}
+
+/**
+ * \desc Each worker lists the directory if it needs listing and no other
+ * worker is already doing so, or else makes the next thumbnail wanted, or else
+ * sleeps on the condition until there is more to do.
+ */
+static i32 BrowserRun(void* data)
+{
+    Browser* browser = data;
+
+    SDL_LockMutex(browser->lock);
+    while (browser->running)
+    {
+        size_t index = 0;
+        if (browser->scan && !browser->scanning)
+        {
+            BrowserScan(browser);
+        }
+        else if (BrowserNextThumb(browser, &index))
+        {
+            BrowserMakeThumb(browser, index);
+        }
+        else
+        {
+            SDL_CondWait(browser->wake, browser->lock);
+        }
+    }
+    SDL_UnlockMutex(browser->lock);
+
+    return 0;
+}
+
+/**
+ * \desc Allocates the browser with no directory and starts the workers, which
+ * sleep until a directory is opened.
+ */
+[[nodiscard]] Browser* BrowserCreate(SDL_Rect rect)
+{
+    Browser* browser = Allocate(sizeof(Browser));
+    browser->rect = rect;
+    browser->entries = NULL;
+    browser->count = 0;
+    browser->listing = NULL;
+    browser->listing_count = 0;
+    browser->generation = 0;
+    browser->scan = false;
+    browser->scanning = false;
+    browser->scroll = 0;
+    browser->hovered = -1;
+    browser->header = LabelCreate(rect.x, rect.y, "", LIGHTGREY, BLACK);
+    browser->pick = false;
+    browser->running = true;
+    browser->lock = SDL_CreateMutex();
+    browser->wake = SDL_CreateCond();
+
+    if (browser->lock == NULL || browser->wake == NULL)
+    {
+        Log(LOG_FATAL, "Could not create file browser: %s", SDL_GetError());
+    }
+
+    for (size_t i = 0; i < BROWSER_WORKERS; ++i)
+    {
+        browser->workers[i] = SDL_CreateThread(BrowserRun, "browser", browser);
+        if (browser->workers[i] == NULL)
+        {
+            Log(LOG_FATAL, "Could not start file browser: %s",
+                SDL_GetError());
+        }
+    }
+
+    return browser;
+}
+
+/**
+ * \desc Clears the running flag, wakes every worker and waits for each to
+ * finish what it is doing before freeing anything they use.
+ */
+void BrowserFree(Browser* browser)
+{
+    SDL_LockMutex(browser->lock);
+    browser->running = false;
+    SDL_CondBroadcast(browser->wake);
+    SDL_UnlockMutex(browser->lock);
+
+    for (size_t i = 0; i < BROWSER_WORKERS; ++i)
+    {
+        SDL_WaitThread(browser->workers[i], NULL);
+    }
+
+    BrowserClear(browser);
+    if (browser->listing)
+    {
+        Free(browser->listing);
+    }
+    LabelFree(browser->header);
+    SDL_DestroyCond(browser->wake);
+    SDL_DestroyMutex(browser->lock);
+    Free(browser);
+}
+
+/**
+ * \desc Thumbnails made from then on are cached in the new directory.
+ */
+void BrowserSetCache(Browser* browser, const char* cache)
+{
+    if (!DirCreate(cache))
+    {
+        Log(LOG_WARNING, "Could not create thumbnail cache %s", cache);
+    }
+
+    SDL_LockMutex(browser->lock);
+    snprintf(browser->cache, sizeof(browser->cache), "%s", cache);
+    SDL_UnlockMutex(browser->lock);
+}
+
+/**
+ * \desc The entries of the old directory are dropped straight away, along with
+ * any listing of it, and the generation bumped so that any work underway on it
+ * is thrown away. A worker is then woken to list the new directory.
+ */
+void BrowserOpen(Browser* browser, const char* dir)
+{
+    SDL_LockMutex(browser->lock);
+    BrowserClear(browser);
+    if (browser->listing)
+    {
+        Free(browser->listing);
+    }
+    browser->listing = NULL;
+    browser->listing_count = 0;
+    snprintf(browser->dir, sizeof(browser->dir), "%s", dir);
+    browser->generation++;
+    browser->scan = true;
+    browser->scroll = 0;
+    browser->hovered = -1;
+    SDL_CondSignal(browser->wake);
+    SDL_UnlockMutex(browser->lock);
+}
+
+/**
+ * \desc The entries are kept until the new listing replaces them, so that the
+ * browser does not empty in the meantime.
+ */
+void BrowserRefresh(Browser* browser)
+{
+    SDL_LockMutex(browser->lock);
+    browser->scan = true;
+    SDL_CondSignal(browser->wake);
+    SDL_UnlockMutex(browser->lock);
+}
+
+/**
+ * \desc Works out the parent of a directory. The last part of the path is
+ * dropped where there is one to drop, and otherwise the parent is reached
+ * through "..".
+ */
+static bool BrowserParent(const char* dir, char* dest, size_t size)
+{
+    const char* slash = strrchr(dir, '/');
+    const char* last = slash ? slash + 1 : dir;
+    if (slash == NULL || strcmp(last, ".") == 0 || strcmp(last, "..") == 0 ||
+        *last == '\0')
+    {
+        return BrowserJoin(dir, "..", dest, size);
+    }
+
+    const i32 length = slash == dir ? 1 : (i32)(slash - dir);
+    snprintf(dest, size, "%.*s", length, dir);
+    return true;
+}
+
+/**
+ * \desc The mouse wheel scrolls the rows whilst over the browser, and the
+ * entry under the mouse is kept for the header. Clicking a subdirectory opens
+ * it, or the parent directory for the first entry, and clicking a map picks it.
+ */
+void BrowserHandleInput(Browser* browser, const Input* input)
+{
+    SDL_LockMutex(browser->lock);
+    browser->hovered = -1;
+
+    if (!InputMouseWithin(input, browser->rect))
+    {
+        SDL_UnlockMutex(browser->lock);
+        return;
+    }
+
+    const i32 columns = BrowserColumns(browser);
+    const i32 rows = BrowserRows(browser);
+    const i32 total = (i32)((browser->count + (size_t)columns - 1) / columns);
+    browser->scroll = SDL_min(browser->scroll - input->mouse_wheel,
+                              total - rows);
+    browser->scroll = SDL_max(browser->scroll, 0);
+
+    const SDL_Point mouse = InputMouseSnapToGlyph(input);
+    const i32 column = (mouse.x - browser->rect.x) / BROWSER_THUMB_SIZE;
+    const i32 row = (mouse.y - browser->rect.y - 1) / BROWSER_THUMB_SIZE;
+    const i32 index = column + (browser->scroll + row) * columns;
+    if (mouse.y > browser->rect.y && column < columns && row < rows &&
+        index >= 0 && (size_t)index < browser->count)
+    {
+        browser->hovered = index;
+    }
+
+    if (browser->hovered < 0 || !InputMousePressed(input, SDL_BUTTON_LEFT))
+    {
+        SDL_UnlockMutex(browser->lock);
+        return;
+    }
+
+    char path[BROWSER_MAX_PATH] = {0};
+    const BrowserEntry* entry = &browser->entries[browser->hovered];
+    const bool is_dir = entry->is_dir;
+    const bool ok =
+        browser->hovered == 0
+            ? BrowserParent(browser->dir, path, sizeof(path))
+            : BrowserJoin(browser->dir, entry->name, path, sizeof(path));
+
+    if (ok && !is_dir)
+    {
+        memcpy(browser->picked, path, sizeof(path));
+        browser->pick = true;
+    }
+    SDL_UnlockMutex(browser->lock);
+
+    if (ok && is_dir)
+    {
+        BrowserOpen(browser, path);
+    }
+}
+
+/**
+ * \desc Copies the pixels of a thumbnail into a texture of its own, which then
+ * holds the only copy of them.
+ */
+static void BrowserUpload(BrowserEntry* entry, const Window* wind)
+{
+    const Thumbnail* thumb = &entry->thumb;
+    entry->texture = SDL_CreateTexture(wind->sdl_renderer,
+                                       SDL_PIXELFORMAT_RGBA8888,
+                                       SDL_TEXTUREACCESS_STATIC, thumb->width,
+                                       thumb->height);
+    if (entry->texture == NULL)
+    {
+        Log(LOG_WARNING, "Could not create thumbnail texture: %s",
+            SDL_GetError());
+        entry->state = BROWSER_THUMB_FAILED;
+        ThumbnailClear(&entry->thumb);
+        return;
+    }
+
+    SDL_SetTextureBlendMode(entry->texture, SDL_BLENDMODE_BLEND);
+    SDL_UpdateTexture(entry->texture, NULL, thumb->pixels,
+                      thumb->width * (i32)sizeof(u32));
+    Free(entry->thumb.pixels);
+    entry->thumb.pixels = NULL;
+    entry->state = BROWSER_THUMB_SHOWN;
+}
+
+/**
+ * \desc Lets go of the thumbnails of the entries well beyond the rows shown,
+ * so that scrolling through thousands of maps holds on to a bounded number of
+ * textures. They are made again, from the cache, if scrolled back to.
+ */
+static void BrowserEvict(Browser* browser)
+{
+    size_t first = 0, last = 0;
+    BrowserRange(browser, BROWSER_KEEP, &first, &last);
+
+    for (size_t i = 0; i < browser->count; ++i)
+    {
+        BrowserEntry* entry = &browser->entries[i];
+        if ((i >= first && i < last) ||
+            (entry->state != BROWSER_THUMB_READY &&
+             entry->state != BROWSER_THUMB_SHOWN))
+        {
+            continue;
+        }
+
+        ThumbnailClear(&entry->thumb);
+        if (entry->texture)
+        {
+            SDL_DestroyTexture(entry->texture);
+            entry->texture = NULL;
+        }
+        entry->state = BROWSER_THUMB_NONE;
+    }
+}
+
+/**
+ * \desc Replaces the entries with a fresh listing, if there is one, keeping
+ * the rows shown where there are still enough entries. The workers are then
+ * woken to make the thumbnails of the new entries.
+ */
+static void BrowserTakeListing(Browser* browser)
+{
+    if (browser->listing == NULL)
+    {
+        return;
+    }
+
+    BrowserClear(browser);
+    browser->entries = browser->listing;
+    browser->count = browser->listing_count;
+    browser->listing = NULL;
+    browser->listing_count = 0;
+    browser->hovered = -1;
+
+    const i32 columns = BrowserColumns(browser);
+    const i32 total = (i32)((browser->count + (size_t)columns - 1) / columns);
+    browser->scroll =
+        SDL_max(SDL_min(browser->scroll, total - BrowserRows(browser)), 0);
+
+    SDL_CondBroadcast(browser->wake);
+}
+
+/**
+ * \desc Shows the name of the entry under the mouse in the header, or else the
+ * directory, keeping the end of a name too long to fit. The glyphs of the
+ * header are only rebuilt if its text changes.
+ */
+static void BrowserSetHeader(Browser* browser)
+{
+    char text[BROWSER_MAX_PATH + 8] = {0};
+    if (browser->hovered >= 0)
+    {
+        const BrowserEntry* entry = &browser->entries[browser->hovered];
+        snprintf(text, sizeof(text), "%s%s", entry->name,
+                 entry->is_dir ? "/" : "");
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "%s%s", browser->dir,
+                 browser->scan || browser->scanning ? " ..." : "");
+    }
+
+    const size_t length = strlen(text);
+    const size_t width = (size_t)SDL_max(browser->rect.w, 1);
+    const char* shown = length > width ? text + length - width : text;
+    if (strcmp(shown, browser->header->text) != 0)
+    {
+        LabelSetText(browser->header, shown);
+    }
+}
+
+/**
+ * \desc Each thumbnail is scaled to fit its square, keeping its aspect ratio,
+ * and centred within it. A thumbnail which is ready is copied to a texture
+ * first, though only so many are copied each frame, so that a screenful
+ * arriving at once is spread over a few frames. Directories are drawn as
+ * filled squares, and maps without a thumbnail yet as outlines. The entry
+ * under the mouse is outlined, and the previous draw colour restored
+ * afterwards.
+ */
+void BrowserRender(Browser* browser, const Window* wind, const Texture* tex)
+{
+    SDL_LockMutex(browser->lock);
+    BrowserTakeListing(browser);
+
+    const i32 columns = BrowserColumns(browser);
+    const i32 size_w = BROWSER_THUMB_SIZE * tex->glyph_w;
+    const i32 size_h = BROWSER_THUMB_SIZE * tex->glyph_h;
+    size_t first = 0, last = 0;
+    BrowserRange(browser, 0, &first, &last);
+
+    u8 r = 0, g = 0, b = 0, a = 0;
+    SDL_GetRenderDrawColor(wind->sdl_renderer, &r, &g, &b, &a);
+
+    i32 uploads = 0;
+    for (size_t i = first; i < last; ++i)
+    {
+        BrowserEntry* entry = &browser->entries[i];
+        const i32 column = (i32)(i - first) % columns;
+        const i32 row = (i32)(i - first) / columns;
+
+        SDL_Rect thumb = {0};
+        thumb.x = (browser->rect.x + column * BROWSER_THUMB_SIZE) *
+                  tex->glyph_w;
+        thumb.y = (browser->rect.y + 1 + row * BROWSER_THUMB_SIZE) *
+                  tex->glyph_h;
+        thumb.w = size_w;
+        thumb.h = size_h;
+
+        SDL_Rect inner = {thumb.x + 2, thumb.y + 2, size_w - 4, size_h - 4};
+        if (entry->state == BROWSER_THUMB_READY && uploads < BROWSER_UPLOADS)
+        {
+            BrowserUpload(entry, wind);
+            uploads++;
+        }
+
+        if (entry->is_dir)
+        {
+            SDL_SetRenderDrawColor(wind->sdl_renderer, DARKGREY.r,
+                                   DARKGREY.g, DARKGREY.b, DARKGREY.a);
+            SDL_RenderFillRect(wind->sdl_renderer, &inner);
+        }
+        else if (entry->state == BROWSER_THUMB_SHOWN)
+        {
+            const f32 scale =
+                SDL_min((f32)(size_w - 2) / entry->thumb.width,
+                        (f32)(size_h - 2) / entry->thumb.height);
+
+            SDL_Rect dest = {0};
+            dest.w = SDL_max((i32)(entry->thumb.width * scale), 1);
+            dest.h = SDL_max((i32)(entry->thumb.height * scale), 1);
+            dest.x = thumb.x + (size_w - dest.w) / 2;
+            dest.y = thumb.y + (size_h - dest.h) / 2;
+            SDL_RenderCopy(wind->sdl_renderer, entry->texture, NULL, &dest);
+        }
+        else
+        {
+            SDL_SetRenderDrawColor(wind->sdl_renderer, GREY.r, GREY.g,
+                                   GREY.b, GREY.a);
+            SDL_RenderDrawRect(wind->sdl_renderer, &inner);
+        }
+
+        if ((i32)i == browser->hovered)
+        {
+            SDL_SetRenderDrawColor(wind->sdl_renderer, LIGHTGREY.r,
+                                   LIGHTGREY.g, LIGHTGREY.b, LIGHTGREY.a);
+            SDL_RenderDrawRect(wind->sdl_renderer, &thumb);
+        }
+    }
+
+    SDL_SetRenderDrawColor(wind->sdl_renderer, r, g, b, a);
+
+    BrowserEvict(browser);
+    BrowserSetHeader(browser);
+    SDL_UnlockMutex(browser->lock);
+
+    LabelRender(browser->header, wind, tex);
+}
@@ -16,148 +16,2261 @@
 
 /**
  * \desc First allocates the memory for the canvas then sets its current
- * operation, glyph index an dimensions in glyph co-ordinates.
+ * operation, glyph index an dimensions in glyph co-ordinates. The cells are
+ * created blank, one for each glyph of the canvas rectangle.
  */
 [[nodiscard]] Canvas* CanvasCreate(SDL_Rect rect, bool writable)
 {
     Canvas* canvas = Allocate(sizeof(Canvas));
-    canvas->glyphs = VectorCreate();
+    canvas->cells = ChunkStoreCreate(rect.w, rect.h, (Cell){0});
     canvas->op = CANVAS_NONE;
     canvas->glyph_index = 0;
     canvas->rect = rect;
+    canvas->offset_x = 0;
+    canvas->offset_y = 0;
     canvas->writable = writable;
+    canvas->history = NULL;
+    canvas->journal = NULL;
+    canvas->macro = NULL;
+    canvas->minimap = NULL;
+    canvas->cache = NULL;
+    canvas->num_cached = 0;
+    canvas->cache_budget = 0;
+    canvas->cache_used = 0;
+    canvas->resident = NULL;
+    canvas->scaled = NULL;
+    canvas->cache_tex = NULL;
+    canvas->cache_frame = 0;
+    canvas->num_dirty = 0;
+    canvas->anims = NULL;
+    canvas->wheel = NULL;
+    canvas->brush = NULL;
+    canvas->stroke = (SDL_Point){0};
+    canvas->stroking = false;
+    canvas->stamp = NULL;
+    canvas->selection = (SDL_Rect){0};
+    canvas->anchor = (SDL_Point){0};
+    canvas->marking = false;
+    canvas->gradient = NULL;
+    canvas->fill_end = (SDL_Point){0};
+    canvas->txn = (CanvasTransaction){0};
+    canvas->listeners = VectorCreate();
 
     return canvas;
 }
 
 /**
- * \desc Frees the canvas memory by freeing the glyphs including the current
- * glyph.
+ * \desc The cells are cloned as they are, so compressed chunks are copied
+ * without being decompressed. The copy has no cache of its own until it is
+ * first rendered, and no minimap or listeners until they are attached.
  */
-void CanvasFree(Canvas* canvas)
+[[nodiscard]] Canvas* CanvasClone(Canvas* canvas)
 {
-    for (size_t i = 0; i < VectorLength(canvas->glyphs); ++i)
-    {
-        Glyph* glyph = VectorAt(canvas->glyphs, i);
-        GlyphFree(glyph);
-    }
+    Canvas* clone = Allocate(sizeof(Canvas));
+    *clone = *canvas;
+    clone->cells = ChunkStoreClone(canvas->cells);
+    clone->op = CANVAS_NONE;
+    clone->minimap = NULL;
+    clone->cache = NULL;
+    clone->num_cached = 0;
+    clone->cache_budget = 0;
+    clone->cache_used = 0;
+    clone->resident = NULL;
+    clone->scaled = NULL;
+    clone->cache_tex = NULL;
+    clone->num_dirty = 0;
+    clone->wheel = NULL;
+    clone->stroking = false;
+    clone->selection = (SDL_Rect){0};
+    clone->marking = false;
+    clone->txn = (CanvasTransaction){0};
+    clone->listeners = VectorCreate();
 
-    VectorFree(canvas->glyphs);
-    Free(canvas);
+    return clone;
 }
 
 /**
- * \desc Firstly resets the current canvas operation. Then checks for user input
- * on an canvas where mouse input is snapped to the glyph dimensions. If the
- * mouse is within the canvas then input is registered. If the canvas is not
- * writable, then the left mouse button selects the current glyph. If the canvas
- * is writable, then the left mouse button places, the right erases and the
- * middle selects the hovered over glyph. The canvas operation and glyph index
- * are then used during the canvas update.
+ * \desc Destroys the texture of every cache slot along with the slots of the
+ * chunks at each scale, the scaled copies of the texture and the timing wheel
+ * of the animated chunks.
  */
-void CanvasHandleInput(Canvas* canvas, const Input* input)
+static void CanvasFreeCache(Canvas* canvas)
 {
-    canvas->op = CANVAS_NONE;
-
-    if (!InputMouseWithin(input, canvas->rect))
+    if (canvas->cache == NULL)
     {
         return;
     }
 
-    for (size_t i = 0; i < VectorLength(canvas->glyphs); ++i)
+    for (size_t i = 0; i < canvas->num_cached; ++i)
     {
-        Glyph* glyph = VectorAt(canvas->glyphs, i);
-        SDL_Rect rect = {0};
-        rect.x = (u32)glyph->x;
-        rect.y = (u32)glyph->y;
-        rect.w = 1;
-        rect.h = 1;
-
-        if (!InputMouseWithin(input, rect))
+        if (canvas->cache[i].texture)
         {
-            continue;
+            SDL_DestroyTexture(canvas->cache[i].texture);
         }
+    }
+
+    if (canvas->wheel)
+    {
+        TimingWheelFree(canvas->wheel);
+        canvas->wheel = NULL;
+    }
 
-        if (!canvas->writable)
+    for (i32 scale = 1; scale <= TEXTURE_MAX_SCALE; ++scale)
+    {
+        if (canvas->resident[scale])
         {
-            if (InputMouseDown(input, SDL_BUTTON_LEFT))
-            {
-                canvas->op = CANVAS_SELECT;
-                canvas->glyph_index = i;
-            }
-            continue;
+            Free(canvas->resident[scale]);
         }
-
-        if (InputMouseDown(input, SDL_BUTTON_LEFT))
+        if (canvas->scaled[scale])
         {
-            canvas->op = CANVAS_PLACE;
-            canvas->glyph_index = i;
+            SDL_DestroyTexture(canvas->scaled[scale]->sdl_texture);
+            TextureFree(canvas->scaled[scale]);
         }
-        else if (InputMouseDown(input, SDL_BUTTON_RIGHT))
+    }
+
+    Free(canvas->cache);
+    Free(canvas->resident);
+    Free(canvas->scaled);
+    canvas->cache = NULL;
+    canvas->num_cached = 0;
+    canvas->cache_budget = 0;
+    canvas->cache_used = 0;
+    canvas->resident = NULL;
+    canvas->scaled = NULL;
+    canvas->num_dirty = 0;
+}
+
+/**
+ * \desc The glyph of an animated cell is replaced by its frame at the time,
+ * whilst the canvas has animations.
+ */
+static Cell CanvasFrame(const Canvas* canvas, Cell cell, u32 time)
+{
+    if (canvas->anims)
+    {
+        cell.index = AnimationsFrame(canvas->anims, cell.index, time);
+    }
+
+    return cell;
+}
+
+/**
+ * \desc Sets or clears the bit of a cell in the animated mask of its chunk.
+ */
+static void CanvasSetAnimated(CanvasChunk* chunk, i32 bit, bool animated)
+{
+    const u64 mask = (u64)1 << (bit % 64);
+    if (animated)
+    {
+        chunk->animated[bit / 64] |= mask;
+    }
+    else
+    {
+        chunk->animated[bit / 64] &= ~mask;
+    }
+}
+
+/**
+ * \desc Checks the animated mask of a chunk for any bit.
+ */
+static bool CanvasHasAnimated(const CanvasChunk* chunk)
+{
+    for (size_t i = 0; i < CHUNK_CELLS / 64; ++i)
+    {
+        if (chunk->animated[i])
         {
-            canvas->op = CANVAS_ERASE;
-            canvas->glyph_index = i;
+            return true;
         }
-        else if (InputMouseDown(input, SDL_BUTTON_MIDDLE))
+    }
+
+    return false;
+}
+
+/**
+ * \desc Frees the canvas memory by freeing the cells, as well as the cache, the
+ * listeners and the buffers of the transaction. An attached history, journal or
+ * macro is not owned by the canvas.
+ */
+void CanvasFree(Canvas* canvas)
+{
+    CanvasFreeCache(canvas);
+    ChunkStoreFree(canvas->cells);
+
+    for (size_t i = 0; i < VectorLength(canvas->listeners); ++i)
+    {
+        Free(VectorAt(canvas->listeners, i));
+    }
+    VectorFree(canvas->listeners);
+
+    if (canvas->txn.writes)
+    {
+        Free(canvas->txn.writes);
+    }
+    if (canvas->txn.changes)
+    {
+        Free(canvas->txn.changes);
+    }
+    Free(canvas);
+}
+
+/**
+ * \desc Firstly resets the current canvas operation. Then checks for user input
+ * on the cell of the canvas under the mouse, if there is one, as drawn in the
+ * canvas rectangle from its offset.
+ */
+void CanvasHandleInput(Canvas* canvas, const Input* input)
+{
+    canvas->op = CANVAS_NONE;
+
+    const SDL_Point origin = {canvas->offset_x, canvas->offset_y};
+    size_t index = 0;
+    if (CanvasCellAt(canvas, input, canvas->rect, origin, 0, &index))
+    {
+        CanvasHandleCellInput(canvas, input, index);
+    }
+}
+
+/**
+ * \desc If the canvas is not writable, then the left mouse button selects the
+ * current glyph. If the canvas is writable, then the left mouse button places,
+ * the right erases and the middle selects the hovered over glyph. Holding
+ * shift, the left mouse button marks a selection instead. The canvas operation
+ * and glyph index are then used during the canvas update. Without a button
+ * held the operation is left as it is.
+ */
+void CanvasHandleCellInput(Canvas* canvas, const Input* input, size_t index)
+{
+    if (!canvas->writable)
+    {
+        if (InputMouseDown(input, SDL_BUTTON_LEFT))
         {
             canvas->op = CANVAS_SELECT;
-            canvas->glyph_index = i;
+            canvas->glyph_index = index;
         }
+        return;
+    }
+
+    if (InputMouseDown(input, SDL_BUTTON_LEFT))
+    {
+        canvas->op = input->curr_mod_map & KMOD_SHIFT ? CANVAS_MARK
+                                                      : CANVAS_PLACE;
+        canvas->glyph_index = index;
+    }
+    else if (InputMouseDown(input, SDL_BUTTON_RIGHT))
+    {
+        canvas->op = CANVAS_ERASE;
+        canvas->glyph_index = index;
+    }
+    else if (InputMouseDown(input, SDL_BUTTON_MIDDLE))
+    {
+        canvas->op = CANVAS_SELECT;
+        canvas->glyph_index = index;
+    }
+}
+
+/**
+ * \desc The mouse position within the area is divided by the size of a cell at
+ * the zoom level and added to the origin. The far edges of the area count as
+ * within it, so the position is clamped to the last pixel of the area.
+ */
+[[nodiscard]] bool CanvasCellAt(const Canvas* canvas, const Input* input,
+                                SDL_Rect rect, SDL_Point origin, i32 zoom,
+                                size_t* index)
+{
+    if (!InputMouseWithin(input, rect))
+    {
+        return false;
+    }
+
+    const SDL_Point mouse = InputMousePos();
+    const i32 cell_w = CanvasZoomSize(input->conversion.x, zoom);
+    const i32 cell_h = CanvasZoomSize(input->conversion.y, zoom);
+    const i32 px = SDL_min(mouse.x - rect.x * input->conversion.x,
+                           rect.w * input->conversion.x - 1);
+    const i32 py = SDL_min(mouse.y - rect.y * input->conversion.y,
+                           rect.h * input->conversion.y - 1);
+
+    const i32 x = origin.x + px / cell_w;
+    const i32 y = origin.y + py / cell_h;
+    if (px < 0 || py < 0 || x < 0 || y < 0 || x >= canvas->cells->width ||
+        y >= canvas->cells->height)
+    {
+        return false;
+    }
+
+    *index = (size_t)x + (size_t)y * (size_t)canvas->cells->width;
+    return true;
+}
+
+/**
+ * \desc Adds an operation to the macro being recorded, if there is one.
+ */
+static MacroOp* CanvasRecord(Canvas* canvas, MacroKind kind)
+{
+    return canvas->macro ? MacroAdd(canvas->macro, kind) : NULL;
+}
+
+/**
+ * \desc A round or square brush is recorded by its shape, so that it can be
+ * made again. A custom brush is made from a stamp which may not exist when the
+ * macro is played, so its spans are recorded instead.
+ */
+static void CanvasRecordStamp(Canvas* canvas, const Brush* brush, i32 x, i32 y,
+                              Cell cell)
+{
+    if (canvas->macro == NULL)
+    {
+        return;
+    }
+
+    if (brush->shape != BRUSH_CUSTOM)
+    {
+        MacroOp* op = CanvasRecord(canvas, MACRO_BRUSH);
+        op->rect = (SDL_Rect){x, y, 1, 1};
+        op->cell = cell;
+        op->shape = brush->shape;
+        op->radius = brush->radius;
+        return;
+    }
+
+    for (size_t i = 0; i < brush->num_spans; ++i)
+    {
+        const BrushSpan* span = &brush->spans[i];
+        MacroOp* op = CanvasRecord(canvas, MACRO_SPAN);
+        op->rect = (SDL_Rect){x + span->x0, y + span->dy, span->x1 - span->x0,
+                              1};
+        op->cell = cell;
+    }
+}
+
+/**
+ * \desc Stamps the brush at the cell being edited. Whilst a stroke is underway
+ * the brush is also stamped along the line from where it was last stamped, at
+ * intervals of half its radius, so that a quick stroke leaves no gaps. Every
+ * stamp along the line is written in one transaction, so cells they overlap
+ * are changed once. Holding the brush still stamps nothing more.
+ */
+static void CanvasStroke(Canvas* canvas, Cell cell)
+{
+    const i32 width = canvas->cells->width;
+    if (width <= 0)
+    {
+        return;
+    }
+
+    const SDL_Point to = {(i32)(canvas->glyph_index % width),
+                          (i32)(canvas->glyph_index / width)};
+    const SDL_Point from = canvas->stroking ? canvas->stroke : to;
+
+    if (canvas->stroking && from.x == to.x && from.y == to.y)
+    {
+        return;
+    }
+
+    const i32 dx = to.x - from.x;
+    const i32 dy = to.y - from.y;
+    const i32 distance = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
+    const i32 spacing =
+        canvas->brush->radius > 1 ? canvas->brush->radius / 2 : 1;
+    const i32 steps = (distance + spacing - 1) / spacing;
+
+    CanvasBegin(canvas);
+    for (i32 i = steps ? 1 : 0; i <= steps; ++i)
+    {
+        const i32 x = steps ? from.x + dx * i / steps : to.x;
+        const i32 y = steps ? from.y + dy * i / steps : to.y;
+        CanvasStamp(canvas, canvas->brush, x, y, cell);
+        CanvasRecordStamp(canvas, canvas->brush, x, y, cell);
+    }
+    CanvasCommit(canvas);
+
+    canvas->stroke = to;
+    canvas->stroking = true;
+}
+
+/**
+ * \desc Copies the stamp centred on the cell being edited. Like a brush, the
+ * stamp is only copied again once the mouse has moved to another cell.
+ */
+static void CanvasStampStroke(Canvas* canvas)
+{
+    const i32 width = canvas->cells->width;
+    if (width <= 0)
+    {
+        return;
+    }
+
+    const Stamp* stamp = canvas->stamp;
+    const SDL_Point to = {(i32)(canvas->glyph_index % width),
+                          (i32)(canvas->glyph_index / width)};
+    if (canvas->stroking && canvas->stroke.x == to.x &&
+        canvas->stroke.y == to.y)
+    {
+        return;
+    }
+
+    const SDL_Rect rect = {to.x - stamp->width / 2, to.y - stamp->height / 2,
+                           stamp->width, stamp->height};
+    CanvasPaste(canvas, stamp->cells, rect);
+
+    MacroOp* op = CanvasRecord(canvas, MACRO_PASTE);
+    if (op)
+    {
+        const size_t size = sizeof(Cell) * (size_t)(rect.w * rect.h);
+        op->rect = rect;
+        op->cells = Allocate(size);
+        memcpy(op->cells, stamp->cells, size);
+    }
+
+    canvas->stroke = to;
+    canvas->stroking = true;
+}
+
+/**
+ * \desc The gradient runs from the cell where the mouse button was pressed to
+ * the cell now under the mouse, blending from the background colour of the
+ * current glyph to its foreground colour. It fills the selection, or the whole
+ * canvas if nothing is selected, and is filled again whenever the mouse moves
+ * to another cell. As only the cells which change are redrawn into the cache
+ * and all belong to the same history entry, the fill is previewed live and
+ * undone in one step. Likewise, each fill replaces the last in the macro.
+ */
+static void CanvasGradientStroke(Canvas* canvas, const Glyph* glyph)
+{
+    const i32 width = canvas->cells->width;
+    if (width <= 0)
+    {
+        return;
+    }
+
+    const SDL_Point to = {(i32)(canvas->glyph_index % width),
+                          (i32)(canvas->glyph_index / width)};
+    const bool refill = canvas->stroking;
+    if (!canvas->stroking)
+    {
+        canvas->stroke = to;
+        canvas->stroking = true;
+    }
+    else if (canvas->fill_end.x == to.x && canvas->fill_end.y == to.y)
+    {
+        return;
+    }
+
+    Gradient gradient = *canvas->gradient;
+    gradient.from = glyph->bg;
+    gradient.to = glyph->fg;
+    gradient.start = canvas->stroke;
+    gradient.end = to;
+
+    const SDL_Rect whole = {0, 0, width, canvas->cells->height};
+    const bool selected = canvas->selection.w > 0 && canvas->selection.h > 0;
+    CanvasFillGradient(canvas, &gradient,
+                       selected ? canvas->selection : whole);
+    canvas->fill_end = to;
+
+    if (canvas->macro && refill)
+    {
+        MacroRemoveLast(canvas->macro);
+    }
+    MacroOp* op = CanvasRecord(canvas, MACRO_GRADIENT);
+    if (op)
+    {
+        op->gradient = gradient;
+        op->rect = selected ? canvas->selection : whole;
     }
 }
 
+/**
+ * \desc The selection spans from the cell where the mouse button was pressed
+ * to the cell now under the mouse, whichever way round they are.
+ */
+static void CanvasMark(Canvas* canvas)
+{
+    const i32 width = canvas->cells->width;
+    if (width <= 0)
+    {
+        return;
+    }
+
+    const SDL_Point cell = {(i32)(canvas->glyph_index % width),
+                            (i32)(canvas->glyph_index / width)};
+    if (!canvas->marking)
+    {
+        canvas->anchor = cell;
+        canvas->marking = true;
+    }
+
+    canvas->selection.x = SDL_min(canvas->anchor.x, cell.x);
+    canvas->selection.y = SDL_min(canvas->anchor.y, cell.y);
+    canvas->selection.w = abs(canvas->anchor.x - cell.x) + 1;
+    canvas->selection.h = abs(canvas->anchor.y - cell.y) + 1;
+}
+
 /**
  * \desc The canvas is updated only updated if a passed in glyph requires change
  * (i.e. not NULL) and if the current glyph index is valid. The current glyph
  * passed in is used based on the canvas operation: placing sets the a canvas
  * glyph to the current glyph; selection sets the current glyph to a canvas
  * glyph (based on canvas type); erasure just sets a canvas glyph to blank.
+ * Changed cells are marked dirty and recorded to the history; every edit made
+ * whilst placing or erasing is held belongs to the same history entry, which is
+ * committed as soon as neither is. With a brush set, the whole stroke is
+ * stamped instead of the single cell, and with a stamp set, placing copies the
+ * stamp. With a gradient set, placing fills the gradient instead of either.
+ * Marking grows the selection, which is kept once marking ends. A cell placed
+ * on its own is only recorded to the macro when it changed.
  */
 void CanvasUpdate(Canvas* canvas, Glyph* cur_glyph)
 {
-    Glyph* glyph = VectorAt(canvas->glyphs, canvas->glyph_index);
-
     if (!cur_glyph)
     {
         return;
     }
 
+    const Cell before = CanvasGetCell(canvas, canvas->glyph_index);
+    Cell after = before;
+
     switch (canvas->op)
     {
     case CANVAS_NONE:
         break;
 
     case CANVAS_PLACE:
-        glyph->fg = cur_glyph->fg;
-        glyph->bg = cur_glyph->bg;
-        glyph->index = cur_glyph->index;
+        after.fg = cur_glyph->fg;
+        after.bg = cur_glyph->bg;
+        after.index = (u8)cur_glyph->index;
         break;
 
     case CANVAS_SELECT:
-        cur_glyph->fg = glyph->fg;
-        cur_glyph->bg = glyph->bg;
-        cur_glyph->index = glyph->index;
+        cur_glyph->fg = before.fg;
+        cur_glyph->bg = before.bg;
+        cur_glyph->index = before.index;
         break;
 
     case CANVAS_ERASE:
-        glyph->index = 0;
-        glyph->fg = BLANK;
-        glyph->bg = BLANK;
+        after.index = 0;
+        after.fg = BLANK;
+        after.bg = BLANK;
+        break;
+
+    case CANVAS_MARK:
+        CanvasMark(canvas);
+        break;
 
     default:
         break;
     }
+
+    if (canvas->op != CANVAS_MARK)
+    {
+        canvas->marking = false;
+    }
+
+    if (canvas->op != CANVAS_PLACE && canvas->op != CANVAS_ERASE)
+    {
+        canvas->stroking = false;
+        if (canvas->history)
+        {
+            HistoryCommit(canvas->history);
+        }
+        return;
+    }
+
+    if (canvas->gradient && canvas->op == CANVAS_PLACE)
+    {
+        CanvasGradientStroke(canvas, cur_glyph);
+        return;
+    }
+
+    if (canvas->stamp && canvas->op == CANVAS_PLACE)
+    {
+        CanvasStampStroke(canvas);
+        return;
+    }
+
+    if (canvas->brush)
+    {
+        CanvasStroke(canvas, after);
+        return;
+    }
+
+    const i32 width = canvas->cells->width;
+    if (width <= 0)
+    {
+        return;
+    }
+
+    const i32 x = (i32)(canvas->glyph_index % width);
+    const i32 y = (i32)(canvas->glyph_index / width);
+    CanvasBegin(canvas);
+    CanvasWrite(canvas, x, y, after);
+
+    MacroOp* op = CanvasCommit(canvas) ? CanvasRecord(canvas, MACRO_PLACE)
+                                       : NULL;
+    if (op)
+    {
+        op->rect = (SDL_Rect){x, y, 1, 1};
+        op->cell = after;
+    }
+}
+
+/**
+ * \desc Draws a cell into the cache of its chunk, which must be the current
+ * render target, at the position of the cell within the chunk.
+ */
+static void CanvasRenderCell(const Window* wind, const Texture* tex, Cell cell,
+                             i32 x, i32 y, bool clear)
+{
+    SDL_Rect dest = {0};
+    dest.x = (x % CHUNK_SIZE) * tex->glyph_w;
+    dest.y = (y % CHUNK_SIZE) * tex->glyph_h;
+    dest.w = tex->glyph_w;
+    dest.h = tex->glyph_h;
+
+    if (clear)
+    {
+        SDL_RenderFillRect(wind->sdl_renderer, &dest);
+    }
+
+    Glyph glyph = {0};
+    glyph.index = cell.index;
+    glyph.fg = cell.fg;
+    glyph.bg = cell.bg;
+    GlyphRenderTo(&glyph, wind, tex, dest);
+}
+
+/**
+ * \desc Creates the cache slots, as many chunks rendered from the texture as
+ * fit within the memory allowed but no more than the chunks at every scale,
+ * which are all empty. The slots of the chunks at a scale, and the copy of the
+ * texture at it, are only made once a view draws at that scale. Nothing is
+ * rendered until a view draws a chunk.
+ */
+static void CanvasCreateCache(Canvas* canvas, const Texture* tex)
+{
+    CanvasFreeCache(canvas);
+
+    const ChunkStore* store = canvas->cells;
+    const size_t num_chunks = (size_t)(store->chunks_w * store->chunks_h);
+    const size_t chunk_bytes = (size_t)CHUNK_CELLS *
+                               (size_t)(tex->glyph_w * tex->glyph_h) * 4;
+
+    canvas->cache_budget =
+        SDL_max(CANVAS_CACHE_BYTES / chunk_bytes, (size_t)1);
+    canvas->cache_used = 0;
+    canvas->num_cached =
+        SDL_min(canvas->cache_budget,
+                SDL_max(num_chunks, (size_t)1) * TEXTURE_MAX_SCALE);
+    canvas->cache = Allocate(sizeof(CanvasChunk) * canvas->num_cached);
+    for (size_t i = 0; i < canvas->num_cached; ++i)
+    {
+        canvas->cache[i] = (CanvasChunk){0};
+        canvas->cache[i].key = -1;
+    }
+
+    canvas->resident = Allocate(sizeof(i32*) * (TEXTURE_MAX_SCALE + 1));
+    canvas->scaled = Allocate(sizeof(Texture*) * (TEXTURE_MAX_SCALE + 1));
+
+    canvas->cache_tex = tex;
+    canvas->num_dirty = 0;
+    if (canvas->anims)
+    {
+        canvas->wheel = TimingWheelCreate(CANVAS_ANIMATION_RESOLUTION,
+                                          SDL_GetTicks());
+    }
+}
+
+/**
+ * \desc The texture itself is drawn from at a scale of one. Any other scale is
+ * drawn from a copy of the texture scaled up by it, made the first time, or
+ * from the texture itself should the copy not be made.
+ */
+static const Texture* CanvasGlyphs(Canvas* canvas, const Window* wind,
+                                   const Texture* tex, i32 scale)
+{
+    if (scale <= 1 || scale > TEXTURE_MAX_SCALE || canvas->scaled == NULL)
+    {
+        return tex;
+    }
+
+    if (canvas->scaled[scale] == NULL)
+    {
+        canvas->scaled[scale] = TextureScale(tex, wind, scale);
+    }
+
+    return canvas->scaled[scale] ? canvas->scaled[scale] : tex;
 }
 
 /**
- * \desc Renders a canvas to a window based on a given texture by iterating
- * through its glyphs.
+ * \desc Finds the slot a chunk is cached in at a scale, if it has one.
  */
-void CanvasRender(const Canvas* canvas, const Window* wind, const Texture* tex)
+static CanvasChunk* CanvasCached(const Canvas* canvas, i32 key, i32 scale)
 {
-    for (size_t i = 0; i < VectorLength(canvas->glyphs); ++i)
+    const i32* resident = canvas->resident ? canvas->resident[scale] : NULL;
+    if (resident == NULL || resident[key] < 0)
     {
-        const Glyph* glyph = VectorAt(canvas->glyphs, i);
-        GlyphRender(glyph, wind, tex);
+        return NULL;
     }
-}
\ No newline at end of file
+
+    return &canvas->cache[resident[key]];
+}
+
+/**
+ * \desc Removes the chunk held by a slot, forgetting any of its cells still to
+ * be redrawn. The slot keeps its texture.
+ */
+static void CanvasDropChunk(Canvas* canvas, CanvasChunk* chunk)
+{
+    if (chunk->key < 0)
+    {
+        return;
+    }
+
+    canvas->resident[chunk->scale][chunk->key] = -1;
+    canvas->num_dirty -= chunk->num_dirty;
+    chunk->num_dirty = 0;
+    chunk->key = -1;
+}
+
+/**
+ * \desc Removes the chunk held by a slot and destroys its texture, giving back
+ * the room it took in the cache.
+ */
+static void CanvasDropTexture(Canvas* canvas, CanvasChunk* chunk)
+{
+    CanvasDropChunk(canvas, chunk);
+    if (chunk->texture)
+    {
+        SDL_DestroyTexture(chunk->texture);
+        chunk->texture = NULL;
+        canvas->cache_used -= (size_t)(chunk->scale * chunk->scale);
+    }
+}
+
+/**
+ * \desc Finds the slot to render a chunk into: an empty slot if there is one,
+ * or else the slot drawn least recently. The chunk it held loses its slot.
+ */
+static CanvasChunk* CanvasEvictChunk(Canvas* canvas)
+{
+    CanvasChunk* victim = &canvas->cache[0];
+    for (size_t i = 0; i < canvas->num_cached && victim->key >= 0; ++i)
+    {
+        CanvasChunk* chunk = &canvas->cache[i];
+        if (chunk->key < 0 || chunk->used < victim->used)
+        {
+            victim = chunk;
+        }
+    }
+
+    CanvasDropChunk(canvas, victim);
+    return victim;
+}
+
+/**
+ * \desc Destroys the texture of the slot drawn least recently, other than the
+ * slot being rendered into, to make room for a texture of another scale.
+ */
+static bool CanvasEvictTexture(Canvas* canvas, const CanvasChunk* keep)
+{
+    CanvasChunk* victim = NULL;
+    for (size_t i = 0; i < canvas->num_cached; ++i)
+    {
+        CanvasChunk* chunk = &canvas->cache[i];
+        if (chunk != keep && chunk->texture &&
+            (victim == NULL || chunk->used < victim->used))
+        {
+            victim = chunk;
+        }
+    }
+
+    if (victim == NULL)
+    {
+        return false;
+    }
+
+    CanvasDropTexture(canvas, victim);
+    return true;
+}
+
+/**
+ * \desc Retrieves the cache of a chunk at a scale, rendering the chunk into a
+ * slot if it has none at that scale. The glyphs are those of the texture
+ * scaled up by it, so that the chunk is rendered at the size it is copied at.
+ * The texture of an evicted chunk is reused when it is of the same scale, and
+ * is otherwise destroyed, along with those of the slots drawn least recently
+ * until the new texture fits within the memory allowed. The whole chunk is
+ * cleared to transparent, so that blank glyphs (and the cells beyond the edge
+ * of the canvas) stay see-through, and its animated cells are noted as it is
+ * drawn. The texture is sampled at the nearest pixel, so that a chunk copied
+ * zoomed out is not blurred. The previous render target and draw colour are
+ * restored afterwards.
+ */
+static CanvasChunk* CanvasCacheChunk(Canvas* canvas, const Window* wind,
+                                     const Texture* glyphs, i32 cx, i32 cy,
+                                     i32 scale)
+{
+    ChunkStore* store = canvas->cells;
+    const i32 key = cx + cy * store->chunks_w;
+    CanvasChunk* chunk = CanvasCached(canvas, key, scale);
+    if (chunk)
+    {
+        chunk->used = canvas->cache_frame;
+        return chunk;
+    }
+
+    if (canvas->resident[scale] == NULL)
+    {
+        const size_t num_chunks = (size_t)(store->chunks_w * store->chunks_h);
+        canvas->resident[scale] =
+            Allocate(sizeof(i32) * SDL_max(num_chunks, (size_t)1));
+        for (size_t i = 0; i < num_chunks; ++i)
+        {
+            canvas->resident[scale][i] = -1;
+        }
+    }
+
+    chunk = CanvasEvictChunk(canvas);
+    if (chunk->texture && chunk->scale != scale)
+    {
+        CanvasDropTexture(canvas, chunk);
+    }
+
+    if (chunk->texture == NULL)
+    {
+        const size_t room = (size_t)(scale * scale);
+        while (canvas->cache_used + room > canvas->cache_budget)
+        {
+            if (!CanvasEvictTexture(canvas, chunk))
+            {
+                break;
+            }
+        }
+
+        chunk->texture = SDL_CreateTexture(
+            wind->sdl_renderer, SDL_PIXELFORMAT_RGBA8888,
+            SDL_TEXTUREACCESS_TARGET, CHUNK_SIZE * glyphs->glyph_w,
+            CHUNK_SIZE * glyphs->glyph_h);
+        if (chunk->texture == NULL)
+        {
+            Log(LOG_WARNING, "Could not create canvas cache: %s",
+                SDL_GetError());
+            return NULL;
+        }
+
+        SDL_SetTextureBlendMode(chunk->texture, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(chunk->texture, SDL_ScaleModeNearest);
+        chunk->scale = (u8)scale;
+        canvas->cache_used += room;
+    }
+
+    const u32 now = SDL_GetTicks();
+    chunk->key = key;
+    chunk->used = canvas->cache_frame;
+    chunk->frame_time = now;
+    chunk->num_dirty = 0;
+    chunk->scheduled = false;
+    memset(chunk->dirty, 0, sizeof(chunk->dirty));
+    canvas->resident[scale][key] = (i32)(chunk - canvas->cache);
+
+    u8 r = 0, g = 0, b = 0, a = 0;
+    SDL_Texture* target = SDL_GetRenderTarget(wind->sdl_renderer);
+    SDL_GetRenderDrawColor(wind->sdl_renderer, &r, &g, &b, &a);
+    SDL_SetRenderDrawColor(wind->sdl_renderer, 0, 0, 0, 0);
+    SDL_SetRenderTarget(wind->sdl_renderer, chunk->texture);
+    SDL_RenderClear(wind->sdl_renderer);
+
+    const Cell* cells = ChunkStoreAcquire(store, cx, cy);
+    for (i32 j = 0; j < CHUNK_SIZE; ++j)
+    {
+        const i32 y = cy * CHUNK_SIZE + j;
+        for (i32 i = 0; i < CHUNK_SIZE; ++i)
+        {
+            const i32 x = cx * CHUNK_SIZE + i;
+            const Cell cell = cells[i + j * CHUNK_SIZE];
+            const bool inside = x < store->width && y < store->height;
+            if (inside)
+            {
+                CanvasRenderCell(wind, glyphs,
+                                 CanvasFrame(canvas, cell, now), x, y, false);
+            }
+            CanvasSetAnimated(chunk, i + j * CHUNK_SIZE,
+                              inside && canvas->anims &&
+                                  AnimationsHas(canvas->anims, cell.index));
+        }
+    }
+    ChunkStoreRelease(store, cx, cy);
+
+    SDL_SetRenderTarget(wind->sdl_renderer, target);
+    SDL_SetRenderDrawColor(wind->sdl_renderer, r, g, b, a);
+
+    return chunk;
+}
+
+/**
+ * \desc Redraws the dirty cells into the caches, visiting only the cached
+ * chunks which have any and walking the set bits of their masks. The cell of
+ * each glyph is first cleared without blending, as an erased glyph must not
+ * leave the previous one showing through. Animated cells are drawn with the
+ * frame of the rest of their chunk. Each chunk is drawn with the glyphs of the
+ * scale it is cached at.
+ */
+static void CanvasRenderDirty(Canvas* canvas, const Window* wind,
+                              const Texture* tex)
+{
+    u8 r = 0, g = 0, b = 0, a = 0;
+    SDL_BlendMode mode = SDL_BLENDMODE_NONE;
+    SDL_Texture* target = SDL_GetRenderTarget(wind->sdl_renderer);
+    SDL_GetRenderDrawColor(wind->sdl_renderer, &r, &g, &b, &a);
+    SDL_GetRenderDrawBlendMode(wind->sdl_renderer, &mode);
+
+    SDL_SetRenderDrawColor(wind->sdl_renderer, 0, 0, 0, 0);
+    SDL_SetRenderDrawBlendMode(wind->sdl_renderer, SDL_BLENDMODE_NONE);
+
+    ChunkStore* store = canvas->cells;
+    for (size_t s = 0; s < canvas->num_cached && canvas->num_dirty; ++s)
+    {
+        CanvasChunk* chunk = &canvas->cache[s];
+        if (chunk->key < 0 || chunk->num_dirty == 0)
+        {
+            continue;
+        }
+
+        const i32 cx = chunk->key % store->chunks_w;
+        const i32 cy = chunk->key / store->chunks_w;
+        const Texture* glyphs = CanvasGlyphs(canvas, wind, tex, chunk->scale);
+        SDL_SetRenderTarget(wind->sdl_renderer, chunk->texture);
+
+        const Cell* cells = ChunkStoreAcquire(store, cx, cy);
+        for (size_t word = 0; word < CHUNK_CELLS / 64; ++word)
+        {
+            for (u64 bits = chunk->dirty[word]; bits; bits &= bits - 1)
+            {
+                const i32 bit = (i32)(word * 64) + __builtin_ctzll(bits);
+                const Cell cell =
+                    CanvasFrame(canvas, cells[bit], chunk->frame_time);
+                CanvasRenderCell(wind, glyphs, cell,
+                                 cx * CHUNK_SIZE + bit % CHUNK_SIZE,
+                                 cy * CHUNK_SIZE + bit / CHUNK_SIZE, true);
+            }
+            chunk->dirty[word] = 0;
+        }
+        ChunkStoreRelease(store, cx, cy);
+
+        canvas->num_dirty -= chunk->num_dirty;
+        chunk->num_dirty = 0;
+    }
+
+    SDL_SetRenderTarget(wind->sdl_renderer, target);
+    SDL_SetRenderDrawColor(wind->sdl_renderer, r, g, b, a);
+    SDL_SetRenderDrawBlendMode(wind->sdl_renderer, mode);
+}
+
+/**
+ * \brief The state passed to the timing wheel when animating chunks.
+ */
+typedef struct
+{
+    Canvas* canvas;     /**< The canvas being animated. */
+    const Window* wind; /**< Window to render with. */
+    const Texture* tex; /**< Texture to render from. */
+    u32 now;            /**< Time to draw the frames at. */
+} CanvasAnimation;
+
+/**
+ * \desc Expires a chunk from the timing wheel: only the animated cells of the
+ * chunk whose frame has changed since it was last drawn are redrawn, by walking
+ * the set bits of its mask. The chunk is scheduled again when next drawn. A
+ * chunk which has lost its slot since it was scheduled is skipped. The key of
+ * the wheel holds the scale of the slot as well as the chunk.
+ */
+static void CanvasAnimateChunk(void* data, u32 key)
+{
+    const CanvasAnimation* animation = data;
+    Canvas* canvas = animation->canvas;
+    ChunkStore* store = canvas->cells;
+    const i32 scale = (i32)(key % (TEXTURE_MAX_SCALE + 1));
+    const i32 index = (i32)(key / (TEXTURE_MAX_SCALE + 1));
+    CanvasChunk* chunk = CanvasCached(canvas, index, scale);
+    if (chunk == NULL || !chunk->scheduled)
+    {
+        return;
+    }
+
+    const i32 cx = index % store->chunks_w;
+    const i32 cy = index / store->chunks_w;
+    const Texture* glyphs =
+        CanvasGlyphs(canvas, animation->wind, animation->tex, scale);
+
+    chunk->scheduled = false;
+    SDL_SetRenderTarget(animation->wind->sdl_renderer, chunk->texture);
+
+    const Cell* cells = ChunkStoreAcquire(store, cx, cy);
+    for (size_t word = 0; word < CHUNK_CELLS / 64; ++word)
+    {
+        for (u64 bits = chunk->animated[word]; bits; bits &= bits - 1)
+        {
+            const i32 bit = (i32)(word * 64) + __builtin_ctzll(bits);
+            const u8 before = AnimationsFrame(canvas->anims, cells[bit].index,
+                                              chunk->frame_time);
+            const Cell cell = CanvasFrame(canvas, cells[bit], animation->now);
+            if (cell.index != before)
+            {
+                CanvasRenderCell(animation->wind, glyphs, cell,
+                                 cx * CHUNK_SIZE + bit % CHUNK_SIZE,
+                                 cy * CHUNK_SIZE + bit / CHUNK_SIZE, true);
+            }
+        }
+    }
+    ChunkStoreRelease(store, cx, cy);
+
+    chunk->frame_time = animation->now;
+}
+
+/**
+ * \desc Advances the timing wheel, animating the chunks which have reached
+ * their next change of frame, with the same render state as dirty cells.
+ */
+static void CanvasAnimate(Canvas* canvas, const Window* wind,
+                          const Texture* tex)
+{
+    u8 r = 0, g = 0, b = 0, a = 0;
+    SDL_BlendMode mode = SDL_BLENDMODE_NONE;
+    SDL_Texture* target = SDL_GetRenderTarget(wind->sdl_renderer);
+    SDL_GetRenderDrawColor(wind->sdl_renderer, &r, &g, &b, &a);
+    SDL_GetRenderDrawBlendMode(wind->sdl_renderer, &mode);
+
+    SDL_SetRenderDrawColor(wind->sdl_renderer, 0, 0, 0, 0);
+    SDL_SetRenderDrawBlendMode(wind->sdl_renderer, SDL_BLENDMODE_NONE);
+
+    CanvasAnimation animation = {canvas, wind, tex, SDL_GetTicks()};
+    TimingWheelAdvance(canvas->wheel, animation.now, CanvasAnimateChunk,
+                       &animation);
+
+    SDL_SetRenderTarget(wind->sdl_renderer, target);
+    SDL_SetRenderDrawColor(wind->sdl_renderer, r, g, b, a);
+    SDL_SetRenderDrawBlendMode(wind->sdl_renderer, mode);
+}
+
+/**
+ * \desc The cache is (re)created empty when it does not exist or was rendered
+ * from a different texture, and is otherwise brought up to date with the dirty
+ * cells and the animated chunks which are due. This is done once however many
+ * views draw the canvas, and counts a frame for the chunks drawn after it.
+ */
+bool CanvasRefresh(Canvas* canvas, const Window* wind, const Texture* tex)
+{
+    canvas->cache_frame++;
+    if (canvas->cache == NULL || canvas->cache_tex != tex)
+    {
+        CanvasCreateCache(canvas, tex);
+        return true;
+    }
+
+    if (canvas->num_dirty)
+    {
+        CanvasRenderDirty(canvas, wind, tex);
+    }
+
+    if (canvas->wheel && canvas->wheel->count)
+    {
+        CanvasAnimate(canvas, wind, tex);
+    }
+
+    return true;
+}
+
+/**
+ * \desc Only the chunks which overlap the area are copied, each in a single
+ * copy scaled by the zoom level. The area is clipped so that chunks which
+ * overlap its edges do not draw beyond it; the previous clipping is restored
+ * afterwards. Chunks without a cache are rendered into one as they are first
+ * copied. Each chunk copied with animated cells is scheduled to be redrawn at
+ * its next change of frame, unless it already is. Zoomed in, the chunks are
+ * cached at the scale of the zoom factor, rendered from a copy of the texture
+ * scaled up by it, so that each is copied one to one; zoomed out, they are
+ * cached at the size of the texture and shrunk as they are copied. Should the
+ * canvas have no cache, the scaled copy not be made, or the area show more
+ * chunks than may be cached at once at the scale, the visible cells are
+ * rendered individually instead, read a block at a time. The selection, if
+ * there is one, is outlined on top.
+ */
+void CanvasBlit(Canvas* canvas, const Window* wind, const Texture* tex,
+                SDL_Rect rect, SDL_Point origin, i32 zoom)
+{
+    const ChunkStore* store = canvas->cells;
+    const i32 cell_w = CanvasZoomSize(tex->glyph_w, zoom);
+    const i32 cell_h = CanvasZoomSize(tex->glyph_h, zoom);
+
+    SDL_Rect area = {0};
+    area.x = rect.x * tex->glyph_w;
+    area.y = rect.y * tex->glyph_h;
+    area.w = rect.w * tex->glyph_w;
+    area.h = rect.h * tex->glyph_h;
+
+    const i32 x0 = SDL_max(origin.x, 0);
+    const i32 y0 = SDL_max(origin.y, 0);
+    const i32 x1 = SDL_min(origin.x + (area.w + cell_w - 1) / cell_w,
+                           store->width);
+    const i32 y1 = SDL_min(origin.y + (area.h + cell_h - 1) / cell_h,
+                           store->height);
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return;
+    }
+
+    SDL_Rect clip = {0};
+    const bool clipped = SDL_RenderIsClipEnabled(wind->sdl_renderer);
+    SDL_RenderGetClipRect(wind->sdl_renderer, &clip);
+    SDL_RenderSetClipRect(wind->sdl_renderer, &area);
+
+    const i32 scale = zoom > 0 ? zoom + 1 : 1;
+    const Texture* glyphs = CanvasGlyphs(canvas, wind, tex, scale);
+    const size_t num_shown =
+        (size_t)((x1 - 1) / CHUNK_SIZE - x0 / CHUNK_SIZE + 1) *
+        (size_t)((y1 - 1) / CHUNK_SIZE - y0 / CHUNK_SIZE + 1);
+    if (canvas->cache == NULL || (scale > 1 && glyphs == tex) ||
+        num_shown > canvas->num_cached ||
+        num_shown * (size_t)(scale * scale) > canvas->cache_budget)
+    {
+        const SDL_Rect block = {x0, y0, x1 - x0, y1 - y0};
+        Cell* cells = Allocate(sizeof(Cell) * (size_t)(block.w * block.h));
+        ChunkStoreRead(canvas->cells, block, cells);
+
+        const u32 now = SDL_GetTicks();
+        for (i32 y = y0; y < y1; ++y)
+        {
+            for (i32 x = x0; x < x1; ++x)
+            {
+                const Cell cell = CanvasFrame(
+                    canvas, cells[(x - x0) + (y - y0) * block.w], now);
+                Glyph glyph = {0};
+                glyph.index = cell.index;
+                glyph.fg = cell.fg;
+                glyph.bg = cell.bg;
+
+                SDL_Rect dest = {0};
+                dest.x = area.x + (x - origin.x) * cell_w;
+                dest.y = area.y + (y - origin.y) * cell_h;
+                dest.w = cell_w;
+                dest.h = cell_h;
+                GlyphRenderTo(&glyph, wind, glyphs, dest);
+            }
+        }
+
+        Free(cells);
+    }
+    else
+    {
+        for (i32 cy = y0 / CHUNK_SIZE; cy <= (y1 - 1) / CHUNK_SIZE; ++cy)
+        {
+            for (i32 cx = x0 / CHUNK_SIZE; cx <= (x1 - 1) / CHUNK_SIZE; ++cx)
+            {
+                CanvasChunk* chunk =
+                    CanvasCacheChunk(canvas, wind, glyphs, cx, cy, scale);
+                if (chunk == NULL)
+                {
+                    continue;
+                }
+
+                if (canvas->wheel && !chunk->scheduled &&
+                    CanvasHasAnimated(chunk))
+                {
+                    TimingWheelSchedule(
+                        canvas->wheel,
+                        (u32)(chunk->key * (TEXTURE_MAX_SCALE + 1) + scale),
+                        AnimationsNextChange(canvas->anims,
+                                             chunk->frame_time));
+                    chunk->scheduled = true;
+                }
+
+                SDL_Rect dest = {0};
+                dest.x = area.x + (cx * CHUNK_SIZE - origin.x) * cell_w;
+                dest.y = area.y + (cy * CHUNK_SIZE - origin.y) * cell_h;
+                dest.w = CHUNK_SIZE * cell_w;
+                dest.h = CHUNK_SIZE * cell_h;
+                SDL_RenderCopy(wind->sdl_renderer, chunk->texture, NULL,
+                               &dest);
+            }
+        }
+    }
+
+    if (canvas->selection.w > 0 && canvas->selection.h > 0)
+    {
+        SDL_Rect outline = {0};
+        outline.x = area.x + (canvas->selection.x - origin.x) * cell_w;
+        outline.y = area.y + (canvas->selection.y - origin.y) * cell_h;
+        outline.w = canvas->selection.w * cell_w;
+        outline.h = canvas->selection.h * cell_h;
+
+        u8 r = 0, g = 0, b = 0, a = 0;
+        SDL_GetRenderDrawColor(wind->sdl_renderer, &r, &g, &b, &a);
+        SDL_SetRenderDrawColor(wind->sdl_renderer, WHITE.r, WHITE.g, WHITE.b,
+                               WHITE.a);
+        SDL_RenderDrawRect(wind->sdl_renderer, &outline);
+        SDL_SetRenderDrawColor(wind->sdl_renderer, r, g, b, a);
+    }
+
+    SDL_RenderSetClipRect(wind->sdl_renderer, clipped ? &clip : NULL);
+}
+
+/**
+ * \desc Zooming in adds the size again for each level, so that every level
+ * from zero up is a whole multiple of it. Zooming out halves it, but never
+ * below a single pixel.
+ */
+[[nodiscard]] i32 CanvasZoomSize(i32 size, i32 zoom)
+{
+    if (zoom >= 0)
+    {
+        return size * (zoom + 1);
+    }
+
+    return SDL_max(size >> -zoom, 1);
+}
+
+/**
+ * \desc Renders a canvas to a window based on a given texture: the cache is
+ * refreshed, then drawn into the canvas rectangle from the canvas offset.
+ */
+void CanvasRender(Canvas* canvas, const Window* wind, const Texture* tex)
+{
+    CanvasRefresh(canvas, wind, tex);
+
+    const SDL_Point origin = {canvas->offset_x, canvas->offset_y};
+    CanvasBlit(canvas, wind, tex, canvas->rect, origin, 0);
+}
+
+/**
+ * \desc The offset is clamped so that the rectangle never scrolls past the last
+ * row or column of cells.
+ */
+void CanvasScroll(Canvas* canvas, i32 dx, i32 dy)
+{
+    const i32 max_x = SDL_max(canvas->cells->width - canvas->rect.w, 0);
+    const i32 max_y = SDL_max(canvas->cells->height - canvas->rect.h, 0);
+    canvas->offset_x = SDL_min(SDL_max(canvas->offset_x + dx, 0), max_x);
+    canvas->offset_y = SDL_min(SDL_max(canvas->offset_y + dy, 0), max_y);
+}
+
+/**
+ * \desc Converts the row-major index to a position in the chunk store.
+ */
+[[nodiscard]] Cell CanvasGetCell(Canvas* canvas, size_t index)
+{
+    const i32 width = canvas->cells->width;
+    if (width <= 0)
+    {
+        return (Cell){0};
+    }
+
+    return ChunkStoreGet(canvas->cells, (i32)(index % width),
+                         (i32)(index / width));
+}
+
+/**
+ * \desc Marks a cell which has been written so that the cache is brought up to
+ * date. Whether the cell is animated is noted in its chunk at every scale it is
+ * cached at, and it is drawn straight into the minimap, if there is one.
+ */
+static void CanvasCellChanged(Canvas* canvas, i32 x, i32 y, Cell cell)
+{
+    CanvasMarkDirty(canvas, (size_t)x + (size_t)y * canvas->cells->width);
+
+    const i32 key = x / CHUNK_SIZE + (y / CHUNK_SIZE) * canvas->cells->chunks_w;
+    for (i32 scale = 1; canvas->anims && scale <= TEXTURE_MAX_SCALE; ++scale)
+    {
+        CanvasChunk* chunk = CanvasCached(canvas, key, scale);
+        if (chunk)
+        {
+            const i32 bit = x % CHUNK_SIZE + (y % CHUNK_SIZE) * CHUNK_SIZE;
+            CanvasSetAnimated(chunk, bit,
+                              AnimationsHas(canvas->anims, cell.index));
+        }
+    }
+
+    if (canvas->minimap)
+    {
+        MinimapSetCell(canvas->minimap, x, y, cell);
+    }
+}
+
+/**
+ * \desc Only the outermost transaction resets the buffers, and is recorded
+ * unless told otherwise.
+ */
+void CanvasBegin(Canvas* canvas)
+{
+    if (canvas->txn.depth++ == 0)
+    {
+        canvas->txn.count = 0;
+        canvas->txn.record = true;
+    }
+}
+
+/**
+ * \desc Opens a transaction whose changes are not recorded to the history, as
+ * when an entry of the history is itself being undone or redone. Nested
+ * within another transaction, it is recorded as that one is.
+ */
+static void CanvasBeginUnrecorded(Canvas* canvas)
+{
+    CanvasBegin(canvas);
+    if (canvas->txn.depth == 1)
+    {
+        canvas->txn.record = false;
+    }
+}
+
+/**
+ * \desc Makes room for a number of writes more, doubling the buffer as often
+ * as needed.
+ */
+static void CanvasReserve(CanvasTransaction* txn, size_t count)
+{
+    if (txn->count + count <= txn->capacity)
+    {
+        return;
+    }
+
+    size_t capacity = txn->capacity ? txn->capacity : 64;
+    while (capacity < txn->count + count)
+    {
+        capacity <<= 1;
+    }
+
+    txn->writes = Reallocate(txn->writes, sizeof(CanvasPending) * capacity);
+    txn->capacity = capacity;
+}
+
+/**
+ * \desc Appends a write of a cell which is known to lie within the canvas.
+ */
+static void CanvasStage(Canvas* canvas, i32 x, i32 y, Cell cell)
+{
+    CanvasTransaction* txn = &canvas->txn;
+    CanvasPending* write = &txn->writes[txn->count];
+    write->chunk =
+        (u32)(x / CHUNK_SIZE + (y / CHUNK_SIZE) * canvas->cells->chunks_w);
+    write->offset = (u16)(x % CHUNK_SIZE + (y % CHUNK_SIZE) * CHUNK_SIZE);
+    write->order = (u32)txn->count;
+    write->cell = cell;
+    txn->count++;
+}
+
+/**
+ * \desc Writes outside of the canvas are dropped straight away.
+ */
+void CanvasWrite(Canvas* canvas, i32 x, i32 y, Cell cell)
+{
+    if (x < 0 || y < 0 || x >= canvas->cells->width ||
+        y >= canvas->cells->height)
+    {
+        return;
+    }
+
+    CanvasReserve(&canvas->txn, 1);
+    CanvasStage(canvas, x, y, cell);
+}
+
+/**
+ * \desc The run is clipped to the canvas first.
+ */
+void CanvasWriteSpan(Canvas* canvas, i32 x, i32 y, i32 count, Cell cell)
+{
+    const i32 x0 = SDL_max(x, 0);
+    const i32 x1 = SDL_min(x + count, canvas->cells->width);
+    if (y < 0 || y >= canvas->cells->height || x0 >= x1)
+    {
+        return;
+    }
+
+    CanvasReserve(&canvas->txn, (size_t)(x1 - x0));
+    for (i32 i = x0; i < x1; ++i)
+    {
+        CanvasStage(canvas, i, y, cell);
+    }
+}
+
+/**
+ * \desc The block is clipped to the canvas and staged a chunk at a time, so
+ * that a block written on its own is already in order of chunk when it is
+ * committed, and need not be sorted.
+ */
+void CanvasWriteBlock(Canvas* canvas, const Cell* cells, SDL_Rect rect)
+{
+    const i32 x0 = SDL_max(rect.x, 0);
+    const i32 x1 = SDL_min(rect.x + rect.w, canvas->cells->width);
+    const i32 y0 = SDL_max(rect.y, 0);
+    const i32 y1 = SDL_min(rect.y + rect.h, canvas->cells->height);
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return;
+    }
+
+    CanvasReserve(&canvas->txn, (size_t)(x1 - x0) * (size_t)(y1 - y0));
+    for (i32 cy = y0 / CHUNK_SIZE; cy <= (y1 - 1) / CHUNK_SIZE; ++cy)
+    {
+        const i32 row0 = SDL_max(y0, cy * CHUNK_SIZE);
+        const i32 row1 = SDL_min(y1, (cy + 1) * CHUNK_SIZE);
+        for (i32 cx = x0 / CHUNK_SIZE; cx <= (x1 - 1) / CHUNK_SIZE; ++cx)
+        {
+            const i32 col0 = SDL_max(x0, cx * CHUNK_SIZE);
+            const i32 col1 = SDL_min(x1, (cx + 1) * CHUNK_SIZE);
+            for (i32 y = row0; y < row1; ++y)
+            {
+                const Cell* source = &cells[(y - rect.y) * rect.w - rect.x];
+                for (i32 x = col0; x < col1; ++x)
+                {
+                    CanvasStage(canvas, x, y, source[x]);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * \desc Orders writes by chunk, then by cell, then by when they were made.
+ */
+static int CanvasWriteSort(const void* a, const void* b)
+{
+    const CanvasPending* wa = a;
+    const CanvasPending* wb = b;
+    const u64 ka = (u64)wa->chunk * CHUNK_CELLS + wa->offset;
+    const u64 kb = (u64)wb->chunk * CHUNK_CELLS + wb->offset;
+    if (ka != kb)
+    {
+        return ka < kb ? -1 : 1;
+    }
+
+    return wa->order < wb->order ? -1 : (wa->order > wb->order);
+}
+
+/**
+ * \desc Adds a change to the changes of the commit.
+ */
+static void CanvasAddChange(CanvasTransaction* txn, size_t index, Cell before,
+                            Cell after)
+{
+    if (txn->num_changes == txn->cap_changes)
+    {
+        txn->cap_changes = txn->cap_changes ? txn->cap_changes << 1 : 64;
+        txn->changes =
+            Reallocate(txn->changes, sizeof(HistoryEdit) * txn->cap_changes);
+    }
+
+    txn->changes[txn->num_changes++] =
+        (HistoryEdit){.index = index, .before = before, .after = after};
+}
+
+/**
+ * \desc The writes are sorted by chunk, unless they already are, and only the
+ * last write to each cell is kept. Each chunk is then acquired once, and the
+ * writes which change a cell applied to it, and noted in the usage of the
+ * chunk. Only once every write is applied are the changes published, all
+ * together: each changed cell is marked to be redrawn and drawn into the
+ * minimap, the changes are recorded to the history and logged to the journal,
+ * and every listener is notified of them and the area they cover.
+ */
+size_t CanvasCommit(Canvas* canvas)
+{
+    CanvasTransaction* txn = &canvas->txn;
+    if (txn->depth == 0 || --txn->depth > 0)
+    {
+        return 0;
+    }
+
+    bool sorted = true;
+    for (size_t i = 1; i < txn->count && sorted; ++i)
+    {
+        sorted = CanvasWriteSort(&txn->writes[i - 1], &txn->writes[i]) < 0;
+    }
+
+    if (!sorted)
+    {
+        qsort(txn->writes, txn->count, sizeof(CanvasPending), &CanvasWriteSort);
+    }
+
+    ChunkStore* store = canvas->cells;
+    txn->num_changes = 0;
+    i32 bounds[4] = {INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN};
+    i64 held = -1;
+    Cell* cells = NULL;
+
+    for (size_t i = 0; i < txn->count; ++i)
+    {
+        const CanvasPending* write = &txn->writes[i];
+        if (i + 1 < txn->count && txn->writes[i + 1].chunk == write->chunk &&
+            txn->writes[i + 1].offset == write->offset)
+        {
+            continue;
+        }
+
+        const i32 cx = (i32)write->chunk % store->chunks_w;
+        const i32 cy = (i32)write->chunk / store->chunks_w;
+        if (held != write->chunk)
+        {
+            if (held >= 0)
+            {
+                ChunkStoreRelease(store, (i32)held % store->chunks_w,
+                                  (i32)held / store->chunks_w);
+            }
+            cells = ChunkStoreAcquire(store, cx, cy);
+            held = write->chunk;
+        }
+
+        Cell* target = &cells[write->offset];
+        if (memcmp(target, &write->cell, sizeof(Cell)) == 0)
+        {
+            continue;
+        }
+
+        const i32 x = cx * CHUNK_SIZE + write->offset % CHUNK_SIZE;
+        const i32 y = cy * CHUNK_SIZE + write->offset / CHUNK_SIZE;
+        CanvasAddChange(txn, (size_t)x + (size_t)y * store->width, *target,
+                        write->cell);
+        *target = write->cell;
+        ChunkStoreNote(store, cx, cy, write->cell);
+
+        bounds[0] = SDL_min(bounds[0], x);
+        bounds[1] = SDL_min(bounds[1], y);
+        bounds[2] = SDL_max(bounds[2], x + 1);
+        bounds[3] = SDL_max(bounds[3], y + 1);
+    }
+
+    if (held >= 0)
+    {
+        ChunkStoreRelease(store, (i32)held % store->chunks_w,
+                          (i32)held / store->chunks_w);
+    }
+    txn->count = 0;
+
+    if (txn->num_changes == 0)
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < txn->num_changes; ++i)
+    {
+        const HistoryEdit* change = &txn->changes[i];
+        CanvasCellChanged(canvas, (i32)(change->index % store->width),
+                          (i32)(change->index / store->width), change->after);
+        if (canvas->history && txn->record)
+        {
+            HistoryRecord(canvas->history, change->index, change->before,
+                          change->after);
+        }
+        if (canvas->journal)
+        {
+            JournalEdit(canvas->journal, change->index, change->after);
+        }
+    }
+
+    CanvasChange change = {0};
+    change.edits = txn->changes;
+    change.count = txn->num_changes;
+    change.bounds = (SDL_Rect){bounds[0], bounds[1], bounds[2] - bounds[0],
+                               bounds[3] - bounds[1]};
+
+    for (size_t i = 0; i < VectorLength(canvas->listeners); ++i)
+    {
+        const CanvasListener* listener = VectorAt(canvas->listeners, i);
+        listener->notify(listener->data, &change);
+    }
+
+    return txn->num_changes;
+}
+
+/**
+ * \desc Listeners are notified in the order they were added.
+ */
+void CanvasListen(Canvas* canvas,
+                  void (*notify)(void* data, const CanvasChange* change),
+                  void* data)
+{
+    CanvasListener* listener = Allocate(sizeof(CanvasListener));
+    listener->notify = notify;
+    listener->data = data;
+    VectorPush(canvas->listeners, listener);
+}
+
+/**
+ * \desc Removes the first listener which matches, if any.
+ */
+void CanvasUnlisten(Canvas* canvas,
+                    void (*notify)(void* data, const CanvasChange* change),
+                    void* data)
+{
+    for (size_t i = 0; i < VectorLength(canvas->listeners); ++i)
+    {
+        CanvasListener* listener = VectorAt(canvas->listeners, i);
+        if (listener->notify == notify && listener->data == data)
+        {
+            Free(listener);
+            VectorDelete(canvas->listeners, i);
+            return;
+        }
+    }
+}
+
+/**
+ * \desc Writes a cell given by its row-major index.
+ */
+static void CanvasWriteIndex(Canvas* canvas, size_t index, Cell cell)
+{
+    const i32 width = canvas->cells->width;
+    if (width > 0)
+    {
+        CanvasWrite(canvas, (i32)(index % width), (i32)(index / width), cell);
+    }
+}
+
+/**
+ * \desc Each span of the brush is written as a run, in a transaction of its
+ * own, so that only the cells which change are recorded and redrawn.
+ */
+size_t CanvasStamp(Canvas* canvas, const Brush* brush, i32 x, i32 y, Cell cell)
+{
+    CanvasBegin(canvas);
+    for (size_t i = 0; i < brush->num_spans; ++i)
+    {
+        const BrushSpan* span = &brush->spans[i];
+        CanvasWriteSpan(canvas, x + span->x0, y + span->dy,
+                        span->x1 - span->x0, cell);
+    }
+
+    return CanvasCommit(canvas);
+}
+
+/**
+ * \desc The brush is not owned by the canvas. Any stroke underway is ended, so
+ * that the new brush does not join up with where the old one was stamped.
+ */
+void CanvasSetBrush(Canvas* canvas, const Brush* brush)
+{
+    canvas->brush = brush;
+    canvas->stroking = false;
+}
+
+/**
+ * \desc The block is read from the store under a single lock, a chunk at a
+ * time.
+ */
+[[nodiscard]] Cell* CanvasCopy(Canvas* canvas, SDL_Rect rect)
+{
+    Cell* cells = Allocate(sizeof(Cell) * (size_t)(rect.w * rect.h));
+    ChunkStoreRead(canvas->cells, rect, cells);
+
+    return cells;
+}
+/**
+ * \desc The block is written in a transaction of its own.
+ */
+size_t CanvasPaste(Canvas* canvas, const Cell* cells, SDL_Rect rect)
+{
+    CanvasBegin(canvas);
+    CanvasWriteBlock(canvas, cells, rect);
+    return CanvasCommit(canvas);
+}
+
+/**
+ * \desc Only the chunks whose usage may hold a match are read, a chunk at a
+ * time, and every cell which matches is written in a single transaction, so
+ * that a whole canvas with few matches is replaced in a single history entry
+ * without reading the rest of it.
+ */
+size_t CanvasReplace(Canvas* canvas, const CellMatch* match, Cell cell)
+{
+    ChunkStore* store = canvas->cells;
+    const i32 total = SDL_max(store->chunks_w * store->chunks_h, 1);
+    i32* chunks = Allocate(sizeof(i32) * (size_t)total);
+    const size_t num_chunks = ChunkStoreFind(store, match, chunks);
+
+    CanvasBegin(canvas);
+    for (size_t i = 0; i < num_chunks; ++i)
+    {
+        const i32 cx = chunks[i] % store->chunks_w;
+        const i32 cy = chunks[i] / store->chunks_w;
+        const i32 num_x = SDL_min(CHUNK_SIZE, store->width - cx * CHUNK_SIZE);
+        const i32 num_y = SDL_min(CHUNK_SIZE, store->height - cy * CHUNK_SIZE);
+        const Cell* cells = ChunkStoreAcquire(store, cx, cy);
+
+        for (i32 y = 0; y < num_y; ++y)
+        {
+            for (i32 x = 0; x < num_x; ++x)
+            {
+                Cell after = cells[x + y * CHUNK_SIZE];
+                if (!ChunkStoreMatches(match, after))
+                {
+                    continue;
+                }
+
+                after.index =
+                    match->fields & CELL_MATCH_GLYPH ? cell.index : after.index;
+                after.fg = match->fields & CELL_MATCH_FG ? cell.fg : after.fg;
+                after.bg = match->fields & CELL_MATCH_BG ? cell.bg : after.bg;
+                CanvasWrite(canvas, cx * CHUNK_SIZE + x, cy * CHUNK_SIZE + y,
+                            after);
+            }
+        }
+
+        ChunkStoreRelease(store, cx, cy);
+    }
+
+    Free(chunks);
+
+    MacroOp* op = CanvasRecord(canvas, MACRO_REPLACE);
+    if (op)
+    {
+        op->match = *match;
+        op->cell = cell;
+    }
+
+    return CanvasCommit(canvas);
+}
+
+/**
+ * \desc The cells are transformed chunk by chunk in the store. Every cached
+ * chunk may now hold other cells, and the grid may have changed shape, so the
+ * cache is dropped to be rebuilt, the minimap redrawn and the offset clamped
+ * again. The selection no longer marks the same cells, so it is cleared. Undone
+ * and redone transforms pass through here too, so all are logged to the
+ * journal.
+ */
+static void CanvasApplyTransform(Canvas* canvas, TransformType type)
+{
+    CanvasFreeCache(canvas);
+    ChunkStoreTransform(canvas->cells, type);
+    if (canvas->journal)
+    {
+        JournalTransform(canvas->journal, type);
+    }
+    CanvasSetMinimap(canvas, canvas->minimap);
+    CanvasScroll(canvas, 0, 0);
+
+    canvas->stroking = false;
+    canvas->selection = (SDL_Rect){0};
+    canvas->marking = false;
+}
+
+/**
+ * \desc The transform is recorded as it is, rather than as an edit of every
+ * cell, as undoing it is no more than applying its inverse.
+ */
+void CanvasTransform(Canvas* canvas, TransformType type)
+{
+    if (type == TRANSFORM_NONE)
+    {
+        return;
+    }
+
+    CanvasApplyTransform(canvas, type);
+    if (canvas->history)
+    {
+        HistoryRecordTransform(canvas->history, type);
+    }
+
+    MacroOp* op = CanvasRecord(canvas, MACRO_TRANSFORM);
+    if (op)
+    {
+        op->transform = type;
+    }
+}
+
+/**
+ * \desc The selection is lifted out, cleared and put back transformed with its
+ * top left corner in place, clipped to the canvas. Both the clearing and the
+ * placing are recorded into the same history entry, so that a single undo
+ * restores the selection as it was.
+ */
+size_t CanvasTransformSelection(Canvas* canvas, TransformType type)
+{
+    const SDL_Rect rect = canvas->selection;
+    if (type == TRANSFORM_NONE || rect.w <= 0 || rect.h <= 0)
+    {
+        return 0;
+    }
+
+    SDL_Rect dest = rect;
+    TransformSize(type, rect.w, rect.h, &dest.w, &dest.h);
+
+    MacroOp* op = CanvasRecord(canvas, MACRO_TRANSFORM_AREA);
+    if (op)
+    {
+        op->transform = type;
+        op->rect = rect;
+    }
+
+    const size_t num_cells = (size_t)(rect.w * rect.h);
+    Cell* cells = CanvasCopy(canvas, rect);
+    Cell* transformed = Allocate(sizeof(Cell) * num_cells);
+    Cell* blank = Allocate(sizeof(Cell) * num_cells);
+    TransformCells(type, cells, rect.w, rect.h, transformed);
+
+    if (canvas->history)
+    {
+        HistoryCommit(canvas->history);
+    }
+
+    CanvasBegin(canvas);
+    CanvasWriteBlock(canvas, blank, rect);
+    CanvasWriteBlock(canvas, transformed, dest);
+    const size_t changed = CanvasCommit(canvas);
+
+    if (canvas->history)
+    {
+        HistoryCommit(canvas->history);
+    }
+
+    canvas->selection.w = SDL_min(dest.w, canvas->cells->width - dest.x);
+    canvas->selection.h = SDL_min(dest.h, canvas->cells->height - dest.y);
+
+    Free(cells);
+    Free(transformed);
+    Free(blank);
+
+    return changed;
+}
+
+/**
+ * \desc The cells are resized chunk by chunk in the store, so the cache is
+ * dropped to be rebuilt along with the minimap. Cell indices depend upon the
+ * width of the canvas and cells may have been dropped, so the edits recorded
+ * before can no longer be undone, and the history is cleared. Each way of
+ * resizing records itself to the macro, so nothing is recorded here. A canvas
+ * is never made larger than the largest extent of a store.
+ */
+static bool CanvasApplyResize(Canvas* canvas, SDL_Rect rect)
+{
+    if (rect.w <= 0 || rect.h <= 0 || rect.w > CHUNK_MAX_EXTENT ||
+        rect.h > CHUNK_MAX_EXTENT)
+    {
+        return false;
+    }
+
+    CanvasFreeCache(canvas);
+    ChunkStoreResize(canvas->cells, rect, (Cell){0});
+    if (canvas->journal)
+    {
+        JournalResize(canvas->journal, rect);
+    }
+    CanvasSetMinimap(canvas, canvas->minimap);
+    CanvasScroll(canvas, 0, 0);
+
+    if (canvas->history)
+    {
+        HistoryClear(canvas->history);
+    }
+
+    canvas->stroking = false;
+    canvas->selection = (SDL_Rect){0};
+    canvas->marking = false;
+
+    return true;
+}
+
+/**
+ * \desc The area kept is recorded to the macro as it is.
+ */
+void CanvasResize(Canvas* canvas, SDL_Rect rect)
+{
+    MacroOp* op = CanvasApplyResize(canvas, rect)
+                      ? CanvasRecord(canvas, MACRO_RESIZE)
+                      : NULL;
+    if (op)
+    {
+        op->rect = rect;
+    }
+}
+
+/**
+ * \desc The area kept is offset by none, half or all of the change in size,
+ * according to the column and row of the anchor. The change in size is
+ * recorded to the macro, rather than the size, so that it grows every map it
+ * is played onto alike.
+ */
+void CanvasResizeAnchored(Canvas* canvas, i32 width, i32 height,
+                          CanvasAnchor anchor)
+{
+    const i32 dw = canvas->cells->width - width;
+    const i32 dh = canvas->cells->height - height;
+
+    SDL_Rect rect = {0};
+    rect.x = dw * (i32)(anchor % 3) / 2;
+    rect.y = dh * (i32)(anchor / 3) / 2;
+    rect.w = width;
+    rect.h = height;
+
+    MacroOp* op = CanvasApplyResize(canvas, rect)
+                      ? CanvasRecord(canvas, MACRO_GROW)
+                      : NULL;
+    if (op)
+    {
+        op->rect = (SDL_Rect){0, 0, -dw, -dh};
+        op->anchor = (u8)anchor;
+    }
+}
+
+/**
+ * \desc A canvas with nothing on it is left as it is, rather than being cropped
+ * to nothing. The crop is recorded to the macro as such, so that each map it is
+ * played onto is cropped to its own content.
+ */
+bool CanvasCropToContent(Canvas* canvas)
+{
+    const SDL_Rect bounds = ChunkStoreBounds(canvas->cells, (Cell){0});
+    if (!CanvasApplyResize(canvas, bounds))
+    {
+        return false;
+    }
+
+    CanvasRecord(canvas, MACRO_CROP);
+    return true;
+}
+
+/**
+ * \desc The block is filled a band of chunk rows at a time, so that however
+ * large it is, only one band of cells is ever held outside of the store. Each
+ * band is read in a chunk at a time, filled a row at a time and written back
+ * with CanvasPaste, in a transaction of its own which only publishes the cells
+ * which changed.
+ */
+size_t CanvasFillGradient(Canvas* canvas, const Gradient* gradient,
+                          SDL_Rect rect)
+{
+    ChunkStore* store = canvas->cells;
+    const i32 x0 = SDL_max(rect.x, 0);
+    const i32 x1 = SDL_min(rect.x + rect.w, store->width);
+    const i32 y0 = SDL_max(rect.y, 0);
+    const i32 y1 = SDL_min(rect.y + rect.h, store->height);
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return 0;
+    }
+
+    Cell* band = Allocate(sizeof(Cell) * (size_t)((x1 - x0) * CHUNK_SIZE));
+    size_t changed = 0;
+
+    for (i32 y = y0; y < y1;)
+    {
+        const i32 end = SDL_min((y / CHUNK_SIZE + 1) * CHUNK_SIZE, y1);
+        const SDL_Rect part = {x0, y, x1 - x0, end - y};
+
+        ChunkStoreRead(store, part, band);
+        GradientFill(gradient, part, band);
+        changed += CanvasPaste(canvas, band, part);
+        y = end;
+    }
+
+    Free(band);
+
+    return changed;
+}
+
+/**
+ * \desc The gradient is not owned by the canvas. Any stroke underway is ended.
+ */
+void CanvasSetGradient(Canvas* canvas, const Gradient* gradient)
+{
+    canvas->gradient = gradient;
+    canvas->stroking = false;
+}
+
+/**
+ * \desc The stamp is not owned by the canvas. Any stroke underway is ended.
+ */
+void CanvasSetStamp(Canvas* canvas, Stamp* stamp)
+{
+    canvas->stamp = stamp;
+    canvas->stroking = false;
+}
+
+/**
+ * \desc This is the only time every cell is drawn into the minimap: a chunk at
+ * a time, so each chunk is decompressed at most once. From then on the minimap
+ * is kept up to date by each cell that is set.
+ */
+void CanvasSetMinimap(Canvas* canvas, Minimap* minimap)
+{
+    canvas->minimap = minimap;
+    if (minimap == NULL)
+    {
+        return;
+    }
+
+    ChunkStore* store = canvas->cells;
+    MinimapResize(minimap, store->width, store->height);
+
+    for (i32 cy = 0; cy < store->chunks_h; ++cy)
+    {
+        for (i32 cx = 0; cx < store->chunks_w; ++cx)
+        {
+            const Cell* cells = ChunkStoreAcquire(store, cx, cy);
+            for (i32 j = 0; j < CHUNK_SIZE; ++j)
+            {
+                for (i32 i = 0; i < CHUNK_SIZE; ++i)
+                {
+                    MinimapSetCell(minimap, cx * CHUNK_SIZE + i,
+                                   cy * CHUNK_SIZE + j,
+                                   cells[i + j * CHUNK_SIZE]);
+                }
+            }
+            ChunkStoreRelease(store, cx, cy);
+        }
+    }
+}
+
+/**
+ * \desc Which cells are animated depends upon the animations, so the cache is
+ * dropped to be rebuilt, along with a new timing wheel, when next rendered.
+ */
+void CanvasSetAnimations(Canvas* canvas, const Animations* anims)
+{
+    if (canvas->anims == anims)
+    {
+        return;
+    }
+
+    canvas->anims = anims;
+    CanvasFreeCache(canvas);
+}
+
+/**
+ * \desc Only cells of cached chunks are marked, at every scale their chunk is
+ * cached at, as any other chunk is drawn whole when it is next cached. The
+ * count of the chunk of the cell is kept too, so that clean chunks are skipped
+ * when the caches are refreshed.
+ */
+void CanvasMarkDirty(Canvas* canvas, size_t index)
+{
+    const ChunkStore* store = canvas->cells;
+    if (canvas->resident == NULL ||
+        index >= (size_t)(store->width * store->height))
+    {
+        return;
+    }
+
+    const i32 x = (i32)(index % store->width);
+    const i32 y = (i32)(index / store->width);
+    const i32 key = x / CHUNK_SIZE + (y / CHUNK_SIZE) * store->chunks_w;
+    const i32 bit = x % CHUNK_SIZE + (y % CHUNK_SIZE) * CHUNK_SIZE;
+    const u64 mask = (u64)1 << (bit % 64);
+    for (i32 scale = 1; scale <= TEXTURE_MAX_SCALE; ++scale)
+    {
+        CanvasChunk* chunk = CanvasCached(canvas, key, scale);
+        if (chunk == NULL || chunk->dirty[bit / 64] & mask)
+        {
+            continue;
+        }
+
+        chunk->dirty[bit / 64] |= mask;
+        chunk->num_dirty++;
+        canvas->num_dirty++;
+    }
+}
+
+/**
+ * \desc Restores the before state of every edit of the entry, in reverse order,
+ * or applies the inverse of its transform. The edits are written in one
+ * transaction which is not itself recorded.
+ */
+bool CanvasUndo(Canvas* canvas)
+{
+    if (canvas->history == NULL)
+    {
+        return false;
+    }
+
+    const HistoryEntry* entry = HistoryUndo(canvas->history);
+    if (entry == NULL)
+    {
+        return false;
+    }
+
+    if (entry->transform != TRANSFORM_NONE)
+    {
+        CanvasApplyTransform(canvas, TransformInverse(entry->transform));
+    }
+
+    CanvasBeginUnrecorded(canvas);
+    for (size_t i = entry->count; i-- > 0;)
+    {
+        CanvasWriteIndex(canvas, entry->edits[i].index, entry->edits[i].before);
+    }
+    CanvasCommit(canvas);
+
+    return true;
+}
+
+/**
+ * \desc Restores the after state of every edit of the entry, in order, or
+ * applies its transform again, in one transaction like an undo.
+ */
+bool CanvasRedo(Canvas* canvas)
+{
+    if (canvas->history == NULL)
+    {
+        return false;
+    }
+
+    const HistoryEntry* entry = HistoryRedo(canvas->history);
+    if (entry == NULL)
+    {
+        return false;
+    }
+
+    if (entry->transform != TRANSFORM_NONE)
+    {
+        CanvasApplyTransform(canvas, entry->transform);
+    }
+
+    CanvasBeginUnrecorded(canvas);
+    for (size_t i = 0; i < entry->count; ++i)
+    {
+        CanvasWriteIndex(canvas, entry->edits[i].index, entry->edits[i].after);
+    }
+    CanvasCommit(canvas);
+
+    return true;
+}
+
+/**
+ * \desc Clips a rectangle of a macro to the canvas as it is now, which may not
+ * be the size it was recorded on, or may have been made up by hand. The sums
+ * are widened, so that a rectangle far off the canvas does not wrap around
+ * onto it.
+ */
+static bool CanvasClipRect(const Canvas* canvas, SDL_Rect rect,
+                           SDL_Rect* clipped)
+{
+    const i64 x0 = SDL_max((i64)rect.x, 0);
+    const i64 y0 = SDL_max((i64)rect.y, 0);
+    const i64 x1 = SDL_min((i64)rect.x + rect.w, (i64)canvas->cells->width);
+    const i64 y1 = SDL_min((i64)rect.y + rect.h, (i64)canvas->cells->height);
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return false;
+    }
+
+    *clipped = (SDL_Rect){(i32)x0, (i32)y0, (i32)(x1 - x0), (i32)(y1 - y0)};
+    return true;
+}
+
+/**
+ * \desc The macro attached to the canvas, if any, is detached whilst playing,
+ * so that a macro played whilst recording is not recorded a second time. A
+ * brush is made again only when the shape or radius changes, and an area is
+ * transformed by selecting it for the while. Every rectangle is clipped to the
+ * canvas first, and an operation which falls off it is skipped, as is a growth
+ * which would leave the canvas empty or larger than it may be. Edits played
+ * in a row are recorded into a single history entry, but a transform is an
+ * entry of its own, a transformed area commits the edits before it, and a
+ * resize clears the history, so a macro which does any of those takes more
+ * than one undo to revert.
+ */
+size_t CanvasPlayMacro(Canvas* canvas, const Macro* macro)
+{
+    Macro* recording = canvas->macro;
+    canvas->macro = NULL;
+
+    Brush* brush = NULL;
+    size_t changed = 0;
+
+    for (size_t i = 0; i < macro->count; ++i)
+    {
+        const MacroOp* op = &macro->ops[i];
+        const SDL_Rect rect = op->rect;
+        SDL_Rect clipped = {0};
+
+        switch (op->kind)
+        {
+        case MACRO_PLACE:
+            CanvasBegin(canvas);
+            CanvasWrite(canvas, rect.x, rect.y, op->cell);
+            changed += CanvasCommit(canvas);
+            break;
+        case MACRO_BRUSH:
+            if (brush == NULL || brush->shape != op->shape ||
+                brush->radius != op->radius)
+            {
+                if (brush)
+                {
+                    BrushFree(brush);
+                }
+                brush = BrushCreate(op->shape, op->radius);
+            }
+            changed += CanvasStamp(canvas, brush, rect.x, rect.y, op->cell);
+            break;
+        case MACRO_SPAN:
+            if (CanvasClipRect(canvas, (SDL_Rect){rect.x, rect.y, rect.w, 1},
+                               &clipped))
+            {
+                CanvasBegin(canvas);
+                CanvasWriteSpan(canvas, clipped.x, clipped.y, clipped.w,
+                                op->cell);
+                changed += CanvasCommit(canvas);
+            }
+            break;
+        case MACRO_PASTE:
+            // The block is written whole, as it clips itself whilst keeping
+            // the offset of each cell within it.
+            if (CanvasClipRect(canvas, rect, &clipped))
+            {
+                changed += CanvasPaste(canvas, op->cells, rect);
+            }
+            break;
+        case MACRO_REPLACE:
+            changed += CanvasReplace(canvas, &op->match, op->cell);
+            break;
+        case MACRO_GRADIENT:
+            if (CanvasClipRect(canvas, rect, &clipped))
+            {
+                changed += CanvasFillGradient(canvas, &op->gradient, clipped);
+            }
+            break;
+        case MACRO_TRANSFORM:
+            CanvasTransform(canvas, op->transform);
+            break;
+        case MACRO_TRANSFORM_AREA:
+            if (CanvasClipRect(canvas, rect, &clipped))
+            {
+                canvas->selection = clipped;
+                CanvasTransformSelection(canvas, op->transform);
+                canvas->selection = (SDL_Rect){0};
+            }
+            break;
+        case MACRO_RESIZE:
+            CanvasResize(canvas, rect);
+            break;
+        case MACRO_GROW:
+        {
+            const i64 width = (i64)canvas->cells->width + rect.w;
+            const i64 height = (i64)canvas->cells->height + rect.h;
+            if (width > 0 && height > 0 && width <= CHUNK_MAX_EXTENT &&
+                height <= CHUNK_MAX_EXTENT)
+            {
+                CanvasResizeAnchored(canvas, (i32)width, (i32)height,
+                                     (CanvasAnchor)op->anchor);
+            }
+            break;
+        }
+        case MACRO_CROP:
+            CanvasCropToContent(canvas);
+            break;
+        }
+    }
+
+    if (canvas->history)
+    {
+        HistoryCommit(canvas->history);
+    }
+
+    if (brush)
+    {
+        BrushFree(brush);
+    }
+
+    canvas->macro = recording;
+
+    return changed;
+}
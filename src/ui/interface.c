@@ -16,10 +16,10 @@
 
 /**
  * \desc Begins by allocating memory for the interface and assigning glyph
- * dimensions. The interface componentes are then created after this and pushed
- * into the widget vector. The widgets are sorted by render order at the end of
- * the function.
- * TODO: Load from a JSON file or something similar.
+ * dimensions. The interface components are then created from the editor layout
+ * and pushed into the widget vector. The widgets are sorted by render order and
+ * then indexed by the perfect hash slot of their identifier. The drawing area
+ * follows the main canvas of the layout.
  */
 [[nodiscard]] Interface* InterfaceCreate(Texture* tex)
 {
@@ -33,16 +33,39 @@
     itfc->cur_glyph->x = 17;
     itfc->cur_glyph->y = 14;
 
+    itfc->ghost_stamp = NULL;
     itfc->show_ghost = false;
     itfc->active_tab = 1;
-    itfc->drawing_area = (SDL_Rect){21, 1, 58, 43};
 
     itfc->widgets = VectorCreate();
-    InterfaceCreateWidgets(itfc);
+    if (!InterfaceLoadLayout(itfc, INTERFACE_LAYOUT))
+    {
+        Log(LOG_FATAL, "Could not load interface layout %s!", INTERFACE_LAYOUT);
+    }
 
     qsort(itfc->widgets->data, VectorLength(itfc->widgets), sizeof(Widget*),
           &WidgetSort);
 
+    for (size_t i = 0; i < VectorLength(itfc->widgets); ++i)
+    {
+        Widget* widget = VectorAt(itfc->widgets, i);
+        const i32 slot = PerfectHashLookup(&WIDGET_IDS, widget->id);
+        if (slot < 0)
+        {
+            Log(LOG_WARNING, "Widget \"%s\" is not listed in widget_ids.keys!",
+                widget->id);
+            continue;
+        }
+
+        itfc->lookup[slot] = widget;
+    }
+
+    const Widget* cvs_main = InterfaceFindWidget(itfc, "cvs_main");
+    if (cvs_main)
+    {
+        itfc->drawing_area = ((const Canvas*)cvs_main->data)->rect;
+    }
+
     return itfc;
 }
 
@@ -82,7 +105,7 @@ void InterfaceHandleInput(Interface* itfc, Input* input)
         }
     }
 
-    Widget* btn_quit = WidgetFind(itfc->widgets, "btn_quit");
+    Widget* btn_quit = InterfaceFindWidget(itfc, "btn_quit");
     if (btn_quit)
     {
         if (ButtonIsPressed((Button*)btn_quit->data))
@@ -91,7 +114,7 @@ void InterfaceHandleInput(Interface* itfc, Input* input)
         }
     }
 
-    Widget* btn_tab1 = WidgetFind(itfc->widgets, "btn_tab1");
+    Widget* btn_tab1 = InterfaceFindWidget(itfc, "btn_tab1");
     if (btn_tab1)
     {
         if (ButtonIsPressed((Button*)btn_tab1->data))
@@ -100,7 +123,7 @@ void InterfaceHandleInput(Interface* itfc, Input* input)
         }
     }
 
-    Widget* btn_tab2 = WidgetFind(itfc->widgets, "btn_tab2");
+    Widget* btn_tab2 = InterfaceFindWidget(itfc, "btn_tab2");
     if (btn_tab2)
     {
         if (ButtonIsPressed((Button*)btn_tab2->data))
@@ -109,6 +132,15 @@ void InterfaceHandleInput(Interface* itfc, Input* input)
         }
     }
 
+    Widget* btn_load = InterfaceFindWidget(itfc, "btn_load");
+    if (btn_load)
+    {
+        if (ButtonIsPressed((Button*)btn_load->data))
+        {
+            itfc->active_tab = 3;
+        }
+    }
+
     if (InputKeyPressed(input, SDLK_1))
     {
         itfc->active_tab = 1;
@@ -117,6 +149,10 @@ void InterfaceHandleInput(Interface* itfc, Input* input)
     {
         itfc->active_tab = 2;
     }
+    else if (InputKeyPressed(input, SDLK_3))
+    {
+        itfc->active_tab = 3;
+    }
 
     itfc->show_ghost = InputMouseWithin(input, itfc->drawing_area);
     if (itfc->show_ghost)
@@ -153,7 +189,9 @@ void InterfaceUpdate(Interface* itfc)
 /**
  * \desc Renders the whole interface by iterating through each widget. Only the
  * persistent widgets or widgets in the current tab are rendered. The current
- * glyph is also rendered, as well as a ghost glyph if the flag is set.
+ * glyph is also rendered, as well as a ghost glyph if the flag is set. A ghost
+ * stamp is centred on the ghost glyph, drawn translucent with a single copy of
+ * its cached texture, and clipped to the drawing area.
  */
 void InterfaceRender(const Interface* itfc, const Window* wind,
                      const Texture* tex)
@@ -168,7 +206,29 @@ void InterfaceRender(const Interface* itfc, const Window* wind,
         }
     }
 
-    if (itfc->show_ghost)
+    if (itfc->show_ghost && itfc->ghost_stamp)
+    {
+        const Stamp* stamp = itfc->ghost_stamp;
+        SDL_Rect dest = {0};
+        dest.x = (itfc->ghost->x - stamp->width / 2) * tex->glyph_w;
+        dest.y = (itfc->ghost->y - stamp->height / 2) * tex->glyph_h;
+        dest.w = stamp->width * tex->glyph_w;
+        dest.h = stamp->height * tex->glyph_h;
+
+        SDL_Rect area = {0};
+        area.x = itfc->drawing_area.x * tex->glyph_w;
+        area.y = itfc->drawing_area.y * tex->glyph_h;
+        area.w = itfc->drawing_area.w * tex->glyph_w;
+        area.h = itfc->drawing_area.h * tex->glyph_h;
+
+        SDL_Rect clip = {0};
+        const bool clipped = SDL_RenderIsClipEnabled(wind->sdl_renderer);
+        SDL_RenderGetClipRect(wind->sdl_renderer, &clip);
+        SDL_RenderSetClipRect(wind->sdl_renderer, &area);
+        StampRender(itfc->ghost_stamp, wind, tex, dest, STAMP_GHOST_ALPHA);
+        SDL_RenderSetClipRect(wind->sdl_renderer, clipped ? &clip : NULL);
+    }
+    else if (itfc->show_ghost)
     {
         GlyphRender(itfc->ghost, wind, tex);
     }
@@ -180,143 +240,58 @@ void InterfaceRender(const Interface* itfc, const Window* wind,
 }
 
 /**
- * \desc A convenience function which creates a set of widgets for an interface
- * based on hard-coded values. Each widget type created is grouped logically.
+ * \desc Loads the layout, which maps its compiled cache when it is up to date,
+ * and instantiates every widget from it. The layout memory is released straight
+ * after, as the widgets hold their own copies of the glyphs.
  */
-void InterfaceCreateWidgets(Interface* itfc)
+bool InterfaceLoadLayout(Interface* itfc, const char* path)
 {
-    // BUTTONS -----------------------------------------------------------------
-    Button* btn_quit =
-        ButtonCreate(1, 41, "Quit", BORDER_SINGLE, GREY, LIGHTGREY, true);
-    Button* btn_save =
-        ButtonCreate(7, 41, "Save", BORDER_SINGLE, GREY, LIGHTGREY, false);
-    Button* btn_load =
-        ButtonCreate(13, 41, "Load", BORDER_SINGLE, GREY, LIGHTGREY, false);
-    Button* btn_tab1 =
-        ButtonCreate(2, 3, "Glyphs", BORDER_NONE, LIGHTGREY, BLANK, true);
-    Button* btn_tab2 =
-        ButtonCreate(9, 3, "Tools", BORDER_NONE, LIGHTGREY, BLANK, true);
-
-    VectorPush(itfc->widgets,
-               WidgetCreate("btn_quit", WIDGET_BUTTON, btn_quit, 1, 0));
-    VectorPush(itfc->widgets,
-               WidgetCreate("btn_save", WIDGET_BUTTON, btn_save, 1, 0));
-    VectorPush(itfc->widgets,
-               WidgetCreate("btn_load", WIDGET_BUTTON, btn_load, 1, 0));
-    VectorPush(itfc->widgets,
-               WidgetCreate("btn_tab1", WIDGET_BUTTON, btn_tab1, 0, 0));
-    VectorPush(itfc->widgets,
-               WidgetCreate("btn_tab2", WIDGET_BUTTON, btn_tab2, 0, 0));
-
-    // CANVASES ----------------------------------------------------------------
-    Canvas* cvs_main = CanvasCreate((SDL_Rect){21, 1, 58, 43}, true);
-    for (i32 i = 0; i < 58; ++i)
+    Layout* layout = LayoutLoad(path);
+    if (layout == NULL)
     {
-        for (i32 j = 0; j < 43; ++j)
-        {
-            Glyph* glyph = GlyphCreate();
-            glyph->x = i + cvs_main->rect.x;
-            glyph->y = j + cvs_main->rect.y;
-            glyph->fg = LIGHTGREY;
-            glyph->bg = BLACK;
-            glyph->index = 250;
-            VectorPush(cvs_main->glyphs, glyph);
-        }
+        return false;
     }
 
-    VectorPush(itfc->widgets,
-               WidgetCreate("cvs_main", WIDGET_CANVAS, cvs_main, 0, 0));
-
-    // LABELS ------------------------------------------------------------------
-    Label* lbl_title = LabelCreate(4, 0, "Karte v0.0.1", DARKGREY, LIGHTGREY);
-    Label* lbl_color = LabelCreate(2, 16, "Colours", LIGHTGREY, BLACK);
-    Label* lb_glyph = LabelCreate(2, 23, "Glyphs", LIGHTGREY, BLACK);
-    Label* lbl_current = LabelCreate(2, 14, "Current glyph:", LIGHTGREY, BLACK);
-    Label* lbl_tab1 = LabelCreate(2, 2, "Main", LIGHTGREY, BLACK);
-    Label* lbl_tab2 = LabelCreate(2, 2, "Tools", LIGHTGREY, BLACK);
-
-    VectorPush(itfc->widgets,
-               WidgetCreate("lbl_title", WIDGET_LABEL, lbl_title, 0, 1));
-    VectorPush(itfc->widgets,
-               WidgetCreate("lbl_color", WIDGET_LABEL, lbl_color, 1, 1));
-    VectorPush(itfc->widgets,
-               WidgetCreate("lbl_glyph", WIDGET_LABEL, lb_glyph, 1, 1));
-    VectorPush(itfc->widgets,
-               WidgetCreate("lbl_current", WIDGET_LABEL, lbl_current, 1, 1));
-    VectorPush(itfc->widgets,
-               WidgetCreate("lbl_tab1", WIDGET_LABEL, lbl_tab1, 1, 1));
-    VectorPush(itfc->widgets,
-               WidgetCreate("lbl_tab2", WIDGET_LABEL, lbl_tab2, 2, 1));
-
-    // PANELS ------------------------------------------------------------------
-    Panel* pnl_options =
-        PanelCreate((SDL_Rect){0, 0, 20, 45}, BORDER_SINGLE, LIGHTGREY);
-    Panel* pnl_editor =
-        PanelCreate((SDL_Rect){20, 0, 60, 45}, BORDER_SINGLE, LIGHTGREY);
-    Panel* pnl_color_box =
-        PanelCreate((SDL_Rect){1, 16, 18, 6}, BORDER_SINGLE, LIGHTGREY);
-    Panel* pnl_glyph_box =
-        PanelCreate((SDL_Rect){1, 23, 18, 18}, BORDER_SINGLE, LIGHTGREY);
-    Panel* pnl_tab =
-        PanelCreate((SDL_Rect){1, 2, 18, 3}, BORDER_SINGLE, LIGHTGREY);
-
-    VectorPush(itfc->widgets,
-               WidgetCreate("pnl_options", WIDGET_PANEL, pnl_options, 0, 0));
-    VectorPush(itfc->widgets,
-               WidgetCreate("pnl_editor", WIDGET_PANEL, pnl_editor, 0, 0));
-    VectorPush(itfc->widgets, WidgetCreate("pnl_color_box", WIDGET_PANEL,
-                                           pnl_color_box, 1, 0));
-    VectorPush(itfc->widgets, WidgetCreate("pnl_glyph_box", WIDGET_PANEL,
-                                           pnl_glyph_box, 1, 0));
-    VectorPush(itfc->widgets,
-               WidgetCreate("pnl_tab", WIDGET_PANEL, pnl_tab, 0, 0));
-
-    // SELECTORS ---------------------------------------------------------------
-    Selector* sct_glyphs =
-        SelectorCreate((SDL_Rect){2, 24, 17, 16}, SELECTOR_INDEX);
-    for (i32 i = 0; i < 16; ++i)
+    LayoutInstantiate(layout, itfc->widgets);
+    LayoutFree(layout);
+
+    return true;
+}
+
+/**
+ * \desc Swapping the data of the main canvas widget is all that is required to
+ * show another canvas: the widget does not own any other state of its canvas.
+ * The operation of the incoming canvas is reset so that input from while it was
+ * hidden is not applied.
+ */
+Canvas* InterfaceSetCanvas(Interface* itfc, Canvas* canvas)
+{
+    Widget* cvs_main = InterfaceFindWidget(itfc, "cvs_main");
+    if (cvs_main == NULL)
     {
-        for (i32 j = 0; j < 16; ++j)
-        {
-            Glyph* glyph = GlyphCreate();
-            glyph->x = i + sct_glyphs->rect.x;
-            glyph->y = j + sct_glyphs->rect.y;
-            glyph->fg = LIGHTGREY;
-            glyph->bg = BLACK;
-            glyph->index = i + j * 16;
-            VectorPush(sct_glyphs->glyphs, glyph);
-        }
+        return NULL;
     }
 
-    Selector* sct_colors = SelectorCreate(
-        (SDL_Rect){2, 17, 16, 4}, SELECTOR_FOREGROUND | SELECTOR_BACKGROUND);
-    i32 x = 0, y = 0;
-    const i32 dx[4] = {0, 1, 0, 1};
-    const i32 dy[4] = {0, 0, 1, 1};
-    for (i32 i = 0; i < 16; ++i)
-    {
-        if (i > 0 && i % 8 == 0)
-        {
-            x = 0;
-            y += 2;
-        }
+    Canvas* previous = cvs_main->data;
+    canvas->op = CANVAS_NONE;
+    cvs_main->data = canvas;
 
-        for (i32 j = 0; j < 4; ++j)
-        {
-            Glyph* glyph = GlyphCreate();
-            glyph->x = sct_colors->rect.x + x + dx[j];
-            glyph->y = sct_colors->rect.y + y + dy[j];
-            glyph->fg = COLORS[i];
-            glyph->bg = COLORS[i];
-            glyph->index = FILLED;
-            VectorPush(sct_colors->glyphs, glyph);
-        }
+    return previous;
+}
 
-        x += 2;
+/**
+ * \desc Finds a widget by its identifier through the perfect hash of the
+ * built-in widget identifiers. This is a single probe into the lookup table of
+ * the interface rather than a scan over every widget.
+ */
+[[nodiscard]] Widget* InterfaceFindWidget(const Interface* itfc,
+                                          const char* id)
+{
+    const i32 slot = PerfectHashLookup(&WIDGET_IDS, id);
+    if (slot < 0)
+    {
+        return NULL;
     }
 
-    VectorPush(itfc->widgets,
-               WidgetCreate("sct_glyphs ", WIDGET_SELECTOR, sct_glyphs, 1, 0));
-    VectorPush(itfc->widgets,
-               WidgetCreate("sct_colors", WIDGET_SELECTOR, sct_colors, 1, 0));
-}
\ No newline at end of file
+    return itfc->lookup[slot];
+}
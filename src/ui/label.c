@@ -60,6 +60,32 @@ void LabelFree(Label* label)
     Free(label);
 }
 
+/**
+ * \desc The existing glyphs are freed and new glyphs are created for the text,
+ * in the same colours and position as before.
+ */
+void LabelSetText(Label* label, const char* text)
+{
+    for (size_t i = 0; i < VectorLength(label->glyphs); ++i)
+    {
+        GlyphFree(VectorAt(label->glyphs, i));
+    }
+    label->glyphs->size = 0;
+
+    snprintf(label->text, sizeof(label->text), "%s", text);
+
+    for (u32 i = 0; i < strlen(label->text); ++i)
+    {
+        Glyph* glyph = GlyphCreate();
+        glyph->x = label->x + i;
+        glyph->y = label->y;
+        glyph->index = (u8)label->text[i];
+        glyph->fg = label->fg;
+        glyph->bg = label->bg;
+        VectorPush(label->glyphs, glyph);
+    }
+}
+
 /**
  * \desc Renders a label to a window based on a given texture by iterating
  * through its glyphs.
@@ -0,0 +1,826 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file layout.c
+ *
+ * \brief A layout describes the widgets of an interface in a text file. On
+ * first load the text is compiled into a binary blob with every glyph already
+ * built, which is cached next to the text file and memory-mapped on later
+ * loads. Widgets are then instantiated from the blob in a single pass.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "ui/layout.h"
+
+/**
+ * \desc Names of the colours in the order of the COLORS table.
+ */
+static const char* const LAYOUT_COLOR_NAMES[24] = {
+    "LIGHTGREY", "GREY",      "DARKGREY", "YELLOW", "GOLD",       "ORANGE",
+    "PINK",      "RED",       "MAROON",   "GREEN",  "LIME",       "DARKGREEN",
+    "SKYBLUE",   "BLUE",      "DARKBLUE", "PURPLE", "VIOLET",     "DARKPURPLE",
+    "BEIGE",     "BROWN",     "DARKBROWN", "WHITE", "BLACK",      "BLANK"};
+
+/**
+ * \desc The maximum number of whitespace separated fields on a layout line.
+ */
+#define LAYOUT_MAX_TOKENS 16
+
+/**
+ * \brief Growable arrays of widgets and glyphs used whilst compiling.
+ */
+typedef struct
+{
+    LayoutWidget* widgets;
+    size_t num_widgets;
+    size_t cap_widgets;
+    Glyph* glyphs;
+    size_t num_glyphs;
+    size_t cap_glyphs;
+} LayoutBuilder;
+
+/**
+ * \desc The glyph section starts after the header and widgets, padded so that
+ * the glyphs are suitably aligned.
+ */
+static size_t LayoutGlyphOffset(size_t num_widgets)
+{
+    const size_t offset =
+        sizeof(LayoutHeader) + sizeof(LayoutWidget) * num_widgets;
+    const size_t align = _Alignof(Glyph);
+
+    return (offset + align - 1) / align * align;
+}
+
+/**
+ * \desc Appends an empty glyph to the builder, doubling its capacity when full.
+ */
+static Glyph* LayoutPushGlyph(LayoutBuilder* builder)
+{
+    if (builder->num_glyphs == builder->cap_glyphs)
+    {
+        builder->cap_glyphs =
+            builder->cap_glyphs ? builder->cap_glyphs << 1 : 256;
+        builder->glyphs =
+            Reallocate(builder->glyphs, sizeof(Glyph) * builder->cap_glyphs);
+    }
+
+    Glyph* glyph = &builder->glyphs[builder->num_glyphs++];
+    *glyph = (Glyph){0};
+    return glyph;
+}
+
+/**
+ * \desc Appends copies of a set of glyphs to the builder.
+ */
+static void LayoutPushGlyphs(LayoutBuilder* builder, const Vector* glyphs)
+{
+    for (size_t i = 0; i < VectorLength(glyphs); ++i)
+    {
+        *LayoutPushGlyph(builder) = *(const Glyph*)VectorAt(glyphs, i);
+    }
+}
+
+/**
+ * \desc Appends an empty widget to the builder, doubling its capacity when
+ * full. Its glyphs start at the current end of the glyph array.
+ */
+static LayoutWidget* LayoutPushWidget(LayoutBuilder* builder)
+{
+    if (builder->num_widgets == builder->cap_widgets)
+    {
+        builder->cap_widgets =
+            builder->cap_widgets ? builder->cap_widgets << 1 : 32;
+        builder->widgets = Reallocate(
+            builder->widgets, sizeof(LayoutWidget) * builder->cap_widgets);
+    }
+
+    LayoutWidget* widget = &builder->widgets[builder->num_widgets++];
+    *widget = (LayoutWidget){0};
+    widget->first_glyph = (u32)builder->num_glyphs;
+    return widget;
+}
+
+/**
+ * \desc Splits a line in place into whitespace separated tokens. A token which
+ * starts with a double quote runs until the closing quote, so that text may
+ * contain spaces; the quotes themselves are dropped. A hash outside of quotes
+ * starts a comment.
+ */
+static size_t LayoutTokenise(char* line, char** tokens)
+{
+    size_t count = 0;
+    char* c = line;
+
+    while (*c && count < LAYOUT_MAX_TOKENS)
+    {
+        while (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n')
+        {
+            c++;
+        }
+
+        if (*c == '\0' || *c == '#')
+        {
+            break;
+        }
+
+        if (*c == '"')
+        {
+            tokens[count++] = ++c;
+            while (*c && *c != '"')
+            {
+                c++;
+            }
+        }
+        else
+        {
+            tokens[count++] = c;
+            while (*c && *c != ' ' && *c != '\t' && *c != '\r' && *c != '\n')
+            {
+                c++;
+            }
+        }
+
+        if (*c)
+        {
+            *c++ = '\0';
+        }
+    }
+
+    return count;
+}
+
+/**
+ * \desc Parses a colour by its name in graphics/color.h.
+ */
+static bool LayoutParseColor(const char* token, SDL_Color* col)
+{
+    for (size_t i = 0; i < 24; ++i)
+    {
+        if (strcmp(token, LAYOUT_COLOR_NAMES[i]) == 0)
+        {
+            *col = COLORS[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * \desc Parses a border type: none, single or double.
+ */
+static bool LayoutParseBorder(const char* token, Border* border)
+{
+    if (strcmp(token, "none") == 0)
+    {
+        *border = BORDER_NONE;
+    }
+    else if (strcmp(token, "single") == 0)
+    {
+        *border = BORDER_SINGLE;
+    }
+    else if (strcmp(token, "double") == 0)
+    {
+        *border = BORDER_DOUBLE;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \desc Parses a boolean: true or false.
+ */
+static bool LayoutParseBool(const char* token, bool* value)
+{
+    *value = strcmp(token, "true") == 0;
+    return *value || strcmp(token, "false") == 0;
+}
+
+/**
+ * \desc Parses a base-10 integer which must make up the whole token.
+ */
+static bool LayoutParseInt(const char* token, i32* value)
+{
+    char* end = NULL;
+    *value = (i32)strtol(token, &end, 10);
+    return end != token && *end == '\0';
+}
+
+/**
+ * \desc Parses a selector type as selection flags joined by a bar, e.g.
+ * "foreground|background".
+ */
+static bool LayoutParseSelector(const char* token, SelectorType* type)
+{
+    char flags[LAYOUT_MAX_TEXT] = {0};
+    snprintf(flags, sizeof(flags), "%s", token);
+
+    *type = SELECTOR_NONE;
+    for (char* flag = strtok(flags, "|"); flag; flag = strtok(NULL, "|"))
+    {
+        if (strcmp(flag, "index") == 0)
+        {
+            *type |= SELECTOR_INDEX;
+        }
+        else if (strcmp(flag, "foreground") == 0)
+        {
+            *type |= SELECTOR_FOREGROUND;
+        }
+        else if (strcmp(flag, "background") == 0)
+        {
+            *type |= SELECTOR_BACKGROUND;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return *type != SELECTOR_NONE;
+}
+
+/**
+ * \desc Builds the glyphs of a selector from one of the built-in sources: the
+ * 16x16 table of glyph indices, or 2x2 swatches of the first 16 colours laid
+ * out in rows of eight.
+ */
+static bool LayoutBuildSelector(LayoutBuilder* builder, const char* source,
+                                SDL_Rect rect)
+{
+    if (strcmp(source, "glyphs") == 0)
+    {
+        for (i32 i = 0; i < 16; ++i)
+        {
+            for (i32 j = 0; j < 16; ++j)
+            {
+                Glyph* glyph = LayoutPushGlyph(builder);
+                glyph->x = i + rect.x;
+                glyph->y = j + rect.y;
+                glyph->fg = LIGHTGREY;
+                glyph->bg = BLACK;
+                glyph->index = i + j * 16;
+            }
+        }
+
+        return true;
+    }
+
+    if (strcmp(source, "colors") == 0)
+    {
+        i32 x = 0, y = 0;
+        const i32 dx[4] = {0, 1, 0, 1};
+        const i32 dy[4] = {0, 0, 1, 1};
+        for (i32 i = 0; i < 16; ++i)
+        {
+            if (i > 0 && i % 8 == 0)
+            {
+                x = 0;
+                y += 2;
+            }
+
+            for (i32 j = 0; j < 4; ++j)
+            {
+                Glyph* glyph = LayoutPushGlyph(builder);
+                glyph->x = rect.x + x + dx[j];
+                glyph->y = rect.y + y + dy[j];
+                glyph->fg = COLORS[i];
+                glyph->bg = COLORS[i];
+                glyph->index = FILLED;
+            }
+
+            x += 2;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * \desc Compiles a single tokenised line into a widget and its glyphs. The
+ * first four fields are common to every type: type, identifier, tab and render
+ * order. The remaining fields depend on the type:
+ *
+ *   button   x y border text_col bord_col active "text"
+ *   canvas   x y w h writable index fg bg
+ *   label    x y fg bg "text"
+ *   minimap  x y w h
+ *   panel    x y w h border col
+ *   selector x y w h type source
+ *   stamps   x y w h
+ *   browser  x y w h
+ *
+ * Panel, label and button glyphs are built by their own constructors so that
+ * they are identical to widgets created in code.
+ */
+static bool LayoutCompileLine(LayoutBuilder* builder, char** t, size_t n)
+{
+    if (n < 6 || strlen(t[1]) >= LAYOUT_MAX_ID)
+    {
+        return false;
+    }
+
+    LayoutWidget* widget = LayoutPushWidget(builder);
+    strcpy(widget->id, t[1]);
+
+    i32 tab = 0;
+    bool ok = LayoutParseInt(t[2], &tab) && LayoutParseInt(t[3], &widget->z) &&
+              LayoutParseInt(t[4], &widget->rect.x) &&
+              LayoutParseInt(t[5], &widget->rect.y);
+    widget->tab = (u32)tab;
+
+    if (ok && strcmp(t[0], "button") == 0 && n == 11 &&
+        strlen(t[10]) < LAYOUT_MAX_TEXT)
+    {
+        widget->type = WIDGET_BUTTON;
+        strcpy(widget->text, t[10]);
+        ok = LayoutParseBorder(t[6], &widget->border) &&
+             LayoutParseColor(t[7], &widget->fg) &&
+             LayoutParseColor(t[8], &widget->bg) &&
+             LayoutParseBool(t[9], &widget->flag);
+
+        if (ok)
+        {
+            Button* button =
+                ButtonCreate(widget->rect.x, widget->rect.y, widget->text,
+                             widget->border, widget->fg, widget->bg, true);
+            widget->rect = button->panel->rect;
+            widget->num_glyphs = (u32)VectorLength(button->label->glyphs);
+            widget->num_border_glyphs =
+                (u32)VectorLength(button->panel->glyphs);
+            LayoutPushGlyphs(builder, button->label->glyphs);
+            LayoutPushGlyphs(builder, button->panel->glyphs);
+            ButtonFree(button);
+        }
+    }
+    else if (ok && strcmp(t[0], "canvas") == 0 && n == 12)
+    {
+        widget->type = WIDGET_CANVAS;
+        i32 index = 0;
+        ok = LayoutParseInt(t[6], &widget->rect.w) &&
+             LayoutParseInt(t[7], &widget->rect.h) &&
+             LayoutParseBool(t[8], &widget->flag) &&
+             LayoutParseInt(t[9], &index) && index >= 0 && index < 256 &&
+             LayoutParseColor(t[10], &widget->fg) &&
+             LayoutParseColor(t[11], &widget->bg);
+
+        for (i32 i = 0; ok && i < widget->rect.w; ++i)
+        {
+            for (i32 j = 0; j < widget->rect.h; ++j)
+            {
+                Glyph* glyph = LayoutPushGlyph(builder);
+                glyph->x = i + widget->rect.x;
+                glyph->y = j + widget->rect.y;
+                glyph->fg = widget->fg;
+                glyph->bg = widget->bg;
+                glyph->index = index;
+            }
+        }
+    }
+    else if (ok && strcmp(t[0], "label") == 0 && n == 9 &&
+             strlen(t[8]) < LAYOUT_MAX_TEXT)
+    {
+        widget->type = WIDGET_LABEL;
+        strcpy(widget->text, t[8]);
+        ok = LayoutParseColor(t[6], &widget->fg) &&
+             LayoutParseColor(t[7], &widget->bg);
+
+        if (ok)
+        {
+            Label* label = LabelCreate(widget->rect.x, widget->rect.y,
+                                       widget->text, widget->fg, widget->bg);
+            widget->rect.w = (i32)strlen(widget->text);
+            widget->rect.h = 1;
+            LayoutPushGlyphs(builder, label->glyphs);
+            LabelFree(label);
+        }
+    }
+    else if (ok && strcmp(t[0], "minimap") == 0 && n == 8)
+    {
+        widget->type = WIDGET_MINIMAP;
+        ok = LayoutParseInt(t[6], &widget->rect.w) &&
+             LayoutParseInt(t[7], &widget->rect.h);
+    }
+    else if (ok && strcmp(t[0], "stamps") == 0 && n == 8)
+    {
+        widget->type = WIDGET_STAMPS;
+        ok = LayoutParseInt(t[6], &widget->rect.w) &&
+             LayoutParseInt(t[7], &widget->rect.h);
+    }
+    else if (ok && strcmp(t[0], "browser") == 0 && n == 8)
+    {
+        widget->type = WIDGET_BROWSER;
+        ok = LayoutParseInt(t[6], &widget->rect.w) &&
+             LayoutParseInt(t[7], &widget->rect.h);
+    }
+    else if (ok && strcmp(t[0], "panel") == 0 && n == 10)
+    {
+        widget->type = WIDGET_PANEL;
+        ok = LayoutParseInt(t[6], &widget->rect.w) &&
+             LayoutParseInt(t[7], &widget->rect.h) &&
+             LayoutParseBorder(t[8], &widget->border) &&
+             LayoutParseColor(t[9], &widget->fg);
+
+        if (ok)
+        {
+            Panel* panel =
+                PanelCreate(widget->rect, widget->border, widget->fg);
+            widget->num_border_glyphs = (u32)VectorLength(panel->glyphs);
+            LayoutPushGlyphs(builder, panel->glyphs);
+            PanelFree(panel);
+        }
+    }
+    else if (ok && strcmp(t[0], "selector") == 0 && n == 10)
+    {
+        widget->type = WIDGET_SELECTOR;
+        ok = LayoutParseInt(t[6], &widget->rect.w) &&
+             LayoutParseInt(t[7], &widget->rect.h) &&
+             LayoutParseSelector(t[8], &widget->selector) &&
+             LayoutBuildSelector(builder, t[9], widget->rect);
+    }
+    else
+    {
+        ok = false;
+    }
+
+    if (!ok)
+    {
+        builder->num_glyphs = widget->first_glyph;
+        builder->num_widgets--;
+        return false;
+    }
+
+    if (widget->type != WIDGET_BUTTON && widget->type != WIDGET_PANEL)
+    {
+        widget->num_glyphs = (u32)(builder->num_glyphs - widget->first_glyph);
+    }
+
+    return true;
+}
+
+/**
+ * \desc Reads the layout text line by line, compiling each widget line and
+ * logging (then skipping) any line which cannot be parsed. The widgets and
+ * glyphs are then packed behind a header into a single blob, which is the exact
+ * image later written to and mapped from the cache.
+ */
+[[nodiscard]] void* LayoutCompile(const char* path, size_t* size)
+{
+    *size = 0;
+
+    i64 source_size = 0, source_mtime = 0;
+    FILE* file = fopen(path, "r");
+    if (file == NULL || !FileStat(path, &source_size, &source_mtime))
+    {
+        Log(LOG_ERROR, "Could not open layout %s!", path);
+        if (file)
+        {
+            fclose(file);
+        }
+        return NULL;
+    }
+
+    LayoutBuilder builder = {0};
+    char line[512] = {0};
+    u32 line_number = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        line_number++;
+
+        char* tokens[LAYOUT_MAX_TOKENS] = {0};
+        const size_t n = LayoutTokenise(line, tokens);
+        if (n == 0)
+        {
+            continue;
+        }
+
+        if (!LayoutCompileLine(&builder, tokens, n))
+        {
+            Log(LOG_ERROR, "%s:%u: invalid %s widget!", path, line_number,
+                tokens[0]);
+        }
+    }
+    fclose(file);
+
+    const size_t glyph_offset = LayoutGlyphOffset(builder.num_widgets);
+    *size = glyph_offset + sizeof(Glyph) * builder.num_glyphs;
+
+    u8* blob = Allocate(*size);
+    LayoutHeader* header = (LayoutHeader*)blob;
+    memcpy(header->magic, LAYOUT_MAGIC, sizeof(header->magic));
+    header->version = LAYOUT_VERSION;
+    header->widget_size = sizeof(LayoutWidget);
+    header->glyph_size = sizeof(Glyph);
+    header->source_size = source_size;
+    header->source_mtime = source_mtime;
+    header->num_widgets = (u32)builder.num_widgets;
+    header->num_glyphs = (u32)builder.num_glyphs;
+
+    if (builder.num_widgets)
+    {
+        memcpy(blob + sizeof(LayoutHeader), builder.widgets,
+               sizeof(LayoutWidget) * builder.num_widgets);
+    }
+
+    if (builder.num_glyphs)
+    {
+        memcpy(blob + glyph_offset, builder.glyphs,
+               sizeof(Glyph) * builder.num_glyphs);
+    }
+
+    if (builder.widgets)
+    {
+        Free(builder.widgets);
+    }
+    if (builder.glyphs)
+    {
+        Free(builder.glyphs);
+    }
+
+    return blob;
+}
+
+/**
+ * \desc A widget is only valid if it is of a type which is instantiated, its
+ * identifier and text are terminated within their fields, and its glyphs, the
+ * content followed by the border, lie within the glyph section. The glyph
+ * range is summed in 64 bits, so that no count can wrap it back into range.
+ */
+static bool LayoutValidateWidget(const LayoutWidget* widget, u32 num_glyphs)
+{
+    switch (widget->type)
+    {
+    case WIDGET_BUTTON:
+    case WIDGET_CANVAS:
+    case WIDGET_LABEL:
+    case WIDGET_PANEL:
+    case WIDGET_SELECTOR:
+    case WIDGET_MINIMAP:
+    case WIDGET_STAMPS:
+    case WIDGET_BROWSER:
+        break;
+
+    default:
+        return false;
+    }
+
+    if (memchr(widget->id, '\0', sizeof(widget->id)) == NULL ||
+        memchr(widget->text, '\0', sizeof(widget->text)) == NULL)
+    {
+        return false;
+    }
+
+    return (u64)widget->first_glyph + widget->num_glyphs +
+               widget->num_border_glyphs <=
+           num_glyphs;
+}
+
+/**
+ * \desc A blob is only valid for a source if it was compiled by this build from
+ * the exact source size and modification time, if it is large enough to hold
+ * every section the header claims, and if every widget is valid, as the blob
+ * is read straight from the cache file.
+ */
+static bool LayoutValidate(const void* data, size_t size, i64 source_size,
+                           i64 source_mtime)
+{
+    if (size < sizeof(LayoutHeader))
+    {
+        return false;
+    }
+
+    const LayoutHeader* header = data;
+    if (memcmp(header->magic, LAYOUT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != LAYOUT_VERSION ||
+        header->widget_size != sizeof(LayoutWidget) ||
+        header->glyph_size != sizeof(Glyph) ||
+        header->source_size != source_size ||
+        header->source_mtime != source_mtime)
+    {
+        return false;
+    }
+
+    if (size < LayoutGlyphOffset(header->num_widgets) +
+                   sizeof(Glyph) * header->num_glyphs)
+    {
+        return false;
+    }
+
+    const LayoutWidget* widgets =
+        (const LayoutWidget*)((const u8*)data + sizeof(LayoutHeader));
+    for (u32 i = 0; i < header->num_widgets; ++i)
+    {
+        if (!LayoutValidateWidget(&widgets[i], header->num_glyphs))
+        {
+            Log(LOG_WARNING, "Invalid widget %u in layout cache", i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * \desc Attempts to map the cache of the layout first. If the cache is missing
+ * or stale, the text is compiled and the result written to the cache for the
+ * next load. Should writing the cache fail, the compiled blob is used straight
+ * from memory.
+ */
+[[nodiscard]] Layout* LayoutLoad(const char* path)
+{
+    char cache[256] = {0};
+    snprintf(cache, sizeof(cache), "%s%s", path, LAYOUT_CACHE_EXTENSION);
+
+    i64 source_size = 0, source_mtime = 0;
+    if (!FileStat(path, &source_size, &source_mtime))
+    {
+        Log(LOG_ERROR, "No such layout %s", path);
+        return NULL;
+    }
+
+    Layout* layout = Allocate(sizeof(Layout));
+    layout->data = FileMap(cache, &layout->size);
+    layout->mapped = layout->data != NULL;
+
+    if (layout->mapped && !LayoutValidate(layout->data, layout->size,
+                                          source_size, source_mtime))
+    {
+        FileUnmap(layout->data, layout->size);
+        layout->data = NULL;
+        layout->mapped = false;
+    }
+
+    if (!layout->mapped)
+    {
+        layout->data = LayoutCompile(path, &layout->size);
+        if (layout->data == NULL)
+        {
+            Free(layout);
+            return NULL;
+        }
+
+        FILE* file = fopen(cache, "wb");
+        if (file == NULL ||
+            fwrite(layout->data, 1, layout->size, file) != layout->size)
+        {
+            Log(LOG_WARNING, "Could not write layout cache %s", cache);
+        }
+
+        if (file)
+        {
+            fclose(file);
+        }
+    }
+
+    const u8* blob = layout->data;
+    layout->header = (const LayoutHeader*)blob;
+    layout->widgets = (const LayoutWidget*)(blob + sizeof(LayoutHeader));
+    layout->glyphs =
+        (const Glyph*)(blob + LayoutGlyphOffset(layout->header->num_widgets));
+
+    return layout;
+}
+
+/**
+ * \desc Unmaps a mapped blob, or frees a compiled one, then the layout itself.
+ */
+void LayoutFree(Layout* layout)
+{
+    if (layout->mapped)
+    {
+        FileUnmap(layout->data, layout->size);
+    }
+    else
+    {
+        Free(layout->data);
+    }
+
+    Free(layout);
+}
+
+/**
+ * \desc Copies a run of compiled glyphs into a glyph vector, which is sized up
+ * front to hold exactly that many glyphs.
+ */
+static void LayoutLoadGlyphs(const Layout* layout, Vector* glyphs, u32 first,
+                             u32 count)
+{
+    VectorResize(glyphs, count);
+    for (u32 i = 0; i < count; ++i)
+    {
+        Glyph* glyph = GlyphCreate();
+        *glyph = layout->glyphs[first + i];
+        VectorPush(glyphs, glyph);
+    }
+}
+
+/**
+ * \desc Creates every widget of the layout in one pass. Each component is made
+ * without glyphs of its own and then given the prebuilt glyphs from the blob,
+ * so nothing is generated at start-up; canvases store the glyphs as cells. The
+ * widget vector is sized once for all of the widgets.
+ */
+void LayoutInstantiate(const Layout* layout, Vector* widgets)
+{
+    VectorResize(widgets, VectorLength(widgets) + layout->header->num_widgets);
+
+    for (u32 i = 0; i < layout->header->num_widgets; ++i)
+    {
+        const LayoutWidget* lw = &layout->widgets[i];
+        void* data = NULL;
+
+        switch (lw->type)
+        {
+        case WIDGET_BUTTON: {
+            Button* button = ButtonCreate(lw->rect.x, lw->rect.y, "",
+                                          BORDER_NONE, lw->fg, lw->bg,
+                                          lw->flag);
+            button->panel->rect = lw->rect;
+            button->panel->border = lw->border;
+            button->panel->col = lw->bg;
+            button->label->x = lw->border == BORDER_NONE ? lw->rect.x
+                                                         : lw->rect.x + 1;
+            button->label->y = lw->border == BORDER_NONE ? lw->rect.y
+                                                         : lw->rect.y + 1;
+            strcpy(button->label->text, lw->text);
+            LayoutLoadGlyphs(layout, button->label->glyphs, lw->first_glyph,
+                             lw->num_glyphs);
+            LayoutLoadGlyphs(layout, button->panel->glyphs,
+                             lw->first_glyph + lw->num_glyphs,
+                             lw->num_border_glyphs);
+            data = button;
+            break;
+        }
+
+        case WIDGET_CANVAS: {
+            Canvas* canvas = CanvasCreate(lw->rect, lw->flag);
+            for (u32 j = 0; j < lw->num_glyphs; ++j)
+            {
+                const Glyph* glyph = &layout->glyphs[lw->first_glyph + j];
+                const i32 x = (i32)glyph->x - lw->rect.x;
+                const i32 y = (i32)glyph->y - lw->rect.y;
+                const Cell cell = {(u8)glyph->index, glyph->fg, glyph->bg};
+                ChunkStoreSet(canvas->cells, x, y, cell);
+            }
+            data = canvas;
+            break;
+        }
+
+        case WIDGET_LABEL: {
+            Label* label =
+                LabelCreate(lw->rect.x, lw->rect.y, "", lw->fg, lw->bg);
+            strcpy(label->text, lw->text);
+            LayoutLoadGlyphs(layout, label->glyphs, lw->first_glyph,
+                             lw->num_glyphs);
+            data = label;
+            break;
+        }
+
+        case WIDGET_MINIMAP:
+            data = MinimapCreate(lw->rect);
+            break;
+
+        case WIDGET_STAMPS:
+            data = StampLibraryCreate(lw->rect);
+            break;
+
+        case WIDGET_BROWSER:
+            data = BrowserCreate(lw->rect);
+            break;
+
+        case WIDGET_PANEL: {
+            Panel* panel = PanelCreate(lw->rect, BORDER_NONE, lw->fg);
+            panel->border = lw->border;
+            panel->col = lw->fg;
+            LayoutLoadGlyphs(layout, panel->glyphs, lw->first_glyph,
+                             lw->num_border_glyphs);
+            data = panel;
+            break;
+        }
+
+        case WIDGET_SELECTOR: {
+            Selector* selector = SelectorCreate(lw->rect, lw->selector);
+            LayoutLoadGlyphs(layout, selector->glyphs, lw->first_glyph,
+                             lw->num_glyphs);
+            data = selector;
+            break;
+        }
+
+        default:
+            continue;
+        }
+
+        VectorPush(widgets,
+                   WidgetCreate(lw->id, lw->type, data, lw->tab, lw->z));
+    }
+}
@@ -0,0 +1,297 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file minimap.c
+ *
+ * \brief A minimap shows the whole of a map at (at most) one pixel per cell,
+ * with the part of the map shown by the canvas outlined. Clicking on it moves
+ * the canvas to the clicked cell.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "ui/minimap.h"
+
+/**
+ * \desc The colour of a cell is the one it shows from afar, as in thumbnails,
+ * packed in the format of the texture.
+ */
+static u32 MinimapColor(Cell cell)
+{
+    const SDL_Color col = ThumbnailCellColor(cell);
+
+    return (u32)col.r << 24 | (u32)col.g << 16 | (u32)col.b << 8 | col.a;
+}
+
+/**
+ * \desc Allocates a minimap with no map. It is given a size when a canvas is
+ * attached to it.
+ */
+[[nodiscard]] Minimap* MinimapCreate(SDL_Rect rect)
+{
+    Minimap* minimap = Allocate(sizeof(Minimap));
+    minimap->rect = rect;
+    minimap->dest = (SDL_Rect){0};
+    minimap->texture = NULL;
+    minimap->pixels = NULL;
+    minimap->width = 0;
+    minimap->height = 0;
+    minimap->span_min = NULL;
+    minimap->span_max = NULL;
+    minimap->row_min = 0;
+    minimap->row_max = -1;
+    minimap->full = true;
+    minimap->viewport = (SDL_Rect){0};
+    minimap->target = (SDL_Point){0};
+    minimap->jump = false;
+
+    return minimap;
+}
+
+/**
+ * \desc Frees the texture and buffers of the minimap, then the minimap itself.
+ */
+void MinimapFree(Minimap* minimap)
+{
+    if (minimap->texture)
+    {
+        SDL_DestroyTexture(minimap->texture);
+    }
+
+    if (minimap->pixels)
+    {
+        Free(minimap->pixels);
+        Free(minimap->span_min);
+        Free(minimap->span_max);
+    }
+
+    Free(minimap);
+}
+
+/**
+ * \desc The texture is only recreated if the size of the map changes. Either
+ * way, the whole of it is copied when the minimap is next rendered.
+ */
+void MinimapResize(Minimap* minimap, i32 width, i32 height)
+{
+    if (minimap->texture && (width != minimap->width ||
+                             height != minimap->height))
+    {
+        SDL_DestroyTexture(minimap->texture);
+        minimap->texture = NULL;
+    }
+
+    if (minimap->pixels)
+    {
+        Free(minimap->pixels);
+        Free(minimap->span_min);
+        Free(minimap->span_max);
+        minimap->pixels = NULL;
+    }
+
+    minimap->width = SDL_max(width, 0);
+    minimap->height = SDL_max(height, 0);
+    minimap->row_min = 0;
+    minimap->row_max = -1;
+    minimap->full = true;
+
+    if (minimap->width && minimap->height)
+    {
+        minimap->pixels =
+            Allocate(sizeof(u32) * (size_t)(minimap->width * minimap->height));
+        minimap->span_min = Allocate(sizeof(i32) * (size_t)minimap->height);
+        minimap->span_max = Allocate(sizeof(i32) * (size_t)minimap->height);
+    }
+}
+
+/**
+ * \desc Writes the colour of the cell into the buffer and widens the changed
+ * span of its row, if the colour changed at all.
+ */
+void MinimapSetCell(Minimap* minimap, i32 x, i32 y, Cell cell)
+{
+    if (x < 0 || y < 0 || x >= minimap->width || y >= minimap->height)
+    {
+        return;
+    }
+
+    u32* pixel = &minimap->pixels[x + y * minimap->width];
+    const u32 color = MinimapColor(cell);
+    if (*pixel == color)
+    {
+        return;
+    }
+    *pixel = color;
+
+    if (minimap->full)
+    {
+        return;
+    }
+
+    if (minimap->row_min > minimap->row_max)
+    {
+        minimap->row_min = y;
+        minimap->row_max = y;
+        minimap->span_min[y] = x;
+        minimap->span_max[y] = x;
+    }
+    else if (y < minimap->row_min || y > minimap->row_max ||
+             minimap->span_min[y] > minimap->span_max[y])
+    {
+        for (i32 j = y; j < minimap->row_min; ++j)
+        {
+            minimap->span_min[j] = minimap->width;
+            minimap->span_max[j] = -1;
+        }
+        for (i32 j = minimap->row_max + 1; j <= y; ++j)
+        {
+            minimap->span_min[j] = minimap->width;
+            minimap->span_max[j] = -1;
+        }
+        minimap->row_min = SDL_min(minimap->row_min, y);
+        minimap->row_max = SDL_max(minimap->row_max, y);
+        minimap->span_min[y] = x;
+        minimap->span_max[y] = x;
+    }
+    else
+    {
+        minimap->span_min[y] = SDL_min(minimap->span_min[y], x);
+        minimap->span_max[y] = SDL_max(minimap->span_max[y], x);
+    }
+}
+
+/**
+ * \desc Whilst the left mouse button is down over the drawn map, the cell under
+ * the mouse becomes the target, and the jump flag is set for the editor to move
+ * the canvas there.
+ */
+void MinimapHandleInput(Minimap* minimap, const Input* input)
+{
+    if (minimap->dest.w <= 0 || minimap->dest.h <= 0 ||
+        !InputMouseDown(input, SDL_BUTTON_LEFT))
+    {
+        return;
+    }
+
+    const SDL_Point mouse = InputMousePos();
+    if (!SDL_PointInRect(&mouse, &minimap->dest))
+    {
+        return;
+    }
+
+    minimap->target.x =
+        (mouse.x - minimap->dest.x) * minimap->width / minimap->dest.w;
+    minimap->target.y =
+        (mouse.y - minimap->dest.y) * minimap->height / minimap->dest.h;
+    minimap->jump = true;
+}
+
+/**
+ * \desc Copies the changed pixels of the buffer into the texture, creating it
+ * if required. Each changed span is locked and written on its own, so a single
+ * edit costs a single pixel however large the map.
+ */
+static bool MinimapUpload(Minimap* minimap, const Window* wind)
+{
+    if (minimap->texture == NULL)
+    {
+        minimap->texture = SDL_CreateTexture(
+            wind->sdl_renderer, SDL_PIXELFORMAT_RGBA8888,
+            SDL_TEXTUREACCESS_STREAMING, minimap->width, minimap->height);
+        if (minimap->texture == NULL)
+        {
+            Log(LOG_WARNING, "Could not create minimap texture: %s",
+                SDL_GetError());
+            return false;
+        }
+
+        SDL_SetTextureBlendMode(minimap->texture, SDL_BLENDMODE_BLEND);
+        minimap->full = true;
+    }
+
+    if (minimap->full)
+    {
+        SDL_UpdateTexture(minimap->texture, NULL, minimap->pixels,
+                          minimap->width * (i32)sizeof(u32));
+        minimap->full = false;
+        minimap->row_min = 0;
+        minimap->row_max = -1;
+        return true;
+    }
+
+    for (i32 y = minimap->row_min; y <= minimap->row_max; ++y)
+    {
+        if (minimap->span_min[y] > minimap->span_max[y])
+        {
+            continue;
+        }
+
+        SDL_Rect span = {0};
+        span.x = minimap->span_min[y];
+        span.y = y;
+        span.w = minimap->span_max[y] - minimap->span_min[y] + 1;
+        span.h = 1;
+
+        void* pixels = NULL;
+        i32 pitch = 0;
+        if (SDL_LockTexture(minimap->texture, &span, &pixels, &pitch) == 0)
+        {
+            memcpy(pixels, &minimap->pixels[span.x + y * minimap->width],
+                   sizeof(u32) * (size_t)span.w);
+            SDL_UnlockTexture(minimap->texture);
+        }
+    }
+
+    minimap->row_min = 0;
+    minimap->row_max = -1;
+    return true;
+}
+
+/**
+ * \desc The map is drawn centred in the minimap area, scaled down to fit if it
+ * is larger than it but never scaled up. The viewport is outlined over it, and
+ * the previous draw colour restored afterwards.
+ */
+void MinimapRender(Minimap* minimap, const Window* wind, const Texture* tex)
+{
+    if (minimap->pixels == NULL || !MinimapUpload(minimap, wind))
+    {
+        minimap->dest = (SDL_Rect){0};
+        return;
+    }
+
+    const i32 area_w = minimap->rect.w * tex->glyph_w;
+    const i32 area_h = minimap->rect.h * tex->glyph_h;
+    const f32 scale =
+        SDL_min(SDL_min((f32)area_w / minimap->width,
+                        (f32)area_h / minimap->height),
+                1.0f);
+
+    minimap->dest.w = SDL_max((i32)(minimap->width * scale), 1);
+    minimap->dest.h = SDL_max((i32)(minimap->height * scale), 1);
+    minimap->dest.x = minimap->rect.x * tex->glyph_w +
+                      (area_w - minimap->dest.w) / 2;
+    minimap->dest.y = minimap->rect.y * tex->glyph_h +
+                      (area_h - minimap->dest.h) / 2;
+    SDL_RenderCopy(wind->sdl_renderer, minimap->texture, NULL, &minimap->dest);
+
+    SDL_Rect outline = {0};
+    outline.x = minimap->dest.x +
+                minimap->viewport.x * minimap->dest.w / minimap->width;
+    outline.y = minimap->dest.y +
+                minimap->viewport.y * minimap->dest.h / minimap->height;
+    outline.w = minimap->viewport.w * minimap->dest.w / minimap->width;
+    outline.h = minimap->viewport.h * minimap->dest.h / minimap->height;
+    outline.w = SDL_max(outline.w, 1);
+    outline.h = SDL_max(outline.h, 1);
+
+    u8 r = 0, g = 0, b = 0, a = 0;
+    SDL_GetRenderDrawColor(wind->sdl_renderer, &r, &g, &b, &a);
+    SDL_SetRenderDrawColor(wind->sdl_renderer, LIGHTGREY.r, LIGHTGREY.g,
+                           LIGHTGREY.b, LIGHTGREY.a);
+    SDL_RenderDrawRect(wind->sdl_renderer, &outline);
+    SDL_SetRenderDrawColor(wind->sdl_renderer, r, g, b, a);
+}
@@ -0,0 +1,290 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file stamps.c
+ *
+ * \brief A stamp is a block of cells copied from a canvas, kept so that it can
+ * be placed again elsewhere. The stamp library shows every stamp as a
+ * thumbnail, from which one may be picked to place.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "ui/stamps.h"
+
+/**
+ * \desc The stamp takes the cells as they are. Its texture is not created until
+ * the stamp is first drawn, as that requires a window.
+ */
+[[nodiscard]] Stamp* StampCreate(Cell* cells, i32 width, i32 height)
+{
+    Stamp* stamp = Allocate(sizeof(Stamp));
+    stamp->cells = cells;
+    stamp->width = width;
+    stamp->height = height;
+    stamp->texture = NULL;
+    stamp->tex = NULL;
+
+    return stamp;
+}
+
+/**
+ * \desc Destroys the texture, if it was ever rendered, and frees the cells and
+ * then the stamp itself.
+ */
+void StampFree(Stamp* stamp)
+{
+    if (stamp->texture)
+    {
+        SDL_DestroyTexture(stamp->texture);
+    }
+
+    Free(stamp->cells);
+    Free(stamp);
+}
+
+/**
+ * \desc Renders every cell of the stamp into a texture of its own, at the full
+ * size of the glyphs, restoring the render target and draw colour afterwards.
+ */
+static bool StampRenderTexture(Stamp* stamp, const Window* wind,
+                               const Texture* tex)
+{
+    if (stamp->texture)
+    {
+        SDL_DestroyTexture(stamp->texture);
+    }
+
+    stamp->texture = SDL_CreateTexture(
+        wind->sdl_renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+        stamp->width * tex->glyph_w, stamp->height * tex->glyph_h);
+    if (stamp->texture == NULL)
+    {
+        Log(LOG_WARNING, "Could not create stamp texture: %s", SDL_GetError());
+        return false;
+    }
+
+    SDL_SetTextureBlendMode(stamp->texture, SDL_BLENDMODE_BLEND);
+    stamp->tex = tex;
+
+    u8 r = 0, g = 0, b = 0, a = 0;
+    SDL_Texture* target = SDL_GetRenderTarget(wind->sdl_renderer);
+    SDL_GetRenderDrawColor(wind->sdl_renderer, &r, &g, &b, &a);
+    SDL_SetRenderTarget(wind->sdl_renderer, stamp->texture);
+    SDL_SetRenderDrawColor(wind->sdl_renderer, 0, 0, 0, 0);
+    SDL_RenderClear(wind->sdl_renderer);
+
+    for (i32 y = 0; y < stamp->height; ++y)
+    {
+        for (i32 x = 0; x < stamp->width; ++x)
+        {
+            const Cell cell = stamp->cells[x + y * stamp->width];
+            Glyph glyph = {0};
+            glyph.index = cell.index;
+            glyph.fg = cell.fg;
+            glyph.bg = cell.bg;
+
+            const SDL_Rect dest = {x * tex->glyph_w, y * tex->glyph_h,
+                                   tex->glyph_w, tex->glyph_h};
+            GlyphRenderTo(&glyph, wind, tex, dest);
+        }
+    }
+
+    SDL_SetRenderTarget(wind->sdl_renderer, target);
+    SDL_SetRenderDrawColor(wind->sdl_renderer, r, g, b, a);
+
+    return true;
+}
+
+/**
+ * \desc However many cells the stamp has, it is drawn with a single copy of its
+ * texture, which is only rendered the first time or when the glyph texture has
+ * changed.
+ */
+void StampRender(Stamp* stamp, const Window* wind, const Texture* tex,
+                 SDL_Rect dest, u8 alpha)
+{
+    if ((stamp->texture == NULL || stamp->tex != tex) &&
+        !StampRenderTexture(stamp, wind, tex))
+    {
+        return;
+    }
+
+    SDL_SetTextureAlphaMod(stamp->texture, alpha);
+    SDL_RenderCopy(wind->sdl_renderer, stamp->texture, NULL, &dest);
+}
+
+/**
+ * \desc Allocates an empty library with nothing selected.
+ */
+[[nodiscard]] StampLibrary* StampLibraryCreate(SDL_Rect rect)
+{
+    StampLibrary* library = Allocate(sizeof(StampLibrary));
+    library->rect = rect;
+    library->count = 0;
+    library->selected = -1;
+    library->changed = false;
+
+    return library;
+}
+
+/**
+ * \desc Frees every stamp and then the library itself.
+ */
+void StampLibraryFree(StampLibrary* library)
+{
+    for (size_t i = 0; i < library->count; ++i)
+    {
+        StampFree(library->stamps[i]);
+    }
+
+    Free(library);
+}
+
+/**
+ * \desc The library never drops a stamp to make room, as that would lose work
+ * without asking; a full library logs a warning instead.
+ */
+bool StampLibraryAdd(StampLibrary* library, Stamp* stamp)
+{
+    if (library->count == STAMPS_MAX)
+    {
+        Log(LOG_WARNING, "The stamp library is full!");
+        StampFree(stamp);
+        return false;
+    }
+
+    library->stamps[library->count++] = stamp;
+    StampLibrarySelect(library, (i32)library->count - 1);
+
+    return true;
+}
+
+/**
+ * \desc The stamps after the removed one move down to fill its place, and the
+ * selection is cleared.
+ */
+void StampLibraryRemoveSelected(StampLibrary* library)
+{
+    if (library->selected < 0)
+    {
+        return;
+    }
+
+    const size_t index = (size_t)library->selected;
+    StampFree(library->stamps[index]);
+    memmove(&library->stamps[index], &library->stamps[index + 1],
+            sizeof(Stamp*) * (library->count - index - 1));
+    library->count--;
+    StampLibrarySelect(library, -1);
+}
+
+/**
+ * \desc Indices out of range select nothing. The changed flag is only set if
+ * the selection really changed.
+ */
+void StampLibrarySelect(StampLibrary* library, i32 index)
+{
+    if (index < 0 || (size_t)index >= library->count)
+    {
+        index = -1;
+    }
+
+    if (library->selected != index)
+    {
+        library->selected = index;
+        library->changed = true;
+    }
+}
+
+/**
+ * \desc Looks up the stamp at the selected index.
+ */
+[[nodiscard]] Stamp* StampLibrarySelected(const StampLibrary* library)
+{
+    return library->selected < 0 ? NULL : library->stamps[library->selected];
+}
+
+/**
+ * \desc Finds the thumbnail clicked on, if any. The thumbnails fill the rows of
+ * the library from left to right.
+ */
+void StampLibraryHandleInput(StampLibrary* library, const Input* input)
+{
+    if (!InputMousePressed(input, SDL_BUTTON_LEFT) ||
+        !InputMouseWithin(input, library->rect))
+    {
+        return;
+    }
+
+    const SDL_Point mouse = InputMouseSnapToGlyph(input);
+    const i32 columns = SDL_max(library->rect.w / STAMP_THUMB_SIZE, 1);
+    const i32 column = (mouse.x - library->rect.x) / STAMP_THUMB_SIZE;
+    const i32 row = (mouse.y - library->rect.y) / STAMP_THUMB_SIZE;
+    if (column >= columns)
+    {
+        return;
+    }
+
+    const i32 index = column + row * columns;
+    if ((size_t)index < library->count)
+    {
+        StampLibrarySelect(library, index == library->selected ? -1 : index);
+    }
+}
+
+/**
+ * \desc Each stamp is scaled to fit its thumbnail, keeping its aspect ratio,
+ * and centred within it. The selected thumbnail is outlined, and the previous
+ * draw colour restored afterwards.
+ */
+void StampLibraryRender(StampLibrary* library, const Window* wind,
+                        const Texture* tex)
+{
+    const i32 columns = SDL_max(library->rect.w / STAMP_THUMB_SIZE, 1);
+    const i32 size_w = STAMP_THUMB_SIZE * tex->glyph_w;
+    const i32 size_h = STAMP_THUMB_SIZE * tex->glyph_h;
+
+    for (size_t i = 0; i < library->count; ++i)
+    {
+        Stamp* stamp = library->stamps[i];
+        const i32 column = (i32)i % columns;
+        const i32 row = (i32)i / columns;
+        if ((row + 1) * STAMP_THUMB_SIZE > library->rect.h)
+        {
+            break;
+        }
+
+        SDL_Rect thumb = {0};
+        thumb.x = (library->rect.x + column * STAMP_THUMB_SIZE) * tex->glyph_w;
+        thumb.y = (library->rect.y + row * STAMP_THUMB_SIZE) * tex->glyph_h;
+        thumb.w = size_w;
+        thumb.h = size_h;
+
+        const i32 stamp_w = stamp->width * tex->glyph_w;
+        const i32 stamp_h = stamp->height * tex->glyph_h;
+        const f32 scale = SDL_min(SDL_min((f32)(size_w - 2) / stamp_w,
+                                          (f32)(size_h - 2) / stamp_h),
+                                  1.0f);
+
+        SDL_Rect dest = {0};
+        dest.w = SDL_max((i32)(stamp_w * scale), 1);
+        dest.h = SDL_max((i32)(stamp_h * scale), 1);
+        dest.x = thumb.x + (size_w - dest.w) / 2;
+        dest.y = thumb.y + (size_h - dest.h) / 2;
+        StampRender(stamp, wind, tex, dest, 255);
+
+        if ((i32)i == library->selected)
+        {
+            u8 r = 0, g = 0, b = 0, a = 0;
+            SDL_GetRenderDrawColor(wind->sdl_renderer, &r, &g, &b, &a);
+            SDL_SetRenderDrawColor(wind->sdl_renderer, LIGHTGREY.r,
+                                   LIGHTGREY.g, LIGHTGREY.b, LIGHTGREY.a);
+            SDL_RenderDrawRect(wind->sdl_renderer, &thumb);
+            SDL_SetRenderDrawColor(wind->sdl_renderer, r, g, b, a);
+        }
+    }
+}
@@ -0,0 +1,128 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file view.c
+ *
+ * \brief A view is a pane onto a canvas, with its own area of the window,
+ * scroll position and zoom level. Views draw from the caches of their canvas,
+ * so that any number of them may show the same canvas for little more than the
+ * cost of copying the chunks they overlap.
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "ui/view.h"
+
+/**
+ * \desc Allocates the view and clamps its zoom level. The glyph size of the
+ * texture is kept so that the view knows how many cells it shows.
+ */
+[[nodiscard]] View* ViewCreate(Canvas* canvas, SDL_Rect rect, i32 zoom,
+                               const Texture* tex)
+{
+    View* view = Allocate(sizeof(View));
+    view->canvas = canvas;
+    view->rect = rect;
+    view->origin = (SDL_Point){0, 0};
+    view->glyph = (SDL_Point){tex->glyph_w, tex->glyph_h};
+    view->zoom = SDL_min(SDL_max(zoom, CANVAS_ZOOM_MIN), CANVAS_ZOOM_MAX);
+
+    return view;
+}
+
+/**
+ * \desc Frees the view itself; the canvas belongs to its document.
+ */
+void ViewFree(View* view) { Free(view); }
+
+/**
+ * \desc Nothing is done unless the mouse is over the view. The mouse wheel
+ * zooms with control held, scrolls horizontally with shift held and otherwise
+ * scrolls vertically. The operation of the canvas is only set from the cell
+ * under the mouse, and never reset, as the canvas may be shown elsewhere.
+ */
+void ViewHandleInput(View* view, const Input* input)
+{
+    if (!InputMouseWithin(input, view->rect))
+    {
+        return;
+    }
+
+    if (input->mouse_wheel && input->curr_mod_map & KMOD_CTRL)
+    {
+        ViewZoom(view, view->zoom + (input->mouse_wheel > 0 ? 1 : -1));
+    }
+    else if (input->mouse_wheel && input->curr_mod_map & KMOD_SHIFT)
+    {
+        ViewScroll(view, -input->mouse_wheel * VIEW_SCROLL_STEP, 0);
+    }
+    else if (input->mouse_wheel)
+    {
+        ViewScroll(view, 0, -input->mouse_wheel * VIEW_SCROLL_STEP);
+    }
+
+    size_t index = 0;
+    if (CanvasCellAt(view->canvas, input, view->rect, view->origin,
+                     view->zoom, &index))
+    {
+        CanvasHandleCellInput(view->canvas, input, index);
+    }
+}
+
+/**
+ * \desc Refreshing the canvas does nothing if it is already up to date, so
+ * only the first view of a canvas to be rendered in a frame redraws anything.
+ */
+void ViewRender(View* view, const Window* wind, const Texture* tex)
+{
+    CanvasRefresh(view->canvas, wind, tex);
+    CanvasBlit(view->canvas, wind, tex, view->rect, view->origin, view->zoom);
+}
+
+/**
+ * \desc The origin is clamped so that the view never scrolls past the last row
+ * or column of cells, given the number of cells it shows at its zoom level.
+ */
+void ViewScroll(View* view, i32 dx, i32 dy)
+{
+    const i32 cell_w = CanvasZoomSize(view->glyph.x, view->zoom);
+    const i32 cell_h = CanvasZoomSize(view->glyph.y, view->zoom);
+    const i32 cols = view->rect.w * view->glyph.x / cell_w;
+    const i32 rows = view->rect.h * view->glyph.y / cell_h;
+    const i32 max_x = SDL_max(view->canvas->cells->width - cols, 0);
+    const i32 max_y = SDL_max(view->canvas->cells->height - rows, 0);
+
+    view->origin.x = SDL_min(SDL_max(view->origin.x + dx, 0), max_x);
+    view->origin.y = SDL_min(SDL_max(view->origin.y + dy, 0), max_y);
+}
+
+/**
+ * \desc The cell at the centre of the view is found at the old zoom level, and
+ * the origin moved so that it is at the centre again at the new one.
+ */
+void ViewZoom(View* view, i32 zoom)
+{
+    zoom = SDL_min(SDL_max(zoom, CANVAS_ZOOM_MIN), CANVAS_ZOOM_MAX);
+    if (zoom == view->zoom)
+    {
+        return;
+    }
+
+    const i32 half_w = view->rect.w * view->glyph.x / 2;
+    const i32 half_h = view->rect.h * view->glyph.y / 2;
+    const i32 old_w = CanvasZoomSize(view->glyph.x, view->zoom);
+    const i32 old_h = CanvasZoomSize(view->glyph.y, view->zoom);
+    const i32 new_w = CanvasZoomSize(view->glyph.x, zoom);
+    const i32 new_h = CanvasZoomSize(view->glyph.y, zoom);
+
+    const i32 centre_x = view->origin.x + half_w / old_w;
+    const i32 centre_y = view->origin.y + half_h / old_h;
+
+    view->zoom = zoom;
+    view->origin.x = centre_x - half_w / new_w;
+    view->origin.y = centre_y - half_h / new_h;
+    ViewScroll(view, 0, 0);
+}
@@ -61,6 +61,18 @@ void WidgetFree(Widget* widget)
         SelectorFree((Selector*)widget->data);
         break;
 
+    case WIDGET_MINIMAP:
+        MinimapFree((Minimap*)widget->data);
+        break;
+
+    case WIDGET_STAMPS:
+        StampLibraryFree((StampLibrary*)widget->data);
+        break;
+
+    case WIDGET_BROWSER:
+        BrowserFree((Browser*)widget->data);
+        break;
+
     default:
         break;
     }
@@ -88,6 +100,18 @@ void WidgetHandleInput(const Widget* widget, const Input* input)
         SelectorHandleInput((Selector*)widget->data, input);
         break;
 
+    case WIDGET_MINIMAP:
+        MinimapHandleInput((Minimap*)widget->data, input);
+        break;
+
+    case WIDGET_STAMPS:
+        StampLibraryHandleInput((StampLibrary*)widget->data, input);
+        break;
+
+    case WIDGET_BROWSER:
+        BrowserHandleInput((Browser*)widget->data, input);
+        break;
+
     case WIDGET_LABEL:
         [[fallthrough]];
 
@@ -159,6 +183,18 @@ void WidgetRender(const Widget* widget, const Window* wind, const Texture* tex)
         SelectorRender((Selector*)widget->data, wind, tex);
         break;
 
+    case WIDGET_MINIMAP:
+        MinimapRender((Minimap*)widget->data, wind, tex);
+        break;
+
+    case WIDGET_STAMPS:
+        StampLibraryRender((StampLibrary*)widget->data, wind, tex);
+        break;
+
+    case WIDGET_BROWSER:
+        BrowserRender((Browser*)widget->data, wind, tex);
+        break;
+
     default:
         break;
     }
@@ -0,0 +1,219 @@
+/* =============================================================================
+ *   Karte
+ * ========================================================================== */
+
+/**
+ * \file phashgen.c
+ *
+ * \brief A build-step tool which reads a fixed set of keys (one per line) and
+ * emits a C header containing a minimal perfect hash table for those keys. The
+ * header is consumed through the functions in memory/phash.h.
+ *
+ * Usage: phashgen <input.keys> <output.h>
+ *
+ * \author Anthony Mercer
+ *
+ */
+
+#include "core/common.h"
+#include "core/utils.h"
+#include "memory/phash.h"
+
+u32 g_mem_allocs = 0;
+
+/**
+ * \desc The maximum length of a key, matching the widget identifier length.
+ */
+#define PHASHGEN_MAX_KEY 256
+
+/**
+ * \brief A key set read from an input file.
+ */
+typedef struct
+{
+    size_t count;
+    char** keys;
+} KeySet;
+
+/**
+ * \desc Reads the key file line by line. Trailing whitespace is stripped and
+ * blank lines or lines beginning with a hash are skipped. Keys are emitted as C
+ * string literals, so quotes and backslashes are rejected, as are duplicates.
+ */
+static KeySet ReadKeys(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+        Log(LOG_FATAL, "Could not open key file %s!", path);
+    }
+
+    KeySet set = {0};
+    size_t capacity = 16;
+    set.keys = Allocate(sizeof(char*) * capacity);
+
+    char line[PHASHGEN_MAX_KEY] = {0};
+    while (fgets(line, sizeof(line), file))
+    {
+        size_t length = strlen(line);
+        while (length > 0 && (line[length - 1] == '\n' ||
+                              line[length - 1] == '\r' ||
+                              line[length - 1] == ' ' ||
+                              line[length - 1] == '\t'))
+        {
+            line[--length] = '\0';
+        }
+
+        if (length == 0 || line[0] == '#')
+        {
+            continue;
+        }
+
+        if (StringContains(line, '"') || StringContains(line, '\\'))
+        {
+            Log(LOG_FATAL, "Key \"%s\" in %s contains an invalid character!",
+                line, path);
+        }
+
+        for (size_t i = 0; i < set.count; ++i)
+        {
+            if (strcmp(set.keys[i], line) == 0)
+            {
+                Log(LOG_FATAL, "Duplicate key \"%s\" in %s!", line, path);
+            }
+        }
+
+        if (set.count == capacity)
+        {
+            char** keys = Allocate(sizeof(char*) * (capacity << 1));
+            memcpy(keys, set.keys, sizeof(char*) * capacity);
+            Free(set.keys);
+            set.keys = keys;
+            capacity <<= 1;
+        }
+
+        set.keys[set.count] = Allocate(length + 1);
+        memcpy(set.keys[set.count], line, length + 1);
+        set.count++;
+    }
+
+    fclose(file);
+    return set;
+}
+
+/**
+ * \desc The table name is the upper-cased file name of the key file, without
+ * its directory or extension, e.g. res/keys/widget_ids.keys is WIDGET_IDS.
+ */
+static void TableName(const char* path, char* dest, size_t size)
+{
+    const char* base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+
+    size_t i = 0;
+    for (; base[i] && base[i] != '.' && i < size - 1; ++i)
+    {
+        const char c = base[i];
+        dest[i] = (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A')
+                  : (c == '-')           ? '_'
+                                         : c;
+    }
+    dest[i] = '\0';
+}
+
+/**
+ * \desc Writes the generated header. The header only contains static constant
+ * data, so it can be included from any translation unit which needs the table.
+ */
+static void WriteHeader(const char* in_path, const char* out_path,
+                        const char* name, size_t count, size_t num_buckets,
+                        const u32* displacements, const KeySet* set,
+                        const u32* slots)
+{
+    FILE* file = fopen(out_path, "w");
+    if (file == NULL)
+    {
+        Log(LOG_FATAL, "Could not open output file %s!", out_path);
+    }
+
+    const char* base = strrchr(out_path, '/');
+    base = base ? base + 1 : out_path;
+
+    fprintf(file,
+            "/* ============================================================"
+            "=================\n"
+            " *   Karte\n"
+            " * ==========================================================="
+            "=============== */\n\n");
+    fprintf(file, "/**\n * \\file %s\n *\n", base);
+    fprintf(file,
+            " * \\brief Minimal perfect hash table generated by phashgen from\n"
+            " * %s.\n *\n"
+            " * Do not edit by hand: change the key file and rebuild.\n",
+            in_path);
+    fprintf(file, " *\n */\n\n");
+
+    fprintf(file, "#ifndef GENERATED_%s_H\n#define GENERATED_%s_H\n\n", name,
+            name);
+    fprintf(file, "#include \"memory/phash.h\"\n\n");
+    fprintf(file, "#define %s_COUNT %zu\n\n", name, count);
+
+    fprintf(file, "static const u32 %s_DISPLACEMENTS[%zu] = {\n    ", name,
+            num_buckets);
+    for (size_t b = 0; b < num_buckets; ++b)
+    {
+        fprintf(file, "%u%s", displacements[b],
+                b + 1 == num_buckets ? "};\n\n"
+                : (b + 1) % 8        ? ", "
+                                     : ",\n    ");
+    }
+
+    fprintf(file, "static const char* const %s_KEYS[%zu] = {\n", name,
+            count ? count : 1);
+    for (size_t i = 0; i < count; ++i)
+    {
+        fprintf(file, "    \"%s\",\n", set->keys[slots[i]]);
+    }
+    fprintf(file, "%s};\n\n", count ? "" : "    \"\",\n");
+
+    fprintf(file, "static const PerfectHash %s = {\n", name);
+    fprintf(file, "    %s_COUNT, %zu, %s_DISPLACEMENTS, %s_KEYS};\n\n", name,
+            num_buckets, name, name);
+    fprintf(file, "#endif\n");
+
+    fclose(file);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        Log(LOG_FATAL, "Usage: phashgen <input.keys> <output.h>");
+    }
+
+    KeySet set = ReadKeys(argv[1]);
+    const size_t num_buckets = set.count > 1 ? (set.count + 1) / 2 : 1;
+
+    u32* displacements = Allocate(sizeof(u32) * num_buckets);
+    u32* slots = Allocate(sizeof(u32) * (set.count ? set.count : 1));
+    if (!PerfectHashGenerate((const char* const*)set.keys, set.count,
+                             num_buckets, displacements, slots))
+    {
+        Log(LOG_FATAL, "Could not find a displacement for every bucket!");
+    }
+
+    char name[PHASHGEN_MAX_KEY] = {0};
+    TableName(argv[1], name, sizeof(name));
+    WriteHeader(argv[1], argv[2], name, set.count, num_buckets, displacements,
+                &set, slots);
+
+    for (size_t i = 0; i < set.count; ++i)
+    {
+        Free(set.keys[i]);
+    }
+    Free(slots);
+    Free(displacements);
+    Free(set.keys);
+
+    return EXIT_SUCCESS;
+}